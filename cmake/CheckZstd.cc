@@ -0,0 +1,31 @@
+/** -*- C++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <stdio.h>
+#include <zstd.h>
+#include <zdict.h>
+
+
+int main() {
+  char output[64];
+  if (ZSTD_isError(ZSTD_compress(output, sizeof(output), "hello world", 12, 3)))
+    return 1;
+  printf("%s\n", ZSTD_versionString());
+  return 0;
+}
@@ -68,7 +68,8 @@ endmacro()
 HT_INSTALL_LIBS(lib ${BOOST_LIBS} ${Thrift_LIBS}
                 ${Kfs_LIBRARIES} ${Mapr_LIBRARIES} ${LibEvent_LIB}
                 ${EXPAT_LIBRARIES} ${BZIP2_LIBRARIES}
-                ${ZLIB_LIBRARIES} ${SNAPPY_LIBRARY} ${SIGAR_LIBRARY} ${Tcmalloc_LIBRARIES}
+                ${ZLIB_LIBRARIES} ${SNAPPY_LIBRARY} ${LZ4_LIBRARY} ${ZSTD_LIBRARY}
+                ${SIGAR_LIBRARY} ${Tcmalloc_LIBRARIES}
                 ${Jemalloc_LIBRARIES} ${Ceph_LIBRARIES} ${RE2_LIBRARIES}
                 ${EDITLINE_LIBRARIES})
 
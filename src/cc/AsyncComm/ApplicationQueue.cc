@@ -0,0 +1,217 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/** @file
+ * Definitions for ApplicationQueue.
+ * This file contains method definitions for ApplicationQueue, a work-stealing
+ * application request queue.
+ */
+
+#include <Common/Compat.h>
+
+#include "ApplicationQueue.h"
+
+using namespace Hypertable;
+using namespace std;
+
+ApplicationQueue::ApplicationQueueState::ApplicationQueueState(size_t queue_count) {
+  if (queue_count == 0)
+    queue_count = 1;
+  worker_queues.reserve(queue_count);
+  for (size_t i=0; i<queue_count; ++i)
+    worker_queues.push_back(make_unique<WorkerQueue>());
+}
+
+void ApplicationQueue::ApplicationQueueState::enqueue(RequestRec *rec,
+                                                      size_t hint) {
+  if (rec->handler->is_urgent()) {
+    {
+      lock_guard<std::mutex> lock(urgent_mutex);
+      urgent_queue.push_back(rec);
+    }
+    urgent_queued++;
+  }
+  else {
+    WorkerQueue &wq = *worker_queues[hint % worker_queues.size()];
+    {
+      lock_guard<std::mutex> lock(wq.mutex);
+      wq.queue.push_back(rec);
+    }
+    queued++;
+  }
+
+  // Idle workers increment threads_available before checking for runnable
+  // requests, so either they see the request or we see them
+  if (threads_available > 0) {
+    lock_guard<std::mutex> lock(mutex);
+    cond.notify_one();
+  }
+}
+
+ApplicationQueue::RequestRec *
+ApplicationQueue::ApplicationQueueState::dequeue(size_t index) {
+  RequestRec *rec;
+
+  if (urgent_queued > 0) {
+    lock_guard<std::mutex> lock(urgent_mutex);
+    if (!urgent_queue.empty()) {
+      rec = urgent_queue.front();
+      urgent_queue.pop_front();
+      urgent_queued--;
+      waiting--;
+      return rec;
+    }
+  }
+
+  if (paused || queued == 0)
+    return nullptr;
+
+  size_t count = worker_queues.size();
+  for (size_t i=0; i<count; ++i) {
+    WorkerQueue &wq = *worker_queues[(index + i) % count];
+    lock_guard<std::mutex> lock(wq.mutex);
+    if (wq.queue.empty())
+      continue;
+    if (i == 0) {
+      rec = wq.queue.front();
+      wq.queue.pop_front();
+    }
+    else {
+      rec = wq.queue.back();
+      wq.queue.pop_back();
+    }
+    queued--;
+    waiting--;
+    return rec;
+  }
+  return nullptr;
+}
+
+void ApplicationQueue::ApplicationQueueState::remove(RequestRec *rec,
+                                                     size_t index) {
+  GroupState *group_state = rec->group_state;
+  RequestRec *next {};
+  vector<RequestRec *> expired;
+
+  if (group_state) {
+    GroupShard &shard = group_shard(group_state->group_id);
+    lock_guard<std::mutex> lock(shard.mutex);
+    group_state->outstanding--;
+    while (group_state->outstanding > 0) {
+      RequestQueue &pending = group_state->urgent_pending.empty() ?
+        group_state->pending : group_state->urgent_pending;
+      next = pending.front();
+      pending.pop_front();
+      if (!next->handler->is_expired())
+        break;
+      expired.push_back(next);
+      next = nullptr;
+      group_state->outstanding--;
+      waiting--;
+    }
+    if (next == nullptr) {
+      group_state->running = false;
+      if (group_state->outstanding == 0) {
+        shard.group_state_map.erase(group_state->group_id);
+        delete group_state;
+      }
+    }
+  }
+
+  if (next)
+    enqueue(next, index);
+
+  for (auto expired_rec : expired)
+    delete expired_rec;
+  delete rec;
+}
+
+void ApplicationQueue::Worker::operator()() {
+  RequestRec *rec;
+
+  while (true) {
+
+    if ((rec = m_state.dequeue(m_index)) == nullptr) {
+      if (m_one_shot)
+        return;
+      unique_lock<std::mutex> lock(m_state.mutex);
+      m_state.threads_available++;
+      while (!m_state.runnable()) {
+        if (m_state.shutdown) {
+          m_state.threads_available--;
+          return;
+        }
+        if (m_state.threads_available == m_state.threads_total)
+          m_state.quiesce_cond.notify_all();
+        m_state.cond.wait(lock);
+      }
+      m_state.threads_available--;
+      continue;
+    }
+
+    rec->handler->run();
+    m_state.remove(rec, m_index);
+    if (m_one_shot)
+      return;
+  }
+}
+
+void ApplicationQueue::add(ApplicationHandler *app_handler) {
+  HT_ASSERT(app_handler);
+
+  uint64_t group_id = app_handler->get_group_id();
+  RequestRec *rec = new RequestRec(app_handler);
+
+  m_state.waiting++;
+
+  if (group_id != 0) {
+    GroupShard &shard = m_state.group_shard(group_id);
+    lock_guard<std::mutex> lock(shard.mutex);
+    GroupStateMap::iterator uiter = shard.group_state_map.find(group_id);
+    if (uiter != shard.group_state_map.end()) {
+      rec->group_state = (*uiter).second;
+      rec->group_state->outstanding++;
+    }
+    else {
+      rec->group_state = new GroupState();
+      rec->group_state->group_id = group_id;
+      shard.group_state_map[group_id] = rec->group_state;
+    }
+    // Held in the group until the running request completes
+    if (rec->group_state->running) {
+      if (app_handler->is_urgent())
+        rec->group_state->urgent_pending.push_back(rec);
+      else
+        rec->group_state->pending.push_back(rec);
+      return;
+    }
+    rec->group_state->running = true;
+  }
+
+  bool urgent = app_handler->is_urgent();
+
+  m_state.enqueue(rec, m_state.next_queue++);
+
+  if (urgent && m_dynamic_threads && m_state.threads_available == 0) {
+    Worker worker(m_state, m_state.next_queue++, true);
+    Thread t(worker);
+  }
+}
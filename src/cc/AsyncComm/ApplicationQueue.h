@@ -35,9 +35,11 @@
 #include <Common/StringExt.h>
 #include <Common/Thread.h>
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
@@ -85,9 +87,27 @@ namespace Hypertable {
    * deadlocks when the application queue gets paused due to low memory
    * condition in the RangeServer.  The ApplicationHandler#is_urgent
    * method is used to signal if a request is urgent.
+   *
+   * <b>Scheduling</b>
+   *
+   * Each worker thread has its own request deque.  Added requests are
+   * distributed round-robin across the deques and a worker takes requests
+   * from the front of its own deque, stealing from the back of the other
+   * deques when its own is empty.  Urgent requests go on a single shared
+   * urgent queue that workers check first.  Only requests that are ready to
+   * run are placed on these queues.  A request whose group is running is
+   * held in a FIFO queue in its GroupState and is placed on a worker deque
+   * when the preceding request in the group completes, so group scheduling
+   * takes constant time regardless of how many requests are waiting.
    */
   class ApplicationQueue : public ApplicationQueueInterface {
 
+    class RequestRec;
+
+    /** Individual request queue
+     */
+    typedef std::deque<RequestRec *> RequestQueue;
+
     /** Tracks group execution state.
      * A GroupState object is created for each unique group ID to track the
      * queue execution state of requests in the group.
@@ -96,10 +116,15 @@ namespace Hypertable {
     public:
       GroupState() : group_id(0), running(false), outstanding(1) { return; }
       uint64_t group_id;    //!< Group ID
-      /** <i>true</i> if a request from this group is being executed */
+      /** <i>true</i> if a request from this group is queued or being
+       * executed */
       bool     running;
       /** Number of outstanding (uncompleted) requests in queue for this group*/
       int      outstanding;
+      /** Urgent requests waiting for the running request to complete */
+      RequestQueue urgent_pending;
+      /** Requests waiting for the running request to complete */
+      RequestQueue pending;
     };
 
     /** Hash map of thread group ID to GroupState
@@ -116,27 +141,109 @@ namespace Hypertable {
       GroupState *group_state;     //!< Pointer to GroupState to which request belongs
     };
 
-    /** Individual request queue
+    /** Partition of the group state map.
+     */
+    class GroupShard {
+    public:
+      /// %Mutex for serializing access to #group_state_map and the
+      /// GroupState objects it contains
+      std::mutex mutex;
+      /// Group ID to group state map
+      GroupStateMap group_state_map;
+    };
+
+    /** Worker request deque.
      */
-    typedef std::list<RequestRec *> RequestQueue;
+    class WorkerQueue {
+    public:
+      /// %Mutex for serializing access to #queue
+      std::mutex mutex;
+      /// Requests ready to run
+      RequestQueue queue;
+    };
 
     /** Application queue state shared among worker threads.
      */
     class ApplicationQueueState {
     public:
-      ApplicationQueueState() : threads_available(0), shutdown(false),
-                                paused(false) { }
 
-      /// Normal request queue
-      RequestQueue queue;
+      /// Number of group state map partitions
+      static const size_t GROUP_SHARDS = 64;
+
+      /** Constructor.
+       * @param queue_count Number of worker request deques
+       */
+      ApplicationQueueState(size_t queue_count=1);
+
+      /** Places a runnable request on a request queue.
+       * Urgent requests are placed on #urgent_queue, other requests on the
+       * back of the worker deque selected by <code>hint</code>.  Wakes up
+       * an idle worker thread if there is one.
+       * @param rec Request record
+       * @param hint Worker deque hint
+       */
+      void enqueue(RequestRec *rec, size_t hint);
+
+      /** Removes the next request to run.
+       * Checks the urgent queue first.  If the queue is not paused, then
+       * checks the front of worker deque <code>index</code> followed by the
+       * back of the other worker deques.
+       * @param index Index of worker deque to check first
+       * @return Request record or nullptr if there are no runnable requests
+       */
+      RequestRec *dequeue(size_t index);
+
+      /** Finishes a request.  If the request belongs to a group, the next
+       * request waiting in the group is placed on worker deque
+       * <code>index</code>, skipping (and removing) expired requests.  If no
+       * requests are waiting, the group's running flag is cleared and the
+       * group state is removed once its outstanding count drops to 0.
+       * @param rec Request record to remove
+       * @param index Worker deque of the calling thread
+       */
+      void remove(RequestRec *rec, size_t index);
+
+      /** Checks if there is a request that can be run.
+       * @return <i>true</i> if there is a runnable request, <i>false</i>
+       * otherwise
+       */
+      bool runnable() const {
+        return urgent_queued > 0 || (!paused && queued > 0);
+      }
+
+      /** Returns the group state partition for a group ID.
+       * @param group_id Group ID
+       * @return Group state partition
+       */
+      GroupShard &group_shard(uint64_t group_id) {
+        return group_shards[(group_id * 0x9E3779B97F4A7C15ULL) >> 58];
+      }
+
+      /// Worker request deques
+      std::vector<std::unique_ptr<WorkerQueue>> worker_queues;
+
+      /// %Mutex for serializing access to #urgent_queue
+      std::mutex urgent_mutex;
 
       /// Urgent request queue
       RequestQueue urgent_queue;
 
-      /// Group ID to group state map
-      GroupStateMap group_state_map;
+      /// Group state map partitions
+      GroupShard group_shards[GROUP_SHARDS];
+
+      /// Number of requests on the worker deques
+      std::atomic<size_t> queued {};
+
+      /// Number of requests on the urgent queue
+      std::atomic<size_t> urgent_queued {};
+
+      /// Number of requests waiting to be run
+      std::atomic<size_t> waiting {};
 
-      /// %Mutex for serializing concurrent access
+      /// Round-robin counter for distributing requests across worker deques
+      std::atomic<size_t> next_queue {};
+
+      /// %Mutex for idle thread synchronization
       std::mutex mutex;
 
       /// Condition variable to signal pending handlers
@@ -146,16 +253,16 @@ namespace Hypertable {
       std::condition_variable quiesce_cond;
 
       /// Idle thread count
-      size_t threads_available;
+      std::atomic<size_t> threads_available {};
       
       /// Total initial threads
-      size_t threads_total;
+      size_t threads_total {};
 
       /// Flag indicating if shutdown is in progress
-      bool shutdown;
+      std::atomic<bool> shutdown {};
 
       /// Flag indicating if queue has been paused
-      bool paused;
+      std::atomic<bool> paused {};
     };
 
     /** Application queue worker thread function (functor)
@@ -163,146 +270,21 @@ namespace Hypertable {
     class Worker {
 
     public:
-      Worker(ApplicationQueueState &qstate, bool one_shot=false) 
-      : m_state(qstate), m_one_shot(one_shot) { return; }
+      Worker(ApplicationQueueState &qstate, size_t index, bool one_shot=false) 
+        : m_state(qstate), m_index(index), m_one_shot(one_shot) { return; }
 
       /** Thread run method
        */
-      void operator()() {
-        RequestRec *rec = 0;
-        RequestQueue::iterator iter;
-
-        while (true) {
-          {
-            std::unique_lock<std::mutex> lock(m_state.mutex);
-
-            m_state.threads_available++;
-            while ((m_state.paused || m_state.queue.empty()) &&
-                   m_state.urgent_queue.empty()) {
-              if (m_state.shutdown) {
-                m_state.threads_available--;
-                return;
-              }
-              if (m_state.threads_available == m_state.threads_total)
-                m_state.quiesce_cond.notify_all();
-              m_state.cond.wait(lock);
-            }
-
-            if (m_state.shutdown) {
-              m_state.threads_available--;
-              return;
-            }
-
-            rec = 0;
-
-            iter = m_state.urgent_queue.begin();
-            while (iter != m_state.urgent_queue.end()) {
-              rec = (*iter);
-              if (rec->group_state == 0 || !rec->group_state->running) {
-                if (rec->group_state)
-                  rec->group_state->running = true;
-                m_state.urgent_queue.erase(iter);
-                break;
-              }
-              if (!rec->handler || rec->handler->is_expired()) {
-                iter = m_state.urgent_queue.erase(iter);
-                remove_expired(rec);
-              }
-              rec = 0;
-              iter++;
-            }
-
-            if (rec == 0 && !m_state.paused) {
-              iter = m_state.queue.begin();
-              while (iter != m_state.queue.end()) {
-                rec = (*iter);
-                if (rec->group_state == 0 || !rec->group_state->running) {
-                  if (rec->group_state)
-                    rec->group_state->running = true;
-                  m_state.queue.erase(iter);
-                  break;
-                }
-                if (!rec->handler || rec->handler->is_expired()) {
-                  iter = m_state.queue.erase(iter);
-                  remove_expired(rec);
-                }
-                rec = 0;
-                iter++;
-              }
-            }
-
-            if (rec == 0 && !m_one_shot) {
-              if (m_state.shutdown) {
-                m_state.threads_available--;
-                return;
-              }
-              m_state.cond.wait(lock);
-              if (m_state.shutdown) {
-                m_state.threads_available--;
-                return;
-              }
-            }
-
-            m_state.threads_available--;
-          }
-
-          if (rec) {
-            if (rec->handler)
-              rec->handler->run();
-            remove(rec);
-            if (m_one_shot)
-              return;
-          }
-          else if (m_one_shot)
-            return;
-        }
-
-        HT_INFO("thread exit");
-      }
+      void operator()();
 
     private:
 
-      /** Removes and deletes a request.  This method updates the group
-       * state associated with <code>rec</code> by setting the running flag to
-       * <i>false</i> and decrementing the outstanding count.  If the
-       * outstanding count for the group drops to 0, the group state record
-       * is removed from ApplicationQueueState::group_state_map and is deleted.
-       * @param rec Request record to remove
-       */
-      void remove(RequestRec *rec) {
-        if (rec->group_state) {
-          std::lock_guard<std::mutex> ulock(m_state.mutex);
-          rec->group_state->running = false;
-          rec->group_state->outstanding--;
-          if (rec->group_state->outstanding == 0) {
-            m_state.group_state_map.erase(rec->group_state->group_id);
-            delete rec->group_state;
-          }
-        }
-        delete rec;
-      }
-
-      /** Removes and deletes an expired request.  This method updates the group
-       * state associated with <code>rec</code> by decrementing the outstanding
-       * count.  If the outstanding count for the group drops to 0, the group
-       * state record is removed from ApplicationQueueState::group_state_map and
-       * is deleted.
-       * @param rec Request record to remove
-       */
-      void remove_expired(RequestRec *rec) {
-        if (rec->group_state) {
-          rec->group_state->outstanding--;
-          if (rec->group_state->outstanding == 0) {
-            m_state.group_state_map.erase(rec->group_state->group_id);
-            delete rec->group_state;
-          }
-        }
-        delete rec;
-      }
-
       /// Shared application queue state object
       ApplicationQueueState &m_state;
 
+      /// Index of worker deque owned by this thread
+      size_t m_index;
+
       /// Set to <i>true</i> if thread should exit after executing request
       bool m_one_shot;
     };
@@ -333,20 +315,21 @@ namespace Hypertable {
     /**
      * Constructor initialized with worker thread count.
      * This constructor sets up the application queue with a number of worker
-     * threads specified by <code>worker_count</code>.
+     * threads specified by <code>worker_count</code>, each with its own
+     * request deque.
      * @param worker_count Number of worker threads to create
      * @param dynamic_threads Dynamically create temporary thread to carry out
      * requests if none available.
      */
     ApplicationQueue(int worker_count, bool dynamic_threads=true) 
-      : joined(false), m_dynamic_threads(dynamic_threads) {
+      : m_state(worker_count), joined(false),
+        m_dynamic_threads(dynamic_threads) {
       m_state.threads_total = worker_count;
-      Worker Worker(m_state);
       assert (worker_count > 0);
       for (int i=0; i<worker_count; ++i) {
-        m_thread_ids.push_back(m_threads.create_thread(Worker)->get_id());
+        Worker worker(m_state, i);
+        m_thread_ids.push_back(m_threads.create_thread(worker)->get_id());
       }
-      //threads
     }
 
     /** Destructor.
@@ -372,6 +355,7 @@ namespace Hypertable {
      * completion of the shutdown.
      */
     void shutdown() {
+      std::lock_guard<std::mutex> lock(m_state.mutex);
       m_state.shutdown = true;
       m_state.cond.notify_all();
     }
@@ -425,42 +409,7 @@ namespace Hypertable {
      * Event object.
      * @param app_handler Pointer to request to add
      */
-    virtual void add(ApplicationHandler *app_handler) {
-      GroupStateMap::iterator uiter;
-      uint64_t group_id = app_handler->get_group_id();
-      RequestRec *rec = new RequestRec(app_handler);
-      rec->group_state = 0;
-
-      HT_ASSERT(app_handler);
-
-      if (group_id != 0) {
-        std::lock_guard<std::mutex> ulock(m_state.mutex);
-        if ((uiter = m_state.group_state_map.find(group_id))
-            != m_state.group_state_map.end()) {
-          rec->group_state = (*uiter).second;
-          rec->group_state->outstanding++;
-        }
-        else {
-          rec->group_state = new GroupState();
-          rec->group_state->group_id = group_id;
-          m_state.group_state_map[group_id] = rec->group_state;
-        }
-      }
-
-      {
-        std::lock_guard<std::mutex> lock(m_state.mutex);
-        if (app_handler->is_urgent()) {
-          m_state.urgent_queue.push_back(rec);
-          if (m_dynamic_threads && m_state.threads_available == 0) {
-            Worker worker(m_state, true);
-            Thread t(worker);
-          }
-        }
-        else
-          m_state.queue.push_back(rec);
-        m_state.cond.notify_one();
-      }
-    }
+    virtual void add(ApplicationHandler *app_handler);
 
     /** Adds a request (application request handler) to the application queue.
      * The request queue is designed to support the serialization of related
@@ -479,8 +428,7 @@ namespace Hypertable {
     /// the request queues for a thread to become available
     /// @return Request backlog
     size_t backlog() {
-      std::lock_guard<std::mutex> lock(m_state.mutex);
-      return m_state.queue.size() + m_state.urgent_queue.size();
+      return m_state.waiting;
     }
   };
 
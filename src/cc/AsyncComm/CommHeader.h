@@ -29,6 +29,8 @@
 #ifndef AsyncComm_COMMHEADER_H
 #define AsyncComm_COMMHEADER_H
 
+#include <Common/Checksum.h>
+
 namespace Hypertable {
 
   /** @addtogroup AsyncComm
@@ -52,6 +54,7 @@ namespace Hypertable {
       FLAGS_BIT_IGNORE_RESPONSE  = 0x0002, //!< Response should be ignored
       FLAGS_BIT_URGENT           = 0x0004, //!< Request is urgent
       FLAGS_BIT_PROFILE          = 0x0008, //!< Request should be profiled
+      FLAGS_BIT_CHECKSUM_CRC32C  = 0x2000, //!< Header checksum is CRC32C
       FLAGS_BIT_PROXY_MAP_UPDATE = 0x4000, //!< ProxyMap update message
       FLAGS_BIT_PAYLOAD_CHECKSUM = 0x8000  //!< Payload checksumming is enabled
     };
@@ -63,6 +66,7 @@ namespace Hypertable {
       FLAGS_MASK_IGNORE_RESPONSE  = 0xFFFD, //!< Response should be ignored bit
       FLAGS_MASK_URGENT           = 0xFFFB, //!< Request is urgent bit
       FLAGS_MASK_PROFILE          = 0xFFF7, //!< Request should be profiled
+      FLAGS_MASK_CHECKSUM_CRC32C  = 0xDFFF, //!< Header checksum is CRC32C bit
       FLAGS_MASK_PROXY_MAP_UPDATE = 0xBFFF, //!< ProxyMap update message bit
       FLAGS_MASK_PAYLOAD_CHECKSUM = 0x7FFF  //!< Payload checksumming is enabled bit
     };
@@ -96,7 +100,13 @@ namespace Hypertable {
 
     /** Encode header to memory pointed to by <code>*bufp</code>.
      * The <code>bufp</code> pointer is advanced to address immediately
-     * following the encoded header.
+     * following the encoded header.  The header checksum of requests is
+     * computed with the default checksum algorithm (see
+     * default_checksum_algorithm()) and
+     * the algorithm is recorded with the #FLAGS_BIT_CHECKSUM_CRC32C bit.
+     * Responses carry the bit over from the request (see
+     * initialize_from_request_header()), so they are checksummed with the
+     * algorithm the requester understands.
      * @param bufp Address of memory pointer to where header is to be encoded.
      */
     void encode(uint8_t **bufp);
@@ -133,6 +143,15 @@ namespace Hypertable {
       total_len = 0;
     }
 
+    /** Returns algorithm with which header checksum is computed.
+     * @return CHECKSUM_CRC32C if #FLAGS_BIT_CHECKSUM_CRC32C is set,
+     * CHECKSUM_FLETCHER32 otherwise
+     */
+    ChecksumAlgorithm checksum_algorithm() const {
+      return (flags & FLAGS_BIT_CHECKSUM_CRC32C) ?
+        CHECKSUM_CRC32C : CHECKSUM_FLETCHER32;
+    }
+
     uint8_t version;     //!< Protocol version
     uint8_t header_len;  //!< Length of header
     uint16_t alignment;  //!< Align payload to this byte offset
@@ -63,6 +63,12 @@ bool DispatchHandlerSynchronizer::wait_for_reply(EventPtr &event_ptr) {
 }
 
 
+bool DispatchHandlerSynchronizer::reply_ready() {
+  lock_guard<mutex> lock(m_mutex);
+  return !m_receive_queue.empty();
+}
+
+
 bool DispatchHandlerSynchronizer::wait_for_connection() {
   unique_lock<mutex> lock(m_mutex);
 
@@ -100,6 +100,14 @@ namespace Hypertable {
      */
     bool wait_for_reply(EventPtr &event);
 
+    /** Checks if a response event has been received.  Can be used to
+     * determine whether or not a subsequent call to wait_for_reply() will
+     * block.
+     *
+     * @return true if the event queue is non-empty, false otherwise
+     */
+    bool reply_ready();
+
     /// Waits for CONNECTION_ESTABLISHED event.
     /// This function waits for an event to arrive on #m_receive_queue and if it
     /// is an ERROR event, it throws an exception, if it is a DISCONNECT event
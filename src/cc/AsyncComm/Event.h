@@ -30,6 +30,7 @@
 
 #include "Clock.h"
 #include "CommHeader.h"
+#include "ReceiveBufferPool.h"
 
 #include <Common/Error.h>
 #include <Common/InetAddr.h>
@@ -110,13 +111,16 @@ namespace Hypertable {
       set_proxy(proxy_);
     }
 
-    /** Destructor.  Deallocates message payload buffer and proxy name buffer
+    /** Destructor.  Deallocates message payload buffer (unless it is a slice
+     * of #payload_buffer) and proxy name buffer
      */
     ~Event() {
-      if (payload_aligned)
-        free((void *)payload);
-      else
-        delete [] payload;
+      if (!payload_buffer) {
+        if (payload_aligned)
+          free((void *)payload);
+        else
+          delete [] payload;
+      }
       if (proxy_buf != proxy_buf_static)
         delete [] proxy_buf;
     }
@@ -210,6 +214,15 @@ namespace Hypertable {
     /// Flag indicating if payload was allocated with posix_memalign
     bool payload_aligned {};
 
+    /// Pooled receive buffer holding #payload, or null if #payload was
+    /// allocated for this event
+    ReceiveBufferPtr payload_buffer;
+
+    /// Flag indicating if #payload is a slice of a ReceiveBufferPool buffer.
+    /// Such a buffer is shared with other messages, so holders that retain
+    /// the event for long should copy the payload out instead.
+    bool payload_pooled {};
+
     /** Generates a one-line string representation of the event.  For example:
      * <pre>
      *   Event: type=MESSAGE id=2 gid=0 header_len=16 total_len=20 \
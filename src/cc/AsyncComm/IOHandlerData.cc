@@ -35,6 +35,8 @@
 #include <Common/InetAddr.h>
 #include <Common/Time.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <iostream>
@@ -112,7 +114,6 @@ namespace {
 bool
 IOHandlerData::handle_event(struct pollfd *event,
                             ClockT::time_point arrival_time) {
-  int error = 0;
   bool eof = false;
 
   //DisplayEvent(event);
@@ -126,62 +127,8 @@ IOHandlerData::handle_event(struct pollfd *event,
     }
 
     if (event->revents & POLLIN) {
-      size_t nread;
-      while (true) {
-        if (!m_got_header) {
-          nread = et_socket_read(m_sd, m_message_header_ptr,
-                                 m_message_header_remaining, &error, &eof);
-          if (nread == (size_t)-1) {
-            if (errno != ECONNREFUSED) {
-              if (ReactorFactory::verbose)
-                HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
-                         (int)m_message_header_remaining, strerror(errno));
-            }
-            else
-              test_and_set_error(Error::COMM_CONNECT_ERROR);
-
-            handle_disconnect();
-            return true;
-          }
-          else if (nread < m_message_header_remaining) {
-            m_message_header_remaining -= nread;
-            m_message_header_ptr += nread;
-            if (error == EAGAIN)
-              break;
-            error = 0;
-          }
-          else {
-            m_message_header_ptr += nread;
-            handle_message_header(arrival_time);
-          }
-
-          if (eof)
-            break;
-        }
-        else { // got header
-          nread = et_socket_read(m_sd, m_message_ptr, m_message_remaining,
-                                 &error, &eof);
-          if (nread == (size_t)-1) {
-            if (ReactorFactory::verbose)
-              HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
-                       (int)m_message_header_remaining, strerror(errno));
-            handle_disconnect();
-            return true;
-          }
-          else if (nread < m_message_remaining) {
-            m_message_ptr += nread;
-            m_message_remaining -= nread;
-            if (error == EAGAIN)
-              break;
-            error = 0;
-          }
-          else
-            handle_message_body();
-
-          if (eof)
-            break;
-        }
-      }
+      if (handle_read_readiness(arrival_time, &eof))
+        return true;
     }
 
     if (eof) {
@@ -224,7 +171,6 @@ IOHandlerData::handle_event(struct pollfd *event,
 bool
 IOHandlerData::handle_event(struct epoll_event *event,
                             ClockT::time_point arrival_time) {
-  int error = 0;
   bool eof = false;
 
   //DisplayEvent(event);
@@ -238,62 +184,8 @@ IOHandlerData::handle_event(struct epoll_event *event,
     }
 
     if (event->events & EPOLLIN) {
-      size_t nread;
-      while (true) {
-        if (!m_got_header) {
-          nread = et_socket_read(m_sd, m_message_header_ptr,
-                                 m_message_header_remaining, &error, &eof);
-          if (nread == (size_t)-1) {
-            if (errno != ECONNREFUSED) {
-              if (ReactorFactory::verbose)
-                HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
-                         (int)m_message_header_remaining, strerror(errno));
-            }
-            else
-              test_and_set_error(Error::COMM_CONNECT_ERROR);
-
-            handle_disconnect();
-            return true;
-          }
-          else if (nread < m_message_header_remaining) {
-            m_message_header_remaining -= nread;
-            m_message_header_ptr += nread;
-            if (error == EAGAIN)
-              break;
-            error = 0;
-          }
-          else {
-            m_message_header_ptr += nread;
-            handle_message_header(arrival_time);
-          }
-
-          if (eof)
-            break;
-        }
-        else { // got header
-          nread = et_socket_read(m_sd, m_message_ptr, m_message_remaining,
-                                 &error, &eof);
-          if (nread == (size_t)-1) {
-            if (ReactorFactory::verbose)
-              HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
-                       (int)m_message_header_remaining, strerror(errno));
-            handle_disconnect();
-            return true;
-          }
-          else if (nread < m_message_remaining) {
-            m_message_ptr += nread;
-            m_message_remaining -= nread;
-            if (error == EAGAIN)
-              break;
-            error = 0;
-          }
-          else
-            handle_message_body();
-
-          if (eof)
-            break;
-        }
-      }
+      if (handle_read_readiness(arrival_time, &eof))
+        return true;
     }
 
     if (ReactorFactory::ms_epollet) {
@@ -342,7 +234,6 @@ IOHandlerData::handle_event(struct epoll_event *event,
 
 bool IOHandlerData::handle_event(port_event_t *event,
                                  ClockT::time_point arrival_time) {
-  int error = 0;
   bool eof = false;
 
   //display_event(event);
@@ -359,62 +250,8 @@ bool IOHandlerData::handle_event(port_event_t *event,
     }
 
     if (event->portev_events & POLLIN) {
-      size_t nread;
-      while (true) {
-        if (!m_got_header) {
-          nread = et_socket_read(m_sd, m_message_header_ptr,
-                                 m_message_header_remaining, &error, &eof);
-          if (nread == (size_t)-1) {
-            if (errno != ECONNREFUSED) {
-              if (ReactorFactory::verbose)
-                HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
-                         (int)m_message_header_remaining, strerror(errno));
-            }
-            else
-              test_and_set_error(Error::COMM_CONNECT_ERROR);
-
-            handle_disconnect();
-            return true;
-          }
-          else if (nread < m_message_header_remaining) {
-            m_message_header_remaining -= nread;
-            m_message_header_ptr += nread;
-            if (error == EAGAIN)
-              break;
-            error = 0;
-          }
-          else {
-            m_message_header_ptr += nread;
-            handle_message_header(arrival_time);
-          }
-
-          if (eof)
-            break;
-        }
-        else { // got header
-          nread = et_socket_read(m_sd, m_message_ptr, m_message_remaining,
-                                 &error, &eof);
-          if (nread == (size_t)-1) {
-            if (ReactorFactory::verbose)
-              HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
-                       (int)m_message_header_remaining, strerror(errno));
-            handle_disconnect();
-            return true;
-          }
-          else if (nread < m_message_remaining) {
-            m_message_ptr += nread;
-            m_message_remaining -= nread;
-            if (error == EAGAIN)
-              break;
-            error = 0;
-          }
-          else
-            handle_message_body();
-
-          if (eof)
-            break;
-        }
-      }
+      if (handle_read_readiness(arrival_time, &eof))
+        return true;
     }
 
     if (eof) {
@@ -482,70 +319,9 @@ bool IOHandlerData::handle_event(struct kevent *event,
     }
 
     if (event->filter == EVFILT_READ) {
-      size_t available = (size_t)event->data;
-      size_t nread;
-      while (available > 0) {
-        if (!m_got_header) {
-          if (m_message_header_remaining <= available) {
-            nread = FileUtils::read(m_sd, m_message_header_ptr,
-                                    m_message_header_remaining);
-            if (nread == (size_t)-1) {
-              if (ReactorFactory::verbose)
-                HT_INFOF("FileUtils::read(%d, len=%d) failure : %s", m_sd,
-                         (int)m_message_header_remaining, strerror(errno));
-              handle_disconnect();
-              return true;
-            }
-            assert(nread == m_message_header_remaining);
-            available -= nread;
-            m_message_header_ptr += nread;
-            handle_message_header(arrival_time);
-          }
-          else {
-            nread = FileUtils::read(m_sd, m_message_header_ptr, available);
-            if (nread == (size_t)-1) {
-              if (ReactorFactory::verbose)
-                HT_INFOF("FileUtils::read(%d, len=%d) failure : %s", m_sd,
-                         (int)available, strerror(errno));
-              handle_disconnect();
-              return true;
-            }
-            assert(nread == available);
-            m_message_header_remaining -= nread;
-            m_message_header_ptr += nread;
-            return false;
-          }
-        }
-        if (m_got_header) {
-          if (m_message_remaining <= available) {
-            nread = FileUtils::read(m_sd, m_message_ptr, m_message_remaining);
-            if (nread == (size_t)-1) {
-              if (ReactorFactory::verbose)
-                HT_INFOF("FileUtils::read(%d, len=%d) failure : %s", m_sd,
-                         (int)m_message_remaining, strerror(errno));
-              handle_disconnect();
-              return true;
-            }
-            assert(nread == m_message_remaining);
-            available -= nread;
-            handle_message_body();
-          }
-          else {
-            nread = FileUtils::read(m_sd, m_message_ptr, available);
-            if (nread == (size_t)-1) {
-              if (ReactorFactory::verbose)
-                HT_INFOF("FileUtils::read(%d, len=%d) failure : %s", m_sd,
-                         (int)available, strerror(errno));
-              handle_disconnect();
-              return true;
-            }
-            assert(nread == available);
-            m_message_ptr += nread;
-            m_message_remaining -= nread;
-            available = 0;
-          }
-        }
-      }
+      bool eof = false;
+      if (handle_read_readiness(arrival_time, &eof))
+        return true;
     }
   }
   catch (Hypertable::Exception &e) {
@@ -563,50 +339,176 @@ bool IOHandlerData::handle_event(struct kevent *event,
 #endif
 
 
-void IOHandlerData::handle_message_header(ClockT::time_point arrival_time) {
-  size_t header_len = (size_t)m_message_header[1];
+bool IOHandlerData::handle_read_readiness(ClockT::time_point arrival_time,
+                                          bool *eofp) {
+  int error = 0;
+  size_t nread;
 
-  // check to see if there is any variable length header
-  // after the fixed length portion that needs to be read
-  if (header_len > (size_t)(m_message_header_ptr - m_message_header)) {
-    m_message_header_remaining = header_len - (size_t)(m_message_header_ptr
-                                                       - m_message_header);
-    return;
+  while (true) {
+    if (m_got_header) {
+      nread = et_socket_read(m_sd, m_message_ptr, m_message_remaining,
+                             &error, eofp);
+      if (nread == (size_t)-1) {
+        if (ReactorFactory::verbose)
+          HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
+                   (int)m_message_remaining, strerror(errno));
+        handle_disconnect();
+        return true;
+      }
+      m_message_ptr += nread;
+      m_message_remaining -= nread;
+      if (m_message_remaining == 0)
+        handle_message_body();
+    }
+    else {
+      prepare_receive_buffer();
+      HT_ASSERT(m_recv_end < ReceiveBufferPool::BUFFER_SIZE);
+      size_t len = ReceiveBufferPool::BUFFER_SIZE - m_recv_end;
+      nread = et_socket_read(m_sd, m_recv_buffer.get() + m_recv_end, len,
+                             &error, eofp);
+      if (nread == (size_t)-1) {
+        if (errno != ECONNREFUSED) {
+          if (ReactorFactory::verbose)
+            HT_INFOF("socket read(%d, len=%d) failure : %s", m_sd,
+                     (int)len, strerror(errno));
+        }
+        else
+          test_and_set_error(Error::COMM_CONNECT_ERROR);
+
+        handle_disconnect();
+        return true;
+      }
+      m_recv_end += nread;
+      handle_received_data(arrival_time);
+    }
+
+    if (*eofp || error == EAGAIN)
+      break;
+    error = 0;
+  }
+
+  return false;
+}
+
+
+void IOHandlerData::prepare_receive_buffer() {
+  size_t unprocessed = m_recv_end - m_recv_begin;
+
+  if (m_recv_buffer && m_recv_buffer.use_count() == 1) {
+    // No events reference the buffer, so it can be reused in place once
+    // reads of it by other threads are visible
+    atomic_thread_fence(memory_order_acquire);
+    if (m_recv_begin > 0 &&
+        (unprocessed == 0 || m_recv_end == ReceiveBufferPool::BUFFER_SIZE)) {
+      memmove(m_recv_buffer.get(), m_recv_buffer.get() + m_recv_begin,
+              unprocessed);
+      m_recv_begin = 0;
+      m_recv_end = unprocessed;
+    }
   }
+  else if (!m_recv_buffer || m_recv_end == ReceiveBufferPool::BUFFER_SIZE) {
+    ReceiveBufferPtr buffer = ReceiveBufferPool::get();
+    if (unprocessed)
+      memcpy(buffer.get(), m_recv_buffer.get() + m_recv_begin, unprocessed);
+    m_recv_buffer = buffer;
+    m_recv_begin = 0;
+    m_recv_end = unprocessed;
+  }
+}
+
+
+void IOHandlerData::handle_received_data(ClockT::time_point arrival_time) {
+  uint8_t *base;
+  size_t available;
+
+  while (!m_got_header) {
+    base = m_recv_buffer.get() + m_recv_begin;
+    available = m_recv_end - m_recv_begin;
 
+    if (!m_event) {
+      if (available < CommHeader::FIXED_LENGTH || available < (size_t)base[1])
+        return;
+      size_t header_len = (size_t)base[1];
+      m_recv_begin += header_len;
+      handle_message_header(base, header_len, available - header_len,
+                            arrival_time);
+      continue;
+    }
+
+    size_t payload_len = m_event->header.total_len - m_event->header.header_len;
+    if (available < payload_len)
+      return;
+
+    m_event->payload = base;
+    m_event->payload_len = payload_len;
+    m_event->payload_buffer = m_recv_buffer;
+    m_event->payload_pooled = true;
+    m_recv_begin += payload_len;
+    handle_message_body();
+  }
+}
+
+
+void IOHandlerData::handle_message_header(uint8_t *header, size_t header_len,
+                                          size_t available,
+                                          ClockT::time_point arrival_time) {
   m_event = make_shared<Event>(Event::MESSAGE, m_addr);
-  m_event->load_message_header(m_message_header, header_len);
+  m_event->load_message_header(header, header_len);
   m_event->arrival_time = arrival_time;
 
+  if (m_event->header.total_len < header_len)
+    HT_THROWF(Error::COMM_BAD_HEADER, "Message length %u is less than header "
+              "length %u", (unsigned)m_event->header.total_len,
+              (unsigned)header_len);
+
+  size_t payload_len = m_event->header.total_len - header_len;
+
+  if (payload_len <= MAX_POOLED_PAYLOAD && m_event->header.alignment == 0)
+    return;
+
   m_message_aligned = false;
 
 #if defined(__linux__)
   if (m_event->header.alignment > 0) {
     void *vptr = 0;
-    posix_memalign(&vptr, m_event->header.alignment,
-		   m_event->header.total_len - header_len);
+    posix_memalign(&vptr, m_event->header.alignment, payload_len);
     m_message = (uint8_t *)vptr;
     m_message_aligned = true;
   }
   else
-    m_message = new uint8_t [m_event->header.total_len - header_len];
+    m_message = new uint8_t [payload_len];
 #else
-  m_message = new uint8_t [m_event->header.total_len - header_len];
+  m_message = new uint8_t [payload_len];
 #endif
-  m_message_ptr = m_message;
-  m_message_remaining = m_event->header.total_len - header_len;
-  m_message_header_remaining = 0;
+
+  // Copy the part of the payload that arrived with the header
+  size_t len = std::min(available, payload_len);
+  memcpy(m_message, header + header_len, len);
+  m_recv_begin += len;
+
+  m_message_ptr = m_message + len;
+  m_message_remaining = payload_len - len;
   m_got_header = true;
+
+  if (m_message_remaining == 0)
+    handle_message_body();
 }
 
 
 void IOHandlerData::handle_message_body() {
   DispatchHandler *dh {};
 
+  if (m_got_header) {
+    m_event->payload = m_message;
+    m_event->payload_len = m_event->header.total_len
+                           - m_event->header.header_len;
+    m_event->payload_aligned = m_message_aligned;
+    m_message = 0;
+  }
+
   if (m_event->header.flags & CommHeader::FLAGS_BIT_PROXY_MAP_UPDATE) {
-    ReactorRunner::handler_map->update_proxy_map((const char *)m_message,
-                  m_event->header.total_len - m_event->header.header_len);
-    free_message_buffer();
+    ReactorRunner::handler_map->update_proxy_map((const char *)m_event->payload,
+                                                 m_event->payload_len);
     m_event.reset();
     //HT_INFO("proxy map update");
   }
@@ -619,14 +521,9 @@ void IOHandlerData::handle_message_body() {
                  "=%d,total_len=%d)", m_event->header.id, m_event->header.version,
                  m_event->header.total_len);
     }
-    free_message_buffer();
     m_event.reset();
   }
   else {
-    m_event->payload = m_message;
-    m_event->payload_len = m_event->header.total_len
-                           - m_event->header.header_len;
-    m_event->payload_aligned = m_message_aligned;
     {
       lock_guard<mutex> lock(m_mutex);
       m_event->set_proxy(m_proxy);
@@ -30,6 +30,7 @@
 
 #include "CommBuf.h"
 #include "IOHandler.h"
+#include "ReceiveBufferPool.h"
 
 #include <Common/Error.h>
 
@@ -52,6 +53,11 @@ namespace Hypertable {
 
   public:
 
+    /// Largest message payload delivered as a slice of a pooled receive
+    /// buffer.  Larger payloads are read into a buffer of their own so that
+    /// long-lived events (e.g. cached block reads) do not pin receive buffers.
+    static const size_t MAX_POOLED_PAYLOAD = 8*1024;
+
     /** Constructor.
      * @param sd Socket descriptor
      * @param addr Address of remote end of connection
@@ -67,7 +73,9 @@ namespace Hypertable {
     }
 
     /** Destructor */
-    virtual ~IOHandlerData() { }
+    virtual ~IOHandlerData() {
+      free_message_buffer();
+    }
 
     /** Disconnects handler by delivering Event::DISCONNECT via default dispatch
      * handler.
@@ -82,8 +90,6 @@ namespace Hypertable {
     void reset_incoming_message_state() {
       m_got_header = false;
       m_event.reset();
-      m_message_header_ptr = m_message_header;
-      m_message_header_remaining = CommHeader::FIXED_LENGTH;
       m_message = 0;
       m_message_ptr = 0;
       m_message_remaining = 0;
@@ -141,16 +147,14 @@ namespace Hypertable {
      * #handle_write_readiness.  If #handle_write_readiness returns <i>true</i>
      * the handler is disconnected with a call to #handle_disconnect and
      * <i>true</i> is returned.  <code>POLLIN</code> events are handled by
-     * reading message data off the socket.  First the message header is read
-     * and decoded with #handle_message_header and then the message payload is
-     * read and delivered to the application with #handle_message_body.  If a
+     * reading message data off the socket with #handle_read_readiness.  If a
      * read error is encountered, #m_error is set to the approprate error
      * code (if not already set) and the handler is disconnected with
      * a call to #handle_disconnect and <i>true</i> is returned. 
      * <i>EOF</i>, <code>POLLERR</code> events, and <code>POLLHUP</code> events
      * are handled by disconnecting the handler with a call to
      * #handle_disconnect and <i>true</i> is returned.
-     * <code>arrival_time</code> is passed into #handle_message_header to be
+     * <code>arrival_time</code> is passed into #handle_read_readiness to be
      * delivered to the applicaiton via the Event object.
      * @param event Pointer to <code>pollfd</code> structure describing event
      * @param arrival_time Time of event arrival
@@ -167,16 +171,14 @@ namespace Hypertable {
      * #handle_write_readiness.  If #handle_write_readiness returns <i>true</i>
      * the handler is disconnected with a call to #handle_disconnect and
      * <i>true</i> is returned.  <code>EVFILT_READ</code> events are handled by
-     * reading message data off the socket.  First the message header is read
-     * and decoded with #handle_message_header and then the message payload is
-     * read and delivered to the application with #handle_message_body.  If a
+     * reading message data off the socket with #handle_read_readiness.  If a
      * read error is encountered, #m_error is set to the approprate error
      * code (if not already set) and the handler is disconnected with
      * a call to #handle_disconnect and <i>true</i> is returned. 
      * <code>EV_EOF</code> events are
      * handled by disconnecting the handler with a call to #handle_disconnect
      * and <i>true</i> is returned.  <code>arrival_time</code> is passed into
-     * #handle_message_header to be delivered to the applicaiton via the
+     * #handle_read_readiness to be delivered to the applicaiton via the
      * Event object.
      * @param event Pointer to <code>kevent</code> structure describing event
      * @param arrival_time Time of event arrival
@@ -192,9 +194,7 @@ namespace Hypertable {
      * #handle_write_readiness.  If #handle_write_readiness returns <i>true</i>
      * the handler is disconnected with a call to #handle_disconnect and
      * <i>true</i> is returned.  <code>EPOLLIN</code> events are handled by
-     * reading message data off the socket.  First the message header is read
-     * and decoded with #handle_message_header and then the message payload is
-     * read and delivered to the application with #handle_message_body.  If a
+     * reading message data off the socket with #handle_read_readiness.  If a
      * read error is encountered, #m_error is set to the approprate error
      * code (if not already set) and the handler is disconnected with
      * a call to #handle_disconnect and <i>true</i> is returned.
@@ -202,7 +202,7 @@ namespace Hypertable {
      * <code>POLLRDHUP</code> events (level-triggered epoll only) are
      * handled by disconnecting the handler with a call to #handle_disconnect
      * and <i>true</i> is returned.  <code>arrival_time</code> is passed into
-     * #handle_message_header to be delivered to the applicaiton via the
+     * #handle_read_readiness to be delivered to the applicaiton via the
      * Event object.
      * @param event Pointer to <code>epoll_event</code> structure describing
      * event
@@ -219,16 +219,14 @@ namespace Hypertable {
      * #handle_write_readiness.  If #handle_write_readiness returns <i>true</i>
      * the handler is disconnected with a call to #handle_disconnect and
      * <i>true</i> is returned.  <code>POLLIN</code> events are handled by
-     * reading message data off the socket.  First the message header is read
-     * and decoded with #handle_message_header and then the message payload is
-     * read and delivered to the application with #handle_message_body.  If a
+     * reading message data off the socket with #handle_read_readiness.  If a
      * read error is encountered, #m_error is set to the approprate error
      * code (if not already set) and the handler is disconnected with
      * a call to #handle_disconnect and <i>true</i> is returned. 
      * <i>EOF</i>, <code>POLLERR</code> events, <code>POLLHUP</code>, and
      * <code>POLLREMOVE</code> events are handled by disconnecting the handler
      * with a call to #handle_disconnect and <i>true</i> is returned.
-     * <code>arrival_time</code> is passed into #handle_message_header to be
+     * <code>arrival_time</code> is passed into #handle_read_readiness to be
      * delivered to the applicaiton via the Event object.
      * @param event Pointer to <code>port_event_t</code> structure describing
      * event
@@ -264,20 +262,60 @@ namespace Hypertable {
 
   private:
 
-    /** Processes a message header.  This method is called when the fixed
-     * length portion of a header has been completely received.  It first
-     * checks to see if there is a variable portion of the header that has
-     * not yet been read, if so, it adjusts #m_message_header_remaining and
-     * returns.  If the header has been completely received, it allocates
-     * a new Event object and sets #m_event pointing to it.  It initializes
-     * the event object with the message header and <code>arrival_time</code>.
-     * It then allocates the message payload buffer (#m_message), initialzes
-     * the payload buffer pointers, and sets #m_got_header to <i>true</i>.
+    /** Reads incoming messages off the socket.  Data is read into the
+     * current pooled receive buffer (#m_recv_buffer) with as few
+     * <code>read</code> calls as possible and every complete message in the
+     * buffer is processed with #handle_received_data.  The payload of a
+     * message that is too large to be pooled is read directly into its own
+     * buffer (#m_message).  Reading stops on <code>EAGAIN</code> or
+     * <i>EOF</i>.  If a read error is encountered, #m_error is set to the
+     * approprate error code (if not already set) and the handler is
+     * disconnected with a call to #handle_disconnect.
+     * @param arrival_time Time of event arrival
+     * @param eofp Set to <i>true</i> if <i>EOF</i> was encountered
+     * @return <i>false</i> on success, <i>true</i> if error encountered and
+     * handler was decomissioned
+     */
+    bool handle_read_readiness(ClockT::time_point arrival_time, bool *eofp);
+
+    /** Prepares #m_recv_buffer for reading.  If the buffer is full and
+     * still referenced by delivered events, a new buffer is obtained from
+     * ReceiveBufferPool and the unprocessed data is copied to it.  If the
+     * buffer is not referenced by any events, the unprocessed data is moved
+     * to the front of the buffer instead.
+     */
+    void prepare_receive_buffer();
+
+    /** Processes the data in #m_recv_buffer.  Decodes message headers with
+     * #handle_message_header and delivers every message whose payload has
+     * been completely received with #handle_message_body.  The payloads of
+     * these messages are slices of #m_recv_buffer.  Stops when an
+     * incomplete message is encountered or a message that is not pooled has
+     * been started.
+     * @param arrival_time Time of event arrival
+     */
+    void handle_received_data(ClockT::time_point arrival_time);
+
+    /** Processes a message header.  Allocates a new Event object, sets
+     * #m_event pointing to it, and initializes it with the message header and
+     * <code>arrival_time</code>.  If the payload is larger than
+     * #MAX_POOLED_PAYLOAD or requires alignment, a payload buffer
+     * (#m_message) is allocated, the portion of the payload that has
+     * already been received is copied into it, and #m_got_header is set to
+     * <i>true</i>.
+     * @param header Serialized message header
+     * @param header_len Length of message header
+     * @param available Amount of data following the header in #m_recv_buffer
+     * @param arrival_time Time of event arrival
      */
-    void handle_message_header(ClockT::time_point arrival_time);
+    void handle_message_header(uint8_t *header, size_t header_len,
+                               size_t available,
+                               ClockT::time_point arrival_time);
 
     /** Processes a message body.  This method is called when a message
-     * has been completely received (header + payload).  It first checks to
+     * has been completely received (header + payload).  If the payload was
+     * read into #m_message, ownership of the buffer is passed to the event.
+     * It then checks to
      * see if the message is a proxy update message and if so, it updates
      * its proxy map with a call to HandlerMap::update_proxy_map and returns.
      * Otherwise if it is a response message and the
@@ -298,7 +336,7 @@ namespace Hypertable {
     /// Flag indicating if socket connection has been completed
     bool m_connected {};
 
-    /// Flag indicating if message header has been completely received
+    /// Flag indicating if message payload is being read into #m_message
     bool m_got_header {};
 
     /// Flag indicating if message buffer was allocated with posix_memalign()
@@ -307,14 +345,14 @@ namespace Hypertable {
     /// Pointer to Event object holding message to deliver to application
     EventPtr m_event;
 
-    /// Message header buffer
-    uint8_t m_message_header[64];
+    /// Current receive buffer
+    ReceiveBufferPtr m_recv_buffer;
 
-    /// Pointer to next write position in #m_message_header
-    uint8_t *m_message_header_ptr {};
+    /// Offset of first unprocessed byte in #m_recv_buffer
+    size_t m_recv_begin {};
 
-    /// Amount of header remaining to be read
-    size_t m_message_header_remaining;
+    /// Offset of end of received data in #m_recv_buffer
+    size_t m_recv_end {};
 
     /// Poiner to message payload buffer
     uint8_t *m_message {};
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for ReceiveBufferPool.
+/// This file contains method definitions for ReceiveBufferPool, a pool of
+/// fixed-size buffers into which incoming messages are read.
+
+#include <Common/Compat.h>
+
+#include "ReceiveBufferPool.h"
+
+#include <mutex>
+#include <vector>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+
+  struct PoolState {
+    mutex lock;
+    vector<uint8_t *> free_list;
+  };
+
+  /// Never destroyed, since Event objects holding buffers may outlive
+  /// static destruction
+  PoolState *pool_state() {
+    static PoolState *state = new PoolState();
+    return state;
+  }
+
+}
+
+ReceiveBufferPtr ReceiveBufferPool::get() {
+  PoolState *state = pool_state();
+  uint8_t *buf {};
+  {
+    lock_guard<mutex> lock(state->lock);
+    if (!state->free_list.empty()) {
+      buf = state->free_list.back();
+      state->free_list.pop_back();
+    }
+  }
+  if (buf == nullptr)
+    buf = new uint8_t [BUFFER_SIZE];
+  return ReceiveBufferPtr(buf, &ReceiveBufferPool::release);
+}
+
+size_t ReceiveBufferPool::free_count() {
+  PoolState *state = pool_state();
+  lock_guard<mutex> lock(state->lock);
+  return state->free_list.size();
+}
+
+void ReceiveBufferPool::release(uint8_t *buf) {
+  PoolState *state = pool_state();
+  {
+    lock_guard<mutex> lock(state->lock);
+    if (state->free_list.size() < MAX_FREE) {
+      state->free_list.push_back(buf);
+      return;
+    }
+  }
+  delete [] buf;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for ReceiveBufferPool.
+/// This file contains type declarations for ReceiveBufferPool, a pool of
+/// fixed-size buffers into which incoming messages are read.
+
+#ifndef AsyncComm_ReceiveBufferPool_h
+#define AsyncComm_ReceiveBufferPool_h
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Hypertable {
+
+  /// @addtogroup AsyncComm
+  /// @{
+
+  /// Smart pointer to pooled receive buffer
+  typedef std::shared_ptr<uint8_t> ReceiveBufferPtr;
+
+  /// Pool of fixed-size receive buffers.
+  /// IOHandlerData reads incoming data into these buffers and hands the
+  /// payloads of small messages to Event objects as slices of the buffer.
+  /// The buffer is returned to the pool once the handler has moved on to a
+  /// new buffer and the last Event referencing it has been destroyed.
+  class ReceiveBufferPool {
+  public:
+
+    /// Size of each receive buffer
+    static const size_t BUFFER_SIZE = 64*1024;
+
+    /// Maximum number of free buffers retained by the pool
+    static const size_t MAX_FREE = 256;
+
+    /// Gets a receive buffer.
+    /// Takes a buffer off the free list, or allocates a new one if the free
+    /// list is empty.  The buffer is put back on the free list when the last
+    /// reference to it is dropped.
+    /// @return Smart pointer to #BUFFER_SIZE byte buffer
+    static ReceiveBufferPtr get();
+
+    /// Returns number of buffers on the free list.
+    /// @return Number of free buffers
+    static size_t free_count();
+
+  private:
+
+    /// Puts a buffer back on the free list, or deallocates it if the free
+    /// list already holds #MAX_FREE buffers.
+    /// @param buf Buffer to release
+    static void release(uint8_t *buf);
+  };
+
+  /// @}
+}
+
+#endif // AsyncComm_ReceiveBufferPool_h
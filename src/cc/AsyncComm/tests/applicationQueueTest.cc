@@ -0,0 +1,245 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <Common/Compat.h>
+
+#include <AsyncComm/ApplicationQueue.h>
+#include <AsyncComm/Event.h>
+
+#include <Common/Init.h>
+#include <Common/Error.h>
+#include <Common/Logger.h>
+#include <Common/Usage.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace Hypertable;
+
+namespace {
+  const char *usage[] = {
+    "usage: applicationQueueTest [--benchmark [<workers>]]",
+    "",
+    "This program tests request group serialization, urgent request handling",
+    "and quiescing of the ApplicationQueue.  With --benchmark, it measures",
+    "dispatch latency (time from add() to run()) for a mix of grouped and",
+    "ungrouped requests added by several threads while a set of slow groups",
+    "keeps a backlog of requests waiting on the queue.",
+    0
+  };
+
+  typedef chrono::steady_clock ClockT;
+
+  /// Records execution order of requests in a group
+  class GroupHandler : public ApplicationHandler {
+  public:
+    GroupHandler(EventPtr &event, int seq, vector<int> &order,
+                 atomic<int> &active)
+      : ApplicationHandler(event), m_seq(seq), m_order(order),
+        m_active(active) { }
+    void run() override {
+      // Only one request per group may run at a time
+      if (++m_active != 1)
+        HT_FATAL("Group requests executed concurrently");
+      m_order.push_back(m_seq);
+      this_thread::yield();
+      m_active--;
+    }
+  private:
+    int m_seq;
+    vector<int> &m_order;
+    atomic<int> &m_active;
+  };
+
+  /// Counts executions
+  class CountHandler : public ApplicationHandler {
+  public:
+    CountHandler(atomic<int> &count, bool urgent=false)
+      : ApplicationHandler(urgent), m_count(count) { }
+    void run() override { m_count++; }
+  private:
+    atomic<int> &m_count;
+  };
+
+  /// Records dispatch latency
+  class LatencyHandler : public ApplicationHandler {
+  public:
+    LatencyHandler(EventPtr &event, int64_t *latency, int work_us=0)
+      : ApplicationHandler(event), m_added(ClockT::now()), m_latency(latency),
+        m_work_us(work_us) { }
+    void run() override {
+      if (m_latency)
+        *m_latency = chrono::duration_cast<chrono::nanoseconds>(ClockT::now() - m_added).count();
+      if (m_work_us)
+        this_thread::sleep_for(chrono::microseconds(m_work_us));
+    }
+  private:
+    ClockT::time_point m_added;
+    int64_t *m_latency;
+    int m_work_us;
+  };
+
+  EventPtr make_event(uint64_t group_id) {
+    EventPtr event = make_shared<Event>(Event::MESSAGE);
+    event->group_id = group_id;
+    return event;
+  }
+
+  bool wait_for_count(atomic<int> &count, int expected) {
+    auto deadline = ClockT::now() + chrono::seconds(30);
+    while (count < expected) {
+      if (ClockT::now() > deadline)
+        return false;
+      this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+  void test_groups() {
+    const int groups = 16;
+    const int per_group = 500;
+    ApplicationQueue app_queue(8);
+    vector<vector<int>> order(groups);
+    vector<atomic<int>> active(groups);
+
+    for (auto &a : active)
+      a = 0;
+
+    for (int i=0; i<per_group; i++) {
+      for (int g=0; g<groups; g++) {
+        EventPtr event = make_event(g+1);
+        app_queue.add(new GroupHandler(event, i, order[g], active[g]));
+      }
+    }
+
+    if (!app_queue.wait_for_idle(ClockT::now() + chrono::seconds(30)))
+      HT_FATAL("Timed out waiting for group requests");
+
+    for (int g=0; g<groups; g++) {
+      HT_ASSERT(order[g].size() == (size_t)per_group);
+      for (int i=0; i<per_group; i++)
+        HT_ASSERT(order[g][i] == i);
+    }
+    HT_ASSERT(app_queue.backlog() == 0);
+  }
+
+  void test_pause() {
+    ApplicationQueue app_queue(2);
+    atomic<int> normal(0);
+    atomic<int> urgent(0);
+
+    app_queue.stop();
+    for (int i=0; i<100; i++)
+      app_queue.add(new CountHandler(normal));
+    for (int i=0; i<10; i++)
+      app_queue.add(new CountHandler(urgent, true));
+
+    // Urgent requests run while paused
+    if (!wait_for_count(urgent, 10))
+      HT_FATAL("Timed out waiting for urgent requests");
+    this_thread::sleep_for(chrono::milliseconds(50));
+    HT_ASSERT(normal == 0);
+    HT_ASSERT(app_queue.backlog() == 100);
+
+    app_queue.start();
+    if (!wait_for_count(normal, 100))
+      HT_FATAL("Timed out waiting for requests after start");
+    HT_ASSERT(app_queue.wait_for_idle(ClockT::now() + chrono::seconds(30)));
+  }
+
+  void benchmark(int workers) {
+    const int producers = 4;
+    const int per_producer = 25000;
+    const int groups = 1000;
+    const int slow_groups = 8;
+    const int per_slow_group = 2000;
+    ApplicationQueue app_queue(workers);
+    vector<int64_t> latency(producers * per_producer);
+
+    // Slow groups build up a backlog of requests waiting on the running
+    // request of their group
+    for (int i=0; i<per_slow_group; i++) {
+      for (int g=0; g<slow_groups; g++) {
+        EventPtr event = make_event(groups + g + 1);
+        app_queue.add(new LatencyHandler(event, nullptr, 100));
+      }
+    }
+
+    auto start = ClockT::now();
+    vector<thread> threads;
+    for (int p=0; p<producers; p++)
+      threads.push_back(thread([&app_queue, &latency, p]() {
+            for (int i=0; i<per_producer; i++) {
+              // Half of the requests belong to a group
+              uint64_t group_id = (i & 1) ? 1 + (p*per_producer + i) % groups : 0;
+              EventPtr event = make_event(group_id);
+              app_queue.add(new LatencyHandler(event, &latency[p*per_producer + i]));
+              if ((i % 100) == 0)
+                this_thread::sleep_for(chrono::microseconds(100));
+            }
+          }));
+    for (auto &t : threads)
+      t.join();
+    if (!app_queue.wait_for_idle(ClockT::now() + chrono::seconds(300)))
+      HT_FATAL("Timed out waiting for benchmark requests");
+    double elapsed = chrono::duration<double>(ClockT::now() - start).count();
+
+    sort(latency.begin(), latency.end());
+    auto percentile = [&latency](double p) {
+      return latency[(size_t)(p * (latency.size() - 1))] / 1000.0;
+    };
+    cout << "workers=" << workers << " requests=" << latency.size()
+         << " blocked=" << slow_groups * per_slow_group
+         << " elapsed=" << fixed << setprecision(2) << elapsed << "s"
+         << setprecision(1)
+         << " latency(us) p50=" << percentile(0.5)
+         << " p99=" << percentile(0.99)
+         << " p99.9=" << percentile(0.999)
+         << " max=" << percentile(1.0) << endl;
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+
+  Config::init(0, 0);
+
+  if (argc > 1) {
+    if (strcmp(argv[1], "--benchmark"))
+      Usage::dump_and_exit(usage);
+    benchmark(argc > 2 ? atoi(argv[2]) : 8);
+    return 0;
+  }
+
+  test_groups();
+  test_pause();
+
+  return 0;
+}
@@ -24,6 +24,9 @@
  * A bloom filter is a probabilistic datastructure (see
  * http://en.wikipedia.org/wiki/Bloom_filter). It's used in CellStores to speed
  * up database queries. This bloom filter stores additional checksums.
+ * Optionally the filter can be cache-line blocked, in which case all bits of
+ * an item are derived from a single 64-bit hash and fall within one 64-byte
+ * block, so a lookup touches a single cache line.
  */
 
 #ifndef HYPERTABLE_BLOOM_FILTER_WITH_CHECKSUM_H
@@ -58,9 +61,10 @@ public:
    *
    * @param items_estimate An estimated number of items that will be inserted
    * @param false_positive_prob The probability for false positives
+   * @param blocked Confine each item's bits to a single cache line
    */
   BasicBloomFilterWithChecksum(size_t items_estimate,
-          float false_positive_prob) {
+          float false_positive_prob, bool blocked = false) {
     m_items_actual = 0;
     m_items_estimate = items_estimate;
     m_false_positive_prob = false_positive_prob;
@@ -72,10 +76,7 @@ public:
               "Num elements=%lu false_positive_prob=%.3f",
               (Lu)items_estimate, false_positive_prob);
     }
-    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
-    m_bloom_base = new uint8_t[total_size()];
-    m_bloom_bits = m_bloom_base + 4;
-    memset(m_bloom_base, 0, total_size());
+    allocate(blocked);
 
     HT_DEBUG_OUT << "num funcs=" << m_num_hash_functions << " num bits="
         << m_num_bits << " num bytes= " << m_num_bytes << " bits per element="
@@ -88,9 +89,10 @@ public:
    * @param items_estimate An estimated number of items that will be inserted
    * @param bits_per_item Average bits per item
    * @param num_hashes Number of hash functions for the filter
+   * @param blocked Confine each item's bits to a single cache line
    */
   BasicBloomFilterWithChecksum(size_t items_estimate, float bits_per_item,
-          size_t num_hashes) {
+          size_t num_hashes, bool blocked = false) {
     m_items_actual = 0;
     m_items_estimate = items_estimate;
     m_false_positive_prob = 0.0;
@@ -100,10 +102,7 @@ public:
       HT_THROWF(Error::EMPTY_BLOOMFILTER, "Num elements=%lu bits_per_item=%.3f",
               (Lu)items_estimate, bits_per_item);
     }
-    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
-    m_bloom_base = new uint8_t[total_size()];
-    m_bloom_bits = m_bloom_base + 4;
-    memset(m_bloom_base, 0, total_size());
+    allocate(blocked);
 
     HT_DEBUG_OUT << "num funcs=" << m_num_hash_functions << " num bits="
         << m_num_bits << " num bytes=" << m_num_bytes << " bits per element="
@@ -117,9 +116,10 @@ public:
    * @param items_actual Actual number of items
    * @param length Number of bits
    * @param num_hashes Number of hash functions for the filter
+   * @param blocked Confine each item's bits to a single cache line
    */
   BasicBloomFilterWithChecksum(size_t items_estimate, size_t items_actual,
-          int64_t length, size_t num_hashes) {
+          int64_t length, size_t num_hashes, bool blocked = false) {
     m_items_actual = items_actual;
     m_items_estimate = items_estimate;
     m_false_positive_prob = 0.0;
@@ -130,10 +130,7 @@ public:
               "Estimated items=%lu actual items=%lu length=%lld num hashes=%lu",
               (Lu)items_estimate, (Lu)items_actual, (Lld)length, (Lu)num_hashes);
     }
-    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
-    m_bloom_base = new uint8_t[total_size()];
-    m_bloom_bits = m_bloom_base + 4;
-    memset(m_bloom_base, 0, total_size());
+    allocate(blocked);
 
     HT_DEBUG_OUT << "num funcs=" << m_num_hash_functions << " num bits="
         << m_num_bits << " num bytes=" << m_num_bytes << " bits per element="
@@ -142,7 +139,7 @@ public:
 
   /** Destructor; releases resources */
   ~BasicBloomFilterWithChecksum() {
-    delete[] m_bloom_base;
+    delete[] m_bloom_alloc;
   }
 
   /* XXX/review static functions to expose the bloom filter parameters, given
@@ -160,6 +157,15 @@ public:
    * @param len Size of the data (in bytes)
    */
   void insert(const void *key, size_t len) {
+    if (m_blocked) {
+      uint64_t mask[BLOCK_WORDS];
+      uint64_t *block = probe_block(key, len, mask);
+      for (size_t i = 0; i < BLOCK_WORDS; ++i)
+        block[i] |= mask[i];
+      m_items_actual++;
+      return;
+    }
+
     uint32_t hash = len;
 
     for (size_t i = 0; i < m_num_hash_functions; ++i) {
@@ -189,6 +195,15 @@ public:
    * @return true if the key "may" be contained, otherwise false
    */
   bool may_contain(const void *key, size_t len) const {
+    if (m_blocked) {
+      uint64_t mask[BLOCK_WORDS];
+      const uint64_t *block = probe_block(key, len, mask);
+      uint64_t missing = 0;
+      for (size_t i = 0; i < BLOCK_WORDS; ++i)
+        missing |= mask[i] & ~block[i];
+      return missing == 0;
+    }
+
     uint32_t hash = len;
     uint8_t byte_mask;
     uint8_t byte;
@@ -286,7 +301,68 @@ public:
    */
   size_t get_items_actual() { return m_items_actual; }
 
+  /** Checks if filter is cache-line blocked
+   *
+   * @return true if each item's bits are confined to a single cache line
+   */
+  bool is_blocked() const { return m_blocked; }
+
 private:
+  /** Number of bytes in a block (one cache line) */
+  static const size_t BLOCK_BYTES = 64;
+
+  /** Number of bits in a block */
+  static const size_t BLOCK_BITS = BLOCK_BYTES * CHAR_BIT;
+
+  /** Number of 64-bit words in a block */
+  static const size_t BLOCK_WORDS = BLOCK_BYTES / 8;
+
+  /** Allocates the bit array.
+   * In blocked mode, rounds #m_num_bits up to a whole number of blocks.
+   * The bit array is aligned on a cache line boundary and is preceded by
+   * the 4-byte checksum.
+   *
+   * @param blocked Confine each item's bits to a single cache line
+   */
+  void allocate(bool blocked) {
+    m_blocked = blocked;
+    if (m_blocked) {
+      m_num_blocks = (m_num_bits + BLOCK_BITS - 1) / BLOCK_BITS;
+      m_num_bits = m_num_blocks * BLOCK_BITS;
+    }
+    m_num_bytes = (m_num_bits / CHAR_BIT) + (m_num_bits % CHAR_BIT ? 1 : 0);
+    m_bloom_alloc = new uint8_t[total_size() + BLOCK_BYTES];
+    m_bloom_bits = (uint8_t *)(((uintptr_t)m_bloom_alloc + 4 + BLOCK_BYTES - 1)
+                               & ~(uintptr_t)(BLOCK_BYTES - 1));
+    m_bloom_base = m_bloom_bits - 4;
+    memset(m_bloom_base, 0, total_size());
+  }
+
+  /** Computes block and bit mask for a key (blocked mode).
+   * A single 64-bit hash is computed; the high 32 bits select the block and
+   * the low 32 bits generate the bit positions within the block by double
+   * hashing.  The mask is built as 64-bit words so the caller's loop over
+   * the block compiles to a few vector instructions.
+   *
+   * @param key Pointer to the key's data
+   * @param len Size of the data (in bytes)
+   * @param mask Receives the bits to set or test within the block
+   * @return Pointer to the block
+   */
+  uint64_t *probe_block(const void *key, size_t len, uint64_t *mask) const {
+    uint64_t hash = murmurhash64a(key, len, len);
+    size_t block = (size_t)(((hash >> 32) * m_num_blocks) >> 32);
+    uint32_t h = (uint32_t)hash;
+    uint32_t delta = (h >> 17) | (h << 15);
+    memset(mask, 0, BLOCK_BYTES);
+    for (size_t i = 0; i < m_num_hash_functions; ++i) {
+      uint32_t bit = h % BLOCK_BITS;
+      mask[bit / 64] |= (uint64_t)1 << (bit % 64);
+      h += delta;
+    }
+    return (uint64_t *)(m_bloom_bits + block * BLOCK_BYTES);
+  }
+
   /** The hash function implementation */
   HasherT    m_hasher;
 
@@ -313,6 +389,15 @@ private:
 
   /** The serialized bloom filter data, including metadata and checksums */
   uint8_t   *m_bloom_base;
+
+  /** Allocated memory holding #m_bloom_base */
+  uint8_t   *m_bloom_alloc;
+
+  /** Each item's bits are confined to a single cache line */
+  bool       m_blocked;
+
+  /** Number of blocks (blocked mode only) */
+  size_t     m_num_blocks {};
 };
 
 typedef BasicBloomFilterWithChecksum<> BloomFilterWithChecksum;
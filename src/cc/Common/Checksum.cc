@@ -19,7 +19,7 @@
 
 /** @file
  * Implementation of checksum routines.
- * This file implements the fletcher32 checksum algorithm.
+ * This file implements the fletcher32 and CRC32C checksum algorithms.
  */
 
 #include "Compat.h"
@@ -27,6 +27,14 @@
 #include <zlib.h>
 #include "Checksum.h"
 
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define HT_CRC32C_SSE42 1
+#endif
+
 namespace Hypertable {
 
 #define HT_F32_DO1(buf,i) \
@@ -83,6 +91,217 @@ fletcher32(const void *data8, size_t len8) {
   return (sum2 << 16) | sum1;
 }
 
+namespace {
+
+  /* Reflected CRC32C (Castagnoli) polynomial */
+  const uint32_t CRC32C_POLY = 0x82f63b78;
+
+  /* Lookup tables for slicing-by-8.  table[0] is the standard byte-at-a-time
+   * table, table[k][i] is the CRC of byte i followed by k zero bytes.
+   */
+  struct Crc32cTable {
+    Crc32cTable() {
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++)
+          crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+        table[0][i] = crc;
+      }
+      for (uint32_t i = 0; i < 256; i++)
+        for (int k = 1; k < 8; k++)
+          table[k][i] = (table[k-1][i] >> 8) ^ table[0][table[k-1][i] & 0xff];
+    }
+    uint32_t table[8][256];
+  };
+
+  uint32_t crc32c_sw(uint32_t crc, const uint8_t *data, size_t len) {
+    // Function-local so it is initialized before first use, even from
+    // static initializers in other translation units
+    static const Crc32cTable crc_table;
+    const uint32_t (*t)[256] = crc_table.table;
+
+    while (len && ((uintptr_t)data & 7)) {
+      crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+      len--;
+    }
+
+    while (len >= 8) {
+      uint32_t lo, hi;
+      memcpy(&lo, data, 4);
+      memcpy(&hi, data + 4, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      lo = __builtin_bswap32(lo);
+      hi = __builtin_bswap32(hi);
+#endif
+      lo ^= crc;
+      crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+        t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+        t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+        t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+      data += 8;
+      len -= 8;
+    }
+
+    while (len--)
+      crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+    return crc;
+  }
+
+#if defined(HT_CRC32C_SSE42)
+
+  /* The crc32 instruction has a latency of three cycles but a throughput
+   * of one per cycle, so larger buffers are processed as three interleaved
+   * streams whose CRCs are then combined.  Combining requires shifting a
+   * CRC over the length of the following streams, which is done with
+   * precomputed tables for two fixed stream lengths (see Mark Adler's
+   * crc32c.c).
+   */
+  const size_t CRC32C_LONG = 8192;
+  const size_t CRC32C_SHORT = 256;
+
+  /* Multiplies GF(2) matrix by vector */
+  uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec) {
+      if (vec & 1)
+        sum ^= *mat;
+      vec >>= 1;
+      mat++;
+    }
+    return sum;
+  }
+
+  /* Squares GF(2) matrix */
+  void gf2_matrix_square(uint32_t *square, const uint32_t *mat) {
+    for (int n = 0; n < 32; n++)
+      square[n] = gf2_matrix_times(mat, mat[n]);
+  }
+
+  /* Tables that shift a CRC over a fixed number of zero bytes, one table
+   * per byte of the CRC.
+   */
+  struct Crc32cShiftTable {
+    Crc32cShiftTable(size_t len) {
+      uint32_t even[32], odd[32];
+
+      /* Operator for one zero bit */
+      odd[0] = CRC32C_POLY;
+      for (int n = 1; n < 32; n++)
+        odd[n] = 1U << (n - 1);
+
+      gf2_matrix_square(even, odd);   /* two zero bits */
+      gf2_matrix_square(odd, even);   /* four zero bits */
+
+      /* Square until operator covers len zero bytes (len is power of 2) */
+      uint32_t *op = even;
+      while (true) {
+        gf2_matrix_square(even, odd);
+        op = even;
+        len >>= 1;
+        if (len == 0)
+          break;
+        gf2_matrix_square(odd, even);
+        op = odd;
+        len >>= 1;
+        if (len == 0)
+          break;
+      }
+
+      for (uint32_t n = 0; n < 256; n++) {
+        table[0][n] = gf2_matrix_times(op, n);
+        table[1][n] = gf2_matrix_times(op, n << 8);
+        table[2][n] = gf2_matrix_times(op, n << 16);
+        table[3][n] = gf2_matrix_times(op, n << 24);
+      }
+    }
+    uint32_t shift(uint32_t crc) const {
+      return table[0][crc & 0xff] ^ table[1][(crc >> 8) & 0xff] ^
+        table[2][(crc >> 16) & 0xff] ^ table[3][crc >> 24];
+    }
+    uint32_t table[4][256];
+  };
+
+  template <size_t LEN> __attribute__((target("sse4.2")))
+  void crc32c_hw_streams(uint64_t &crc0, const uint8_t *&data, size_t &len,
+                         const Crc32cShiftTable &shift) {
+    while (len >= LEN * 3) {
+      uint64_t crc1 = 0, crc2 = 0, word;
+      const uint8_t *end = data + LEN;
+      do {
+        memcpy(&word, data, 8);
+        crc0 = _mm_crc32_u64(crc0, word);
+        memcpy(&word, data + LEN, 8);
+        crc1 = _mm_crc32_u64(crc1, word);
+        memcpy(&word, data + 2 * LEN, 8);
+        crc2 = _mm_crc32_u64(crc2, word);
+        data += 8;
+      } while (data < end);
+      crc0 = shift.shift((uint32_t)crc0) ^ crc1;
+      crc0 = shift.shift((uint32_t)crc0) ^ crc2;
+      data += 2 * LEN;
+      len -= 3 * LEN;
+    }
+  }
+
+  __attribute__((target("sse4.2")))
+  uint32_t crc32c_hw(uint32_t crc, const uint8_t *data, size_t len) {
+    static const Crc32cShiftTable long_shift(CRC32C_LONG);
+    static const Crc32cShiftTable short_shift(CRC32C_SHORT);
+
+    while (len && ((uintptr_t)data & 7)) {
+      crc = _mm_crc32_u8(crc, *data++);
+      len--;
+    }
+
+    uint64_t crc64 = crc;
+    crc32c_hw_streams<CRC32C_LONG>(crc64, data, len, long_shift);
+    crc32c_hw_streams<CRC32C_SHORT>(crc64, data, len, short_shift);
+
+    while (len >= 8) {
+      uint64_t word;
+      memcpy(&word, data, 8);
+      crc64 = _mm_crc32_u64(crc64, word);
+      data += 8;
+      len -= 8;
+    }
+    crc = (uint32_t)crc64;
+
+    while (len--)
+      crc = _mm_crc32_u8(crc, *data++);
+
+    return crc;
+  }
+
+  bool have_sse42() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+  }
+
+#endif
+
+  std::atomic<int> default_algorithm {CHECKSUM_FLETCHER32};
+
+}
+
+uint32_t crc32c(const void *data, size_t len) {
+  const uint8_t *ptr = (const uint8_t *)data;
+#if defined(HT_CRC32C_SSE42)
+  static const bool use_hw = have_sse42();
+  if (use_hw)
+    return ~crc32c_hw(0xffffffff, ptr, len);
+#endif
+  return ~crc32c_sw(0xffffffff, ptr, len);
+}
+
+void set_default_checksum_algorithm(ChecksumAlgorithm algorithm) {
+  default_algorithm.store(algorithm, std::memory_order_relaxed);
+}
+
+ChecksumAlgorithm default_checksum_algorithm() {
+  return (ChecksumAlgorithm)default_algorithm.load(std::memory_order_relaxed);
+}
+
 } // namespace Hypertable
 
 /* vim: et sw=2
@@ -19,7 +19,7 @@
 
 /** @file
  * Implementation of checksum routines.
- * This file implements the fletcher32 checksum algorithm.
+ * This file declares the fletcher32 and CRC32C checksum algorithms.
  */
 
 #ifndef HYPERTABLE_CHECKSUM_H
@@ -41,6 +41,54 @@ namespace Hypertable {
    */
   extern uint32_t fletcher32(const void *data, size_t len);
 
+  /** Compute CRC32C (Castagnoli) checksum for arbitrary data.  Uses the
+   * SSE4.2 <code>crc32</code> instruction when the CPU supports it, and a
+   * table-driven (slicing-by-8) implementation otherwise.  Both produce
+   * identical results.
+   *
+   * @param data Pointer to the input data
+   * @param len Input data length in bytes
+   * @return The calculated checksum
+   */
+  extern uint32_t crc32c(const void *data, size_t len);
+
+  /** Checksum algorithms.  Values are recorded in the flags of serialized
+   * headers (see CommHeader and BlockHeader), so they must not change.
+   */
+  enum ChecksumAlgorithm {
+    CHECKSUM_FLETCHER32 = 0, ///< fletcher32()
+    CHECKSUM_CRC32C = 1      ///< crc32c()
+  };
+
+  /** Compute checksum with the given algorithm.
+   *
+   * @param algorithm Checksum algorithm
+   * @param data Pointer to the input data
+   * @param len Input data length in bytes
+   * @return The calculated checksum
+   */
+  inline uint32_t compute_checksum(ChecksumAlgorithm algorithm,
+                                   const void *data, size_t len) {
+    return algorithm == CHECKSUM_CRC32C ?
+      crc32c(data, len) : fletcher32(data, len);
+  }
+
+  /** Sets the checksum algorithm used for newly written data.  This is the
+   * algorithm used for outgoing message headers and for newly written
+   * commit log and cell store blocks.  Readers determine the algorithm from
+   * the header being read, so data written with either algorithm can always
+   * be validated.  Set from the <code>Hypertable.Checksum</code> property.
+   *
+   * @param algorithm Checksum algorithm
+   */
+  extern void set_default_checksum_algorithm(ChecksumAlgorithm algorithm);
+
+  /** Gets the checksum algorithm used for newly written data.
+   *
+   * @return Default checksum algorithm
+   */
+  extern ChecksumAlgorithm default_checksum_algorithm();
+
   /** @}*/
 
 } // namespace Hypertable
@@ -27,6 +27,7 @@
 
 #include <Common/Compat.h>
 #include <Common/Version.h>
+#include <Common/Checksum.h>
 #include <Common/Logger.h>
 #include <Common/String.h>
 #include <Common/Path.h>
@@ -180,8 +181,17 @@ void DefaultPolicy::init_options() {
         "Set system wide logging level (default: info)")
     ("Hypertable.DataDirectory", str()->default_value(default_data_dir),
         "Hypertable data directory root")
+    ("Hypertable.Checksum", str()->default_value("fletcher32"),
+        "Checksum algorithm for outgoing message headers and newly written "
+        "commit log and cell store blocks (fletcher32 or crc32c).  Data "
+        "written with either algorithm is always readable, but crc32c "
+        "should only be enabled once all servers and clients support it")
     ("Hypertable.Client.Workers", i32()->default_value(20),
         "Number of client worker threads created")
+    ("Hypertable.Client.ScanBlockEncoding", str()->default_value("PREFIX"),
+        "Encoding of scan result blocks requested from RangeServers: NONE, "
+        "or a '+' separated list of PREFIX (prefix-compress keys) and LZ4 "
+        "(LZ4-compress the whole block)")
     ("Hypertable.Connection.Retry.Interval", i32()->default_value(10000),
         "Average time, in milliseconds, between connection retry atempts")
     ("Hypertable.LogFlushMethod.Meta", str()->default_value("SYNC"),
@@ -259,6 +269,10 @@ void DefaultPolicy::init_options() {
         "Rename files with .deleted extension instead of removing (for testing)")
     ("FsBroker.Local.DirectIO", boo()->default_value(false),
         "Read and write files using direct i/o")
+    ("FsBroker.Local.MappedReads", boo()->default_value(false),
+        "Serve preads of files stored by a local broker on the same host "
+        "directly from memory-mapped files in the client process, bypassing "
+        "the broker (read by RangeServer only)")
     ("FsBroker.Local.Port", i16()->default_value(15863),
         "Port number on which to listen (read by LocalBroker only)")
     ("FsBroker.Local.Root", str(), "Root of file and directory "
@@ -330,6 +344,9 @@ void DefaultPolicy::init_options() {
         "load balancer to be overloaded")
     ("Hypertable.HqlInterpreter.Mutator.NoLogSync", boo()->default_value(false),
         "Suspends CommitLog sync operation on updates until command completion")
+    ("Hypertable.HqlInterpreter.LoadData.ParserThreads", i32()->default_value(4),
+        "Number of threads parsing LOAD DATA INFILE input in parallel; 0 "
+        "parses input on the loading thread")
     ("Hypertable.RangeLocator.MetadataReadaheadCount", i32()->default_value(10),
         "Number of rows that the RangeLocator fetches from the METADATA")
     ("Hypertable.RangeLocator.MaxErrorQueueLength", i32()->default_value(4),
@@ -406,6 +423,9 @@ void DefaultPolicy::init_options() {
      i32()->default_value(512*KiB), "Page size for CellCache pool allocator")
     ("Hypertable.RangeServer.AccessGroup.CellCache.ScannerCacheSize",
      i32()->default_value(1024), "CellCache scanner cache size")
+    ("Hypertable.RangeServer.AccessGroup.CellCache.SkipList",
+     boo()->default_value(false), "Store CellCache cells in a concurrent skip "
+     "list which scanners read without locking, instead of a std::map")
     ("Hypertable.RangeServer.AccessGroup.ShadowCache",
      boo()->default_value(false), "Enable CellStore shadow caching")
     ("Hypertable.RangeServer.AccessGroup.MaxMemory", i64()->default_value(1*G),
@@ -423,6 +443,10 @@ void DefaultPolicy::init_options() {
         "Trigger a merge if an adjacent run of merge candidate CellStores exceeds this length")
     ("Hypertable.RangeServer.CellStore.DefaultBlockSize",
         i32()->default_value(64*KiB), "Default block size for cell stores")
+    ("Hypertable.RangeServer.CellStore.BlockRestartInterval",
+        i32()->default_value(16), "Number of keys between restart points "
+        "(keys stored without prefix compression) within cell store blocks, "
+        "used to binary search blocks.  0 disables restart points")
     ("Hypertable.RangeServer.Data.DefaultReplication",
         i32()->default_value(-1), "Default replication for data")
     ("Hypertable.RangeServer.CellStore.DefaultCompressor",
@@ -443,6 +467,11 @@ void DefaultPolicy::init_options() {
         "Minimum size of block cache")
     ("Hypertable.RangeServer.BlockCache.MaxMemory", i64()->default_value(-1),
         "Maximum (target) size of block cache")
+    ("Hypertable.RangeServer.BlockCache.Shards", i32()->default_value(16),
+        "Number of independently locked shards in block cache")
+    ("Hypertable.RangeServer.BlockCache.AdmissionFilter",
+        boo()->default_value(true), "Only let a new block displace cached "
+        "blocks that are accessed less frequently (protects against scans)")
     ("Hypertable.RangeServer.QueryCache.EnableMutexStatistics",
      boo()->default_value(true), "Enable query cache mutex statistics")
     ("Hypertable.RangeServer.QueryCache.MaxMemory", i64()->default_value(50*M),
@@ -480,17 +509,25 @@ void DefaultPolicy::init_options() {
         "Roll commit log after this many bytes")
     ("Hypertable.RangeServer.CommitLog.Compressor",
         str()->default_value("quicklz"),
-       "Commit log compressor to use (zlib, lzo, quicklz, snappy, bmz, none)")
+       "Commit log compressor to use (zlib, lzo, quicklz, snappy, lz4, zstd, bmz, none)")
     ("Hypertable.RangeServer.Testing.MaintenanceNeeded.PauseInterval", i32()->default_value(0),
         "TESTING:  After update, if range needs maintenance, pause for this number of milliseconds")
     ("Hypertable.RangeServer.UpdateCoalesceLimit", i64()->default_value(5*M),
         "Amount of update data to coalesce into single commit log sync")
+    ("Hypertable.RangeServer.CommitLog.GroupCommit.TargetLatency",
+        i32()->default_value(0), "Maximum time, in milliseconds, that a commit "
+        "log sync may be held back to group more updates into it while "
+        "updates are queued behind it (0 syncs as soon as the previous sync "
+        "completes)")
     ("Hypertable.RangeServer.Failover.FlushLimit.PerRange",
      i32()->default_value(10*M), "Amount of updates (bytes) accumulated for a "
         "single range to trigger a replay buffer flush")
     ("Hypertable.RangeServer.Failover.FlushLimit.Aggregate",
      i64()->default_value(100*M), "Amount of updates (bytes) accumulated for "
         "all range to trigger a replay buffer flush")
+    ("Hypertable.RangeServer.Failover.ReplayThreads", i32()->default_value(4),
+        "Number of threads used to decompress commit log blocks and send "
+        "them to recovery receivers during commit log replay")
     ("Hypertable.RangeServer.ReadyStatus", str()->default_value("WARNING"),
         "Status code indicating RangeServer is ready for operation")
     ("Hypertable.Metadata.Replication", i32()->default_value(-1),
@@ -498,13 +535,30 @@ void DefaultPolicy::init_options() {
     ("Hypertable.CommitLog.RollLimit", i64()->default_value(100*M),
         "Roll commit log after this many bytes")
     ("Hypertable.CommitLog.Compressor", str()->default_value("quicklz"),
-        "Commit log compressor to use (zlib, lzo, quicklz, snappy, bmz, none)")
+        "Commit log compressor to use (zlib, lzo, quicklz, snappy, lz4, zstd, bmz, none)")
     ("Hypertable.CommitLog.SkipErrors", boo()->default_value(false),
         "Skip over any corruption encountered in the commit log")
     ("Hypertable.RangeServer.Scanner.Ttl", i32()->default_value(1800*K),
         "Number of milliseconds of inactivity before destroying scanners")
     ("Hypertable.RangeServer.Scanner.BufferSize", i64()->default_value(1*M),
         "Size of transfer buffer for scan results")
+    ("Hypertable.RangeServer.Scanner.Prefill.Threads", i32()->default_value(2),
+        "Number of threads that fill the next scan block of outstanding "
+        "scanners ahead of the fetch request (0 disables prefilling)")
+    ("Hypertable.RangeServer.Scanner.Prefill.MaxMemory", i64()->default_value(100*M),
+        "Maximum memory held by prefilled scan blocks waiting to be fetched")
+    ("Hypertable.RangeServer.IO.Background.Rate", i32()->default_value(0),
+        "Maximum rate in MB/s of filesystem reads and appends issued by "
+        "maintenance tasks (0 disables rate limiting)")
+    ("Hypertable.RangeServer.IO.Background.MinimumRate", i32()->default_value(8),
+        "Lower bound in MB/s for automatic reductions of the background I/O "
+        "rate")
+    ("Hypertable.RangeServer.IO.Foreground.TargetLatency", i32()->default_value(20),
+        "Average foreground read latency in milliseconds above which the "
+        "background I/O rate is reduced (0 disables automatic adjustment)")
+    ("Hypertable.RangeServer.Scanner.PrefetchDepth", i32()->default_value(8),
+        "Maximum number of asynchronous block reads a cell store scanner keeps "
+        "outstanding ahead of its current block (0 disables prefetching)")
     ("Hypertable.RangeServer.Timer.Interval", i32()->default_value(20000),
         "Timer interval in milliseconds (reaping scanners, purging commit logs, etc.)")
     ("Hypertable.RangeServer.Maintenance.Interval", i32()->default_value(30000),
@@ -517,6 +571,9 @@ void DefaultPolicy::init_options() {
         "Limit on number of merging tasks to create per maintenance interval")
     ("Hypertable.RangeServer.Maintenance.MergingCompaction.Delay", i32()->default_value(900000),
         "Millisecond delay before scheduling merging compactions in non-low memory mode")
+    ("Hypertable.RangeServer.Maintenance.MajorCompaction.Parallelism", i32(),
+        "Maximum number of sub-ranges of an access group that are compacted "
+        "concurrently during a major compaction.  Default is number-of-cores.")
     ("Hypertable.RangeServer.Maintenance.MoveCompactionsPerInterval", i32()->default_value(2),
         "Limit on number of major compactions due to move per maintenance interval")
     ("Hypertable.RangeServer.Maintenance.InitializationPerInterval", i32(),
@@ -547,7 +604,12 @@ void DefaultPolicy::init_options() {
     ("ThriftBroker.Mutator.FlushInterval", i32()->default_value(1000),
         "Maximum flush interval in milliseconds")
     ("ThriftBroker.Workers", i32()->default_value(50), "Number of "
-        "worker threads for thrift broker")
+        "worker threads for thrift broker (nonblocking server)")
+    ("ThriftBroker.Server", str()->default_value("threaded"), "Thrift server "
+        "type: threaded (one thread per connection) or nonblocking "
+        "(event-driven connections served by ThriftBroker.Workers threads)")
+    ("ThriftBroker.IOThreads", i32()->default_value(1), "Number of I/O "
+        "threads of the nonblocking thrift server")
     ("ThriftBroker.Hyperspace.Session.Reconnect", boo()->default_value(true),
         "ThriftBroker will reconnect to Hyperspace on session expiry")
     ("ThriftBroker.SlowQueryLog.Enable", boo()->default_value(true),
@@ -645,6 +707,16 @@ void DefaultPolicy::init() {
     HT_ERROR_OUT << "unknown logging level: "<< loglevel << HT_END;
     std::quick_exit(EXIT_SUCCESS);
   }
+  String checksum = get_str("Hypertable.Checksum");
+  if (checksum == "fletcher32")
+    set_default_checksum_algorithm(CHECKSUM_FLETCHER32);
+  else if (checksum == "crc32c")
+    set_default_checksum_algorithm(CHECKSUM_CRC32C);
+  else {
+    HT_ERROR_OUT << "unknown checksum algorithm: "<< checksum << HT_END;
+    std::quick_exit(EXIT_FAILURE);
+  }
+
   if (verbose) {
     HT_NOTICE_OUT << "Initializing " << System::exe_name << " (Hypertable "
         << version_string() << ")..." << HT_END;
@@ -380,6 +380,27 @@ namespace Hypertable {
     virtual void decode_response_pread(EventPtr &event, const void **buffer,
                                        uint64_t *offset, uint32_t *length) = 0;
 
+    /** Reads data from a file at the specified position without copying.
+     * Filesystems that can serve a read directly from memory (e.g. a
+     * memory-mapped local file) set <code>event->payload</code> to point to
+     * the requested data and return <i>true</i>.  The event holds a
+     * reference to the memory backing the data, so the data remains valid
+     * for the lifetime of the event, even after the file is closed.  The
+     * default implementation returns <i>false</i>, in which case the caller
+     * should fall back to pread().
+     *
+     * @param fd The open file descriptor
+     * @param len The amount of data to read
+     * @param offset The starting offset of read
+     * @param event Reference to event to hold the data
+     * @return <i>true</i> if <code>event</code> was populated with
+     * <code>len</code> bytes of data, <i>false</i> otherwise
+     */
+    virtual bool pread_view(int fd, size_t len, uint64_t offset,
+                            EventPtr &event) {
+      return false;
+    }
+
     /** Creates a directory asynchronously.  Issues a mkdirs request which
      * creates a directory, including all its missing parents.  The caller
      * will get notified of successful completion or error via the given
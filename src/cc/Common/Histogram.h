@@ -0,0 +1,151 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for Histogram.
+/// This file contains type declarations for Histogram, a histogram of
+/// unsigned integer samples with power-of-two buckets.
+
+#ifndef Common_Histogram_h
+#define Common_Histogram_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace Hypertable {
+
+  /// @addtogroup Common
+  /// @{
+
+  /// Histogram of unsigned integer samples with power-of-two buckets.
+  /// Bucket 0 counts samples equal to zero and bucket <i>i</i> counts samples
+  /// in the range [2<sup>i-1</sup>, 2<sup>i</sup>).  Percentiles are
+  /// therefore accurate to within a factor of two, which is enough to track
+  /// latency and batch size distributions at a fixed, small memory cost.
+  /// Access is not synchronized.
+  class Histogram {
+  public:
+
+    /// Number of buckets
+    static constexpr size_t BUCKETS = 65;
+
+    /// Constructor.
+    Histogram() { clear(); }
+
+    /// Adds a sample.
+    /// @param value Sample value
+    void add(uint64_t value) {
+      m_buckets[bucket(value)]++;
+      m_count++;
+      m_sum += value;
+      if (value > m_max)
+        m_max = value;
+    }
+
+    /// Adds all samples of another histogram.
+    /// @param other Histogram to merge
+    void merge(const Histogram &other) {
+      for (size_t i=0; i<BUCKETS; i++)
+        m_buckets[i] += other.m_buckets[i];
+      m_count += other.m_count;
+      m_sum += other.m_sum;
+      m_max = std::max(m_max, other.m_max);
+    }
+
+    /// Returns an estimate of a percentile.
+    /// The estimate is the upper bound of the bucket holding the
+    /// percentile, capped at the largest sample.
+    /// @param percentile Percentile in the range [0, 100]
+    /// @return Estimated value at <code>percentile</code>, or 0 if there are
+    /// no samples
+    uint64_t percentile(double percentile) const {
+      if (m_count == 0)
+        return 0;
+      uint64_t rank = (uint64_t)((percentile / 100.0) * m_count + 0.5);
+      if (rank == 0)
+        rank = 1;
+      uint64_t seen = 0;
+      for (size_t i=0; i<BUCKETS; i++) {
+        seen += m_buckets[i];
+        if (seen >= rank)
+          return std::min(upper_bound(i), m_max);
+      }
+      return m_max;
+    }
+
+    /// Returns number of samples.
+    /// @return Number of samples
+    uint64_t count() const { return m_count; }
+
+    /// Returns sum of samples.
+    /// @return Sum of samples
+    uint64_t sum() const { return m_sum; }
+
+    /// Returns largest sample.
+    /// @return Largest sample, or 0 if there are no samples
+    uint64_t max() const { return m_max; }
+
+    /// Returns mean of samples.
+    /// @return Mean of samples, or 0 if there are no samples
+    uint64_t mean() const { return m_count ? m_sum / m_count : 0; }
+
+    /// Removes all samples.
+    void clear() {
+      memset(m_buckets, 0, sizeof(m_buckets));
+      m_count = m_sum = m_max = 0;
+    }
+
+  private:
+
+    /// Returns bucket index of a sample.
+    static size_t bucket(uint64_t value) {
+      size_t i = 0;
+      while (value) {
+        value >>= 1;
+        i++;
+      }
+      return i;
+    }
+
+    /// Returns largest value counted in a bucket.
+    static uint64_t upper_bound(size_t i) {
+      return i == 0 ? 0 : (i == 64 ? UINT64_MAX : (((uint64_t)1 << i) - 1));
+    }
+
+    /// Sample count of each bucket
+    uint64_t m_buckets[BUCKETS];
+
+    /// Number of samples
+    uint64_t m_count;
+
+    /// Sum of samples
+    uint64_t m_sum;
+
+    /// Largest sample
+    uint64_t m_max;
+  };
+
+  /// @}
+
+}
+
+#endif // Common_Histogram_h
@@ -48,6 +48,16 @@ namespace Hypertable {
  */
 extern uint32_t murmurhash2(const void *data, size_t len, uint32_t hash);
 
+/**
+ * The 64-bit MurmurHash64A implementation (for 64-bit platforms)
+ *
+ * @param data Pointer to the input buffer
+ * @param len Size of the input buffer
+ * @param seed Initial seed for the hash
+ * @return The 64bit hash of the input buffer
+ */
+extern uint64_t murmurhash64a(const void *data, size_t len, uint64_t seed);
+
 /**
  * Helper structure using overloaded operator() to calculate hashes of various
  * input types.
@@ -172,6 +172,46 @@ struct BloomFilterTest {
 
     delete filter_with_checksum;
 
+    /*** Blocked ***/
+
+    filter_with_checksum = new BasicBloomFilterWithChecksum<HashT>(nitems, fp_prob, true);
+
+    cout << label << " (blocked)" << endl;
+
+    MEASURE("  insert", for (size_t i = 0; i < nitems; ++i)
+      filter_with_checksum->insert(items[i].data), nitems);
+
+    MEASURE("  true positives", for (size_t i = 0; i < nitems; ++i)
+      HT_ASSERT(filter_with_checksum->may_contain(items[i].data)), nitems);
+
+    false_positives = 0.;
+    MEASURE("  false positives",
+      for (size_t i = nitems, n = items.size(); i < n; ++i)
+        if (filter_with_checksum->may_contain(items[i].data))
+          ++false_positives, nfalses);
+
+    cout << "  false positive rate: expected "<< fp_prob <<", got "
+         << false_positives / nfalses << endl;
+
+    filter_with_checksum->serialize(sbuf);
+    StaticBuffer blocked_buf(sbuf.size);
+    memcpy(blocked_buf.base, sbuf.base, sbuf.size);
+    length = filter_with_checksum->get_length_bits();
+    num_hashes = filter_with_checksum->get_num_hashes();
+
+    delete filter_with_checksum;
+
+    filter_with_checksum = new BasicBloomFilterWithChecksum<HashT>(nitems, nitems, length, num_hashes, true);
+    memcpy(filter_with_checksum->base(), blocked_buf.base, blocked_buf.size);
+    String name("blocked");
+    filter_with_checksum->validate(name);
+
+    cout << label << " (blocked deserialized)" << endl;
+
+    MEASURE("  true positives", for (size_t i = 0; i < nitems; ++i)
+      HT_ASSERT(filter_with_checksum->may_contain(items[i].data)), nitems);
+
+    delete filter_with_checksum;
   }
 
   void run() {
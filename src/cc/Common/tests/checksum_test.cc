@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <Common/Compat.h>
+#include <Common/Checksum.h>
+#include <Common/Init.h>
+#include <Common/Logger.h>
+#include <Common/Random.h>
+#include <Common/Stopwatch.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace Hypertable;
+using namespace Config;
+using namespace std;
+
+namespace {
+
+  struct MyPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc("Usage: %s [Options]\n\n"
+        "  Verifies the fletcher32 and crc32c checksum implementations.  With\n"
+        "  --benchmark, measures the throughput of both on buffers of 1KB to\n"
+        "  1MB.\n\nOptions").add_options()
+        ("benchmark", "Measure checksum throughput")
+        ("bytes", i64()->default_value(256*M),
+         "Number of bytes to checksum per buffer size")
+        ;
+    }
+  };
+
+  typedef Cons<MyPolicy, DefaultPolicy> AppPolicy;
+
+  /// Bitwise CRC32C used as reference for the optimized implementation
+  uint32_t crc32c_reference(const uint8_t *data, size_t len) {
+    uint32_t crc = 0xffffffff;
+    while (len--) {
+      crc ^= *data++;
+      for (int i=0; i<8; i++)
+        crc = (crc >> 1) ^ (0x82f63b78 & (0 - (crc & 1)));
+    }
+    return ~crc;
+  }
+
+  void test_known_values() {
+    // Check values from RFC 3720, appendix B.4
+    uint8_t buf[32];
+    memset(buf, 0, sizeof(buf));
+    HT_ASSERT(crc32c(buf, sizeof(buf)) == 0x8a9136aa);
+    memset(buf, 0xff, sizeof(buf));
+    HT_ASSERT(crc32c(buf, sizeof(buf)) == 0x62a8ab43);
+    for (size_t i=0; i<sizeof(buf); i++)
+      buf[i] = i;
+    HT_ASSERT(crc32c(buf, sizeof(buf)) == 0x46dd794e);
+    HT_ASSERT(crc32c("123456789", 9) == 0xe3069283);
+    HT_ASSERT(crc32c(buf, 0) == 0);
+
+    HT_ASSERT(compute_checksum(CHECKSUM_CRC32C, "123456789", 9) == 0xe3069283);
+    HT_ASSERT(compute_checksum(CHECKSUM_FLETCHER32, "123456789", 9) ==
+              fletcher32("123456789", 9));
+  }
+
+  void test_alignments() {
+    vector<uint8_t> buf(100000 + 64);
+    for (auto &b : buf)
+      b = (uint8_t)Random::number32();
+    // Cover unaligned heads and tails of every length up to a few words
+    for (size_t offset=0; offset<16; offset++)
+      for (size_t len=0; len<300; len++)
+        HT_ASSERT(crc32c(buf.data() + offset, len) ==
+                  crc32c_reference(buf.data() + offset, len));
+    // Lengths that exercise the interleaved streams
+    for (size_t len : { 768, 1000, 4096, 3*8192, 3*8192 + 13, 100000 })
+      HT_ASSERT(crc32c(buf.data() + 3, len) ==
+                crc32c_reference(buf.data() + 3, len));
+  }
+
+  void benchmark(int64_t total_bytes) {
+    vector<uint8_t> buf(1024*1024);
+    for (auto &b : buf)
+      b = (uint8_t)Random::number32();
+
+    cout << setw(10) << "size" << setw(16) << "fletcher32"
+         << setw(16) << "crc32c" << endl;
+
+    uint32_t sum = 0;
+    for (size_t size=1024; size<=buf.size(); size *= 4) {
+      size_t iterations = max<int64_t>(1, total_bytes / size);
+      double mb = (double)size * iterations / (1024*1024);
+
+      Stopwatch fletcher_watch;
+      for (size_t i=0; i<iterations; i++)
+        sum += fletcher32(buf.data(), size);
+      fletcher_watch.stop();
+
+      Stopwatch crc_watch;
+      for (size_t i=0; i<iterations; i++)
+        sum += crc32c(buf.data(), size);
+      crc_watch.stop();
+
+      cout << setw(10) << size << setw(11) << fixed << setprecision(1)
+           << mb / fletcher_watch.elapsed() << " MB/s" << setw(11)
+           << mb / crc_watch.elapsed() << " MB/s" << endl;
+    }
+    // Keep the checksum loops from being optimized away
+    if (sum == 0)
+      cout << endl;
+  }
+
+}
+
+int main(int argc, char **argv) {
+  try {
+    init_with_policy<AppPolicy>(argc, argv);
+
+    test_known_values();
+    test_alignments();
+
+    if (has("benchmark"))
+      benchmark(get_i64("bytes"));
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+  return 0;
+}
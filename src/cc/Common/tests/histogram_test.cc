@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <Common/Compat.h>
+#include <Common/Histogram.h>
+#include <Common/Logger.h>
+
+#include <cstdlib>
+
+using namespace Hypertable;
+
+int main(int argc, char **argv) {
+  Histogram histogram;
+
+  HT_ASSERT(histogram.count() == 0);
+  HT_ASSERT(histogram.percentile(50) == 0);
+
+  // Zero has its own bucket
+  histogram.add(0);
+  HT_ASSERT(histogram.percentile(100) == 0);
+
+  // 1..1000
+  histogram.clear();
+  for (uint64_t i=1; i<=1000; i++)
+    histogram.add(i);
+  HT_ASSERT(histogram.count() == 1000);
+  HT_ASSERT(histogram.sum() == 500500);
+  HT_ASSERT(histogram.mean() == 500);
+  HT_ASSERT(histogram.max() == 1000);
+
+  // Median 500 falls in bucket [256, 512)
+  HT_ASSERT(histogram.percentile(50) == 511);
+  // Top percentiles are capped at the largest sample
+  HT_ASSERT(histogram.percentile(99) == 1000);
+  HT_ASSERT(histogram.percentile(100) == 1000);
+  HT_ASSERT(histogram.percentile(0) == 1);
+
+  // Skewed distribution: p50 small, p99 large
+  Histogram skewed;
+  for (int i=0; i<980; i++)
+    skewed.add(10);
+  for (int i=0; i<20; i++)
+    skewed.add(100000);
+  HT_ASSERT(skewed.percentile(50) == 15);
+  HT_ASSERT(skewed.percentile(99) == 100000);
+
+  // Merge
+  histogram.merge(skewed);
+  HT_ASSERT(histogram.count() == 2000);
+  HT_ASSERT(histogram.max() == 100000);
+
+  // Extremes
+  Histogram extreme;
+  extreme.add(UINT64_MAX);
+  HT_ASSERT(extreme.percentile(50) == UINT64_MAX);
+
+  return 0;
+}
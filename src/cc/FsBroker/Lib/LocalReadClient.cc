@@ -0,0 +1,263 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for LocalReadClient.
+/// This file contains definitions for LocalReadClient, a file system broker
+/// client that serves reads of local broker files in-process.
+
+#include <Common/Compat.h>
+
+#include "LocalReadClient.h"
+
+#include "Request/Handler/Factory.h"
+#include "Response/Parameters/Read.h"
+
+#include <Common/Error.h>
+#include <Common/FileUtils.h>
+#include <Common/Logger.h>
+#include <Common/Path.h>
+#include <Common/Serialization.h>
+#include <Common/System.h>
+#include <Common/SystemInfo.h>
+
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+using namespace Hypertable;
+using namespace Hypertable::FsBroker::Lib;
+using namespace std;
+
+LocalReadClient::LocalFile::~LocalFile() {
+  if (base)
+    munmap(base, length);
+  if (fd != -1)
+    ::close(fd);
+}
+
+LocalReadClient::LocalReadClient(ConnectionManagerPtr &conn_mgr,
+                                 PropertiesPtr &cfg)
+  : Client(conn_mgr, cfg) {
+  Path root;
+  if (cfg->has("DfsBroker.Local.Root"))
+    root = Path(cfg->get_str("DfsBroker.Local.Root"));
+  else if (cfg->has("FsBroker.Local.Root"))
+    root = Path(cfg->get_str("FsBroker.Local.Root"));
+  else
+    root = Path("fs/local");
+
+  if (!root.is_complete()) {
+    Path data_dir = cfg->get_str("Hypertable.DataDirectory");
+    root = data_dir / root;
+  }
+  m_rootdir = root.string();
+
+  if (cfg->has("DfsBroker.Local.DirectIO"))
+    m_directio = cfg->get_bool("DfsBroker.Local.DirectIO");
+  else
+    m_directio = cfg->get_bool("FsBroker.Local.DirectIO");
+#if defined(__linux__)
+  // disable direct i/o for kernels < 2.6
+  if (m_directio) {
+    if (System::os_info().version_major == 2 &&
+        System::os_info().version_minor < 6)
+      m_directio = false;
+  }
+#endif
+}
+
+int LocalReadClient::open(const String &name, uint32_t flags) {
+  int fd = Client::open(name, flags);
+
+  String abspath;
+  if (name[0] == '/')
+    abspath = m_rootdir + name;
+  else
+    abspath = m_rootdir + "/" + name;
+
+  int oflags = O_RDONLY;
+  bool directio = m_directio && (flags & Filesystem::OPEN_FLAG_DIRECTIO);
+#ifdef O_DIRECT
+  if (directio)
+    oflags |= O_DIRECT;
+#else
+  directio = false;
+#endif
+
+  auto file = make_shared<LocalFile>();
+
+  if ((file->fd = ::open(abspath.c_str(), oflags)) == -1) {
+    HT_WARNF("Unable to open %s locally, reading through broker - %s",
+             abspath.c_str(), strerror(errno));
+    return fd;
+  }
+
+  struct stat statbuf;
+  if (fstat(file->fd, &statbuf) != 0) {
+    HT_WARNF("fstat(%s) failed, reading through broker - %s",
+             abspath.c_str(), strerror(errno));
+    return fd;
+  }
+  file->length = statbuf.st_size;
+
+  if (!directio) {
+    // Empty files cannot be mapped, reads go to the broker
+    if (file->length == 0)
+      return fd;
+    void *base = mmap(0, file->length, PROT_READ, MAP_SHARED, file->fd, 0);
+    if (base == MAP_FAILED) {
+      HT_WARNF("mmap(%s) failed, reading through broker - %s",
+               abspath.c_str(), strerror(errno));
+      return fd;
+    }
+    file->base = (uint8_t *)base;
+  }
+
+  lock_guard<mutex> lock(m_mutex);
+  m_files[fd] = file;
+  return fd;
+}
+
+void LocalReadClient::close(int32_t fd, DispatchHandler *handler) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_files.erase(fd);
+  }
+  Client::close(fd, handler);
+}
+
+void LocalReadClient::close(int32_t fd) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_files.erase(fd);
+  }
+  Client::close(fd);
+}
+
+void LocalReadClient::pread(int32_t fd, size_t len, uint64_t offset,
+                            bool verify_checksum, DispatchHandler *handler) {
+  LocalFilePtr file = get_local_file(fd);
+
+  if (file && offset + len <= file->length) {
+    EventPtr data_event;
+    try {
+      read_region(file, len, offset, data_event);
+    }
+    catch (Exception &e) {
+      HT_WARN_OUT << e << HT_END;
+      Client::pread(fd, len, offset, verify_checksum, handler);
+      return;
+    }
+
+    // Format the data as a broker pread response
+    Response::Parameters::Read params(offset, len);
+    size_t payload_len = 4 + params.encoded_length() + len;
+    uint8_t *payload = new uint8_t [payload_len];
+    uint8_t *ptr = payload;
+    Serialization::encode_i32(&ptr, Error::OK);
+    params.encode(&ptr);
+    memcpy(ptr, data_event->payload, len);
+
+    EventPtr event = make_shared<Event>(Event::MESSAGE);
+    event->header.command = Request::Handler::Factory::FUNCTION_PREAD;
+    event->header.gid = fd;
+    event->payload = payload;
+    event->payload_len = payload_len;
+    handler->handle(event);
+    return;
+  }
+
+  Client::pread(fd, len, offset, verify_checksum, handler);
+}
+
+size_t LocalReadClient::pread(int32_t fd, void *dst, size_t len,
+                              uint64_t offset, bool verify_checksum) {
+  LocalFilePtr file = get_local_file(fd);
+
+  if (file && offset + len <= file->length) {
+    if (file->base)
+      memcpy(dst, file->base + offset, len);
+    else {
+      EventPtr event;
+      read_region(file, len, offset, event);
+      memcpy(dst, event->payload, len);
+    }
+    return len;
+  }
+
+  return Client::pread(fd, dst, len, offset, verify_checksum);
+}
+
+bool LocalReadClient::pread_view(int fd, size_t len, uint64_t offset,
+                                 EventPtr &event) {
+  LocalFilePtr file = get_local_file(fd);
+  if (!file || offset + len > file->length)
+    return false;
+  read_region(file, len, offset, event);
+  return true;
+}
+
+LocalReadClient::LocalFilePtr LocalReadClient::get_local_file(int32_t fd) {
+  lock_guard<mutex> lock(m_mutex);
+  auto iter = m_files.find(fd);
+  return iter == m_files.end() ? LocalFilePtr() : iter->second;
+}
+
+void LocalReadClient::read_region(LocalFilePtr &file, size_t len,
+                                  uint64_t offset, EventPtr &event) {
+  event = make_shared<Event>(Event::MESSAGE);
+  event->payload_len = len;
+
+  if (file->base) {
+    // Event shares ownership of the mapping
+    event->payload_buffer = ReceiveBufferPtr(file, file->base);
+    event->payload = file->base + offset;
+    return;
+  }
+
+  // O_DIRECT requires aligned offset, length, and buffer
+  uint64_t aligned_offset = offset & ~(uint64_t)(HT_DIRECT_IO_ALIGNMENT - 1);
+  size_t skip = offset - aligned_offset;
+  size_t amount = skip + len;
+  if (!HT_IO_ALIGNED(amount))
+    amount += HT_DIRECT_IO_ALIGNMENT - (amount % HT_DIRECT_IO_ALIGNMENT);
+
+  void *buf;
+  if (posix_memalign(&buf, HT_DIRECT_IO_ALIGNMENT, amount) != 0)
+    HT_THROWF(Error::FSBROKER_IO_ERROR, "posix_memalign(%llu) failed",
+              (Llu)amount);
+  event->payload_buffer = ReceiveBufferPtr((uint8_t *)buf, free);
+
+  ssize_t nread = FileUtils::pread(file->fd, buf, amount, (off_t)aligned_offset);
+  if (nread < (ssize_t)(skip + len))
+    HT_THROWF(Error::FSBROKER_IO_ERROR,
+              "pread(fd=%d, amount=%llu, offset=%llu) returned %lld - %s",
+              file->fd, (Llu)amount, (Llu)aligned_offset, (Lld)nread,
+              nread < 0 ? strerror(errno) : "short read");
+  event->payload = (uint8_t *)buf + skip;
+}
@@ -0,0 +1,141 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for LocalReadClient.
+/// This file contains declarations for LocalReadClient, a file system broker
+/// client that serves reads of local broker files in-process.
+
+#ifndef FsBroker_Lib_LocalReadClient_h
+#define FsBroker_Lib_LocalReadClient_h
+
+#include <FsBroker/Lib/Client.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Hypertable {
+namespace FsBroker {
+namespace Lib {
+
+  /// @addtogroup FsBrokerLib
+  /// @{
+
+  /// Client for a local FS broker running on the same host.
+  /// All requests are sent to the broker, except positional reads of files
+  /// opened for reading, which are served directly from the local
+  /// filesystem.  When a file is opened, it is also opened locally, under
+  /// the broker's root directory (<code>FsBroker.Local.Root</code>), and
+  /// memory-mapped.  Subsequent pread() and pread_view() calls on the file
+  /// descriptor are satisfied from the mapping without a broker round trip,
+  /// and pread_view() hands out the mapped data without copying it.  Files
+  /// opened with Filesystem::OPEN_FLAG_DIRECTIO, when
+  /// <code>FsBroker.Local.DirectIO</code> is enabled, are not mapped but
+  /// read with <code>O_DIRECT</code> into aligned buffers instead, so they
+  /// continue to bypass the page cache.  If a file cannot be opened or
+  /// mapped locally, or a read extends beyond the length of the file at the
+  /// time it was opened, the request is sent to the broker.
+  class LocalReadClient : public Client {
+  public:
+
+    /// Constructor.
+    /// Connects to the broker given by the <code>FsBroker.Host</code> and
+    /// <code>FsBroker.Port</code> properties and determines the local root
+    /// directory from <code>FsBroker.Local.Root</code>.
+    /// @param conn_mgr Connection manager
+    /// @param cfg Configuration properties
+    LocalReadClient(ConnectionManagerPtr &conn_mgr, PropertiesPtr &cfg);
+
+    /// Destructor.
+    virtual ~LocalReadClient() { }
+
+    using Client::open;
+    int open(const String &name, uint32_t flags) override;
+
+    void close(int32_t fd, DispatchHandler *handler) override;
+    void close(int32_t fd) override;
+
+    /// Reads data asynchronously.
+    /// If <code>fd</code> is served locally, the data is read immediately
+    /// and a MESSAGE event, formatted like a broker pread response, is
+    /// delivered to <code>handler</code> from the calling thread.
+    /// Otherwise the request is sent to the broker.
+    void pread(int32_t fd, size_t len, uint64_t offset,
+               bool verify_checksum, DispatchHandler *handler) override;
+    size_t pread(int32_t fd, void *dst, size_t len, uint64_t offset,
+                 bool verify_checksum) override;
+
+    bool pread_view(int fd, size_t len, uint64_t offset,
+                    EventPtr &event) override;
+
+  private:
+
+    /// Locally opened file
+    class LocalFile {
+    public:
+      ~LocalFile();
+      /// Local file descriptor
+      int fd {-1};
+      /// Base of mapping, or nullptr if file is read with O_DIRECT
+      uint8_t *base {};
+      /// Length of file when opened
+      uint64_t length {};
+    };
+
+    /// Smart pointer to LocalFile
+    typedef std::shared_ptr<LocalFile> LocalFilePtr;
+
+    /// Looks up locally opened file.
+    /// @param fd Broker file descriptor
+    /// @return Locally opened file, or nullptr if <code>fd</code> is not
+    /// served locally
+    LocalFilePtr get_local_file(int32_t fd);
+
+    /// Reads a file region into an event.
+    /// Sets <code>event->payload</code> to a slice of the mapping or, for
+    /// O_DIRECT files, to an aligned buffer containing the data.
+    /// @param file Locally opened file
+    /// @param len Amount of data to read
+    /// @param offset Starting offset of read
+    /// @param event Event to hold the data
+    void read_region(LocalFilePtr &file, size_t len, uint64_t offset,
+                     EventPtr &event);
+
+    /// %Mutex protecting #m_files
+    std::mutex m_mutex;
+
+    /// Root directory of local broker
+    std::string m_rootdir;
+
+    /// Read files opened with OPEN_FLAG_DIRECTIO using O_DIRECT
+    bool m_directio {};
+
+    /// Map of broker file descriptors to locally opened files
+    std::unordered_map<int32_t, LocalFilePtr> m_files;
+  };
+
+  /// @}
+
+}}}
+
+#endif // FsBroker_Lib_LocalReadClient_h
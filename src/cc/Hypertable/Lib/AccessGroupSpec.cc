@@ -46,7 +46,7 @@ namespace {
   bool desc_inited = false;
 
   PropertiesDesc
-  compressor_desc("  bmz|lzo|quicklz|zlib|snappy|none [compressor_options]\n\n"
+  compressor_desc("  bmz|lzo|quicklz|zlib|snappy|lz4|zstd|none [compressor_options]\n\n"
                   "compressor_options"),
     bloomfilter_desc("  rows|rows+cols|none [bloomfilter_options]\n\n"
                       "  Default bloom filter is defined by the config property:\n"
@@ -67,10 +67,14 @@ namespace {
       ("normal", "Normal setting for zlib")
       ("fp-len", i16()->default_value(19), "Minimum fingerprint length for bmz")
       ("offset", i16()->default_value(0), "Starting fingerprint offset for bmz")
+      ("acceleration", i32(), "Acceleration factor for lz4")
+      ("level", i32(), "Compression level for zstd")
+      ("dictionary-size", i32(), "Size of compression dictionary to train "
+       "for zstd")
       ;
     compressor_hidden_desc.add_options()
       ("compressor-type", str(), 
-       "Compressor type (bmz|lzo|quicklz|zlib|snappy|none)")
+       "Compressor type (bmz|lzo|quicklz|zlib|snappy|lz4|zstd|none)")
       ;
     compressor_pos_desc.add("compressor-type", 1);
 
@@ -83,6 +87,8 @@ namespace {
        "probability for the Bloom filter")
       ("max-approx-items", i32()->default_value(1000), "Number of cell store "
        "items used to guess the number of actual Bloom filter entries")
+      ("blocked", "Confine the bits of each item to a single 64-byte cache "
+       "line (one cache miss per lookup, slightly higher false positive rate)")
       ;
     bloomfilter_hidden_desc.add_options()
       ("bloom-filter-mode", str(), "Bloom filter mode (rows|rows+cols|none)")
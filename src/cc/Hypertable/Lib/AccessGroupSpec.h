@@ -113,6 +113,8 @@ namespace Hypertable {
     ///   quicklz
     ///   zlib [--best|--9|--normal]
     ///   snappy
+    ///   lz4 [--acceleration &lt;int&gt;]
+    ///   zstd [--level &lt;int&gt;] [--dictionary-size &lt;int&gt;]
     ///   none
     /// </pre>
     /// @param compressor Compressor specification
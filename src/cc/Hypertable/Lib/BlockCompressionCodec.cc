@@ -37,7 +37,9 @@ namespace {
     "zlib",
     "lzo",
     "quicklz",
-    "snappy"
+    "snappy",
+    "lz4",
+    "zstd"
   };
 }
 
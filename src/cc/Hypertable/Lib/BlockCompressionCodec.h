@@ -56,9 +56,28 @@ namespace Hypertable {
       LZO=3,      ///< LZO compression
       QUICKLZ=4,  ///< QuickLZ 1.5 compession
       SNAPPY=5,   ///< Snappy compression
-      COMPRESSION_TYPE_LIMIT=6  ///< Limit of compression types
+      LZ4=6,      ///< LZ4 compression
+      ZSTD=7,     ///< Zstandard compression
+      COMPRESSION_TYPE_LIMIT=8  ///< Limit of compression types
     };
 
+    /// Compression dictionary.
+    /// Codec-specific dictionary that can be shared by several codec
+    /// instances.  Created with load_dictionary() or train_dictionary() of a
+    /// codec of the same type.
+    class Dictionary {
+    public:
+      /// Destructor.
+      virtual ~Dictionary() { }
+      /// Returns pointer to serialized dictionary.
+      virtual const uint8_t *data() const = 0;
+      /// Returns size of serialized dictionary.
+      virtual size_t size() const = 0;
+    };
+
+    /// Smart pointer to Dictionary
+    typedef std::shared_ptr<Dictionary> DictionaryPtr;
+
     /// Compression codec argument vector.
     typedef std::vector<String> Args;
 
@@ -103,6 +122,39 @@ namespace Hypertable {
     /// @return Compressor type
     virtual int get_type() = 0;
 
+    /// Returns requested dictionary size.
+    /// Codecs that support dictionaries return the dictionary size requested
+    /// by their arguments, in which case the caller is expected to collect
+    /// samples and call train_dictionary().  The default implementation
+    /// returns 0.
+    /// @return Requested dictionary size, 0 if dictionaries not supported
+    virtual size_t dictionary_size() { return 0; }
+
+    /// Trains a dictionary from sample data.
+    /// The default implementation returns a null pointer.
+    /// @param samples Sample data, concatenated
+    /// @param sample_sizes Sizes of individual samples in <code>samples</code>
+    /// @return Trained dictionary, or null if dictionary could not be trained
+    virtual DictionaryPtr
+    train_dictionary(const DynamicBuffer &samples,
+                     const std::vector<size_t> &sample_sizes) {
+      return DictionaryPtr();
+    }
+
+    /// Loads a serialized dictionary.
+    /// The default implementation returns a null pointer.
+    /// @param data Serialized dictionary
+    /// @param len Length of serialized dictionary
+    /// @return Dictionary, or null if dictionaries not supported
+    virtual DictionaryPtr load_dictionary(const uint8_t *data, size_t len) {
+      return DictionaryPtr();
+    }
+
+    /// Sets dictionary used by deflate() and inflate().
+    /// The default implementation ignores the dictionary.
+    /// @param dictionary Dictionary created by a codec of the same type
+    virtual void set_dictionary(DictionaryPtr dictionary) { }
+
   };
 
   /// Smart pointer to BlockCompressionCodec
@@ -0,0 +1,131 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for BlockCompressionCodecLz4.
+/// This file contains definitions for BlockCompressionCodecLz4, a class
+/// for compressing blocks using the LZ4 compression algorithm.
+
+#include <Common/Compat.h>
+
+#include "BlockCompressionCodecLz4.h"
+
+#include <Common/Checksum.h>
+#include <Common/DynamicBuffer.h>
+#include <Common/Logger.h>
+
+#include <lz4.h>
+
+#include <cstdlib>
+
+using namespace Hypertable;
+
+void BlockCompressionCodecLz4::set_args(const Args &args) {
+  Args::const_iterator it = args.begin(), arg_end = args.end();
+
+  for (; it != arg_end; ++it) {
+    if (*it == "--acceleration" && it+1 != arg_end) {
+      ++it;
+      m_acceleration = atoi(it->c_str());
+      if (m_acceleration < 1)
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Invalid LZ4 "
+                  "acceleration: '%s'", it->c_str());
+    }
+    else
+      HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Unrecognized argument "
+                "to LZ4 codec: '%s'", (*it).c_str());
+  }
+}
+
+void
+BlockCompressionCodecLz4::deflate(const DynamicBuffer &input,
+    DynamicBuffer &output, BlockHeader &header, size_t reserve) {
+  int bound = LZ4_compressBound(input.fill());
+  output.reserve(header.encoded_length() + bound + reserve);
+
+  int outlen = LZ4_compress_fast((const char *)input.base,
+                                 (char *)output.base + header.encoded_length(),
+                                 input.fill(), bound, m_acceleration);
+
+  /* check for an incompressible block */
+  if (outlen <= 0 || (size_t)outlen >= input.fill()) {
+    header.set_compression_type(NONE);
+    memcpy(output.base+header.encoded_length(), input.base, input.fill());
+    header.set_data_length(input.fill());
+    header.set_data_zlength(input.fill());
+  }
+  else {
+    header.set_compression_type(LZ4);
+    header.set_data_length(input.fill());
+    header.set_data_zlength(outlen);
+  }
+
+  header.set_data_checksum(header.compute_checksum(output.base + header.encoded_length(),
+                header.get_data_zlength()));
+
+  output.ptr = output.base;
+  header.encode(&output.ptr);
+  output.ptr += header.get_data_zlength();
+}
+
+
+void
+BlockCompressionCodecLz4::inflate(const DynamicBuffer &input,
+    DynamicBuffer &output, BlockHeader &header) {
+  const uint8_t *msg_ptr = input.base;
+  size_t remaining = input.fill();
+
+  header.decode(&msg_ptr, &remaining);
+
+  if (header.get_data_zlength() > remaining)
+    HT_THROWF(Error::BLOCK_COMPRESSOR_BAD_HEADER, "Block decompression error, "
+              "header zlength = %lu, actual = %lu",
+              (Lu)header.get_data_zlength(), (Lu)remaining);
+
+  uint32_t checksum = header.compute_checksum(msg_ptr, header.get_data_zlength());
+
+  if (checksum != header.get_data_checksum())
+    HT_THROWF(Error::BLOCK_COMPRESSOR_CHECKSUM_MISMATCH, "Compressed block "
+              "checksum mismatch header=%lx, computed=%lx",
+              (Lu)header.get_data_checksum(), (Lu)checksum);
+
+  try {
+    output.reserve(header.get_data_length());
+
+    // check compress bit
+    if (header.get_compression_type() == NONE)
+      memcpy(output.base, msg_ptr, header.get_data_length());
+    else {
+      int len = LZ4_decompress_safe((const char *)msg_ptr, (char *)output.base,
+                                    header.get_data_zlength(),
+                                    header.get_data_length());
+      if (len < 0 || (uint32_t)len != header.get_data_length())
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INFLATE_ERROR, "%s",
+                  "Compressed block inflate error");
+    }
+
+    output.ptr = output.base + header.get_data_length();
+  }
+  catch (Exception &e) {
+    output.free();
+    throw;
+  }
+}
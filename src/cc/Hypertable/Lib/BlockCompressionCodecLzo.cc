@@ -91,7 +91,7 @@ BlockCompressionCodecLzo::deflate(const DynamicBuffer &input,
     header.set_data_length(input.fill());
     header.set_data_zlength(out_len);
   }
-  header.set_data_checksum(fletcher32(output.base + header.encoded_length(),
+  header.set_data_checksum(header.compute_checksum(output.base + header.encoded_length(),
                            header.get_data_zlength()));
 
   output.ptr = output.base;
@@ -122,7 +122,7 @@ BlockCompressionCodecLzo::inflate(const DynamicBuffer &input,
     HT_THROW(Error::BLOCK_COMPRESSOR_BAD_HEADER, "");
   }
 
-  uint32_t checksum = fletcher32(msg_ptr, header.get_data_zlength());
+  uint32_t checksum = header.compute_checksum(msg_ptr, header.get_data_zlength());
   if (checksum != header.get_data_checksum()) {
     HT_ERRORF("Compressed block checksum mismatch header=%u, computed=%u",
               header.get_data_checksum(), checksum);
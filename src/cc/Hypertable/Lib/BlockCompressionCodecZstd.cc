@@ -0,0 +1,213 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for BlockCompressionCodecZstd.
+/// This file contains definitions for BlockCompressionCodecZstd, a class
+/// for compressing blocks using the Zstandard compression algorithm.
+
+#include <Common/Compat.h>
+
+#include "BlockCompressionCodecZstd.h"
+
+#include <Common/Checksum.h>
+#include <Common/DynamicBuffer.h>
+#include <Common/Logger.h>
+
+#include <zdict.h>
+
+#include <cstdlib>
+
+using namespace Hypertable;
+using namespace std;
+
+BlockCompressionCodecZstd::ZstdDictionary::ZstdDictionary(const uint8_t *data,
+                                                          size_t len, int level)
+  : m_data((const char *)data, len) {
+  cdict = ZSTD_createCDict(m_data.data(), m_data.size(), level);
+  ddict = ZSTD_createDDict(m_data.data(), m_data.size());
+  if (cdict == nullptr || ddict == nullptr)
+    HT_THROW(Error::BLOCK_COMPRESSOR_INIT_ERROR,
+             "Unable to create zstd dictionary");
+}
+
+BlockCompressionCodecZstd::ZstdDictionary::~ZstdDictionary() {
+  ZSTD_freeCDict(cdict);
+  ZSTD_freeDDict(ddict);
+}
+
+BlockCompressionCodecZstd::BlockCompressionCodecZstd(const Args &args) {
+  set_args(args);
+}
+
+BlockCompressionCodecZstd::~BlockCompressionCodecZstd() {
+  ZSTD_freeCCtx(m_cctx);
+  ZSTD_freeDCtx(m_dctx);
+}
+
+void BlockCompressionCodecZstd::set_args(const Args &args) {
+  Args::const_iterator it = args.begin(), arg_end = args.end();
+
+  for (; it != arg_end; ++it) {
+    if (*it == "--level" && it+1 != arg_end) {
+      ++it;
+      m_level = atoi(it->c_str());
+      if (m_level < 1 || m_level > ZSTD_maxCLevel())
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Invalid zstd "
+                  "compression level: '%s'", it->c_str());
+    }
+    else if (*it == "--dictionary-size" && it+1 != arg_end) {
+      ++it;
+      int size = atoi(it->c_str());
+      if (size < 0)
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Invalid zstd "
+                  "dictionary size: '%s'", it->c_str());
+      m_dictionary_size = size;
+    }
+    else
+      HT_THROWF(Error::BLOCK_COMPRESSOR_INVALID_ARG, "Unrecognized argument "
+                "to zstd codec: '%s'", (*it).c_str());
+  }
+}
+
+void
+BlockCompressionCodecZstd::deflate(const DynamicBuffer &input,
+    DynamicBuffer &output, BlockHeader &header, size_t reserve) {
+  size_t bound = ZSTD_compressBound(input.fill());
+  output.reserve(header.encoded_length() + bound + reserve);
+
+  if (m_cctx == nullptr)
+    m_cctx = ZSTD_createCCtx();
+
+  size_t outlen;
+  if (m_dictionary)
+    outlen = ZSTD_compress_usingCDict(m_cctx,
+                                      output.base + header.encoded_length(),
+                                      bound, input.base, input.fill(),
+                                      m_dictionary->cdict);
+  else
+    outlen = ZSTD_compressCCtx(m_cctx, output.base + header.encoded_length(),
+                               bound, input.base, input.fill(), m_level);
+
+  /* check for an incompressible block */
+  if (ZSTD_isError(outlen) || outlen >= input.fill()) {
+    header.set_compression_type(NONE);
+    memcpy(output.base+header.encoded_length(), input.base, input.fill());
+    header.set_data_length(input.fill());
+    header.set_data_zlength(input.fill());
+  }
+  else {
+    header.set_compression_type(ZSTD);
+    header.set_data_length(input.fill());
+    header.set_data_zlength(outlen);
+  }
+
+  header.set_data_checksum(header.compute_checksum(output.base + header.encoded_length(),
+                header.get_data_zlength()));
+
+  output.ptr = output.base;
+  header.encode(&output.ptr);
+  output.ptr += header.get_data_zlength();
+}
+
+
+void
+BlockCompressionCodecZstd::inflate(const DynamicBuffer &input,
+    DynamicBuffer &output, BlockHeader &header) {
+  const uint8_t *msg_ptr = input.base;
+  size_t remaining = input.fill();
+
+  header.decode(&msg_ptr, &remaining);
+
+  if (header.get_data_zlength() > remaining)
+    HT_THROWF(Error::BLOCK_COMPRESSOR_BAD_HEADER, "Block decompression error, "
+              "header zlength = %lu, actual = %lu",
+              (Lu)header.get_data_zlength(), (Lu)remaining);
+
+  uint32_t checksum = header.compute_checksum(msg_ptr, header.get_data_zlength());
+
+  if (checksum != header.get_data_checksum())
+    HT_THROWF(Error::BLOCK_COMPRESSOR_CHECKSUM_MISMATCH, "Compressed block "
+              "checksum mismatch header=%lx, computed=%lx",
+              (Lu)header.get_data_checksum(), (Lu)checksum);
+
+  try {
+    output.reserve(header.get_data_length());
+
+    // check compress bit
+    if (header.get_compression_type() == NONE)
+      memcpy(output.base, msg_ptr, header.get_data_length());
+    else {
+      if (m_dctx == nullptr)
+        m_dctx = ZSTD_createDCtx();
+      size_t len;
+      if (m_dictionary)
+        len = ZSTD_decompress_usingDDict(m_dctx, output.base,
+                                         header.get_data_length(), msg_ptr,
+                                         header.get_data_zlength(),
+                                         m_dictionary->ddict);
+      else
+        len = ZSTD_decompressDCtx(m_dctx, output.base,
+                                  header.get_data_length(), msg_ptr,
+                                  header.get_data_zlength());
+      if (ZSTD_isError(len))
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INFLATE_ERROR,
+                  "Compressed block inflate error - %s",
+                  ZSTD_getErrorName(len));
+      if (len != header.get_data_length())
+        HT_THROWF(Error::BLOCK_COMPRESSOR_INFLATE_ERROR, "Compressed block "
+                  "inflate error, expected %lu bytes, got %lu",
+                  (Lu)header.get_data_length(), (Lu)len);
+    }
+
+    output.ptr = output.base + header.get_data_length();
+  }
+  catch (Exception &e) {
+    output.free();
+    throw;
+  }
+}
+
+BlockCompressionCodec::DictionaryPtr
+BlockCompressionCodecZstd::train_dictionary(const DynamicBuffer &samples,
+                                            const vector<size_t> &sample_sizes) {
+  if (m_dictionary_size == 0 || sample_sizes.empty())
+    return DictionaryPtr();
+
+  string buf(m_dictionary_size, '\0');
+  size_t len = ZDICT_trainFromBuffer(&buf[0], buf.size(), samples.base,
+                                     sample_sizes.data(), sample_sizes.size());
+  if (ZDICT_isError(len)) {
+    HT_INFOF("Unable to train zstd dictionary from %lu samples - %s",
+             (Lu)sample_sizes.size(), ZDICT_getErrorName(len));
+    return DictionaryPtr();
+  }
+  return make_shared<ZstdDictionary>((const uint8_t *)buf.data(), len, m_level);
+}
+
+BlockCompressionCodec::DictionaryPtr
+BlockCompressionCodecZstd::load_dictionary(const uint8_t *data, size_t len) {
+  return make_shared<ZstdDictionary>(data, len, m_level);
+}
+
+void BlockCompressionCodecZstd::set_dictionary(DictionaryPtr dictionary) {
+  m_dictionary = dynamic_pointer_cast<ZstdDictionary>(dictionary);
+}
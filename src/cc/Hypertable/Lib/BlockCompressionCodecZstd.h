@@ -0,0 +1,165 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for BlockCompressionCodecZstd.
+/// This file contains declarations for BlockCompressionCodecZstd, a class
+/// for compressing blocks using the Zstandard compression algorithm.
+
+#ifndef Hypertable_Lib_BlockCompressionCodecZstd_h
+#define Hypertable_Lib_BlockCompressionCodecZstd_h
+
+#include <Hypertable/Lib/BlockCompressionCodec.h>
+
+#include <zstd.h>
+
+namespace Hypertable {
+
+  /// @addtogroup libHypertable
+  /// @{
+
+  /// Block compressor that uses the Zstandard algorithm.
+  /// This class provides a way to compress and decompress blocks of data using
+  /// the <i>zstd</i> algorithm, which offers compression ratios close to zlib
+  /// with much faster decompression.  Small blocks of similar data compress
+  /// considerably better with a shared dictionary, so the codec supports
+  /// training, loading, and using a dictionary (see set_dictionary()).
+  class BlockCompressionCodecZstd : public BlockCompressionCodec {
+
+  public:
+
+    /// Zstandard dictionary.
+    /// Holds the serialized dictionary along with digested compression and
+    /// decompression forms of it, which are read-only and can be shared by
+    /// any number of codec instances.
+    class ZstdDictionary : public Dictionary {
+    public:
+      /// Constructor.
+      /// @param data Serialized dictionary
+      /// @param len Length of serialized dictionary
+      /// @param level Compression level for digested compression dictionary
+      ZstdDictionary(const uint8_t *data, size_t len, int level);
+      /// Destructor.
+      virtual ~ZstdDictionary();
+      const uint8_t *data() const override { return (const uint8_t *)m_data.data(); }
+      size_t size() const override { return m_data.size(); }
+      /// Digested compression dictionary
+      ZSTD_CDict *cdict {};
+      /// Digested decompression dictionary
+      ZSTD_DDict *ddict {};
+    private:
+      /// Serialized dictionary
+      std::string m_data;
+    };
+
+    /// Constructor.
+    /// @param args Arguments to control compression behavior
+    /// @throws Exception Code set to Error::BLOCK_COMPRESSOR_INVALID_ARG
+    BlockCompressionCodecZstd(const Args &args);
+
+    /// Destructor.
+    virtual ~BlockCompressionCodecZstd();
+
+    /// Sets arguments to control compression behavior.
+    /// The following arguments are supported:
+    /// <pre>
+    ///   --level &lt;int&gt;            Compression level (default 3)
+    ///   --dictionary-size &lt;int&gt;  Size of dictionary to train (default 0,
+    ///                            no dictionary)
+    /// </pre>
+    /// @param args Compressor specific arguments
+    /// @throws Exception Code set to Error::BLOCK_COMPRESSOR_INVALID_ARG
+    void set_args(const Args &args) override;
+
+    /// Compresses a buffer using the Zstandard algorithm.
+    /// This method reserves enough space in <code>output</code> to hold the
+    /// serialized <code>header</code> followed by the compressed input followed
+    /// by <code>reserve</code> bytes.  If a dictionary has been set, it is used
+    /// for compression.  If the resulting compressed buffer is larger than the
+    /// input buffer, then the input buffer is copied directly to the output
+    /// buffer and the compression type is set to BlockCompressionCodec::NONE.
+    /// @param input Input buffer
+    /// @param output Output buffer
+    /// @param header Block header populated by function
+    /// @param reserve Additional space to reserve at end of <code>output</code>
+    ///   buffer
+    void deflate(const DynamicBuffer &input, DynamicBuffer &output,
+                 BlockHeader &header, size_t reserve=0) override;
+
+    /// Decompresses a buffer compressed with the Zstandard algorithm.
+    /// If the block was compressed with a dictionary, the same dictionary
+    /// must have been set with set_dictionary().
+    /// @see deflate() for description of input buffer %format
+    /// @param input Input buffer
+    /// @param output Output buffer
+    /// @param header Block header
+    void inflate(const DynamicBuffer &input, DynamicBuffer &output,
+                 BlockHeader &header) override;
+
+    /// Returns enum value representing compression type ZSTD.
+    /// @return Compression type (ZSTD)
+    int get_type() override { return ZSTD; }
+
+    /// Returns dictionary size requested with <code>--dictionary-size</code>.
+    /// @return Requested dictionary size
+    size_t dictionary_size() override { return m_dictionary_size; }
+
+    /// Trains a dictionary of dictionary_size() bytes from sample data.
+    /// @param samples Sample data, concatenated
+    /// @param sample_sizes Sizes of individual samples in <code>samples</code>
+    /// @return Trained dictionary, or null if training failed
+    DictionaryPtr train_dictionary(const DynamicBuffer &samples,
+                                   const std::vector<size_t> &sample_sizes) override;
+
+    /// Loads a serialized dictionary.
+    /// @param data Serialized dictionary
+    /// @param len Length of serialized dictionary
+    /// @return Dictionary
+    DictionaryPtr load_dictionary(const uint8_t *data, size_t len) override;
+
+    /// Sets dictionary used by deflate() and inflate().
+    /// Dictionaries not created by this class are ignored.
+    /// @param dictionary Dictionary
+    void set_dictionary(DictionaryPtr dictionary) override;
+
+  private:
+
+    /// Compression context
+    ZSTD_CCtx *m_cctx {};
+
+    /// Decompression context
+    ZSTD_DCtx *m_dctx {};
+
+    /// Compression level
+    int m_level {3};
+
+    /// Size of dictionary to train
+    size_t m_dictionary_size {};
+
+    /// Dictionary
+    std::shared_ptr<ZstdDictionary> m_dictionary;
+  };
+
+  /// @}
+
+}
+
+#endif // Hypertable_Lib_BlockCompressionCodecZstd_h
@@ -51,6 +51,8 @@ BlockHeader::BlockHeader(uint16_t version, const char *magic) :
   m_flags(0), m_data_length(0), m_data_zlength(0), m_data_checksum(0),
   m_compression_type((uint16_t)-1), m_version(version) {
   HT_ASSERT(version <= LatestVersion);
+  if (version != 0 && default_checksum_algorithm() == CHECKSUM_CRC32C)
+    m_flags |= FLAGS_CHECKSUM_CRC32C;
   if (magic)
     memcpy(m_magic, magic, 10);
   else
@@ -69,7 +71,7 @@ BlockHeader::write_header_checksum(uint8_t *base) {
   }
 
   uint8_t *buf = base + 10;
-  encode_i16(&buf, fletcher32(base+12, encoded_length()-12));
+  encode_i16(&buf, compute_checksum(base+12, encoded_length()-12));
 }
 
 
@@ -113,12 +115,13 @@ void BlockHeader::decode(const uint8_t **bufp, size_t *remainp) {
 
   if (m_version != 0) {
     uint16_t header_checksum = decode_i16(bufp, remainp);
-    uint16_t header_checksum_computed = fletcher32(base+12, encoded_length()-12);
+    // Flags select the checksum algorithm, so decode them first
+    m_flags = decode_i16(bufp, remainp);
+    uint16_t header_checksum_computed = compute_checksum(base+12, encoded_length()-12);
     if (header_checksum_computed != header_checksum)
       HT_THROWF(Error::BLOCK_COMPRESSOR_BAD_HEADER,
                 "Header checksum mismatch: %u (computed) != %u (stored)",
                 (unsigned)header_checksum_computed, (unsigned)header_checksum);
-    m_flags = decode_i16(bufp, remainp);
   }
 
   uint16_t header_length = decode_byte(bufp, remainp);
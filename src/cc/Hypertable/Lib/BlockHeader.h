@@ -28,6 +28,8 @@
 #ifndef HYPERTABLE_BLOCKHEADER_H
 #define HYPERTABLE_BLOCKHEADER_H
 
+#include <Common/Checksum.h>
+
 #include <utility>
 
 namespace Hypertable {
@@ -51,10 +53,18 @@ namespace Hypertable {
 
     static const uint16_t LatestVersion = 1;    
 
+    /// Enumeration for flags field bits
+    enum Flags {
+      /// Header and data checksums are CRC32C (fletcher32 if not set)
+      FLAGS_CHECKSUM_CRC32C = 0x0001
+    };
+
     /** Constructor.
      * Initializes #m_version to <code>version</code>, #m_magic with the first
      * ten bytes of <code>magic</code>, and initializes all other members to
-     * their default values.
+     * their default values.  For versions other than 0, #m_flags is
+     * initialized with the #FLAGS_CHECKSUM_CRC32C flag if the default
+     * checksum algorithm (see default_checksum_algorithm()) is CRC32C.
      * @param version Version of block header to initialize
      * @param magic Pointer to magic character sequence
      */
@@ -106,7 +116,8 @@ namespace Hypertable {
     uint32_t get_data_zlength() { return m_data_zlength; }
 
     /** Sets the checksum field.
-     * The checksum field stores the fletcher32 checksum of the compressed data
+     * The checksum field stores the checksum of the compressed data, as
+     * computed by compute_checksum().
      * @param checksum Checksum of compressed data
      */
     void
@@ -137,6 +148,29 @@ namespace Hypertable {
      */
     uint16_t get_flags() { return m_flags; }
 
+    /** Gets the checksum algorithm.
+     * Version 0 headers always use fletcher32.  Later versions use CRC32C if
+     * the #FLAGS_CHECKSUM_CRC32C flag is set.
+     * @return Algorithm used for header and data checksums
+     */
+    ChecksumAlgorithm checksum_algorithm() const {
+      return (m_version != 0 && (m_flags & FLAGS_CHECKSUM_CRC32C)) ?
+        CHECKSUM_CRC32C : CHECKSUM_FLETCHER32;
+    }
+
+    /** Computes checksum of block data.
+     * Computes the checksum of <code>data</code> with the algorithm given by
+     * checksum_algorithm().  Compression codecs use this to compute the
+     * value of the data checksum field when encoding, and to verify it when
+     * decoding.
+     * @param data Pointer to (compressed) block data
+     * @param len Length of data
+     * @return Checksum of data
+     */
+    uint32_t compute_checksum(const void *data, size_t len) const {
+      return Hypertable::compute_checksum(checksum_algorithm(), data, len);
+    }
+
     /** Computes and writes checksum field.
      * The checksum field is a two-byte field that is located immediately after
      * the ten-byte magic string in the serialized header format (see encode()).
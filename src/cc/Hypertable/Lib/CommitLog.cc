@@ -141,38 +141,47 @@ int64_t CommitLog::get_timestamp() {
 }
 
 int CommitLog::flush() {
-  lock_guard<mutex> lock(m_mutex);
-  int error {};
-
-  try {
-    if (m_fd == -1)
-      return Error::CLOSED;
-    m_fs->flush(m_fd);
-  }
-  catch (Exception &e) {
-    HT_ERRORF("Problem flushing commit log: %s: %s",
-              m_cur_fragment_fname.c_str(), e.what());
-    error = e.code();
-  }
-
-  return error;
+  return sync_fragment(false);
 }
 
 int CommitLog::sync() {
-  lock_guard<mutex> lock(m_mutex);
+  return sync_fragment(true);
+}
+
+/// @details
+/// The filesystem call is made without holding #m_mutex so that writes
+/// issued by another thread can be submitted while the sync is in progress.
+/// #m_syncs_in_progress keeps roll() and close() from closing the fragment
+/// until the call returns.
+int CommitLog::sync_fragment(bool sync) {
+  int32_t fd;
+  string fname;
   int error {};
 
-  try {
+  {
+    lock_guard<mutex> lock(m_mutex);
     if (m_fd == -1)
       return Error::CLOSED;
-    m_fs->sync(m_fd);
+    fd = m_fd;
+    fname = m_cur_fragment_fname;
+    m_syncs_in_progress++;
+  }
+
+  try {
+    if (sync)
+      m_fs->sync(fd);
+    else
+      m_fs->flush(fd);
   }
   catch (Exception &e) {
-    HT_ERRORF("Problem syncing commit log: %s: %s",
-              m_cur_fragment_fname.c_str(), e.what());
+    HT_ERRORF("Problem %s commit log: %s: %s", sync ? "syncing" : "flushing",
+              fname.c_str(), e.what());
     error = e.code();
   }
 
+  lock_guard<mutex> lock(m_mutex);
+  if (--m_syncs_in_progress == 0)
+    m_sync_cond.notify_all();
   return error;
 }
 
@@ -241,7 +250,7 @@ int CommitLog::link_log(uint64_t cluster_id, CommitLogBase *log_base) {
   header.set_compression_type(BlockCompressionCodec::NONE);
   header.set_data_length(log_dir.length() + 1);
   header.set_data_zlength(log_dir.length() + 1);
-  header.set_data_checksum(fletcher32(log_dir.c_str(), log_dir.length()+1));
+  header.set_data_checksum(header.compute_checksum(log_dir.c_str(), log_dir.length()+1));
 
   header.encode(&input.ptr);
   input.add(log_dir.c_str(), log_dir.length() + 1);
@@ -290,6 +299,8 @@ int CommitLog::link_log(uint64_t cluster_id, CommitLogBase *log_base) {
 int CommitLog::close() {
   lock_guard<mutex> lock(m_mutex);
 
+  m_sync_cond.wait(m_mutex, [this](){ return m_syncs_in_progress == 0; });
+
   try {
     if (m_fd >= 0) {
       m_fs->close(m_fd);
@@ -418,6 +429,7 @@ int CommitLog::roll(CommitLogFileInfo **clfip) {
     *clfip = 0;
 
   if (m_fd >= 0) {
+    m_sync_cond.wait(m_mutex, [this](){ return m_syncs_in_progress == 0; });
     try {
       m_fs->close(m_fd);
     }
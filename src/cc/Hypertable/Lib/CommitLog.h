@@ -36,6 +36,7 @@
 #include <Common/Properties.h>
 #include <Common/Filesystem.h>
 
+#include <condition_variable>
 #include <deque>
 #include <map>
 #include <memory>
@@ -203,6 +204,11 @@ namespace Hypertable {
     void initialize(const std::string &log_dir,
                     PropertiesPtr &, CommitLogBase *init_log, bool is_meta);
     int roll(CommitLogFileInfo **clfip=0);
+
+    /// Syncs or flushes current fragment.
+    /// @param sync <i>true</i> to sync, <i>false</i> to flush
+    /// @return Error::OK on success or error code on failure
+    int sync_fragment(bool sync);
     int compress_and_write(DynamicBuffer &input, BlockHeader *header,
                            int64_t revision, Filesystem::Flags flags);
     void remove_file_info(CommitLogFileInfo *fi, StringSet &removed_logs);
@@ -217,6 +223,12 @@ namespace Hypertable {
     int32_t                 m_fd;
     int32_t                 m_replication;
     bool                    m_needs_roll;
+
+    /// Signals completion of syncs (waited on with #m_mutex held)
+    std::condition_variable_any m_sync_cond;
+
+    /// Number of sync_fragment() calls in progress
+    int32_t                 m_syncs_in_progress {};
   };
 
   /// Smart pointer to CommitLog
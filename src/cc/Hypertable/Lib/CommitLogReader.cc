@@ -183,11 +183,7 @@ CommitLogReader::next(const uint8_t **blockp, size_t *lenp,
         continue;
       }
 
-      if (header->get_revision() > m_latest_revision)
-        m_latest_revision = header->get_revision();
-
-      if (header->get_revision() > m_revision)
-        m_revision = header->get_revision();
+      update_revision(header->get_revision());
 
       *blockp = m_block_buffer.base;
       *lenp = m_block_buffer.fill();
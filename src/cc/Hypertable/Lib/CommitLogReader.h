@@ -84,6 +84,17 @@ namespace Hypertable {
 
     int32_t last_fragment_id() { return m_last_fragment_id; }
 
+    /// Records revision of a valid block.
+    /// Callers of next_raw_block() call this for each block read without
+    /// error, so fragment revisions are tracked as they are by next().
+    /// @param revision Revision from block header
+    void update_revision(int64_t revision) {
+      if (revision > m_latest_revision)
+        m_latest_revision = revision;
+      if (revision > m_revision)
+        m_revision = revision;
+    }
+
   private:
 
     void load_fragments(String log_dir, CommitLogFileInfo *parent);
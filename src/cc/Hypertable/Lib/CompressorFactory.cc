@@ -28,9 +28,11 @@
 #include <Hypertable/Lib/BlockCompressionCodecBmz.h>
 #include <Hypertable/Lib/BlockCompressionCodecNone.h>
 #include <Hypertable/Lib/BlockCompressionCodecZlib.h>
+#include <Hypertable/Lib/BlockCompressionCodecLz4.h>
 #include <Hypertable/Lib/BlockCompressionCodecLzo.h>
 #include <Hypertable/Lib/BlockCompressionCodecQuicklz.h>
 #include <Hypertable/Lib/BlockCompressionCodecSnappy.h>
+#include <Hypertable/Lib/BlockCompressionCodecZstd.h>
 
 #include <boost/algorithm/string.hpp>
 
@@ -68,6 +70,12 @@ CompressorFactory::parse_block_codec_spec(const std::string &spec,
   if (name == "snappy")
     return BlockCompressionCodec::SNAPPY;
 
+  if (name == "lz4")
+    return BlockCompressionCodec::LZ4;
+
+  if (name == "zstd")
+    return BlockCompressionCodec::ZSTD;
+
   HT_ERRORF("unknown codec type: %s", name.c_str());
   return BlockCompressionCodec::UNKNOWN;
 }
@@ -88,6 +96,10 @@ CompressorFactory::create_block_codec(BlockCompressionCodec::Type type,
     return new BlockCompressionCodecQuicklz(args);
   case BlockCompressionCodec::SNAPPY:
     return new BlockCompressionCodecSnappy(args);
+  case BlockCompressionCodec::LZ4:
+    return new BlockCompressionCodecLz4(args);
+  case BlockCompressionCodec::ZSTD:
+    return new BlockCompressionCodecZstd(args);
   default:
     HT_THROWF(Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE, "Invalid compression "
               "type: '%d'", (int)type);
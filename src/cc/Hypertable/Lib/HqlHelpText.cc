@@ -369,7 +369,9 @@ namespace {
     "      | lzo",
     "      | quicklz",
     "      | snappy",
+    "      | lz4 [ lz4_options ]",
     "      | zlib [ zlib_options ]",
+    "      | zstd [ zstd_options ]",
     "      | none",
     "",
     "    bmz_options:",
@@ -381,6 +383,13 @@ namespace {
     "      | --best",
     "      | --normal",
     "",
+    "    lz4_options:",
+    "      --acceleration int",
+    "",
+    "    zstd_options:",
+    "      --level int",
+    "      | --dictionary-size int",
+    "",
     "    bloom_filter_spec:",
     "      rows [ bloom_filter_options ]",
     "      | rows+cols [ bloom_filter_options ]",
@@ -539,7 +548,9 @@ namespace {
     "      | lzo",
     "      | quicklz",
     "      | snappy",
+    "      | lz4 [ lz4_options ]",
     "      | zlib [ zlib_options ]",
+    "      | zstd [ zstd_options ]",
     "      | none",
     "",
     "    bmz_options:",
@@ -551,6 +562,13 @@ namespace {
     "      | --best",
     "      | --normal",
     "",
+    "    lz4_options:",
+    "      --acceleration int",
+    "",
+    "    zstd_options:",
+    "      --level int",
+    "      | --dictionary-size int",
+    "",
     "    bloom_filter_spec:",
     "      rows [ bloom_filter_options ]",
     "      | rows+cols [ bloom_filter_options ]",
@@ -850,6 +868,8 @@ namespace {
     "  * quicklz",
     "  * zlib",
     "  * snappy",
+    "  * lz4",
+    "  * zstd",
     "  * none",
     "",
     "The default code is snappy for cell store blocks.  The following list ",
@@ -859,6 +879,13 @@ namespace {
     "  bmz --offset arg    Starting fingerprint offset (default = 0)",
     "  zlib -9 [ --best ]  Highest compression ratio (at the cost of speed)",
     "  zlib --normal       Normal compression ratio",
+    "  lz4 --acceleration arg",
+    "                      Trade compression ratio for speed (default = 1)",
+    "  zstd --level arg    Compression level (default = 3)",
+    "  zstd --dictionary-size arg",
+    "                      Train a dictionary of this many bytes from the",
+    "                      blocks of each cell store and use it to compress",
+    "                      the blocks of the next (default = 0, disabled)",
     "",
     "Table Options",
     "-------------",
@@ -906,7 +933,8 @@ namespace {
     "SELECT",
     "======",
     "",
-    "    SELECT ('*' | (column_predicate [',' column_predicate]*))",
+    "    SELECT ('*' | (column_predicate [',' column_predicate]*)",
+    "            | (aggregate [',' aggregate]*))",
     "      FROM table_name",
     "      [where_clause]",
     "      [options_spec]",
@@ -929,6 +957,10 @@ namespace {
     "    | column_family ':' '^'column_qualifer_prefix",
     "    | column_family ':' '/'column_qualifier_regexp'/'",
     "",
+    "    aggregate:",
+    "      COUNT '(' '*' ')'",
+    "      | (COUNT | SUM | MIN | MAX) '(' column_family [':' column_qualifier] ')'",
+    "",
     "    cell_spec: row ',' column",
     "",
     "    cell_predicate:",
@@ -961,6 +993,7 @@ namespace {
     "      | CELL_LIMIT_PER_FAMILY max_cells_per_cf",
     "      | OFFSET row_offset",
     "      | CELL_OFFSET cell_offset",
+    "      | GROUP BY ROW PREFIX prefix_length",
     "      | INTO FILE filename[.gz]",
     "      | DISPLAY_TIMESTAMPS",
     "      | KEYS_ONLY",
@@ -1004,6 +1037,22 @@ namespace {
     "    SELECT col, col2 FROM test WHERE col =^ \"prefix\";",
     "    SELECT foo FROM test WHERE bar = \"value\";",
     "",
+    "Aggregates",
+    "----------",
+    "",
+    "Instead of cells, SELECT can return the COUNT, SUM, MIN or MAX of the",
+    "selected cells.  Aggregates are evaluated by the RangeServers, so only the",
+    "partial result of each range is transferred back to the client.  COUNT(*)",
+    "counts rows, COUNT(column) counts cells and SUM, MIN and MAX operate on cell",
+    "values that are integers or decimal numbers (other values are ignored).",
+    "Counter columns are aggregated by their current count.  Each aggregate is",
+    "returned as a cell whose column is the aggregate (e.g. SUM(col)) and whose",
+    "value is the result.  Aggregates cannot be combined with OFFSET, LIMIT,",
+    "CELL_OFFSET or CELL_LIMIT.",
+    "",
+    "    SELECT COUNT(*) FROM test WHERE ROW =^ 'com.example';",
+    "    SELECT SUM(clicks), MAX(price:usd) FROM test;",
+    "",
     "Options",
     "-------",
     "",
@@ -1074,6 +1123,12 @@ namespace {
     "     #timestamp '\\t' row '\\t' column '\\t' value",
     "",
     "",
+    "GROUP BY ROW PREFIX prefix_length",
+    "",
+    "Computes the aggregates separately for each distinct prefix of length",
+    "prefix_length of the row key.  The results of each group are returned with",
+    "the prefix as the row.  Only valid in combination with aggregates.",
+    "",
     "DISPLAY_TIMESTAMPS",
     "",
     "The SELECT command displays one cell per line of output.  Each line contains",
@@ -60,6 +60,7 @@
 #include <boost/spirit/include/classic_escape_char.hpp>
 #include <boost/spirit/include/classic_symbols.hpp>
 
+#include <algorithm>
 #include <cctype>
 #include <cstdlib>
 #include <fstream>
@@ -281,6 +282,10 @@ namespace Hypertable {
       int current_relop {};
       int last_boolean_op {BOOLOP_AND};
       int buckets {};
+      uint8_t current_aggregate_function {};
+      std::string current_aggregate_column;
+      std::vector<std::string> aggregate_families;
+      bool aggregate_count_all {};
     };
 
     class ParserState {
@@ -1615,6 +1620,80 @@ namespace Hypertable {
     };
 
 
+    struct scan_set_aggregate_function {
+      scan_set_aggregate_function(ParserState &state, uint8_t function)
+        : state(state), function(function) { }
+      void operator()(char const *str, char const *end) const {
+        state.scan.current_aggregate_function = function;
+      }
+      ParserState &state;
+      uint8_t function;
+    };
+
+    struct scan_set_aggregate_column {
+      scan_set_aggregate_column(ParserState &state) : state(state) { }
+      void operator()(char const *str, char const *end) const {
+        std::string column(str, end-str);
+        column.erase(std::remove_if(column.begin(), column.end(),
+                                    is_any_of(" \t\n\r'\"")), column.end());
+        state.scan.current_aggregate_column = column;
+      }
+      void operator()(const char c) const {
+        HT_ASSERT(c == '*');
+        state.scan.current_aggregate_column.clear();
+      }
+      ParserState &state;
+    };
+
+    struct scan_add_aggregate {
+      scan_add_aggregate(ParserState &state) : state(state) { }
+      void operator()(const char c) const {
+        const std::string &column = state.scan.current_aggregate_column;
+        uint8_t function = state.scan.current_aggregate_function;
+        if (column.empty()) {
+          if (function != ScanAggregate::COUNT)
+            HT_THROWF(Error::HQL_PARSE_ERROR, "Invalid aggregate %s(*)",
+                      ScanAggregate::function_name(function));
+          state.scan.aggregate_count_all = true;
+        }
+        else {
+          std::string family = column.substr(0, column.find(':'));
+          auto &families = state.scan.aggregate_families;
+          if (std::find(families.begin(), families.end(), family) ==
+              families.end())
+            families.push_back(family);
+        }
+        state.scan.builder.add_aggregate(function, column);
+      }
+      ParserState &state;
+    };
+
+    struct scan_set_aggregate_columns {
+      scan_set_aggregate_columns(ParserState &state) : state(state) { }
+      void operator()(char const *str, char const *end) const {
+        // COUNT(*) needs every column to see every row
+        if (state.scan.aggregate_count_all)
+          return;
+        for (auto &family : state.scan.aggregate_families)
+          state.scan.builder.add_column(family);
+      }
+      ParserState &state;
+    };
+
+    struct scan_set_group_by_row_prefix {
+      scan_set_group_by_row_prefix(ParserState &state) : state(state) { }
+      void operator()(int ival) const {
+        if (state.scan.builder.get().group_by_row_prefix != 0)
+          HT_THROW(Error::HQL_PARSE_ERROR,
+                   "SELECT GROUP BY predicate multiply defined.");
+        if (ival <= 0)
+          HT_THROW(Error::HQL_PARSE_ERROR,
+                   "SELECT GROUP BY ROW PREFIX length must be positive.");
+        state.scan.builder.set_group_by_row_prefix(ival);
+      }
+      ParserState &state;
+    };
+
     struct scan_set_display_timestamps {
       scan_set_display_timestamps(ParserState &state) : state(state) { }
       void operator()(char const *str, char const *end) const {
@@ -2533,6 +2612,12 @@ namespace Hypertable {
           Token LISTING      = as_lower_d["listing"];
           Token ESC_HELP     = as_lower_d["\\h"];
           Token SELECT       = as_lower_d["select"];
+          Token COUNT        = as_lower_d["count"];
+          Token SUM          = as_lower_d["sum"];
+          Token MIN          = as_lower_d["min"];
+          Token MAX          = as_lower_d["max"];
+          Token BY           = as_lower_d["by"];
+          Token PREFIX       = as_lower_d["prefix"];
           Token STOP         = as_lower_d["stop"];
           Token START_TIME   = as_lower_d["start_time"];
           Token END_TIME     = as_lower_d["end_time"];
@@ -3167,7 +3252,9 @@ namespace Hypertable {
 
           select_statement
             = SELECT >> !(CELLS)
-              >> ('*' | (column_selection >> *(COMMA >> column_selection)))
+              >> ((aggregate_selection >> *(COMMA >> aggregate_selection))
+                    [scan_set_aggregate_columns(self.state)]
+                  | '*' | (column_selection >> *(COMMA >> column_selection)))
               >> FROM >> user_identifier[set_table_name(self.state)]
               >> !where_clause
               >> *(option_spec)
@@ -3189,6 +3276,21 @@ namespace Hypertable {
             | (identifier[scan_add_column_family(self.state, NO_QUALIFIER)])
             ;
 
+          aggregate_selection
+            = aggregate_function >> LPAREN
+              >> (STAR[scan_set_aggregate_column(self.state)]
+                  | (identifier >> !(COLON >> user_identifier))
+                      [scan_set_aggregate_column(self.state)])
+              >> RPAREN[scan_add_aggregate(self.state)]
+            ;
+
+          aggregate_function
+            = COUNT[scan_set_aggregate_function(self.state, ScanAggregate::COUNT)]
+            | SUM[scan_set_aggregate_function(self.state, ScanAggregate::SUM)]
+            | MIN[scan_set_aggregate_function(self.state, ScanAggregate::MIN)]
+            | MAX[scan_set_aggregate_function(self.state, ScanAggregate::MAX)]
+            ;
+
           where_clause
             = WHERE 
             >> where_predicate
@@ -3308,6 +3410,8 @@ namespace Hypertable {
             | OFFSET >> uint_p[scan_set_row_offset(self.state)]
             | CELL_OFFSET >> EQUAL >> uint_p[scan_set_cell_offset(self.state)]
             | CELL_OFFSET >> uint_p[scan_set_cell_offset(self.state)]
+            | GROUP >> BY >> ROW >> PREFIX >> !EQUAL
+                >> uint_p[scan_set_group_by_row_prefix(self.state)]
             | INTO >> FILE >> string_literal[scan_set_outfile(self.state)]
             | DISPLAY_TIMESTAMPS[scan_set_display_timestamps(self.state)]
             | DISPLAY_REVISIONS[scan_set_display_revisions(self.state)]
@@ -3410,6 +3514,8 @@ namespace Hypertable {
           BOOST_SPIRIT_DEBUG_RULE(column_predicate);
           BOOST_SPIRIT_DEBUG_RULE(column_qualifier_spec);
           BOOST_SPIRIT_DEBUG_RULE(column_selection);
+          BOOST_SPIRIT_DEBUG_RULE(aggregate_selection);
+          BOOST_SPIRIT_DEBUG_RULE(aggregate_function);
           BOOST_SPIRIT_DEBUG_RULE(create_definition);
           BOOST_SPIRIT_DEBUG_RULE(create_definitions);
           BOOST_SPIRIT_DEBUG_RULE(drop_specification);
@@ -3538,6 +3644,7 @@ namespace Hypertable {
           where_clause, where_predicate,
           time_predicate, relop, row_interval, row_predicate, column_match,
           column_predicate, column_qualifier_spec, value_predicate, column_selection,
+          aggregate_selection, aggregate_function,
           option_spec, unused_tokens, datetime, date, time, year,
           load_data_statement, load_data_input, load_data_option, insert_statement,
           insert_value_list, insert_value, delete_statement,
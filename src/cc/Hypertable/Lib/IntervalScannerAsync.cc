@@ -105,6 +105,25 @@ void IntervalScannerAsync::init(const ScanSpec &scan_spec) {
     m_scan_spec_builder.add_column(scan_spec.columns[i]);
   }
 
+  if (!scan_spec.aggregates.empty()) {
+    vector<uint8_t> functions;
+    for (const auto &sa : scan_spec.aggregates) {
+      if (sa.column && *sa.column) {
+        colon = strchr(sa.column, ':');
+        family = colon ? String(sa.column, colon-sa.column) : String(sa.column);
+        if (m_schema->get_column_family(family.c_str()) == 0)
+          HT_THROW(Error::RANGESERVER_INVALID_COLUMNFAMILY,
+                   (String)"Table= " + m_table->get_name() + " , Column family=" + sa.column);
+      }
+      m_scan_spec_builder.add_aggregate(sa.function, sa.column ? sa.column : "");
+      functions.push_back(sa.function);
+    }
+    m_scan_spec_builder.set_group_by_row_prefix(scan_spec.group_by_row_prefix);
+    m_aggregate_groups.set_functions(functions);
+    m_staged_groups.set_functions(functions);
+    m_aggregate = true;
+  }
+
   HT_ASSERT(scan_spec.row_intervals.size() <= 1 || scan_spec.scan_and_filter_rows);
   if (!scan_spec.row_intervals.empty()) {
     if (!scan_spec.scan_and_filter_rows) {
@@ -551,8 +570,17 @@ void IntervalScannerAsync::load_result(ScanCellsPtr &cells) {
   if (m_last_key.row)
     last_key = m_last_key;
 
-  eos = cells->load(m_schema, m_end_row, m_end_inclusive, &m_scan_limit_state,
-		    m_rowset, &m_bytes_scanned, &last_key);
+  if (m_aggregate) {
+    // Interval end is detected by readahead(), partial results have no
+    // row limits, and no last key is recorded since a restart rescans the
+    // whole range
+    cells->load_aggregates(m_staged_groups, m_aggregate_groups,
+                           &m_bytes_scanned);
+    eos = false;
+  }
+  else
+    eos = cells->load(m_schema, m_end_row, m_end_inclusive, &m_scan_limit_state,
+                      m_rowset, &m_bytes_scanned, &last_key);
 
   m_eos = m_eos || eos;
 
@@ -691,6 +719,15 @@ void IntervalScannerAsync::restart_scan(bool refresh) {
 
     if (m_last_key.row)
       m_create_scanner_row = m_last_key.row;
+    else if (m_aggregate) {
+      // Discard partial aggregates of the unfinished range and rescan it
+      // from its start
+      m_staged_groups.clear();
+      if (!m_cur_scanner_finished && !m_range_info.end_row.empty()) {
+        m_create_scanner_row = m_range_info.start_row;
+        m_create_scanner_row.append(1,1);
+      }
+    }
 
     m_state = 0;
     find_range_and_start_scan(m_create_scanner_row.c_str(), true);
@@ -81,6 +81,11 @@ namespace Hypertable {
     /// @return Reference to profile data
     ProfileDataScanner &profile_data() { return m_profile_data; }
 
+    /// Returns partial aggregate results of finished ranges.
+    /// Only populated for scans with aggregates.
+    /// @return Reference to aggregate groups
+    AggregateGroups &aggregate_groups() { return m_aggregate_groups; }
+
   private:
     void reset_outstanding_status(bool is_create, bool reset_timer);
     void readahead();
@@ -127,6 +132,15 @@ namespace Hypertable {
     bool                m_create_event_saved;
     bool                m_invalid_scanner_id_ok;
     bool m_defer_readahead {};
+
+    /// Flag indicating scan evaluates aggregates
+    bool m_aggregate {};
+
+    /// Partial aggregate results of finished ranges
+    AggregateGroups m_aggregate_groups;
+
+    /// Partial aggregate results of range being scanned
+    AggregateGroups m_staged_groups;
   };
 
   /// Smart pointer to IntervalScannerAsync
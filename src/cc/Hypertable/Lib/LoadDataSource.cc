@@ -21,6 +21,8 @@
 #include <Common/Compat.h>
 #include "LoadDataSource.h"
 
+#include <Common/Config.h>
+
 #include <Common/DynamicBuffer.h>
 #include <Common/Error.h>
 #include <Common/FileUtils.h>
@@ -58,19 +60,29 @@ using namespace Hypertable;
 using namespace std;
 
 
+namespace {
+
+  /// Size of blocks read from input
+  const size_t BLOCK_SIZE = 1048576;
+
+}
+
 LoadDataSource::LoadDataSource(const string &header_fname, 
                                int row_uniquify_chars, 
                                int load_flags)
-  : m_type_mask(0), m_cur_line(0), m_line_buffer(0),
-    m_row_key_buffer(0), m_hyperformat(false), m_leading_timestamps(false),
-    m_timestamp_index(-1), m_timestamp(AUTO_ASSIGN), m_offset(0),
-    m_zipped(false), m_rsgen(0), m_header_fname(header_fname),
+  : m_type_mask(0), m_cur_line(0), m_hyperformat(false),
+    m_leading_timestamps(false), m_timestamp_index(-1), m_offset(0),
+    m_zipped(false), m_header_fname(header_fname),
     m_row_uniquify_chars(row_uniquify_chars),
     m_load_flags(load_flags), m_source_size(0), m_first_line_cached(false),
-    m_field_separator('\t')
+    m_field_separator('\t'), m_parser_threads(0)
 {
   if (row_uniquify_chars)
-    m_rsgen = new FixedRandomStringGenerator(row_uniquify_chars);
+    m_inline_state.rsgen.reset(new FixedRandomStringGenerator(row_uniquify_chars));
+
+  if (Config::properties)
+    m_parser_threads =
+      Config::properties->get_i32("Hypertable.HqlInterpreter.LoadData.ParserThreads");
 
   // Verify existence of header file
   if (m_header_fname != "") {
@@ -82,6 +94,11 @@ LoadDataSource::LoadDataSource(const string &header_fname,
   return;
 }
 
+LoadDataSource::~LoadDataSource() {
+  stop_pipeline();
+  delete [] m_type_mask;
+}
+
 String LoadDataSource::get_header() {
   string three_column_header = format("#row%ccolumn%cvalue",
                                       m_field_separator, m_field_separator);
@@ -149,6 +166,7 @@ LoadDataSource::init(const std::vector<String> &key_columns,
   init_src();
   header = get_header();
   parse_header(header, key_columns, timestamp_column);
+  start_pipeline();
 }
 
 void
@@ -284,9 +302,6 @@ LoadDataSource::parse_header(const string &header,
     }
   }
 
-  m_next_value = m_column_info.size();
-  m_limit = 0;
-
   if (!m_hyperformat && m_column_info.size() < 2)
     HT_THROW(Error::HQL_BAD_LOAD_FILE_FORMAT,
              "No columns specified in load file");
@@ -294,389 +309,562 @@ LoadDataSource::parse_header(const string &header,
   m_cur_line = 1;
 }
 
-/**
- *
- */
 bool
 LoadDataSource::next(KeySpec *keyp, uint8_t **valuep, uint32_t *value_lenp,
                      bool *is_deletep, uint32_t *consumedp) 
 {
-  string line;
-  int index;
-  char *base, *ptr, *colon;
-
   if (consumedp)
     *consumedp = 0;
 
-  *is_deletep = false;
-  keyp->flag = FLAG_INSERT;
-
-  if (m_hyperformat) {
+  while (true) {
 
-    while (get_next_line(line)) {
-      m_cur_line++;
+    if (m_batch) {
 
-      if (consumedp && !m_zipped)
-        *consumedp += line.length() + 1;
-
-      m_line_buffer.clear();
-
-      m_line_buffer.add(line.c_str(), strlen(line.c_str())+1);
-
-      base = (char *)m_line_buffer.base;
-
-      /**
-       *  Get timestamp
-       */
-      if (m_leading_timestamps) {
-        if ((ptr = strchr(base, m_field_separator)) == 0) {
-          cerr << "warning: too few fields on line " << m_cur_line << endl;
-          continue;
-        }
-        *ptr++ = 0;
-
-        int64_t timestamp;
-        if (!parse_date_format(base, timestamp)) {
-          cerr << "warn: invalid timestamp format on line " << m_cur_line
-               << ", skipping..." << endl;
-          continue;
-        }
-        keyp->timestamp = (int64_t)timestamp;
-
-        base = ptr;
-      }
-      else
-        keyp->timestamp = AUTO_ASSIGN;
-
-      /**
-       * Get row key
-       */
-      if ((ptr = strchr(base, m_field_separator)) == 0) {
-        cerr << "warning: too few fields on line " << m_cur_line << endl;
-        continue;
-      }
-      if (m_rsgen) {
-        keyp->row_len = (ptr-base) + m_row_uniquify_chars + 1;
-        m_row_key_buffer.clear();
-        m_row_key_buffer.ensure(keyp->row_len + 1);
-        m_row_key_buffer.add_unchecked(base, ptr-base);
-        m_row_key_buffer.add_unchecked(" ", 1);
-        m_rsgen->write((char *)m_row_key_buffer.ptr);
-        keyp->row = m_row_key_buffer.base;
-      }
-      else {
-        keyp->row = base;
-        keyp->row_len = ptr - base;
-      }
-      if (keyp->row_len == 0) {
-        cerr << "warning: zero-lengthed row key on line " 
-             << m_cur_line << ", skipping..." 
-             << endl;
-        continue;
-      }
-      *ptr++ = 0;
-      base = ptr;
-
-      /**
-       * Get column family and qualifier
-       */
-      if ((ptr = strchr(base, m_field_separator)) == 0) {
-        cerr << "warning: too few fields on line " << m_cur_line << endl;
-        continue;
-      }
-      *ptr = 0;
-
-      if ((colon = strchr(base, ':')) != 0) {
-        *colon++ = 0;
-        if (colon < ptr) {
-          keyp->column_qualifier = colon;
-          keyp->column_qualifier_len = ptr - colon;
-        }
-        else {
-          keyp->column_qualifier = 0;
-          keyp->column_qualifier_len = 0;
-        }
-      }
-      else {
-        keyp->column_qualifier = 0;
-        keyp->column_qualifier_len = 0;
+      // Emit warnings for lines preceding the next cell
+      while (m_batch_warning < m_batch->warnings.size() &&
+             m_batch->warnings[m_batch_warning].cell <= m_batch_cell) {
+        const ParseWarning &warning = m_batch->warnings[m_batch_warning++];
+        if (warning.to_stdout)
+          cout << warning.text << endl << flush;
+        else
+          cerr << warning.text << endl;
       }
-      keyp->column_family = *base ? base : 0;
-      ptr++;
 
-      /**
-       * Get value
-       */
-      base = ptr;
-      *valuep = (uint8_t *)base;
-      if ((ptr = strchr(base, m_field_separator)) == 0) {
-        *value_lenp = strlen((char *)*valuep);
-      }
-      else {
-        *value_lenp = ptr-base;
-        *ptr++ = 0;
-        if (!strcmp(ptr, "DELETE")) {
-          if (keyp->column_family == 0)
-            keyp->flag = FLAG_DELETE_ROW;
-          else {
-            if (!m_leading_timestamps)
-              keyp->flag = FLAG_DELETE_COLUMN_FAMILY;
-            else
-              keyp->flag = FLAG_DELETE_CELL;
-          }
-          *is_deletep = true;
-        }
-        else if (!strcmp(ptr, "DELETE_ROW")) {
-          if (keyp->column_family != 0)
-            cerr << "warning: column family specified with DELETE_ROW on line "
-                 << m_cur_line << endl;
-          keyp->flag = FLAG_DELETE_ROW;
-          *is_deletep = true;
-        }
-        else if (!strcmp(ptr, "DELETE_COLUMN_FAMILY")) {
-          keyp->flag = FLAG_DELETE_COLUMN_FAMILY;
-          *is_deletep = true;
-        }
-        else if (!strcmp(ptr, "DELETE_CELL")) {
-          keyp->flag = FLAG_DELETE_CELL;
-          *is_deletep = true;
-        }
-        else if (!strcmp(ptr, "DELETE_CELL_VERSION")) {
-              keyp->flag = FLAG_DELETE_CELL_VERSION;
-          *is_deletep = true;
+      if (m_batch_cell < m_batch->cells.size()) {
+        const ParsedCell &cell = m_batch->cells[m_batch_cell++];
+        keyp->row = cell.row_in_keys ?
+          m_batch->keys.base + cell.row_offset : cell.key.row;
+        keyp->row_len = cell.key.row_len;
+        keyp->column_family = cell.key.column_family;
+        keyp->column_qualifier = cell.key.column_qualifier;
+        keyp->column_qualifier_len = cell.key.column_qualifier_len;
+        keyp->timestamp = cell.key.timestamp;
+        keyp->flag = cell.key.flag;
+        *valuep = cell.value;
+        *value_lenp = cell.value_len;
+        *is_deletep = cell.is_delete;
+        m_cur_line = cell.line;
+        if (consumedp) {
+          *consumedp = (uint32_t)m_unreported_consumed;
+          m_unreported_consumed = 0;
         }
-        else {
-          cerr << "warning: too many fields on line " << m_cur_line << endl;
-        }
-      }
-
-      if (m_zipped && consumedp) {
-        *consumedp = incr_consumed();
+        return true;
       }
 
-      return true;
+      m_cur_line = m_batch->first_line + m_batch->lines;
+      m_batch.reset();
     }
+
+    if (!next_batch())
+      return false;
+    m_batch_cell = 0;
+    m_batch_warning = 0;
+    m_unreported_consumed += m_batch->consumed;
   }
-  else {
+}
 
-    *is_deletep = false;
+bool LoadDataSource::read_block(ParsedBatch &batch) {
+  batch.text.swap(m_carry);
+  m_carry.clear();
 
-    // skip timestamp and rowkey (if needed)
-    // issue 720: do not insert NULL values
-    while (m_next_value < m_limit) {
-      if (should_skip(m_next_value, m_type_mask) || !m_values[m_next_value])
-        m_next_value++;
-      else
+  if (m_first_line_cached) {
+    batch.text.assign(m_first_line.begin(), m_first_line.end());
+    batch.text.push_back('\n');
+    m_first_line_cached = false;
+  }
+
+  // Read until block holds at least one complete line
+  size_t line_end = 0;
+  bool eof = false;
+  while (!eof) {
+    size_t fill = batch.text.size();
+    batch.text.resize(fill + BLOCK_SIZE);
+    m_fin.read(&batch.text[fill], BLOCK_SIZE);
+    size_t nread = m_fin.gcount();
+    batch.text.resize(fill + nread);
+    eof = nread < BLOCK_SIZE;
+    for (line_end = batch.text.size(); line_end > fill; line_end--) {
+      if (batch.text[line_end-1] == '\n')
         break;
     }
+    if (line_end > fill)
+      break;
+  }
 
-    // get from parsed cells if available
-    if (m_next_value > 0 && m_next_value < m_limit) {
-      keyp->row = m_row_key_buffer.base;
-      keyp->row_len = m_row_key_buffer.fill();
-      keyp->column_family = m_column_info[m_next_value].family.c_str();
-      keyp->timestamp = m_timestamp;
+  if (batch.text.empty())
+    return false;
 
-      // clear these, just in case they were set by the client
-      if (m_column_info[m_next_value].qualifier.empty()) {
-        keyp->column_qualifier = 0;
-        keyp->column_qualifier_len = 0;
-      }
-      else {
-        keyp->column_qualifier = m_column_info[m_next_value].qualifier.c_str();
-        keyp->column_qualifier_len =
-            m_column_info[m_next_value].qualifier.length();
-      }
-      if (m_values[m_next_value] == 0) {
-        *valuep = 0;
-        *value_lenp = 0;
-      }
-      else {
-        *valuep = (uint8_t *)m_values[m_next_value];
-        *value_lenp = strlen(m_values[m_next_value]);
-      }
-      m_next_value++;
+  // Carry partial last line over to the next block
+  if (!eof) {
+    m_carry.assign(batch.text.begin() + line_end, batch.text.end());
+    batch.text.resize(line_end);
+  }
+  else if (batch.text.back() != '\n')
+    batch.text.push_back('\n');
+
+  const char *ptr = &batch.text[0];
+  const char *end = ptr + batch.text.size();
+  while ((ptr = (const char *)memchr(ptr, '\n', end - ptr)) != 0) {
+    batch.lines++;
+    ptr++;
+  }
 
-      if (m_zipped && consumedp) {
-        *consumedp = incr_consumed();
-      }
+  batch.consumed = m_zipped ? incr_consumed() : batch.text.size();
+  return true;
+}
 
-      return true;
-    }
+void LoadDataSource::parse_batch(ParsedBatch &batch, ParseState &state) {
+  char *base = &batch.text[0];
+  char *end = base + batch.text.size();
+  char *newline;
+  int64_t line = batch.first_line;
+
+  while (base < end) {
+    newline = (char *)memchr(base, '\n', end - base);
+    *newline = 0;
+    line++;
+    if (m_hyperformat)
+      parse_hyperformat_line(base, line, batch, state);
+    else
+      parse_line(base, line, batch, state);
+    base = newline + 1;
+  }
+}
 
-    while (get_next_line(line)) {
-      m_cur_line++;
-      index = 0;
+void LoadDataSource::add_warning(ParsedBatch &batch, bool to_stdout,
+                                 const string &text) {
+  batch.warnings.push_back({batch.cells.size(), to_stdout, text});
+}
 
-      if (consumedp && !m_zipped)
-        *consumedp += line.length() + 1;
+void LoadDataSource::parse_hyperformat_line(char *base, int64_t line,
+                                            ParsedBatch &batch,
+                                            ParseState &state) {
+  char *ptr, *colon;
+  ParsedCell cell;
 
-      boost::trim_right_if(line, boost::is_any_of("\n"));
-      if (line.length() == 0)
-        continue;
+  cell.line = line;
+  cell.is_delete = false;
+  cell.row_in_keys = false;
+  cell.row_offset = 0;
+  cell.key.flag = FLAG_INSERT;
 
-      m_line_buffer.clear();
-      m_line_buffer.add(line.c_str(), strlen(line.c_str())+1);
-      m_values.clear();
+  /**
+   *  Get timestamp
+   */
+  if (m_leading_timestamps) {
+    if ((ptr = strchr(base, m_field_separator)) == 0) {
+      add_warning(batch, false,
+                  format("warning: too few fields on line %lld", (Lld)line));
+      return;
+    }
+    *ptr++ = 0;
+
+    int64_t timestamp;
+    if (!parse_date_format(base, timestamp)) {
+      add_warning(batch, false,
+                  format("warn: invalid timestamp format on line %lld, "
+                         "skipping...", (Lld)line));
+      return;
+    }
+    cell.key.timestamp = (int64_t)timestamp;
 
-      base = (char *)m_line_buffer.base;
+    base = ptr;
+  }
+  else
+    cell.key.timestamp = AUTO_ASSIGN;
 
-      while ((ptr = strchr(base, m_field_separator)) != 0) {
-        *ptr++ = 0;
+  /**
+   * Get row key
+   */
+  if ((ptr = strchr(base, m_field_separator)) == 0) {
+    add_warning(batch, false,
+                format("warning: too few fields on line %lld", (Lld)line));
+    return;
+  }
+  if (state.rsgen) {
+    cell.key.row_len = (ptr-base) + m_row_uniquify_chars + 1;
+    cell.row_in_keys = true;
+    cell.row_offset = batch.keys.fill();
+    batch.keys.ensure(cell.key.row_len + 1);
+    batch.keys.add_unchecked(base, ptr-base);
+    batch.keys.add_unchecked(" ", 1);
+    state.rsgen->write((char *)batch.keys.ptr);
+    batch.keys.ptr += m_row_uniquify_chars;
+    *batch.keys.ptr++ = 0;
+  }
+  else {
+    cell.key.row = base;
+    cell.key.row_len = ptr - base;
+  }
+  if (cell.key.row_len == 0) {
+    add_warning(batch, false,
+                format("warning: zero-lengthed row key on line %lld, "
+                       "skipping...", (Lld)line));
+    return;
+  }
+  *ptr++ = 0;
+  base = ptr;
 
-        if (strlen(base) == 0 || !strcmp(base, "NULL") ||
-            !strcmp(base, "\\N")) {
-          if (m_type_mask[index]) {
-            cout << "WARNING: Required key or timestamp field not found "
-                "on line " << m_cur_line << ", skipping ..." << endl << flush;
-            continue;
-          }
-          m_values.push_back(0);
-        }
-        else
-          m_values.push_back(base);
+  /**
+   * Get column family and qualifier
+   */
+  if ((ptr = strchr(base, m_field_separator)) == 0) {
+    add_warning(batch, false,
+                format("warning: too few fields on line %lld", (Lld)line));
+    return;
+  }
+  *ptr = 0;
 
-        base = ptr;
-        index++;
-      }
-      if (strlen(base) == 0 || !strcmp(base, "NULL") || !strcmp(base, "\\N"))
-        m_values.push_back(0);
-      else
-        m_values.push_back(base);
+  if ((colon = strchr(base, ':')) != 0) {
+    *colon++ = 0;
+    if (colon < ptr) {
+      cell.key.column_qualifier = colon;
+      cell.key.column_qualifier_len = ptr - colon;
+    }
+    else {
+      cell.key.column_qualifier = 0;
+      cell.key.column_qualifier_len = 0;
+    }
+  }
+  else {
+    cell.key.column_qualifier = 0;
+    cell.key.column_qualifier_len = 0;
+  }
+  cell.key.column_family = *base ? base : 0;
+  ptr++;
 
-      if (!m_hyperformat && m_values.size() != m_column_info.size()) {
-	cerr << "warn: field count on line " << m_cur_line << " does not match header, skipping..." << endl;
-	continue;
+  /**
+   * Get value
+   */
+  base = ptr;
+  cell.value = (uint8_t *)base;
+  if ((ptr = strchr(base, m_field_separator)) == 0) {
+    cell.value_len = strlen((char *)cell.value);
+  }
+  else {
+    cell.value_len = ptr-base;
+    *ptr++ = 0;
+    if (!strcmp(ptr, "DELETE")) {
+      if (cell.key.column_family == 0)
+        cell.key.flag = FLAG_DELETE_ROW;
+      else {
+        if (!m_leading_timestamps)
+          cell.key.flag = FLAG_DELETE_COLUMN_FAMILY;
+        else
+          cell.key.flag = FLAG_DELETE_CELL;
       }
+      cell.is_delete = true;
+    }
+    else if (!strcmp(ptr, "DELETE_ROW")) {
+      if (cell.key.column_family != 0)
+        add_warning(batch, false,
+                    format("warning: column family specified with DELETE_ROW "
+                           "on line %lld", (Lld)line));
+      cell.key.flag = FLAG_DELETE_ROW;
+      cell.is_delete = true;
+    }
+    else if (!strcmp(ptr, "DELETE_COLUMN_FAMILY")) {
+      cell.key.flag = FLAG_DELETE_COLUMN_FAMILY;
+      cell.is_delete = true;
+    }
+    else if (!strcmp(ptr, "DELETE_CELL")) {
+      cell.key.flag = FLAG_DELETE_CELL;
+      cell.is_delete = true;
+    }
+    else if (!strcmp(ptr, "DELETE_CELL_VERSION")) {
+      cell.key.flag = FLAG_DELETE_CELL_VERSION;
+      cell.is_delete = true;
+    }
+    else {
+      add_warning(batch, false,
+                  format("warning: too many fields on line %lld", (Lld)line));
+    }
+  }
 
-      m_limit = std::min(m_values.size(), m_column_info.size());
-
-      /**
-       * setup row key
-       */
-      m_row_key_buffer.clear();
-      if (!add_row_component(0))
-        continue;
-
-      size_t i;
-      for (i=1; i<m_key_comps.size(); i++) {
-        m_row_key_buffer.add(" ", 1);
-        if (!add_row_component(i))
-          break;
-      }
-      if (i<m_key_comps.size())
-        continue;       // rowkey not found. warning in add_row_component.
+  batch.cells.push_back(cell);
+}
 
-      m_row_key_buffer.ensure(1);
-      *m_row_key_buffer.ptr = 0;
+void LoadDataSource::parse_line(char *base, int64_t line, ParsedBatch &batch,
+                                ParseState &state) {
+  char *ptr;
+  int index = 0;
+  int64_t timestamp;
+  if (*base == 0)
+    return;
 
-      if (m_timestamp_index >= 0) {
+  state.values.clear();
 
-        if (m_values.size() <= (size_t)m_timestamp_index) {
-          cerr << "warn: timestamp field not found on line " << m_cur_line
-               << ", skipping..." << endl;
-          continue;
-        }
+  while ((ptr = strchr(base, m_field_separator)) != 0) {
+    *ptr++ = 0;
 
-        if (!parse_date_format(m_values[m_timestamp_index], m_timestamp)) {
-          cerr << "warn: invalid timestamp format on line " << m_cur_line
-               << ", skipping..." << endl;
-          continue;
-        }
-      }
-      else
-        m_timestamp = AUTO_ASSIGN;
-
-      m_next_value = 0;
-      while (should_skip(m_next_value, m_type_mask))
-        m_next_value++;
-
-      if (m_rsgen) {
-        m_row_key_buffer.ensure(m_row_uniquify_chars + 2);
-        keyp->row = m_row_key_buffer.base;
-        keyp->row_len = m_row_key_buffer.fill() + m_row_uniquify_chars + 1;
-        m_row_key_buffer.add_unchecked(" ", 1);
-        m_rsgen->write((char *)m_row_key_buffer.ptr);
-        m_row_key_buffer.ptr += m_row_uniquify_chars;
-      }
-      else {
-        keyp->row = m_row_key_buffer.base;
-        keyp->row_len = m_row_key_buffer.fill();
+    if (strlen(base) == 0 || !strcmp(base, "NULL") ||
+        !strcmp(base, "\\N")) {
+      if (m_type_mask[index]) {
+        add_warning(batch, true,
+                    format("WARNING: Required key or timestamp field not "
+                           "found on line %lld, skipping ...", (Lld)line));
+        continue;
       }
+      state.values.push_back(0);
+    }
+    else
+      state.values.push_back(base);
 
-      keyp->column_family = m_column_info[m_next_value].family.c_str();
-      keyp->timestamp = m_timestamp;
+    base = ptr;
+    index++;
+  }
+  if (strlen(base) == 0 || !strcmp(base, "NULL") || !strcmp(base, "\\N"))
+    state.values.push_back(0);
+  else
+    state.values.push_back(base);
 
-      if (m_column_info[m_next_value].qualifier.empty()) {
-        keyp->column_qualifier = 0;
-        keyp->column_qualifier_len = 0;
-      }
-      else {
-        keyp->column_qualifier = m_column_info[m_next_value].qualifier.c_str();
-        keyp->column_qualifier_len =
-            m_column_info[m_next_value].qualifier.length();
-      }
+  if (state.values.size() != m_column_info.size()) {
+    add_warning(batch, false,
+                format("warn: field count on line %lld does not match "
+                       "header, skipping...", (Lld)line));
+    return;
+  }
 
-      if (m_values[m_next_value] == 0) {
-        *valuep = 0;
-        *value_lenp = 0;
-      }
-      else {
-        *valuep = (uint8_t *)m_values[m_next_value];
-        *value_lenp = strlen(m_values[m_next_value]);
-      }
-      m_next_value++;
+  size_t limit = std::min(state.values.size(), m_column_info.size());
 
-      if (m_zipped && consumedp) {
-        *consumedp = incr_consumed();
-      }
+  /**
+   * setup row key
+   */
+  state.row_key.clear();
+  if (!add_row_component(0, line, batch, state))
+    return;
+
+  for (size_t i=1; i<m_key_comps.size(); i++) {
+    state.row_key.add(" ", 1);
+    if (!add_row_component(i, line, batch, state))
+      return;       // rowkey not found. warning in add_row_component.
+  }
 
-      return true;
+  if (m_timestamp_index >= 0) {
+
+    if (state.values.size() <= (size_t)m_timestamp_index) {
+      add_warning(batch, false,
+                  format("warn: timestamp field not found on line %lld, "
+                         "skipping...", (Lld)line));
+      return;
     }
 
+    if (!parse_date_format(state.values[m_timestamp_index], timestamp)) {
+      add_warning(batch, false,
+                  format("warn: invalid timestamp format on line %lld, "
+                         "skipping...", (Lld)line));
+      return;
+    }
+  }
+  else
+    timestamp = AUTO_ASSIGN;
+
+  ParsedCell cell;
+  cell.line = line;
+  cell.is_delete = false;
+  cell.row_in_keys = true;
+  cell.row_offset = batch.keys.fill();
+  cell.key.flag = FLAG_INSERT;
+  cell.key.timestamp = timestamp;
+
+  // Row key is shared by all cells of the line
+  batch.keys.add(state.row_key.base, state.row_key.fill());
+  cell.key.row_len = state.row_key.fill();
+  if (state.rsgen) {
+    batch.keys.ensure(m_row_uniquify_chars + 2);
+    batch.keys.add_unchecked(" ", 1);
+    state.rsgen->write((char *)batch.keys.ptr);
+    batch.keys.ptr += m_row_uniquify_chars;
+    cell.key.row_len += m_row_uniquify_chars + 1;
+  }
+  batch.keys.ensure(1);
+  *batch.keys.ptr++ = 0;
+
+  // The first value is loaded even if NULL; later NULL values are skipped
+  // (issue 720)
+  size_t next_value = 0;
+  while (should_skip(next_value, m_type_mask))
+    next_value++;
+
+  for (bool first = true; next_value < limit; next_value++, first = false) {
+    if (!first &&
+        (should_skip(next_value, m_type_mask) || !state.values[next_value]))
+      continue;
+
+    cell.key.column_family = m_column_info[next_value].family.c_str();
+    if (m_column_info[next_value].qualifier.empty()) {
+      cell.key.column_qualifier = 0;
+      cell.key.column_qualifier_len = 0;
+    }
+    else {
+      cell.key.column_qualifier = m_column_info[next_value].qualifier.c_str();
+      cell.key.column_qualifier_len =
+        m_column_info[next_value].qualifier.length();
+    }
+    if (state.values[next_value] == 0) {
+      cell.value = 0;
+      cell.value_len = 0;
+    }
+    else {
+      cell.value = (uint8_t *)state.values[next_value];
+      cell.value_len = strlen(state.values[next_value]);
+    }
+    batch.cells.push_back(cell);
   }
-
-  return false;
 }
 
-bool LoadDataSource::add_row_component(int index) 
+bool LoadDataSource::add_row_component(int index, int64_t line,
+                                       ParsedBatch &batch, ParseState &state)
 {
-  const char *value = m_values[m_key_comps[index].index];
-  size_t value_len = 0;
-
-  if (value == 0) {
-    cout << "WARNING: Required key field not found on line " << m_cur_line
-         << ", skipping ..." << endl << flush;
+  if ((size_t)m_key_comps[index].index >= state.values.size() ||
+      state.values[m_key_comps[index].index] == 0) {
+    add_warning(batch, true,
+                format("WARNING: Required key field not found on line %lld, "
+                       "skipping ...", (Lld)line));
     return false;
   }
 
-  value_len = strlen(value);
-
-  if ((size_t)m_key_comps[index].index >= m_values.size() || value == 0) {
-    cout << "WARNING: Required key field not found on line " << m_cur_line
-         << ", skipping ..." << endl << flush;
-    return false;
-  }
+  const char *value = state.values[m_key_comps[index].index];
+  size_t value_len = strlen(value);
 
   if ((size_t)m_key_comps[index].width > value_len) {
     size_t padding = m_key_comps[index].width - value_len;
-    m_row_key_buffer.ensure(m_key_comps[index].width);
+    state.row_key.ensure(m_key_comps[index].width);
     if (m_key_comps[index].left_justify) {
-      m_row_key_buffer.add(value, value_len);
-      memset(m_row_key_buffer.ptr, m_key_comps[index].pad_character, padding);
-      m_row_key_buffer.ptr += padding;
+      state.row_key.add(value, value_len);
+      memset(state.row_key.ptr, m_key_comps[index].pad_character, padding);
+      state.row_key.ptr += padding;
     }
     else {
-      memset(m_row_key_buffer.ptr, m_key_comps[index].pad_character, padding);
-      m_row_key_buffer.ptr += padding;
-      m_row_key_buffer.add(value, value_len);
+      memset(state.row_key.ptr, m_key_comps[index].pad_character, padding);
+      state.row_key.ptr += padding;
+      state.row_key.add(value, value_len);
     }
   }
   else
-    m_row_key_buffer.add(value, value_len);
+    state.row_key.add(value, value_len);
 
   return true;
+}
+
+bool LoadDataSource::next_batch() {
+
+  if (m_parser_threads == 0) {
+    m_batch.reset(new ParsedBatch());
+    m_batch->first_line = m_cur_line;
+    if (!read_block(*m_batch)) {
+      m_batch.reset();
+      return false;
+    }
+    parse_batch(*m_batch, m_inline_state);
+    return true;
+  }
 
+  unique_lock<mutex> lock(m_pipeline_mutex);
+  while (true) {
+    auto iter = m_parsed.find(m_next_seq);
+    if (iter != m_parsed.end()) {
+      m_batch = std::move(iter->second);
+      m_parsed.erase(iter);
+      m_next_seq++;
+      m_pipeline_cond.notify_all();
+      return true;
+    }
+    if (m_read_done && m_next_seq == m_batches_read) {
+      if (m_pipeline_error)
+        rethrow_exception(m_pipeline_error);
+      return false;
+    }
+    m_pipeline_cond.wait(lock);
+  }
+}
+
+void LoadDataSource::start_pipeline() {
+  if (m_parser_threads == 0)
+    return;
+  m_reader_thread = thread(&LoadDataSource::reader_loop, this);
+  for (int i=0; i<m_parser_threads; i++)
+    m_parser_thread_pool.push_back(thread(&LoadDataSource::parser_loop, this));
+}
+
+void LoadDataSource::stop_pipeline() {
+  {
+    lock_guard<mutex> lock(m_pipeline_mutex);
+    m_stop = true;
+    m_pipeline_cond.notify_all();
+  }
+  if (m_reader_thread.joinable())
+    m_reader_thread.join();
+  for (auto &t : m_parser_thread_pool)
+    t.join();
+  m_parser_thread_pool.clear();
+}
+
+void LoadDataSource::reader_loop() {
+  // Bound the number of blocks in flight so memory stays proportional to
+  // the number of parsers
+  const uint64_t max_outstanding = 2 * m_parser_threads + 2;
+  int64_t line = m_cur_line;
+
+  try {
+    while (true) {
+      {
+        unique_lock<mutex> lock(m_pipeline_mutex);
+        m_pipeline_cond.wait(lock, [this, max_outstanding](){
+            return m_stop || m_batches_read - m_next_seq < max_outstanding; });
+        if (m_stop)
+          break;
+      }
+      unique_ptr<ParsedBatch> batch(new ParsedBatch());
+      batch->first_line = line;
+      if (!read_block(*batch))
+        break;
+      line += batch->lines;
+      lock_guard<mutex> lock(m_pipeline_mutex);
+      batch->seq = m_batches_read++;
+      m_unparsed.push_back(std::move(batch));
+      m_pipeline_cond.notify_all();
+    }
+  }
+  catch (...) {
+    lock_guard<mutex> lock(m_pipeline_mutex);
+    m_pipeline_error = current_exception();
+  }
+
+  lock_guard<mutex> lock(m_pipeline_mutex);
+  m_read_done = true;
+  m_pipeline_cond.notify_all();
+}
+
+void LoadDataSource::parser_loop() {
+  ParseState state;
+  unique_ptr<ParsedBatch> batch;
+
+  if (m_row_uniquify_chars)
+    state.rsgen.reset(new FixedRandomStringGenerator(m_row_uniquify_chars));
+
+  while (true) {
+    {
+      unique_lock<mutex> lock(m_pipeline_mutex);
+      m_pipeline_cond.wait(lock, [this](){
+          return m_stop || m_read_done || !m_unparsed.empty(); });
+      if (m_stop || m_unparsed.empty())
+        return;
+      batch = std::move(m_unparsed.front());
+      m_unparsed.pop_front();
+    }
+    try {
+      parse_batch(*batch, state);
+    }
+    catch (...) {
+      lock_guard<mutex> lock(m_pipeline_mutex);
+      if (!m_pipeline_error)
+        m_pipeline_error = current_exception();
+    }
+    lock_guard<mutex> lock(m_pipeline_mutex);
+    m_parsed[batch->seq] = std::move(batch);
+    m_pipeline_cond.notify_all();
+  }
 }
 
 bool LoadDataSource::parse_date_format(const char *str, int64_t &timestamp) 
@@ -33,10 +33,16 @@
 #include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Hypertable {
@@ -47,6 +53,15 @@ namespace Hypertable {
     STDIN
   };
 
+  /// Source of cells for LOAD DATA INFILE.
+  /// Input is read in large blocks by a reader thread, which splits them on
+  /// newline boundaries.  The blocks are parsed into batches of cells by a
+  /// pool of parser threads (see
+  /// <code>Hypertable.HqlInterpreter.LoadData.ParserThreads</code>) and
+  /// next() hands out the cells of each batch in input order.  Warnings
+  /// produced while parsing are emitted by next() at the position in the
+  /// cell stream where the offending line was, so output is identical to
+  /// parsing serially.
   class LoadDataSource {
 
   public:
@@ -54,7 +69,7 @@ namespace Hypertable {
                    int row_uniquify_chars = 0,
                    int load_flags = 0);
 
-    virtual ~LoadDataSource() { delete [] m_type_mask; return; }
+    virtual ~LoadDataSource();
 
     bool has_timestamps() {
       return m_leading_timestamps || (m_timestamp_index != -1);
@@ -72,17 +87,10 @@ namespace Hypertable {
 
   protected:
 
-    bool get_next_line(String &line) {
-      if (m_first_line_cached) {
-        line = m_first_line;
-        m_first_line_cached = false;
-        return true;
-      }
-      getline(m_fin, line);
-      if (m_fin.eof() && line.empty())
-        return false;
-      return true;
-    }
+    /// Stops reader and parser threads.
+    /// Derived classes must call this from their destructor, before the
+    /// source read by the reader thread is destroyed.
+    void stop_pipeline();
 
     virtual void parse_header(const String& header,
                               const std::vector<String> &key_columns,
@@ -117,30 +125,106 @@ namespace Hypertable {
 
     bool parse_date_format(const char *str, int64_t &timestamp);
     bool parse_sec(const char *str, char **end_ptr, int64_t &ns);
-    bool add_row_component(int index);
 
     struct ColumnInfo {
       std::string family;
       std::string qualifier;
     };
 
+    /// Cell parsed from input.
+    /// Pointers refer to the text of the ParsedBatch holding the cell, or to
+    /// #m_column_info.
+    struct ParsedCell {
+      KeySpec key;
+      uint8_t *value;
+      uint32_t value_len;
+      bool is_delete;
+      /// Offset of row key in ParsedBatch::keys, if #row_in_keys is set
+      size_t row_offset;
+      /// Flag indicating row key was built into ParsedBatch::keys
+      bool row_in_keys;
+      /// Line number of cell
+      int64_t line;
+    };
+
+    /// Warning produced while parsing.
+    struct ParseWarning {
+      /// Number of cells of batch preceding the warning
+      size_t cell;
+      /// Flag indicating warning goes to stdout rather than stderr
+      bool to_stdout;
+      std::string text;
+    };
+
+    /// Block of input lines and the cells parsed from it.
+    struct ParsedBatch {
+      /// Position of batch in input
+      uint64_t seq {};
+      /// Line number of line preceding first line of block
+      int64_t first_line {};
+      /// Number of lines in block
+      int64_t lines {};
+      /// Number of source bytes consumed by block
+      uint64_t consumed {};
+      /// Input lines, each terminated by a newline
+      std::vector<char> text;
+      /// Row keys assembled from input fields
+      DynamicBuffer keys;
+      std::vector<ParsedCell> cells;
+      std::vector<ParseWarning> warnings;
+    };
+
+    /// Per-parser scratch state.
+    struct ParseState {
+      std::vector<const char *> values;
+      DynamicBuffer row_key;
+      std::unique_ptr<FixedRandomStringGenerator> rsgen;
+    };
+
+    /// Reads next block of lines from #m_fin.
+    /// @param batch Batch to receive block
+    /// @return <i>false</i> if input is exhausted, <i>true</i> otherwise
+    bool read_block(ParsedBatch &batch);
+
+    /// Parses all lines of a batch into cells.
+    /// @param batch Batch to parse
+    /// @param state Scratch state of calling parser
+    void parse_batch(ParsedBatch &batch, ParseState &state);
+
+    /// Parses one line of a batch in row/column/value format.
+    void parse_hyperformat_line(char *base, int64_t line, ParsedBatch &batch,
+                                ParseState &state);
+
+    /// Parses one line of a batch in header-described format.
+    void parse_line(char *base, int64_t line, ParsedBatch &batch,
+                    ParseState &state);
+
+    bool add_row_component(int index, int64_t line, ParsedBatch &batch,
+                           ParseState &state);
+
+    /// Records a warning at the current end of a batch.
+    static void add_warning(ParsedBatch &batch, bool to_stdout,
+                            const std::string &text);
+
+    /// Makes next parsed batch current.
+    /// @return <i>false</i> if there are no more batches, <i>true</i>
+    /// otherwise
+    bool next_batch();
+
+    void start_pipeline();
+    void reader_loop();
+    void parser_loop();
+
     std::vector<ColumnInfo> m_column_info;
-    std::vector<const char *> m_values;
     std::vector<KeyComponentInfo> m_key_comps;
     uint32_t *m_type_mask;
-    size_t m_next_value;
     boost::iostreams::filtering_istream m_fin;
     int64_t m_cur_line;
-    DynamicBuffer m_line_buffer;
-    DynamicBuffer m_row_key_buffer;
     bool m_hyperformat;
     bool m_leading_timestamps;
     int m_timestamp_index;
-    int64_t m_timestamp;
-    size_t m_limit;
     uint64_t m_offset;
     bool m_zipped;
-    FixedRandomStringGenerator *m_rsgen;
     std::string m_header_fname;
     int m_row_uniquify_chars;
     int m_load_flags;
@@ -148,6 +232,42 @@ namespace Hypertable {
     unsigned long m_source_size;
     bool m_first_line_cached;
     char m_field_separator;
+
+    /// Number of parser threads (0 parses on the calling thread)
+    int m_parser_threads;
+    /// Scratch state used when parsing on the calling thread
+    ParseState m_inline_state;
+    /// Partial line read at the end of the previous block
+    std::vector<char> m_carry;
+    /// Batch being handed out by next()
+    std::unique_ptr<ParsedBatch> m_batch;
+    /// Index of next cell of #m_batch to hand out
+    size_t m_batch_cell {};
+    /// Index of next warning of #m_batch to emit
+    size_t m_batch_warning {};
+    /// Bytes consumed but not yet reported by next()
+    uint64_t m_unreported_consumed {};
+
+    /// %Mutex protecting pipeline state
+    std::mutex m_pipeline_mutex;
+    /// Signals changes in pipeline state
+    std::condition_variable m_pipeline_cond;
+    std::thread m_reader_thread;
+    std::vector<std::thread> m_parser_thread_pool;
+    /// Batches read but not yet parsed
+    std::deque<std::unique_ptr<ParsedBatch>> m_unparsed;
+    /// Parsed batches keyed by sequence number
+    std::map<uint64_t, std::unique_ptr<ParsedBatch>> m_parsed;
+    /// Number of batches read so far
+    uint64_t m_batches_read {};
+    /// Sequence number of next batch to hand out
+    uint64_t m_next_seq {};
+    /// Flag indicating reader has reached end of input
+    bool m_read_done {};
+    /// Flag indicating pipeline is shutting down
+    bool m_stop {};
+    /// Exception thrown by reader or parser threads
+    std::exception_ptr m_pipeline_error;
   };
 
   /// Smart pointer to LoadDataSource
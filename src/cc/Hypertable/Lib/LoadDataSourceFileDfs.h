@@ -48,7 +48,7 @@ namespace Hypertable {
                           const std::string &header_fname,
                           int row_uniquify_chars = 0, int load_flags = 0);
 
-    ~LoadDataSourceFileDfs() { delete m_source;};
+    ~LoadDataSourceFileDfs() { stop_pipeline(); delete m_source; }
 
     uint64_t incr_consumed();
 
@@ -47,7 +47,7 @@ namespace Hypertable {
     LoadDataSourceFileLocal(const std::string &fname, const std::string &header_fname,
                             int row_uniquify_chars = 0, int load_flags = 0);
 
-    ~LoadDataSourceFileLocal() { };
+    ~LoadDataSourceFileLocal() { stop_pipeline(); }
 
     uint64_t incr_consumed();
 
@@ -47,7 +47,7 @@ namespace Hypertable {
     LoadDataSourceStdin (const String& header_fname,
                          int row_uniquify_chars = 0, int load_flags = 0);
 
-    ~LoadDataSourceStdin() { };
+    ~LoadDataSourceStdin() { stop_pipeline(); }
 
     uint64_t incr_consumed();
 
@@ -25,14 +25,62 @@
 
 #include <Common/InetAddr.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 using namespace Hypertable;
 using namespace std;
 
+namespace {
+
+  /// Source of reader slot numbers
+  atomic<size_t> next_reader_slot {0};
+
+  /// Reader slot of calling thread
+  thread_local size_t reader_slot = next_reader_slot.fetch_add(1);
+
+  /// Ends read when going out of scope.
+  struct ReaderGuard {
+    ReaderGuard(atomic<int64_t> *counter) : counter(counter) { }
+    ~ReaderGuard() { counter->fetch_sub(1, memory_order_release); }
+    atomic<int64_t> *counter;
+  };
+
+  /// Compares end rows, a null end row sorting after all others.
+  inline bool end_row_lt(const char *end_row1, const char *end_row2) {
+    return end_row1 && (end_row2 == 0 || strcmp(end_row1, end_row2) < 0);
+  }
+
+}
+
+
+LocationCache::LocationCache(uint32_t max_entries)
+  : m_snapshot(new Snapshot()), m_max_entries(max_entries) {
+  for (size_t i=0; i<READER_SLOTS; i++) {
+    m_readers[i].count[0] = 0;
+    m_readers[i].count[1] = 0;
+  }
+}
+
+
+LocationCache::~LocationCache() {
+  Snapshot *snapshot = m_snapshot.load();
+  for (auto &entry : *snapshot)
+    for (auto value : entry.second->values)
+      delete value;
+  delete snapshot;
+  for (auto value : m_retired)
+    delete value;
+  for (AddressSet::iterator iter = m_addresses.begin();
+       iter != m_addresses.end(); ++iter)
+    delete *iter;
+}
+
+
 /**
  * Insert
  */
@@ -40,9 +88,6 @@ void
 LocationCache::insert(const char *table_name, RangeLocationInfo &range_loc_info,
                       bool pegged) {
   lock_guard<mutex> lock(m_mutex);
-  Value *newval = new Value;
-  LocationMap::iterator iter;
-  LocationCacheKey key;
 
   assert(table_name);
 
@@ -51,60 +96,49 @@ LocationCache::insert(const char *table_name, RangeLocationInfo &range_loc_info,
       << " location=" << location << HT_END;
   */
 
-  newval->start_row = range_loc_info.start_row;
-  newval->end_row = range_loc_info.end_row;
-  newval->addrp = get_constant_address(range_loc_info.addr);
-  newval->pegged = pegged;
+  table_name = m_strings.get(table_name);
 
-  key.table_name = m_strings.get(table_name);
-  key.end_row = (range_loc_info.end_row == "") ? 0 : newval->end_row.c_str();
+  Snapshot *snapshot = new Snapshot(*m_snapshot.load());
+  const char *end_row = range_loc_info.end_row.empty() ?
+    0 : range_loc_info.end_row.c_str();
 
   // remove old entry
-  if ((iter = m_location_map.find(key)) != m_location_map.end())
-    remove((*iter).second);
-
-  // make room for the new entry
-  while (m_location_map.size() >= m_max_entries) {
-    if (m_tail->pegged)
-      move_to_head(m_tail);
-    else
-      remove(m_tail);
-  }
-
-  // add to head
-  if (m_head == 0) {
-    assert(m_tail == 0);
-    newval->next = newval->prev = 0;
-    m_head = m_tail = newval;
-  }
-  else {
-    m_head->next = newval;
-    newval->prev = m_head;
-    newval->next = 0;
-    m_head = newval;
-  }
-
-  // Insert the new entry into the map, recording an iterator to the entry
-  {
-    std::pair<LocationMap::iterator, bool> old_entry;
-    LocationMap::value_type map_value(key, newval);
-    old_entry = m_location_map.insert(map_value);
-    assert(old_entry.second);
-    newval->map_iter = old_entry.first;
+  auto iter = snapshot->find(table_name);
+  if (iter != snapshot->end()) {
+    const Table *table = iter->second.get();
+    auto pos = lower_bound(table->end_rows.begin(), table->end_rows.end(),
+                           end_row, end_row_lt);
+    if (pos != table->end_rows.end() && !end_row_lt(end_row, *pos)) {
+      map<const char *, set<Value *>, LtCstr> victims;
+      victims[table_name].insert(table->values[pos - table->end_rows.begin()]);
+      remove(snapshot, victims);
+    }
   }
 
-}
+  // make room for the new entry
+  make_room(snapshot);
 
-/**
- *
- */
-LocationCache::~LocationCache() {
-  for (AddressSet::iterator iter = m_addresses.begin();
-       iter != m_addresses.end(); ++iter)
-    delete *iter;
-  for (LocationMap::iterator lm_it = m_location_map.begin();
-       lm_it != m_location_map.end(); ++lm_it)
-    delete (*lm_it).second;
+  Value *newval = new Value;
+  newval->start_row = range_loc_info.start_row;
+  newval->end_row = range_loc_info.end_row;
+  newval->addrp = get_constant_address(range_loc_info.addr);
+  newval->pegged = pegged;
+  newval->stamp = m_clock.fetch_add(1, memory_order_relaxed) + 1;
+  newval->table_name = table_name;
+  newval->lru_key = newval->stamp.load(memory_order_relaxed);
+  m_lru[newval->lru_key] = newval;
+  end_row = newval->end_row.empty() ? 0 : newval->end_row.c_str();
+
+  shared_ptr<Table> table = copy_table(snapshot, table_name);
+  auto pos = lower_bound(table->end_rows.begin(), table->end_rows.end(),
+                         end_row, end_row_lt);
+  table->values.insert(table->values.begin() + (pos - table->end_rows.begin()),
+                       newval);
+  table->end_rows.insert(pos, end_row);
+  (*snapshot)[table_name] = table;
+  m_num_entries++;
+
+  publish(snapshot);
 }
 
 
@@ -114,12 +148,15 @@ LocationCache::~LocationCache() {
 bool
 LocationCache::lookup(const char * table_name, const char *rowkey,
                       RangeLocationInfo *range_loc_infop, bool inclusive) {
-  lock_guard<mutex> lock(m_mutex);
+  ReaderGuard guard(reader_enter());
 
-  Value* cacheval;
-  if (!lookup(table_name, rowkey, cacheval, inclusive))
+  Value *cacheval = find(m_snapshot.load(), table_name, rowkey, inclusive);
+  if (cacheval == 0)
     return false;
 
+  cacheval->stamp.store(m_clock.fetch_add(1, memory_order_relaxed) + 1,
+                        memory_order_relaxed);
+
   range_loc_infop->start_row = cacheval->start_row;
   range_loc_infop->end_row   = cacheval->end_row;
   range_loc_infop->addr      = *cacheval->addrp;
@@ -130,12 +167,15 @@ LocationCache::lookup(const char * table_name, const char *rowkey,
 bool
 LocationCache::lookup(const char * table_name, const char *rowkey,
                       RangeAddrInfo *range_addr_infop, bool inclusive) {
-  lock_guard<mutex> lock(m_mutex);
+  ReaderGuard guard(reader_enter());
 
-  Value* cacheval;
-  if (!lookup(table_name, rowkey, cacheval, inclusive))
+  Value *cacheval = find(m_snapshot.load(), table_name, rowkey, inclusive);
+  if (cacheval == 0)
     return false;
 
+  cacheval->stamp.store(m_clock.fetch_add(1, memory_order_relaxed) + 1,
+                        memory_order_relaxed);
+
   range_addr_infop->addr = *cacheval->addrp;
 
   return true;
@@ -143,31 +183,21 @@ LocationCache::lookup(const char * table_name, const char *rowkey,
 
 bool LocationCache::invalidate(const char *table_name, const char *rowkey) {
   lock_guard<mutex> lock(m_mutex);
-  LocationMap::iterator iter;
-  LocationCacheKey key;
 
   assert(table_name);
 
   //cout << table_name << " row=" << rowkey << endl << flush;
 
-  key.table_name = table_name;
-  key.end_row = rowkey;
-
-  if ((iter = m_location_map.lower_bound(key)) == m_location_map.end())
-    return false;
-
-  if (strcmp((*iter).first.table_name, table_name))
+  Snapshot *current = m_snapshot.load();
+  Value *cacheval = find(current, table_name, rowkey, true);
+  if (cacheval == 0)
     return false;
 
-#if 0
-  if (rowkey && strcmp(rowkey, (*iter).second->start_row.c_str()) < 0)
-    return false;
-#endif
-  if ((rowkey == 0 && !(*iter).second->start_row.empty()) ||
-      (rowkey && strcmp(rowkey, (*iter).second->start_row.c_str()) < 0))
-    return false;
-
-  remove((*iter).second);
+  Snapshot *snapshot = new Snapshot(*current);
+  map<const char *, set<Value *>, LtCstr> victims;
+  victims[table_name].insert(cacheval);
+  remove(snapshot, victims);
+  publish(snapshot);
   return true;
 }
 
@@ -178,103 +208,165 @@ void LocationCache::invalidate_host(const string &hostname) {
   addr.set_proxy(hostname);
   const CommAddress *addrp = get_constant_address(addr);
 
-  LocationMap::iterator iter = m_location_map.begin();
-  Value *val = 0;
-  while (iter != m_location_map.end()) {
-    val = 0;
-    if (iter->second->addrp == addrp)
-      val = iter->second;
-    ++iter;
-    if (val)
-      remove(val);
+  Snapshot *current = m_snapshot.load();
+  map<const char *, set<Value *>, LtCstr> victims;
+  for (auto &entry : *current) {
+    for (auto value : entry.second->values) {
+      if (value->addrp == addrp)
+        victims[entry.first].insert(value);
+    }
   }
+
+  if (victims.empty())
+    return;
+
+  Snapshot *snapshot = new Snapshot(*current);
+  remove(snapshot, victims);
+  publish(snapshot);
 }
 
 
 void LocationCache::display(std::ostream &out) {
-  for (Value *value = m_head; value; value = value->prev)
+  lock_guard<mutex> lock(m_mutex);
+  vector<Value *> values;
+  for (auto &entry : *m_snapshot.load())
+    values.insert(values.end(), entry.second->values.begin(),
+                  entry.second->values.end());
+  sort(values.begin(), values.end(), [](Value *v1, Value *v2) {
+      return v1->stamp.load(memory_order_relaxed) >
+        v2->stamp.load(memory_order_relaxed); });
+  for (auto value : values)
     out << "DUMP: end=" << value->end_row << " start=" << value->start_row
         << endl;
 }
 
-bool LocationCache::lookup(const char * table_name, const char *rowkey,
-                           Value*& cacheval, bool inclusive) {
-  LocationMap::iterator iter;
-  LocationCacheKey key;
 
-  assert(table_name);
+LocationCache::Value *
+LocationCache::find(const Snapshot *snapshot, const char *table_name,
+                    const char *rowkey, bool inclusive) {
 
-  key.table_name = table_name;
-  key.end_row = rowkey;
+  auto iter = snapshot->find(table_name);
+  if (iter == snapshot->end())
+    return 0;
 
-  if ((iter = m_location_map.lower_bound(key)) == m_location_map.end())
-    return false;
+  const Table *table = iter->second.get();
+  size_t n = table->end_rows.size();
+  if (n == 0)
+    return 0;
 
-  if (strcmp((*iter).first.table_name, table_name))
-    return false;
-
-  if (inclusive) {
-    if (strcmp(rowkey, (*iter).second->start_row.c_str()) < 0)
-      return false;
-  }
-  else {
-    if (strcmp(rowkey, (*iter).second->start_row.c_str()) <= 0)
-      return false;
+  // Branch-free lower bound: the loop always runs log2(n) times and
+  // the conditional move of base does not depend on a predicted branch
+  const char * const *base = table->end_rows.data();
+  while (n > 1) {
+    size_t half = n / 2;
+    base = end_row_lt(base[half], rowkey) ? base + half : base;
+    n -= half;
   }
+  size_t index = (base - table->end_rows.data()) + end_row_lt(*base, rowkey);
+  if (index == table->end_rows.size())
+    return 0;
 
-  cacheval = (*iter).second;
-  move_to_head(cacheval);
+  Value *cacheval = table->values[index];
+  int cmp = strcmp(rowkey ? rowkey : "", cacheval->start_row.c_str());
+  if (inclusive ? cmp < 0 : cmp <= 0)
+    return 0;
 
-  return true;
+  return cacheval;
 }
 
 
-/**
- * MoveToHead
- */
-void LocationCache::move_to_head(Value *cacheval) {
+atomic<int64_t> *LocationCache::reader_enter() {
+  ReaderSlot &slot = m_readers[reader_slot % READER_SLOTS];
+  while (true) {
+    uint64_t epoch = m_epoch.load();
+    atomic<int64_t> *counter = &slot.count[epoch & 1];
+    counter->fetch_add(1);
+    // If the epoch flipped before the counter was incremented, the writer
+    // that flipped it may not have seen the increment and may free the
+    // snapshot this reader is about to load, so retry in the new epoch.  If
+    // it has not flipped, the next writer to flip it waits for this reader.
+    if (m_epoch.load() == epoch)
+      return counter;
+    counter->fetch_sub(1);
+  }
+}
 
-  if (m_head == cacheval)
-    return;
 
-  // unstich entry from cache
-  cacheval->next->prev = cacheval->prev;
-  if (cacheval->prev == 0)
-    m_tail = cacheval->next;
-  else
-    cacheval->prev->next = cacheval->next;
-
-  cacheval->next = 0;
-  cacheval->prev = m_head;
-  m_head->next = cacheval;
-  m_head = cacheval;
+void LocationCache::publish(Snapshot *snapshot) {
+  Snapshot *old_snapshot = m_snapshot.exchange(snapshot);
+
+  // Readers that entered before the epoch flip may still be using the old
+  // snapshot; readers that enter after it are guaranteed to see the new one
+  size_t parity = m_epoch.fetch_add(1) & 1;
+  for (size_t i=0; i<READER_SLOTS; i++) {
+    while (m_readers[i].count[parity].load() != 0)
+      this_thread::yield();
+  }
+
+  delete old_snapshot;
+  for (auto value : m_retired)
+    delete value;
+  m_retired.clear();
 }
 
 
-/**
- * remove
- */
-void LocationCache::remove(Value *cacheval) {
-  assert(cacheval);
-  if (m_tail == cacheval) {
-    m_tail = cacheval->next;
-    if (m_tail)
-      m_tail->prev = 0;
-    else {
-      assert (m_head == cacheval);
-      m_head = 0;
+shared_ptr<LocationCache::Table>
+LocationCache::copy_table(const Snapshot *snapshot, const char *table_name) {
+  auto iter = snapshot->find(table_name);
+  if (iter == snapshot->end())
+    return make_shared<Table>();
+  return make_shared<Table>(*iter->second);
+}
+
+
+void LocationCache::remove(Snapshot *snapshot,
+                           map<const char *, set<Value *>, LtCstr> &victims) {
+  for (auto &entry : victims) {
+    auto iter = snapshot->find(entry.first);
+    assert(iter != snapshot->end());
+    auto table = make_shared<Table>();
+    const Table *old_table = iter->second.get();
+    for (size_t i=0; i<old_table->values.size(); i++) {
+      if (entry.second.count(old_table->values[i]) == 0) {
+        table->end_rows.push_back(old_table->end_rows[i]);
+        table->values.push_back(old_table->values[i]);
+      }
     }
+    m_num_entries -= old_table->values.size() - table->values.size();
+    for (auto value : entry.second)
+      m_lru.erase(value->lru_key);
+    m_retired.insert(m_retired.end(), entry.second.begin(), entry.second.end());
+    if (table->values.empty())
+      snapshot->erase(iter);
+    else
+      iter->second = table;
   }
-  else if (m_head == cacheval) {
-    m_head = m_head->prev;
-    m_head->next = 0;
-  }
-  else {
-    cacheval->next->prev = cacheval->prev;
-    cacheval->prev->next = cacheval->next;
+}
+
+
+void LocationCache::make_room(Snapshot *snapshot) {
+  size_t pegged_count = 0;
+  while (m_num_entries >= m_max_entries && !m_lru.empty()) {
+    auto iter = m_lru.begin();
+    Value *lru = iter->second;
+    uint64_t stamp = lru->stamp.load(memory_order_relaxed);
+    // Stamp is current, so this is the least recently used entry
+    if (stamp == iter->first && !lru->pegged) {
+      map<const char *, set<Value *>, LtCstr> victims;
+      victims[lru->table_name].insert(lru);
+      remove(snapshot, victims);
+      continue;
+    }
+    if (stamp == iter->first) {
+      if (++pegged_count > m_lru.size())
+        break;
+      stamp = m_clock.fetch_add(1, memory_order_relaxed) + 1;
+      lru->stamp = stamp;
+    }
+    m_lru.erase(iter);
+    lru->lru_key = stamp;
+    m_lru[stamp] = lru;
   }
-  m_location_map.erase(cacheval->map_iter);
-  delete cacheval;
 }
 
 
@@ -288,4 +380,3 @@ const CommAddress *LocationCache::get_constant_address(const CommAddress &addr)
   m_addresses.insert(new_addr);
   return new_addr;
 }
-
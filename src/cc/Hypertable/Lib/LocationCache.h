@@ -28,75 +28,64 @@
 #include <Common/InetAddr.h>
 #include <Common/StringExt.h>
 
+#include <atomic>
 #include <cstring>
 #include <ostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <vector>
 
 namespace Hypertable {
 
-  /**
-   * Key type for Range location cache
-   */
-  struct LocationCacheKey {
-    const char *table_name;
-    const char *end_row;
-  };
-
-  /**
-   * Less than operator for LocationCacheKey
-   */
-  inline bool operator<(const LocationCacheKey &x, const LocationCacheKey &y) {
-    int cmp = strcmp(x.table_name, y.table_name);
-    if (cmp)
-      return cmp < 0;
-    if (y.end_row == 0)
-      return (x.end_row == 0) ? false : true;
-    else if (x.end_row == 0)
-      return false;
-    return strcmp(x.end_row, y.end_row) < 0;
-  }
-
-  /**
-   * Equality operator for LocationCacheKey
-   */
-  inline bool operator==(const LocationCacheKey &x, const LocationCacheKey &y) {
-    if (strcmp(x.table_name, y.table_name))
-      return false;
-    if (x.end_row == 0)
-      return (y.end_row == 0) ? true : false;
-    else if (y.end_row == 0)
-      return false;
-    return !strcmp(x.end_row, y.end_row);
-  }
-
-  /**
-   * Equality operator for LocationCacheKey
-   */
-  inline bool operator!=(const LocationCacheKey &x, const LocationCacheKey &y) {
-    return !(x == y);
-  }
-
-
-  /**
-   *  This class acts as a cache of Range location information.  It
-   */
+  /// @addtogroup libHypertable
+  /// @{
+
+  /// Cache of range locations.
+  /// Lookups are lock-free.  The cache content is held in an immutable
+  /// snapshot that maps each table to an array of its cached ranges sorted
+  /// by end row.  A lookup binary searches the array of the table and
+  /// copies out the matching entry.  Writers (insert(), invalidate() and
+  /// invalidate_host()) are serialized by a mutex.  They build a new
+  /// snapshot in which only the array of the modified table is copied,
+  /// publish it with an atomic pointer swap, and then wait for the readers
+  /// of the old snapshot to drain before freeing it.
+  ///
+  /// Readers announce themselves by incrementing a counter for the current
+  /// epoch in a per-thread slot.  Writers flip the epoch after publishing
+  /// and wait for the counters of the previous epoch to reach zero.
+  /// Counter slots are padded to a cache line so readers running on
+  /// different threads do not write to shared cache lines.
+  ///
+  /// When the number of entries reaches the maximum, the least recently
+  /// used entry is evicted.  Recency is tracked with an access clock
+  /// that each lookup bumps and stores into the entry it returns.  This
+  /// stamp is the only state a lookup modifies.  Writers keep the entries
+  /// in #m_lru ordered by the stamp they had when last indexed; since
+  /// stamps only grow, the least recently used entry is found by re-keying
+  /// stale entries at the front of the index until the front one is
+  /// current, without scanning every entry.
   class LocationCache {
   public:
-    /**
-     */
+
+    /// Cached range location.
+    /// All members except #stamp are immutable once the entry is published
+    /// or only accessed with #m_mutex locked.
     struct Value {
-      struct Value *prev, *next;
-      std::map<LocationCacheKey, Value *>::iterator map_iter;
       std::string start_row;
       std::string end_row;
       const CommAddress *addrp;
       bool pegged;
+      /// Access clock value of last insert or lookup
+      std::atomic<uint64_t> stamp;
+      /// Table name (a #m_strings pointer)
+      const char *table_name;
+      /// Key of entry in #m_lru
+      uint64_t lru_key;
     };
 
-    LocationCache(uint32_t max_entries) : m_mutex(), m_location_map(),
-        m_head(0), m_tail(0), m_max_entries(max_entries) { return; }
+    LocationCache(uint32_t max_entries);
     ~LocationCache();
 
     void insert(const char * table_name, RangeLocationInfo &range_loc_info,
@@ -109,13 +98,82 @@ namespace Hypertable {
 
     void invalidate_host(const std::string &hostname);
 
+    /// Writes cache entries from most to least recently used.
+    /// @param out Output stream
     void display(std::ostream &);
 
   private:
-    bool lookup(const char *table_name, const char *rowkey,
-                Value*& cacheval, bool inclusive);
-    void move_to_head(Value *cacheval);
-    void remove(Value *cacheval);
+
+    /// Cached ranges of a table, sorted by end row.
+    /// An empty end row sorts last and is stored as a null pointer in
+    /// #end_rows.
+    struct Table {
+      /// End rows of #values (pointers into Value::end_row)
+      std::vector<const char *> end_rows;
+      /// Cached ranges
+      std::vector<Value *> values;
+    };
+
+    /// Smart pointer to immutable Table
+    typedef std::shared_ptr<const Table> TablePtr;
+
+    /// Map of table name to cached ranges
+    typedef std::map<const char *, TablePtr, LtCstr> Snapshot;
+
+    /// Per-thread reader counters, padded to a cache line.
+    struct ReaderSlot {
+      std::atomic<int64_t> count[2];
+      char pad[64 - 2*sizeof(std::atomic<int64_t>)];
+    };
+
+    /// Number of reader counter slots
+    static const size_t READER_SLOTS = 64;
+
+    /// Finds range containing a row.
+    /// Must be called within a read started by reader_enter(), or with
+    /// #m_mutex locked.
+    /// @param snapshot Snapshot to search
+    /// @param table_name Table name
+    /// @param rowkey Row key (null for the end of the table)
+    /// @param inclusive If <i>true</i>, <code>rowkey</code> may equal the
+    /// start row of the range
+    /// @return Entry for range, or nullptr if not cached
+    static Value *find(const Snapshot *snapshot, const char *table_name,
+                       const char *rowkey, bool inclusive);
+
+    /// Announces reader of current snapshot.
+    /// The read ends when the returned counter is decremented.
+    /// @return Reader counter of calling thread for current epoch
+    std::atomic<int64_t> *reader_enter();
+
+    /// Publishes a new snapshot and frees the old one.
+    /// Swaps in <code>snapshot</code>, waits until no reader can still be
+    /// accessing the previous snapshot and then deletes it along with the
+    /// entries in #m_retired.  Must be called with #m_mutex locked.
+    /// @param snapshot New snapshot
+    void publish(Snapshot *snapshot);
+
+    /// Returns copy of table array from snapshot.
+    /// @param snapshot Snapshot
+    /// @param table_name Table name (must be a #m_strings pointer)
+    /// @return Copy of array of table, empty if the table has no entries
+    static std::shared_ptr<Table> copy_table(const Snapshot *snapshot,
+                                             const char *table_name);
+
+    /// Removes entries from snapshot.
+    /// Removed entries are dropped from #m_lru and appended to #m_retired.
+    /// Must be called with #m_mutex locked.
+    /// @param snapshot Snapshot to modify
+    /// @param victims Entries to remove, grouped by table name
+    void remove(Snapshot *snapshot,
+                std::map<const char *, std::set<Value *>, LtCstr> &victims);
+
+    /// Evicts least recently used entries until there is room for one more.
+    /// Pegged entries are never evicted; when one is least recently used it
+    /// is marked as used instead, and if every entry is pegged the cache
+    /// grows past its maximum.  Must be called with #m_mutex locked.
+    /// @param snapshot Snapshot to modify
+    void make_room(Snapshot *snapshot);
 
     const CommAddress *get_constant_address(const CommAddress &addr);
 
@@ -126,14 +184,33 @@ namespace Hypertable {
       }
     };
 
-    typedef std::map<LocationCacheKey, Value *> LocationMap;
     typedef std::set<const CommAddress *, CommAddressPointerLt> AddressSet;
 
+    /// %Mutex serializing writers
     std::mutex m_mutex;
-    LocationMap    m_location_map;
+
+    /// Current snapshot
+    std::atomic<Snapshot *> m_snapshot;
+
+    /// Current reader epoch
+    std::atomic<uint64_t> m_epoch {0};
+
+    /// Reader counters
+    ReaderSlot m_readers[READER_SLOTS];
+
+    /// Access clock
+    std::atomic<uint64_t> m_clock {0};
+
+    /// Entries ordered by Value::lru_key, a stamp that is no newer than the
+    /// entry's current stamp
+    std::map<uint64_t, Value *> m_lru;
+
+    /// Entries removed from the current snapshot, to be freed once readers
+    /// of the current snapshot have drained
+    std::vector<Value *> m_retired;
+
     AddressSet     m_addresses;
-    Value         *m_head;
-    Value         *m_tail;
+    size_t         m_num_entries {};
     uint32_t       m_max_entries;
     FlyweightString m_strings;
   };
@@ -141,6 +218,7 @@ namespace Hypertable {
   /// Smart pointer to LocationCache
   typedef std::shared_ptr<LocationCache> LocationCachePtr;
 
+  /// @}
 }
 
 
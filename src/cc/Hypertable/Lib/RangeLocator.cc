@@ -270,16 +270,8 @@ RangeLocator::find_loop(const TableIdentifier *table, const char *row_key,
 int
 RangeLocator::find(const TableIdentifier *table, const char *row_key,
     RangeLocationInfo *rane_loc_infop, Timer &timer, bool hard) {
-  RangeSpec range;
-  ScanSpec meta_scan_spec;
-  vector<ScanBlock> scan_blocks(1);
   int error;
-  Key key;
-  RangeLocationInfo range_loc_info;
-  string start_row;
-  string end_row;
   CommAddress addr;
-  RowInterval ri;
   bool inclusive = (row_key == 0 || *row_key == 0) ? true : false;
   bool root_lookup = table->is_metadata() && (row_key == 0 || strcmp(row_key, Key::END_ROOT_ROW) <= 0);
 
@@ -312,6 +304,82 @@ RangeLocator::find(const TableIdentifier *table, const char *row_key,
 
   /** at this point, we didn't find it so we need to do a METADATA lookup **/
 
+  const char *row = row_key ? row_key : "";
+  LookupPtr lookup;
+
+  {
+    unique_lock<mutex> lock(m_lookup_mutex);
+
+    // If another thread is already looking up a range of this table, wait
+    // for it and use its result if it covers row_key.  Lookups read ahead, so
+    // prefer the one closest below row_key.
+    LookupPtr inflight;
+    auto range = m_lookups.equal_range(table->id);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      const string &other = iter->second->row;
+      if (!inflight ||
+          (other <= row && (inflight->row > row || other > inflight->row)) ||
+          (other > row && inflight->row > row && other < inflight->row))
+        inflight = iter->second;
+    }
+
+    if (inflight) {
+      m_lookup_cond.wait_for(lock, chrono::milliseconds(timer.remaining()),
+                             [&inflight](){ return inflight->done; });
+      if (!inflight->done)
+        return Error::REQUEST_TIMEOUT;
+      if (inflight->error != Error::OK)
+        return inflight->error;
+      if (m_cache->lookup(table->id, row, rane_loc_infop, inclusive))
+        return Error::OK;
+    }
+
+    lookup = make_shared<Lookup>();
+    lookup->row = row;
+    m_lookups.emplace(table->id, lookup);
+  }
+
+  try {
+    error = metadata_lookup(table, row_key, rane_loc_infop, addr, timer, hard);
+  }
+  catch (Exception &e) {
+    finish_lookup(table->id, lookup, e.code());
+    throw;
+  }
+  finish_lookup(table->id, lookup, error);
+  return error;
+}
+
+
+void RangeLocator::finish_lookup(const char *table_id, LookupPtr &lookup,
+                                 int error) {
+  {
+    lock_guard<mutex> lock(m_lookup_mutex);
+    auto range = m_lookups.equal_range(table_id);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+      if (iter->second == lookup) {
+        m_lookups.erase(iter);
+        break;
+      }
+    }
+    lookup->done = true;
+    lookup->error = error;
+  }
+  m_lookup_cond.notify_all();
+}
+
+
+int
+RangeLocator::metadata_lookup(const TableIdentifier *table,
+    const char *row_key, RangeLocationInfo *rane_loc_infop, CommAddress addr,
+    Timer &timer, bool hard) {
+  RangeSpec range;
+  ScanSpec meta_scan_spec;
+  vector<ScanBlock> scan_blocks(1);
+  int error;
+  RowInterval ri;
+  bool inclusive = (row_key == 0 || *row_key == 0) ? true : false;
+
   range.start_row = 0;
   range.end_row = Key::END_ROOT_ROW;
 
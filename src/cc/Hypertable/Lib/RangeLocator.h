@@ -38,9 +38,12 @@
 #include <Common/Timer.h>
 #include <Common/Properties.h>
 
+#include <condition_variable>
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Hypertable {
@@ -161,6 +164,44 @@ namespace Hypertable {
   private:
     friend class RangeLocatorHyperspaceSessionCallback;
 
+    /// METADATA lookup in progress.
+    struct Lookup {
+      /// Row key being located
+      std::string row;
+      /// Set when the lookup has completed
+      bool done {};
+      /// Result of the lookup
+      int error {};
+    };
+
+    /// Smart pointer to Lookup
+    typedef std::shared_ptr<Lookup> LookupPtr;
+
+    /** Looks up the range containing a row key in METADATA.
+     * Scans the root and second-level METADATA ranges as necessary and
+     * loads the locations of the range containing <code>row_key</code>, and
+     * of the ranges that follow it (up to
+     * <code>Hypertable.RangeLocator.MetadataReadaheadCount</code>), into the
+     * location cache.
+     * @param table pointer to table identifier structure
+     * @param row_key row key to locate
+     * @param range_loc_infop address of RangeLocationInfo to hold result
+     * @param addr address of root range
+     * @param timer reference to timer object
+     * @param hard don't consult cache
+     * @return Error::OK on success or error code on failure
+     */
+    int metadata_lookup(const TableIdentifier *table, const char *row_key,
+                        RangeLocationInfo *range_loc_infop, CommAddress addr,
+                        Timer &timer, bool hard);
+
+    /** Completes a METADATA lookup and wakes up threads waiting for it.
+     * @param table_id ID of table being looked up
+     * @param lookup Lookup to complete
+     * @param error Result of the lookup
+     */
+    void finish_lookup(const char *table_id, LookupPtr &lookup, int error);
+
     void initialize(Timer &timer);
     void hyperspace_disconnected();
     void hyperspace_reconnected();
@@ -192,6 +233,15 @@ namespace Hypertable {
     uint32_t               m_max_error_queue_length;
     uint32_t               m_metadata_retry_interval;
     uint32_t               m_root_metadata_retry_interval;
+
+    /// %Mutex protecting #m_lookups
+    std::mutex m_lookup_mutex;
+
+    /// Signals completion of a METADATA lookup
+    std::condition_variable m_lookup_cond;
+
+    /// METADATA lookups in progress, by table ID
+    std::unordered_multimap<std::string, LookupPtr> m_lookups;
   };
 
   /// Smart pointer to RangeLocator
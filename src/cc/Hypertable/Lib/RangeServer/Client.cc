@@ -41,6 +41,7 @@
 #include "Request/Parameters/FetchScanblock.h"
 #include "Request/Parameters/GetStatistics.h"
 #include "Request/Parameters/Heapcheck.h"
+#include "Request/Parameters/LinkCellStores.h"
 #include "Request/Parameters/LoadRange.h"
 #include "Request/Parameters/PhantomCommitRanges.h"
 #include "Request/Parameters/PhantomLoad.h"
@@ -76,6 +77,8 @@ Lib::RangeServer::Client::Client(Comm *comm, int32_t timeout_ms)
   : m_comm(comm), m_default_timeout_ms(timeout_ms) {
   if (timeout_ms == 0)
     m_default_timeout_ms = get_i32("Hypertable.Request.Timeout");
+  m_scan_block_encoding =
+    ScanBlock::parse_encoding(get_str("Hypertable.Client.ScanBlockEncoding"));
 }
 
 
@@ -221,7 +224,8 @@ Lib::RangeServer::Client::create_scanner(const CommAddress &addr,
   header.flags |= CommHeader::FLAGS_BIT_PROFILE;
   if (table.is_system())
     header.flags |= CommHeader::FLAGS_BIT_URGENT;
-  Request::Parameters::CreateScanner params(table, range, scan_spec);
+  Request::Parameters::CreateScanner params(table, range, scan_spec,
+                                            m_scan_block_encoding);
   CommBufPtr cbuf(new CommBuf(header, params.encoded_length()));
   params.encode(cbuf->get_data_ptr_address());
   send_message(addr, cbuf, handler, m_default_timeout_ms);
@@ -236,7 +240,8 @@ Lib::RangeServer::Client::create_scanner(const CommAddress &addr,
   header.flags |= CommHeader::FLAGS_BIT_PROFILE;
   if (table.is_system())
     header.flags |= CommHeader::FLAGS_BIT_URGENT;
-  Request::Parameters::CreateScanner params(table, range, scan_spec);
+  Request::Parameters::CreateScanner params(table, range, scan_spec,
+                                            m_scan_block_encoding);
   CommBufPtr cbuf(new CommBuf(header, params.encoded_length()));
   params.encode(cbuf->get_data_ptr_address());
   send_message(addr, cbuf, handler, timer.remaining());
@@ -270,7 +275,8 @@ Lib::RangeServer::Client::do_create_scanner(const CommAddress &addr,
   header.flags |= CommHeader::FLAGS_BIT_PROFILE;
   if (table.is_system())
     header.flags |= CommHeader::FLAGS_BIT_URGENT;
-  Request::Parameters::CreateScanner params(table, range, scan_spec);
+  Request::Parameters::CreateScanner params(table, range, scan_spec,
+                                            m_scan_block_encoding);
   CommBufPtr cbuf(new CommBuf(header, params.encoded_length()));
   params.encode(cbuf->get_data_ptr_address());
 
@@ -697,6 +703,29 @@ void Lib::RangeServer::Client::do_relinquish_range(const CommAddress &addr,
              + Hypertable::Protocol::string_format_message(event));
 }
 
+void
+Lib::RangeServer::Client::link_cellstores(const CommAddress &addr,
+                                          const TableIdentifier &table,
+                                          const RangeSpec &range,
+                                          const std::vector<String> &access_groups,
+                                          const std::vector<String> &files,
+                                          Timer &timer) {
+  DispatchHandlerSynchronizer sync_handler;
+  CommHeader header(Protocol::COMMAND_LINK_CELLSTORES);
+  Request::Parameters::LinkCellStores params(table, range, access_groups,
+                                             files);
+  CommBufPtr cbuf(new CommBuf(header, params.encoded_length()));
+  params.encode(cbuf->get_data_ptr_address());
+
+  EventPtr event;
+  send_message(addr, cbuf, &sync_handler, timer.remaining());
+
+  if (!sync_handler.wait_for_reply(event))
+    HT_THROW(Hypertable::Protocol::response_code(event),
+             String("RangeServer link_cellstores() failure : ")
+             + Hypertable::Protocol::string_format_message(event));
+}
+
 void Lib::RangeServer::Client::heapcheck(const CommAddress &addr, String &outfile) {
   DispatchHandlerSynchronizer sync_handler;
   CommHeader header(Protocol::COMMAND_HEAPCHECK);
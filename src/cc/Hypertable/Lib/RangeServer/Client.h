@@ -458,6 +458,21 @@ namespace RangeServer {
     void relinquish_range(const CommAddress &addr, const TableIdentifier &table,
                           const RangeSpec &range, Timer &timer);
 
+    /// Issues a synchronous "link cellstores" request.
+    /// Links the CellStore file <code>files[i]</code> into access group
+    /// <code>access_groups[i]</code> of the range identified by
+    /// <code>table</code> and <code>range</code>.
+    /// @param addr Address of RangeServer
+    /// @param table %Table identifier
+    /// @param range %Range specification
+    /// @param access_groups Access group names
+    /// @param files Absolute pathnames of CellStore files
+    /// @param timer Deadline timer
+    void link_cellstores(const CommAddress &addr, const TableIdentifier &table,
+                         const RangeSpec &range,
+                         const std::vector<String> &access_groups,
+                         const std::vector<String> &files, Timer &timer);
+
     /** Issues a "heapcheck" request.  This call blocks until it receives a
      * response from the server.
      * @param addr address of RangeServer
@@ -588,6 +603,9 @@ namespace RangeServer {
 
     Comm *m_comm;
     int32_t m_default_timeout_ms;
+
+    /// Scan block encoding flags requested when creating scanners
+    uint8_t m_scan_block_encoding {};
   };
 
   /// Smart pointer to Client
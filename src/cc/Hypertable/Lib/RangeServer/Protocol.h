@@ -85,6 +85,7 @@ namespace RangeServer {
       COMMAND_SET_STATE,
       COMMAND_TABLE_MAINTENANCE_ENABLE,
       COMMAND_TABLE_MAINTENANCE_DISABLE,
+      COMMAND_LINK_CELLSTORES,
       COMMAND_MAX
     };
 
@@ -40,7 +40,7 @@ uint8_t CreateScanner::encoding_version() const {
 
 size_t CreateScanner::encoded_length_internal() const {
   return m_table.encoded_length() + m_range_spec.encoded_length() +
-    m_scan_spec.encoded_length();
+    m_scan_spec.encoded_length() + (m_scan_block_encoding ? 1 : 0);
 }
 
 /// @details
@@ -62,11 +62,17 @@ size_t CreateScanner::encoded_length_internal() const {
 /// <td>ScanSpec</td>
 /// <td>Scan specification</td>
 /// </tr>
+/// <tr>
+/// <td>i8</td>
+/// <td>Requested scan block encoding flags (optional, omitted if zero)</td>
+/// </tr>
 /// </table>
 void CreateScanner::encode_internal(uint8_t **bufp) const {
   m_table.encode(bufp);
   m_range_spec.encode(bufp);
   m_scan_spec.encode(bufp);
+  if (m_scan_block_encoding)
+    Serialization::encode_i8(bufp, m_scan_block_encoding);
 }
 
 void CreateScanner::decode_internal(uint8_t version, const uint8_t **bufp,
@@ -74,6 +80,8 @@ void CreateScanner::decode_internal(uint8_t version, const uint8_t **bufp,
   m_table.decode(bufp, remainp);
   m_range_spec.decode(bufp, remainp);
   m_scan_spec.decode(bufp, remainp);
+  if (*remainp > 0)
+    m_scan_block_encoding = Serialization::decode_i8(bufp, remainp);
 }
 
 
@@ -59,9 +59,12 @@ namespace Parameters {
     /// @param table %Table identifier
     /// @param range_spec %Range specification
     /// @param scan_spec Scan specification
+    /// @param scan_block_encoding Requested scan block encoding flags (see
+    /// ScanBlock)
     CreateScanner(const TableIdentifier &table, const RangeSpec &range_spec,
-                  const ScanSpec &scan_spec)
-      : m_table(table), m_range_spec(range_spec), m_scan_spec(scan_spec) {}
+                  const ScanSpec &scan_spec, uint8_t scan_block_encoding=0)
+      : m_table(table), m_range_spec(range_spec), m_scan_spec(scan_spec),
+        m_scan_block_encoding(scan_block_encoding) {}
 
     /// Gets table identifier
     /// @return %Table identifier
@@ -75,6 +78,10 @@ namespace Parameters {
     /// @return Scan specification
     const ScanSpec &scan_spec() { return m_scan_spec; }
 
+    /// Gets requested scan block encoding flags
+    /// @return Requested scan block encoding flags
+    uint8_t scan_block_encoding() { return m_scan_block_encoding; }
+
   private:
 
     /// Returns encoding version.
@@ -108,6 +115,9 @@ namespace Parameters {
     /// Scan specification
     ScanSpec m_scan_spec;
 
+    /// Requested scan block encoding flags
+    uint8_t m_scan_block_encoding {};
+
   };
 
   /// @}
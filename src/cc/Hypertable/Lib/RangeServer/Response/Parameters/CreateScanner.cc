@@ -40,7 +40,8 @@ uint8_t CreateScanner::encoding_version() const {
 }
 
 size_t CreateScanner::encoded_length_internal() const {
-  return 13 + m_profile_data.encoded_length();
+  return 13 + m_profile_data.encoded_length() +
+    (m_encoding || m_aggregated ? 1 : 0) + (m_aggregated ? 1 : 0);
 }
 
 /// @details
@@ -70,6 +71,16 @@ size_t CreateScanner::encoded_length_internal() const {
 /// <td>ProfileDataScanner</td>
 /// <td>Profile data</td>
 /// </tr>
+/// <tr>
+/// <td>i8</td>
+/// <td>Scan block encoding flags (optional, omitted if zero and not
+/// aggregated)</td>
+/// </tr>
+/// <tr>
+/// <td>bool</td>
+/// <td>Flag indicating scan blocks hold aggregate results (optional,
+/// omitted if false)</td>
+/// </tr>
 /// </table>
 void CreateScanner::encode_internal(uint8_t **bufp) const {
   Serialization::encode_i32(bufp, m_id);
@@ -77,6 +88,10 @@ void CreateScanner::encode_internal(uint8_t **bufp) const {
   Serialization::encode_i32(bufp, m_skipped_cells);
   Serialization::encode_bool(bufp, m_more);
   m_profile_data.encode(bufp);
+  if (m_encoding || m_aggregated)
+    Serialization::encode_i8(bufp, m_encoding);
+  if (m_aggregated)
+    Serialization::encode_bool(bufp, m_aggregated);
 }
 
 void CreateScanner::decode_internal(uint8_t version, const uint8_t **bufp,
@@ -86,6 +101,12 @@ void CreateScanner::decode_internal(uint8_t version, const uint8_t **bufp,
   m_skipped_cells = Serialization::decode_i32(bufp, remainp);
   m_more = Serialization::decode_bool(bufp, remainp);
   m_profile_data.decode(bufp, remainp);
+  m_encoding = 0;
+  m_aggregated = false;
+  if (*remainp > 0)
+    m_encoding = Serialization::decode_i8(bufp, remainp);
+  if (*remainp > 0)
+    m_aggregated = Serialization::decode_bool(bufp, remainp);
 }
 
 
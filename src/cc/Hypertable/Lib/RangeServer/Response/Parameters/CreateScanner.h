@@ -61,10 +61,14 @@ namespace Parameters {
     /// @param skipped_cells Count of cells skipped
     /// @param more Flag indicating more data to follow
     /// @param profile_data Profile data
+    /// @param encoding Scan block encoding flags (see ScanBlock)
+    /// @param aggregated Flag indicating scan blocks hold aggregate results
     CreateScanner(int32_t id, int32_t skipped_rows, int32_t skipped_cells,
-                  bool more, ProfileDataScanner &profile_data)
+                  bool more, ProfileDataScanner &profile_data,
+                  uint8_t encoding=0, bool aggregated=false)
       : m_id(id), m_skipped_rows(skipped_rows), m_skipped_cells(skipped_cells),
-        m_more(more), m_profile_data(profile_data) {}
+        m_more(more), m_profile_data(profile_data), m_encoding(encoding),
+        m_aggregated(aggregated) {}
     
     /// Gets scanner ID
     /// @return Scanner ID
@@ -86,6 +90,16 @@ namespace Parameters {
     /// @return <i>more</i> flag
     bool more() { return m_more; }
 
+    /// Gets scan block encoding flags
+    /// @return Scan block encoding flags
+    uint8_t encoding() { return m_encoding; }
+
+    /// Gets <i>aggregated</i> flag.
+    /// Servers that predate aggregate scans ignore the aggregates of the scan
+    /// specification and never set this flag.
+    /// @return <i>true</i> if scan blocks hold partial aggregate results
+    bool aggregated() { return m_aggregated; }
+
   private:
 
     /// Returns encoding version.
@@ -125,6 +139,12 @@ namespace Parameters {
     /// Profile data
     ProfileDataScanner m_profile_data;
 
+    /// Scan block encoding flags
+    uint8_t m_encoding {};
+
+    /// Flag indicating scan blocks hold partial aggregate results
+    bool m_aggregated {};
+
   };
 
   /// @}
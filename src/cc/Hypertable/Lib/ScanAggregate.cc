@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for ScanAggregate, AggregateValue and AggregateGroups.
+/// This file contains type definitions for ScanAggregate, an aggregate
+/// function applied to the results of a scan, and for the classes that hold
+/// partial aggregate results.
+
+#include <Common/Compat.h>
+
+#include "ScanAggregate.h"
+
+#include <Common/Logger.h>
+#include <Common/Serialization.h>
+#include <Common/String.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Hypertable;
+using namespace Hypertable::Lib;
+using namespace std;
+
+const char *ScanAggregate::function_name(uint8_t function) {
+  switch (function) {
+  case COUNT:
+    return "COUNT";
+  case SUM:
+    return "SUM";
+  case MIN:
+    return "MIN";
+  case MAX:
+    return "MAX";
+  default:
+    break;
+  }
+  return "UNKNOWN";
+}
+
+uint8_t ScanAggregate::encoding_version() const {
+  return 1;
+}
+
+size_t ScanAggregate::encoded_length_internal() const {
+  return 1 + Serialization::encoded_length_vstr(column);
+}
+
+/// @details
+/// Encoding is as follows:
+/// <table>
+/// <tr>
+/// <th>Encoding</th>
+/// <th>Description</th>
+/// </tr>
+/// <tr>
+/// <td>i8</td>
+/// <td>Function</td>
+/// </tr>
+/// <tr>
+/// <td>vstr</td>
+/// <td>Column</td>
+/// </tr>
+/// </table>
+void ScanAggregate::encode_internal(uint8_t **bufp) const {
+  Serialization::encode_i8(bufp, function);
+  Serialization::encode_vstr(bufp, column);
+}
+
+void ScanAggregate::decode_internal(uint8_t version, const uint8_t **bufp,
+                                    size_t *remainp) {
+  HT_TRY("decoding scan aggregate",
+         function = Serialization::decode_i8(bufp, remainp);
+         column = Serialization::decode_vstr(bufp, remainp));
+}
+
+const string ScanAggregate::render_hql() const {
+  string hql = function_name(function);
+  hql.append("(");
+  if (column && *column)
+    hql.append(column);
+  else
+    hql.append("*");
+  hql.append(")");
+  return hql;
+}
+
+/** @relates ScanAggregate */
+std::ostream &Hypertable::Lib::operator<<(std::ostream &os,
+                                          const ScanAggregate &sa) {
+  os << "{ScanAggregate function=" << ScanAggregate::function_name(sa.function);
+  if (sa.column)
+    os << " column=" << sa.column;
+  os << "}";
+  return os;
+}
+
+
+void AggregateValue::add(uint8_t function, const char *value, size_t len) {
+  if (function == ScanAggregate::COUNT) {
+    count++;
+    return;
+  }
+
+  char buf[64];
+  char *end;
+
+  if (len == 0 || len >= sizeof(buf))
+    return;
+  memcpy(buf, value, len);
+  buf[len] = 0;
+
+  errno = 0;
+  int64_t ival = strtoll(buf, &end, 10);
+  if (*end == 0 && errno == 0) {
+    fold(function, false, ival, 0.0);
+    count++;
+    return;
+  }
+
+  double dval = strtod(buf, &end);
+  if (*end != 0 || end == buf)
+    return;
+  fold(function, true, 0, dval);
+  count++;
+}
+
+void AggregateValue::add(uint8_t function, int64_t value) {
+  if (function != ScanAggregate::COUNT)
+    fold(function, false, value, 0.0);
+  count++;
+}
+
+void AggregateValue::merge(uint8_t function, const AggregateValue &other) {
+  if (other.count == 0)
+    return;
+  if (function != ScanAggregate::COUNT)
+    fold(function, other.is_double, other.int_value, other.double_value);
+  count += other.count;
+}
+
+void AggregateValue::fold(uint8_t function, bool other_is_double,
+                          int64_t ival, double dval) {
+
+  // First value of a MIN or MAX is taken as is
+  if (count == 0 && function != ScanAggregate::SUM) {
+    is_double = other_is_double;
+    int_value = ival;
+    double_value = dval;
+    return;
+  }
+
+  if (other_is_double && !is_double) {
+    double_value = (double)int_value;
+    is_double = true;
+  }
+  else if (is_double && !other_is_double)
+    dval = (double)ival;
+
+  switch (function) {
+  case ScanAggregate::SUM:
+    if (is_double)
+      double_value += dval;
+    else
+      int_value += ival;
+    break;
+  case ScanAggregate::MIN:
+    if (is_double) {
+      if (dval < double_value)
+        double_value = dval;
+    }
+    else if (ival < int_value)
+      int_value = ival;
+    break;
+  case ScanAggregate::MAX:
+    if (is_double) {
+      if (dval > double_value)
+        double_value = dval;
+    }
+    else if (ival > int_value)
+      int_value = ival;
+    break;
+  default:
+    HT_FATALF("Unknown aggregate function %d", (int)function);
+  }
+}
+
+const string AggregateValue::to_string(uint8_t function) const {
+  if (function == ScanAggregate::COUNT)
+    return format("%lld", (Lld)count);
+  if (is_double)
+    return format("%.15g", double_value);
+  return format("%lld", (Lld)int_value);
+}
+
+size_t AggregateValue::encoded_length() const {
+  return Serialization::encoded_length_vi64(count) + 1 +
+    (is_double ? Serialization::encoded_length_double() : 8);
+}
+
+/// @details
+/// Encoding is as follows:
+/// <table>
+/// <tr><th>Encoding</th><th>Description</th></tr>
+/// <tr><td>vi64</td><td>Count</td></tr>
+/// <tr><td>bool</td><td><i>is double</i> flag</td></tr>
+/// <tr><td>i64 or double</td><td>Result</td></tr>
+/// </table>
+void AggregateValue::encode(uint8_t **bufp) const {
+  Serialization::encode_vi64(bufp, count);
+  Serialization::encode_bool(bufp, is_double);
+  if (is_double)
+    Serialization::encode_double(bufp, double_value);
+  else
+    Serialization::encode_i64(bufp, int_value);
+}
+
+void AggregateValue::decode(const uint8_t **bufp, size_t *remainp) {
+  HT_TRY("decoding aggregate value",
+         count = Serialization::decode_vi64(bufp, remainp);
+         is_double = Serialization::decode_bool(bufp, remainp);
+         if (is_double)
+           double_value = Serialization::decode_double(bufp, remainp);
+         else
+           int_value = Serialization::decode_i64(bufp, remainp));
+}
+
+
+vector<AggregateValue> &AggregateGroups::get(const char *group, size_t len) {
+  auto iter = m_groups.find(string(group, len));
+  if (iter == m_groups.end())
+    iter = m_groups.emplace(string(group, len),
+                            vector<AggregateValue>(m_functions.size())).first;
+  return iter->second;
+}
+
+void AggregateGroups::merge(const char *group, size_t len, size_t index,
+                            const AggregateValue &value) {
+  HT_ASSERT(index < m_functions.size());
+  get(group, len)[index].merge(m_functions[index], value);
+}
+
+void AggregateGroups::merge(const AggregateGroups &other) {
+  HT_ASSERT(other.m_functions.size() == m_functions.size());
+  for (const auto &entry : other.m_groups) {
+    vector<AggregateValue> &values = get(entry.first.c_str(),
+                                         entry.first.length());
+    for (size_t i=0; i<values.size(); i++)
+      values[i].merge(m_functions[i], entry.second[i]);
+  }
+}
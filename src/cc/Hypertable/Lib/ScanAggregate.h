@@ -0,0 +1,242 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for ScanAggregate, AggregateValue and AggregateGroups.
+/// This file contains type declarations for ScanAggregate, an aggregate
+/// function applied to the results of a scan, and for the classes that hold
+/// partial aggregate results.
+
+#ifndef Hypertable_Lib_ScanAggregate_h
+#define Hypertable_Lib_ScanAggregate_h
+
+#include <Common/Serializable.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Hypertable {
+namespace Lib {
+
+  using namespace std;
+
+  /// @addtogroup libHypertable
+  /// @{
+
+  /**
+   * Represents an aggregate function in a scan (e.g. SELECT SUM(cf)).
+   * c-string data members are not managed so caller must handle
+   * (de)allocation.
+   */
+  class ScanAggregate : public Serializable {
+  public:
+    enum {
+      COUNT = 1,
+      SUM   = 2,
+      MIN   = 3,
+      MAX   = 4
+    };
+
+    ScanAggregate() { }
+
+    ScanAggregate(uint8_t fn, const char *col) : function(fn), column(col) { }
+
+    ScanAggregate(const uint8_t **bufp, size_t *remainp) {
+      decode(bufp, remainp);
+    }
+
+    virtual ~ScanAggregate() {}
+
+    /// Returns name of aggregate function.
+    /// @param function Aggregate function code
+    /// @return Name of function (e.g. "SUM")
+    static const char *function_name(uint8_t function);
+
+    /// Renders aggregate as HQL.
+    /// @return HQL string representing aggregate (e.g. "SUM(cf:q)")
+    const string render_hql() const;
+
+    /// Aggregate function code
+    uint8_t function {};
+
+    /// Column of the form &lt;family&gt;[:&lt;qualifier&gt;], or empty for
+    /// COUNT(*)
+    const char *column {};
+
+  private:
+
+    /// Returns encoding version.
+    /// @return Encoding version
+    uint8_t encoding_version() const override;
+
+    /// Returns internal serialized length.
+    /// @return Internal serialized length
+    /// @see encode_internal() for encoding format
+    size_t encoded_length_internal() const override;
+
+    /// Writes serialized representation of object to a buffer.
+    /// @param bufp Address of destination buffer pointer (advanced by call)
+    void encode_internal(uint8_t **bufp) const override;
+
+    /// Reads serialized representation of object from a buffer.
+    /// @param version Encoding version
+    /// @param bufp Address of destination buffer pointer (advanced by call)
+    /// @param remainp Address of integer holding amount of serialized object
+    /// remaining
+    /// @see encode_internal() for encoding format
+    void decode_internal(uint8_t version, const uint8_t **bufp,
+			 size_t *remainp) override;
+
+  };
+
+  std::ostream &operator<<(std::ostream &os, const ScanAggregate &sa);
+
+  /**
+   * Partial result of an aggregate function.
+   * Values are kept as 64-bit integers until a value with a fractional part
+   * or exponent is added, after which they are kept as doubles.
+   */
+  class AggregateValue {
+  public:
+
+    /// Adds a cell value.
+    /// For COUNT, increments #count.  For SUM, MIN and MAX, parses
+    /// <code>value</code> as a number and folds it into the result; values
+    /// that are not numbers are ignored.
+    /// @param function Aggregate function code
+    /// @param value Cell value (not NUL-terminated)
+    /// @param len Length of <code>value</code>
+    void add(uint8_t function, const char *value, size_t len);
+
+    /// Adds an integer value.
+    /// @param function Aggregate function code
+    /// @param value Value to add
+    void add(uint8_t function, int64_t value);
+
+    /// Merges another partial result into this one.
+    /// @param function Aggregate function code
+    /// @param other Partial result to merge
+    void merge(uint8_t function, const AggregateValue &other);
+
+    /// Renders result as ASCII.
+    /// @param function Aggregate function code
+    /// @return ASCII representation of result
+    const string to_string(uint8_t function) const;
+
+    /// Returns serialized length.
+    /// @return Serialized length
+    size_t encoded_length() const;
+
+    /// Writes serialized representation to a buffer.
+    /// @param bufp Address of destination buffer pointer (advanced by call)
+    void encode(uint8_t **bufp) const;
+
+    /// Reads serialized representation from a buffer.
+    /// @param bufp Address of source buffer pointer (advanced by call)
+    /// @param remainp Address of integer holding amount of remaining buffer
+    void decode(const uint8_t **bufp, size_t *remainp);
+
+    /// Number of values folded into result
+    int64_t count {};
+
+    /// Integer result (valid if #is_double is <i>false</i>)
+    int64_t int_value {};
+
+    /// Floating point result (valid if #is_double is <i>true</i>)
+    double double_value {};
+
+    /// Flag indicating result is held in #double_value
+    bool is_double {};
+
+  private:
+
+    void fold(uint8_t function, bool other_is_double, int64_t ival,
+              double dval);
+  };
+
+  /**
+   * Partial aggregate results, keyed by group.
+   * Each group holds one AggregateValue per aggregate function of the scan.
+   * The group key is the row prefix selected with GROUP BY ROW PREFIX, or
+   * the empty string if the scan is not grouped.
+   */
+  class AggregateGroups {
+  public:
+    typedef map<string, vector<AggregateValue>> GroupMap;
+
+    /// Sets aggregate functions.
+    /// @param functions Aggregate function code of each aggregate
+    void set_functions(const vector<uint8_t> &functions) {
+      m_functions = functions;
+    }
+
+    /// Returns aggregate functions.
+    /// @return Aggregate function code of each aggregate
+    const vector<uint8_t> &functions() const { return m_functions; }
+
+    /// Returns partial results of a group, creating them if necessary.
+    /// @param group Group key
+    /// @param len Length of group key
+    /// @return Partial results of group, one per aggregate function
+    vector<AggregateValue> &get(const char *group, size_t len);
+
+    /// Merges a partial result of one aggregate of a group.
+    /// @param group Group key
+    /// @param len Length of group key
+    /// @param index Index of aggregate function
+    /// @param value Partial result to merge
+    void merge(const char *group, size_t len, size_t index,
+               const AggregateValue &value);
+
+    /// Merges all partial results of another object.
+    /// @param other Partial results to merge
+    void merge(const AggregateGroups &other);
+
+    /// Returns map of groups.
+    /// @return Map of group key to partial results
+    const GroupMap &groups() const { return m_groups; }
+
+    /// Returns number of groups.
+    /// @return Number of groups
+    size_t size() const { return m_groups.size(); }
+
+    /// Checks if there are no groups.
+    /// @return <i>true</i> if there are no groups, <i>false</i> otherwise
+    bool empty() const { return m_groups.empty(); }
+
+    /// Removes all groups.
+    void clear() { m_groups.clear(); }
+
+  private:
+
+    /// Aggregate function code of each aggregate
+    vector<uint8_t> m_functions;
+
+    /// Map of group key to partial results
+    GroupMap m_groups;
+  };
+
+  /// @}
+
+}}
+
+#endif // Hypertable_Lib_ScanAggregate_h
@@ -28,14 +28,28 @@
 
 #include "ScanBlock.h"
 
+#include <Hypertable/Lib/BlockCompressionCodecLz4.h>
+#include <Hypertable/Lib/BlockHeader.h>
+
 #include <AsyncComm/Protocol.h>
 
 #include <Common/Error.h>
 #include <Common/Logger.h>
 #include <Common/Serialization.h>
 
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstring>
+
 using namespace Hypertable;
 using namespace Serialization;
+using namespace std;
+
+namespace {
+  /// Magic string of LZ4-compressed scan block header
+  const char SCAN_BLOCK_MAGIC[10] = { 'S','c','a','n','B','l','o','c','k','-' };
+}
 
 
 ScanBlock::ScanBlock() {
@@ -51,6 +65,12 @@ int ScanBlock::load(EventPtr &event) {
   m_event = event;
   m_vec.clear();
   m_iter = m_vec.end();
+  m_encoding = 0;
+  m_count = m_index = 0;
+  m_base = m_end = m_ptr = m_last_key = 0;
+  m_last_key_len = 0;
+  m_inflated.reset();
+  m_key_buf.clear();
 
   if ((m_error = (int)Protocol::response_code(event)) != Error::OK)
     return m_error;
@@ -58,6 +78,9 @@ int ScanBlock::load(EventPtr &event) {
   try {
     m_response.decode(&decode_ptr, &decode_remain);
     len = decode_i32(&decode_ptr, &decode_remain);
+    if (len > decode_remain)
+      HT_THROWF(Error::PROTOCOL_ERROR, "Scan block length %u exceeds "
+                "remaining payload %u", (unsigned)len, (unsigned)decode_remain);
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
@@ -65,6 +88,42 @@ int ScanBlock::load(EventPtr &event) {
   }
   uint8_t *p = (uint8_t *)decode_ptr;
   uint8_t *endp = p + len;
+
+  m_encoding = m_response.encoding();
+
+  if (m_encoding & ENCODING_LZ4) {
+    DynamicBuffer input(0, false);
+    BlockHeader header;
+    input.base = p;
+    input.ptr = endp;
+    m_inflated.reset(new DynamicBuffer());
+    try {
+      BlockCompressionCodecLz4 codec((BlockCompressionCodec::Args()));
+      codec.inflate(input, *m_inflated, header);
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << e << HT_END;
+      return e.code();
+    }
+    p = m_inflated->base;
+    endp = m_inflated->ptr;
+  }
+
+  if (m_encoding & ENCODING_PREFIX) {
+    const uint8_t *ptr = p;
+    size_t remain = endp - p;
+    try {
+      m_count = decode_vi32(&ptr, &remain);
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << e << HT_END;
+      return e.code();
+    }
+    m_base = m_ptr = ptr;
+    m_end = endp;
+    return m_error;
+  }
+
   SerializedKey key;
   ByteString value;
 
@@ -81,10 +140,31 @@ int ScanBlock::load(EventPtr &event) {
 }
 
 
+void ScanBlock::reset() {
+  if (m_encoding & ENCODING_PREFIX) {
+    m_ptr = m_base;
+    m_index = 0;
+    m_last_key = 0;
+    m_last_key_len = 0;
+    m_key_buf.clear();
+  }
+  else
+    m_iter = m_vec.begin();
+}
+
+
 bool ScanBlock::next(SerializedKey &key, ByteString &value) {
 
   assert(m_error == Error::OK);
 
+  if (m_encoding & ENCODING_PREFIX) {
+    if (m_index == m_count)
+      return false;
+    decode_next(key, value);
+    m_index++;
+    return true;
+  }
+
   if (m_iter == m_vec.end())
     return false;
 
@@ -95,3 +175,160 @@ bool ScanBlock::next(SerializedKey &key, ByteString &value) {
 
   return true;
 }
+
+
+void ScanBlock::decode_next(SerializedKey &key, ByteString &value) {
+  const uint8_t *ptr = m_ptr;
+  size_t remain = m_end - m_ptr;
+  uint32_t total = decode_vi32(&ptr, &remain);
+
+  if (total < 2 || total > remain)
+    HT_THROWF(Error::PROTOCOL_ERROR, "Bad encoded key length %u in scan block",
+              (unsigned)total);
+
+  const uint8_t *next = ptr + total;
+  uint8_t control = *ptr++;
+  remain = total - 1;
+  uint32_t matching = decode_vi32(&ptr, &remain);
+
+  if (matching > m_last_key_len)
+    HT_THROWF(Error::PROTOCOL_ERROR, "Encoded key shares %u bytes with "
+              "previous key of %u bytes", (unsigned)matching,
+              (unsigned)m_last_key_len);
+
+  size_t suffix_len = next - ptr;
+  uint32_t length = 1 + matching + suffix_len;
+  size_t header_len = encoded_length_vi32(length) + 1;
+
+  // The key is rebuilt in place of the previous one, so move the shared
+  // prefix to where it goes before writing the new header over it
+  size_t last_offset = m_last_key ? m_last_key - m_key_buf.base : 0;
+  if (m_key_buf.size < header_len + matching + suffix_len)
+    m_key_buf.grow(header_len + matching + suffix_len);
+  uint8_t *kbuf = m_key_buf.base;
+  if (matching)
+    memmove(kbuf + header_len, kbuf + last_offset, matching);
+
+  key.ptr = kbuf;
+  encode_vi32(&kbuf, length);
+  *kbuf++ = control;
+  memcpy(kbuf + matching, ptr, suffix_len);
+  m_last_key = kbuf;
+  m_last_key_len = matching + suffix_len;
+  m_key_buf.ptr = kbuf + m_last_key_len;
+
+  value.ptr = next;
+  m_ptr = next + value.length();
+  if (m_ptr > m_end)
+    HT_THROW(Error::PROTOCOL_ERROR, "Truncated value in scan block");
+}
+
+
+void ScanBlock::encode(uint8_t encoding, DynamicBuffer &dbuf) {
+
+  if (encoding == 0)
+    return;
+
+  HT_ASSERT(dbuf.fill() >= 4);
+
+  const uint8_t *base = dbuf.base + 4;
+  const uint8_t *end = dbuf.ptr;
+  DynamicBuffer output(dbuf.fill() + 8);
+  SerializedKey key;
+  ByteString value;
+  const uint8_t *p;
+
+  output.ptr = output.base + 4;
+
+  if (encoding & ENCODING_PREFIX) {
+    uint32_t count = 0;
+
+    for (p = base; p < end; count++) {
+      key.ptr = p;
+      p += key.length();
+      value.ptr = p;
+      p += value.length();
+    }
+
+    encode_vi32(&output.ptr, count);
+
+    const uint8_t *last = 0;
+    size_t last_len = 0;
+
+    for (p = base; p < end; ) {
+      const uint8_t *kptr;
+      key.ptr = p;
+      size_t klen = key.decode_length(&kptr);
+      uint8_t control = *kptr++;
+      size_t payload_len = klen - 1;
+
+      value.ptr = kptr + payload_len;
+      size_t value_len = value.length();
+      p = value.ptr + value_len;
+
+      size_t n = std::min(payload_len, last_len);
+      size_t matching = 0;
+      while (matching < n && kptr[matching] == last[matching])
+        matching++;
+
+      size_t suffix_len = payload_len - matching;
+      uint32_t total = 1 + encoded_length_vi32(matching) + suffix_len;
+
+      output.ensure(encoded_length_vi32(total) + total + value_len);
+      encode_vi32(&output.ptr, total);
+      *output.ptr++ = control;
+      encode_vi32(&output.ptr, matching);
+      output.add_unchecked(kptr + matching, suffix_len);
+      output.add_unchecked(value.ptr, value_len);
+
+      last = kptr;
+      last_len = payload_len;
+    }
+  }
+  else
+    output.add(base, end - base);
+
+  if (encoding & ENCODING_LZ4) {
+    DynamicBuffer input(0, false);
+    DynamicBuffer zblock;
+    BlockHeader header(BlockHeader::LatestVersion, SCAN_BLOCK_MAGIC);
+    BlockCompressionCodecLz4 codec((BlockCompressionCodec::Args()));
+    input.base = output.base + 4;
+    input.ptr = output.ptr;
+    codec.deflate(input, zblock, header, 0);
+    header.write_header_checksum(zblock.base);
+    output.clear();
+    output.reserve(4 + zblock.fill());
+    output.ptr = output.base + 4;
+    output.add_unchecked(zblock.base, zblock.fill());
+  }
+
+  uint8_t *ptr = output.base;
+  encode_i32(&ptr, output.fill() - 4);
+
+  std::swap(dbuf.base, output.base);
+  std::swap(dbuf.ptr, output.ptr);
+  std::swap(dbuf.mark, output.mark);
+  std::swap(dbuf.size, output.size);
+}
+
+
+uint8_t ScanBlock::parse_encoding(const std::string &spec) {
+  vector<string> tokens;
+  uint8_t encoding = 0;
+
+  boost::split(tokens, spec, boost::is_any_of("+"));
+  for (auto &token : tokens) {
+    boost::trim(token);
+    if (!strcasecmp(token.c_str(), "NONE"))
+      continue;
+    else if (!strcasecmp(token.c_str(), "PREFIX"))
+      encoding |= ENCODING_PREFIX;
+    else if (!strcasecmp(token.c_str(), "LZ4"))
+      encoding |= ENCODING_LZ4;
+    else
+      HT_THROWF(Error::CONFIG_BAD_VALUE, "Invalid scan block encoding '%s'",
+                spec.c_str());
+  }
+  return encoding;
+}
@@ -33,8 +33,10 @@
 #include <AsyncComm/Event.h>
 
 #include <Common/ByteString.h>
+#include <Common/DynamicBuffer.h>
 
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace Hypertable {
@@ -46,10 +48,24 @@ namespace Hypertable {
    * FETCH_SCANBLOCK RangeServer methods return a block of scan results
    * and this class parses and provides easy access to the key/value
    * pairs in that result.
+   *
+   * A scan block is sent either as a plain sequence of serialized key/value
+   * pairs or, if the client asked for it when creating the scanner, in an
+   * encoded form described by the encoding flags in the response (see
+   * encode()).  Encoded blocks are decoded lazily: the key of each pair is
+   * reconstructed only when it is returned by next().
    */
   class ScanBlock {
   public:
 
+    /// Scan block encoding flags
+    enum {
+      /// Keys are prefix-compressed against the preceding key
+      ENCODING_PREFIX = 0x01,
+      /// Block is LZ4-compressed
+      ENCODING_LZ4    = 0x02
+    };
+
     typedef std::vector< std::pair<SerializedKey, ByteString> > Vector;
 
     ScanBlock();
@@ -65,14 +81,17 @@ namespace Hypertable {
     /** Returns the number of key/value pairs in the scanblock.
      * @return number of key/value pairs in the scanblock
      */
-    size_t size() { return m_vec.size(); }
+    size_t size() {
+      return (m_encoding & ENCODING_PREFIX) ? m_count : m_vec.size();
+    }
 
     /** Resets iterator to first key/value pair in the scanblock. */
-    void reset() { m_iter = m_vec.begin(); }
+    void reset();
 
     /** Returns the next key/value pair in the scanblock.  <b>NOTE:</b>
      * invoking the #load method invalidates all pointers previously returned
-     * from this method.
+     * from this method.  For blocks with transient_keys(), the returned key
+     * is only valid until the next call.
      * @param key reference to return key pointer
      * @param value reference to return value pointer
      * @return true if key/value returned, false if no more key/value pairs
@@ -84,10 +103,19 @@ namespace Hypertable {
      */
     bool eos() { return !m_response.more(); }
 
+    /// Checks if keys returned by next() are overwritten by the next call.
+    /// Prefix-compressed keys are reconstructed in a buffer that is reused
+    /// for every key of the block, whereas other keys point into the block.
+    /// @return <i>true</i> if keys are only valid until the next call to
+    /// next(), <i>false</i> if they are valid until the block is reloaded
+    bool transient_keys() const { return m_encoding & ENCODING_PREFIX; }
+
     /** Indicates whether or not there are more key/value pairs in block
      * @return ture if #next will return more key/value pairs, false otherwise
      */
     bool more() {
+      if (m_encoding & ENCODING_PREFIX)
+        return m_index < m_count;
       if (m_iter == m_vec.end())
         return false;
       return true;
@@ -98,9 +126,11 @@ namespace Hypertable {
      * which contains most of the data
      */
     size_t memory_used() const {
-      if (m_event)
-        return m_event->payload_len;
-      return 0;
+      size_t used = m_event ? m_event->payload_len : 0;
+      if (m_inflated)
+        used += m_inflated->size;
+      used += m_key_buf.size;
+      return used;
     }
 
     /** Returns scanner ID associated with this scanblock.
@@ -111,19 +141,84 @@ namespace Hypertable {
     /** Returns number of skipped rows because of an OFFSET predicate */
     int get_skipped_rows() { return m_response.skipped_rows(); }
 
-    /** Returns number of skipped rows because of a CELL_OFFSET predicate */
+    /** Returns number of skipped cells because of a CELL_OFFSET predicate */
     int get_skipped_cells() { return m_response.skipped_cells(); }
 
+    /// Checks if block holds partial aggregate results.
+    /// @return <i>true</i> if the RangeServer evaluated the aggregates of the
+    /// scan specification, <i>false</i> otherwise
+    bool aggregated() { return m_response.aggregated(); }
+
     /// Returns reference to profile data.
     /// @return Reference to profile data
     const ProfileDataScanner &profile_data() { return m_response.profile_data(); }
 
+    /// Encodes a block of scan results.
+    /// <code>dbuf</code> holds a block as filled by the RangeServer: a
+    /// 32-bit length followed by that many bytes of serialized key/value
+    /// pairs.  It is replaced with a 32-bit length followed by the encoded
+    /// pairs.  With ENCODING_PREFIX, the encoded pairs start with the pair
+    /// count (vi32) and each key is written as its length (vi32), control
+    /// byte, the length of the prefix it shares with the previous key (vi32)
+    /// and the remaining bytes, as done by KeyCompressorPrefix.  Values are
+    /// written unchanged.  With ENCODING_LZ4, the (possibly prefix encoded)
+    /// pairs are then compressed into a single LZ4 block, preceded by a
+    /// BlockHeader.
+    /// @param encoding Encoding flags
+    /// @param dbuf Block to encode
+    static void encode(uint8_t encoding, DynamicBuffer &dbuf);
+
+    /// Parses an encoding specification.
+    /// The specification is <code>NONE</code> or a '+' separated list of
+    /// <code>PREFIX</code> and <code>LZ4</code> (case insensitive).
+    /// @param spec Encoding specification
+    /// @return Encoding flags
+    /// @throws Exception with code Error::CONFIG_BAD_VALUE if
+    /// <code>spec</code> is not valid
+    static uint8_t parse_encoding(const std::string &spec);
+
   private:
+
+    /// Decodes next prefix-compressed key.
+    /// @param key Set to the reconstructed key
+    /// @param value Set to the value
+    void decode_next(SerializedKey &key, ByteString &value);
+
     int m_error {};
     Vector m_vec;
     Vector::iterator m_iter;
     EventPtr m_event;
     Lib::RangeServer::Response::Parameters::CreateScanner m_response;
+
+    /// Encoding flags of block
+    uint8_t m_encoding {};
+
+    /// Number of key/value pairs in encoded block
+    size_t m_count {};
+
+    /// Index of next key/value pair to decode
+    size_t m_index {};
+
+    /// Start of encoded key/value pairs
+    const uint8_t *m_base {};
+
+    /// End of encoded key/value pairs
+    const uint8_t *m_end {};
+
+    /// Next encoded key/value pair
+    const uint8_t *m_ptr {};
+
+    /// Bytes following the control byte of last decoded key
+    const uint8_t *m_last_key {};
+
+    /// Length of #m_last_key
+    size_t m_last_key_len {};
+
+    /// Block inflated from LZ4-compressed payload
+    std::unique_ptr<DynamicBuffer> m_inflated;
+
+    /// Last key reconstructed by next()
+    DynamicBuffer m_key_buf;
   };
 
   /// Smart pointer to ScanBlock.
@@ -52,6 +52,7 @@ ScanCells::load(SchemaPtr &schema, const string &end_row, bool end_inclusive,
   ColumnFamilySpec *cf_spec;
   size_t total_cells=0;
   bool skipping = lastkey->row != 0;
+  const char *row = 0;
 
   for(size_t ii=0; ii < m_scanblocks.size(); ++ii)
     total_cells += m_scanblocks[ii]->size();
@@ -102,8 +103,18 @@ ScanCells::load(SchemaPtr &schema, const string &end_row, bool end_inclusive,
         }
       }
 
-      cell.row_key = key.row;
-      cell.column_qualifier = key.column_qualifier;
+      if (scanblock->transient_keys()) {
+        // Keep copies of the parts of the key the cell points to, sharing
+        // the row between the cells of a row
+        if (row == 0 || strcmp(row, key.row))
+          row = m_key_arena.dup(key.row);
+        cell.row_key = row;
+        cell.column_qualifier = m_key_arena.dup(key.column_qualifier);
+      }
+      else {
+        cell.row_key = key.row;
+        cell.column_qualifier = key.column_qualifier;
+      }
       if ((cf_spec = schema->get_column_family(key.column_family_code)) == 0) {
         if (key.flag != FLAG_DELETE_ROW)
           HT_THROWF(Error::BAD_KEY, "Unexpected column family code %d",
@@ -150,6 +161,41 @@ ScanCells::load(SchemaPtr &schema, const string &end_row, bool end_inclusive,
   return false;
 }
 
+void ScanCells::load_aggregates(AggregateGroups &staged,
+                                AggregateGroups &groups,
+                                int64_t *bytes_scanned) {
+  SerializedKey serkey;
+  ByteString value;
+  Key key;
+  AggregateValue aggregate;
+  const uint8_t *ptr;
+  size_t remain;
+
+  for (auto &scanblock : m_scanblocks) {
+    // A server that predates aggregate scans returns the raw cells
+    if (!scanblock->aggregated())
+      HT_THROW(Error::NOT_IMPLEMENTED,
+               "RangeServer does not support aggregate scans");
+    while (scanblock->next(serkey, value)) {
+      if (!key.load(serkey))
+        HT_THROW(Error::BAD_KEY, "");
+      if (key.column_family_code == 0 ||
+          key.column_family_code > staged.functions().size())
+        HT_THROWF(Error::BAD_KEY, "Unexpected aggregate index %d",
+                  (int)key.column_family_code - 1);
+      remain = value.decode_length(&ptr);
+      *bytes_scanned += key.length + remain;
+      aggregate.decode(&ptr, &remain);
+      staged.merge(key.row, key.row_len, key.column_family_code - 1,
+                   aggregate);
+    }
+    if (scanblock->eos()) {
+      groups.merge(staged);
+      staged.clear();
+    }
+  }
+}
+
 void ScanCells::add(Cell &cell, bool own) {
   if (!m_cells)
     m_cells = make_shared<CellsBuilder>();
@@ -24,6 +24,7 @@
 
 #include <Hypertable/Lib/Cells.h>
 #include <Hypertable/Lib/ProfileDataScanner.h>
+#include <Hypertable/Lib/ScanAggregate.h>
 #include <Hypertable/Lib/ScanBlock.h>
 #include <Hypertable/Lib/ScanLimitState.h>
 #include <Hypertable/Lib/Schema.h>
@@ -75,7 +76,7 @@ namespace Lib {
       for (const auto &v : m_scanblocks) {
         mem_used += v->memory_used();
       }
-      return mem_used;
+      return mem_used + m_key_arena.used();
     }
 
     /// Returns reference to profile data.
@@ -109,6 +110,23 @@ namespace Lib {
               ScanLimitState *limit_state, CstrSet &rowset,
               int64_t *bytes_scanned, Key *lastkey);
 
+    /// Merges partial aggregate results into aggregate groups.
+    /// Each key/value pair of an aggregation scan holds the partial result of
+    /// one aggregate for one group: the row is the group key, the column
+    /// family code is the aggregate index plus one, and the value is an
+    /// encoded AggregateValue.  Results of each scan block are merged into
+    /// <code>staged</code>, which is merged into <code>groups</code> and
+    /// cleared when a scan block marks the end of its range scanner, so
+    /// that <code>staged</code> only ever holds results of an unfinished
+    /// range.
+    /// @param staged Partial results of the range being scanned
+    /// @param groups Partial results of finished ranges
+    /// @param bytes_scanned Address of byte count to increment
+    /// @throws Exception with code Error::NOT_IMPLEMENTED if a scan block
+    /// was returned by a RangeServer that does not evaluate aggregates
+    void load_aggregates(AggregateGroups &staged, AggregateGroups &groups,
+                         int64_t *bytes_scanned);
+
     /**
      * get number of rows that were skipped because of an OFFSET predicate
      */
@@ -135,6 +153,10 @@ namespace Lib {
 
     vector<ScanBlockPtr> m_scanblocks;
     CellsBuilderPtr m_cells;
+
+    /// Rows and qualifiers of cells loaded from blocks with transient keys
+    CharArena m_key_arena;
+
     ProfileDataScanner m_profile_data;
     bool m_eos {};
   };
@@ -62,6 +62,12 @@ size_t ScanSpec::encoded_length_internal() const {
     len += ci.encoded_length();
   for (auto &cp : column_predicates)
     len += cp.encoded_length();
+  if (!aggregates.empty()) {
+    len += Serialization::encoded_length_vi32(aggregates.size()) +
+      Serialization::encoded_length_vi32(group_by_row_prefix);
+    for (auto &sa : aggregates)
+      len += sa.encoded_length();
+  }
   return len + 8 + 8 + 5;
 }
 
@@ -97,7 +103,15 @@ size_t ScanSpec::encoded_length_internal() const {
 /// <tr><td>bool</td><td><i>scan and filter rows</i> flag</td></tr>
 /// <tr><td>bool</td><td><i>do not cache</i> flag</td></tr>
 /// <tr><td>bool</td><td><i>and column predicates</i> flag</td></tr>
+/// <tr><td>TableParts</td><td>Rebuild indices</td></tr>
+/// <tr><td>vi32</td><td>Aggregate count (optional)</td></tr>
+/// <tr><td>For each aggregate ...</td></tr>
+/// <tr><td>ScanAggregate</td><td>Aggregate (optional)</td></tr>
+/// <tr><td>vi32</td><td>Group by row prefix length (optional)</td></tr>
 /// </table>
+/// The aggregate fields are only encoded if #aggregates is not empty.  They
+/// trail the version 1 fields so that servers that predate them skip them
+/// and plain scan specs encode exactly as before.
 void ScanSpec::encode_internal(uint8_t **bufp) const {
   Serialization::encode_vi32(bufp, row_offset);
   Serialization::encode_vi32(bufp, row_limit);
@@ -123,6 +137,11 @@ void ScanSpec::encode_internal(uint8_t **bufp) const {
   Serialization::encode_bool(bufp, do_not_cache);
   Serialization::encode_bool(bufp, and_column_predicates);
   rebuild_indices.encode(bufp);
+  if (!aggregates.empty()) {
+    Serialization::encode_vi32(bufp, aggregates.size());
+    for (auto & sa : aggregates) sa.encode(bufp);
+    Serialization::encode_vi32(bufp, group_by_row_prefix);
+  }
 }
 
 void ScanSpec::decode_internal(uint8_t version, const uint8_t **bufp,
@@ -130,6 +149,7 @@ void ScanSpec::decode_internal(uint8_t version, const uint8_t **bufp,
   RowInterval ri;
   CellInterval ci;
   ColumnPredicate cp;
+  ScanAggregate sa;
   HT_TRY("decoding scan spec",
          row_offset = Serialization::decode_vi32(bufp, remainp);
          row_limit = Serialization::decode_vi32(bufp, remainp);
@@ -160,7 +180,14 @@ void ScanSpec::decode_internal(uint8_t version, const uint8_t **bufp,
          scan_and_filter_rows = Serialization::decode_bool(bufp, remainp);
          do_not_cache = Serialization::decode_bool(bufp, remainp);
          and_column_predicates = Serialization::decode_bool(bufp, remainp);
-         rebuild_indices.decode(bufp, remainp));
+         rebuild_indices.decode(bufp, remainp);
+         if (*remainp > 0) {
+           for (size_t i = Serialization::decode_vi32(bufp, remainp); i--;) {
+             sa.decode(bufp, remainp);
+             aggregates.push_back(sa);
+           }
+           group_by_row_prefix = Serialization::decode_vi32(bufp, remainp);
+         });
 }
 
 const string ScanSpec::render_hql(const string &table) const {
@@ -168,7 +195,17 @@ const string ScanSpec::render_hql(const string &table) const {
 
   hql.append("SELECT ");
 
-  if (columns.empty())
+  if (!aggregates.empty()) {
+    bool first = true;
+    for (auto & sa : aggregates) {
+      if (first)
+        first = false;
+      else
+        hql.append(",");
+      hql.append(sa.render_hql());
+    }
+  }
+  else if (columns.empty())
     hql.append("*");
   else {
     bool first = true;
@@ -294,6 +331,9 @@ const string ScanSpec::render_hql(const string &table) const {
   if (rebuild_indices)
     hql.append(format(" REBUILD_INDICES %s", rebuild_indices.to_string().c_str()));
 
+  if (group_by_row_prefix)
+    hql.append(format(" GROUP BY ROW PREFIX %d", (int)group_by_row_prefix));
+
   return hql;
 }
 
@@ -383,6 +423,17 @@ ostream &Hypertable::Lib::operator<<(ostream &os, const ScanSpec &scan_spec) {
   if (scan_spec.rebuild_indices)
     os << " rebuild_indices=" << scan_spec.rebuild_indices.to_string();
 
+  if (scan_spec.parallel_ranges)
+    os << " parallel_ranges=" << scan_spec.parallel_ranges
+       << (scan_spec.parallel_unordered ? " unordered" : "");
+
+  // aggregates
+  for (auto & sa : scan_spec.aggregates)
+    os << " " << sa;
+
+  if (scan_spec.group_by_row_prefix)
+    os << " group_by_row_prefix=" << scan_spec.group_by_row_prefix;
+
   os << "}";
 
   return os;
@@ -402,11 +453,15 @@ ScanSpec::ScanSpec(CharArena &arena, const ScanSpec &ss)
     return_deletes(ss.return_deletes), keys_only(ss.keys_only),
     scan_and_filter_rows(ss.scan_and_filter_rows),
     do_not_cache(ss.do_not_cache), and_column_predicates(ss.and_column_predicates),
-    rebuild_indices(ss.rebuild_indices) {
+    rebuild_indices(ss.rebuild_indices), parallel_ranges(ss.parallel_ranges),
+    parallel_unordered(ss.parallel_unordered),
+    aggregates(ScanAggregateAlloc(arena)),
+    group_by_row_prefix(ss.group_by_row_prefix) {
   columns.reserve(ss.columns.size());
   row_intervals.reserve(ss.row_intervals.size());
   cell_intervals.reserve(ss.cell_intervals.size());
   column_predicates.reserve(ss.column_predicates.size());
+  aggregates.reserve(ss.aggregates.size());
 
   for (auto c : ss.columns)
     add_column(arena, c);
@@ -422,6 +477,9 @@ ScanSpec::ScanSpec(CharArena &arena, const ScanSpec &ss)
   for (const auto &cp : ss.column_predicates)
     add_column_predicate(arena, cp.column_family, cp.column_qualifier,
                          cp.operation, cp.value, cp.value_len);
+
+  for (const auto &sa : ss.aggregates)
+    add_aggregate(arena, sa.function, sa.column);
 }
 
 void
@@ -26,6 +26,7 @@
 #include <Hypertable/Lib/ColumnPredicate.h>
 #include <Hypertable/Lib/Key.h>
 #include <Hypertable/Lib/RowInterval.h>
+#include <Hypertable/Lib/ScanAggregate.h>
 #include <Hypertable/Lib/TableParts.h>
 
 #include <Common/PageArenaAllocator.h>
@@ -52,6 +53,9 @@ namespace Lib {
   typedef PageArenaAllocator<ColumnPredicate> ColumnPredicateAlloc;
   typedef vector<ColumnPredicate, ColumnPredicateAlloc> ColumnPredicates;
 
+  typedef PageArenaAllocator<ScanAggregate> ScanAggregateAlloc;
+  typedef vector<ScanAggregate, ScanAggregateAlloc> ScanAggregates;
+
   /// Scan predicate and control specification.
   class ScanSpec : public Serializable {
   public:
@@ -61,7 +65,8 @@ namespace Lib {
         row_intervals(RowIntervalAlloc(arena)),
         cell_intervals(CellIntervalAlloc(arena)),
         column_predicates(ColumnPredicateAlloc(arena)),
-        time_interval(TIMESTAMP_MIN, TIMESTAMP_MAX) { }
+        time_interval(TIMESTAMP_MIN, TIMESTAMP_MAX),
+        aggregates(ScanAggregateAlloc(arena)) { }
     ScanSpec(CharArena &arena, const ScanSpec &);
     ScanSpec(const uint8_t **bufp, size_t *remainp) { decode(bufp, remainp); }
 
@@ -91,6 +96,10 @@ namespace Lib {
       scan_and_filter_rows = false;
       do_not_cache = false;
       and_column_predicates = false;
+      parallel_ranges = 0;
+      parallel_unordered = false;
+      aggregates.clear();
+      group_by_row_prefix = 0;
     }
 
     /// Initialize another ScanSpec object with this copy sans the intervals.
@@ -118,10 +127,14 @@ namespace Lib {
       other.column_predicates = column_predicates;
       other.and_column_predicates = and_column_predicates;
       other.rebuild_indices = rebuild_indices;
+      other.parallel_ranges = parallel_ranges;
+      other.parallel_unordered = parallel_unordered;
+      other.aggregates = aggregates;
+      other.group_by_row_prefix = group_by_row_prefix;
     }
 
     bool cacheable() const {
-      if (do_not_cache || rebuild_indices)
+      if (do_not_cache || rebuild_indices || !aggregates.empty())
         return false;
       else if (row_intervals.size() == 1) {
         HT_ASSERT(row_intervals[0].start && row_intervals[0].end);
@@ -252,6 +265,21 @@ namespace Lib {
       column_predicates.push_back(cp);
     }
 
+    void add_aggregate(CharArena &arena, uint8_t function,
+                       const char *column) {
+      if (function < ScanAggregate::COUNT || function > ScanAggregate::MAX)
+        HT_THROWF(Error::BAD_SCAN_SPEC, "Invalid aggregate function %d",
+                  (int)function);
+      if ((column == 0 || *column == 0) && function != ScanAggregate::COUNT)
+        HT_THROWF(Error::BAD_SCAN_SPEC, "%s(*) not supported",
+                  ScanAggregate::function_name(function));
+      // Aggregate results are returned with the aggregate index as the
+      // column family code, which must fit in a byte
+      if (aggregates.size() == 255)
+        HT_THROW(Error::BAD_SCAN_SPEC, "Aggregate limit of 255 has been exceeded");
+      aggregates.push_back(ScanAggregate(function, arena.dup(column ? column : "")));
+    }
+
     void set_time_interval(int64_t start, int64_t end) {
       time_interval.first = start;
       time_interval.second = end;
@@ -285,6 +313,30 @@ namespace Lib {
     bool and_column_predicates {};
     TableParts rebuild_indices;
 
+    /// Maximum number of ranges of a row interval to scan concurrently.
+    /// Values greater than one make TableScannerAsync look up the ranges
+    /// covering each row interval up front and keep up to this many range
+    /// scans in flight.  Ignored for scans with cell intervals, row or cell
+    /// limits or offsets, or SCAN_AND_FILTER_ROWS.  Interpreted by the
+    /// client only and not serialized.
+    int32_t parallel_ranges {};
+
+    /// Deliver results of concurrent range scans in arrival order.
+    /// When <i>false</i>, results of concurrent range scans are delivered
+    /// in row order.  Interpreted by the client only and not serialized.
+    bool parallel_unordered {};
+
+    /// Aggregate functions to evaluate.
+    /// When not empty, each RangeServer evaluates these functions over the
+    /// cells it scans and returns partial results instead of cells, and
+    /// TableScannerAsync merges the partial results into one cell per group
+    /// and aggregate.  Row and cell limits and offsets are not allowed.
+    ScanAggregates aggregates;
+
+    /// Length of row prefix by which aggregate results are grouped.
+    /// Zero aggregates all cells of the scan into a single group.
+    int32_t group_by_row_prefix {};
+
   private:
 
     /// Returns encoding version.
@@ -549,6 +601,29 @@ namespace Lib {
       m_scan_spec.and_column_predicates = val;
     }
 
+    /// Scan ranges of each row interval concurrently.
+    /// @param n Maximum number of range scans in flight
+    /// @param unordered Deliver results in arrival order instead of row
+    /// order
+    void set_parallel_ranges(int32_t n, bool unordered=false) {
+      m_scan_spec.parallel_ranges = n;
+      m_scan_spec.parallel_unordered = unordered;
+    }
+
+    /// Adds an aggregate function to the scan.
+    /// @param function Aggregate function (e.g. ScanAggregate::SUM)
+    /// @param column Column of the form &lt;family&gt;[:&lt;qualifier&gt;],
+    /// or empty for COUNT(*)
+    void add_aggregate(uint8_t function, const string &column="") {
+      m_scan_spec.add_aggregate(m_arena, function, column.c_str());
+    }
+
+    /// Groups aggregate results by row prefix.
+    /// @param n Length of row prefix
+    void set_group_by_row_prefix(int32_t n) {
+      m_scan_spec.group_by_row_prefix = n;
+    }
+
     /**
      * Clears the state.
      */
@@ -34,16 +34,20 @@ using namespace std;
 
 namespace {
   enum Group {
-    PRIMARY_GROUP = 0
+    PRIMARY_GROUP = 0,
+    IO_GROUP = 1,
+    COMMIT_GROUP = 2
   };
 }
 
-StatsRangeServer::StatsRangeServer() : StatsSerializable(RANGE_SERVER, 1), timestamp(TIMESTAMP_MIN) {
+StatsRangeServer::StatsRangeServer() : StatsSerializable(RANGE_SERVER, 3), timestamp(TIMESTAMP_MIN) {
   group_ids[0] = PRIMARY_GROUP;
+  group_ids[1] = IO_GROUP;
+  group_ids[2] = COMMIT_GROUP;
 }
 
 
-StatsRangeServer::StatsRangeServer(PropertiesPtr &props) : StatsSerializable(RANGE_SERVER, 1), timestamp(TIMESTAMP_MIN) {
+StatsRangeServer::StatsRangeServer(PropertiesPtr &props) : StatsSerializable(RANGE_SERVER, 3), timestamp(TIMESTAMP_MIN) {
   const char *base, *ptr;
   string datadirs = props->get_str("Hypertable.RangeServer.Monitoring.DataDirectories");
   string dir;
@@ -66,6 +70,8 @@ StatsRangeServer::StatsRangeServer(PropertiesPtr &props) : StatsSerializable(RAN
                         StatsSystem::DISK|StatsSystem::SWAP|StatsSystem::NET|
                         StatsSystem::PROC | StatsSystem::FS, dirs);
   group_ids[0] = PRIMARY_GROUP;
+  group_ids[1] = IO_GROUP;
+  group_ids[2] = COMMIT_GROUP;
 }
 
 StatsRangeServer::StatsRangeServer(const StatsRangeServer &other) : StatsSerializable(other.id, other.group_count) {
@@ -95,6 +101,19 @@ StatsRangeServer::StatsRangeServer(const StatsRangeServer &other) : StatsSeriali
   cpu_user = other.cpu_user;
   cpu_sys = other.cpu_sys;
   live = other.live;
+  io_foreground_reads = other.io_foreground_reads;
+  io_foreground_read_bytes = other.io_foreground_read_bytes;
+  io_foreground_read_latency = other.io_foreground_read_latency;
+  io_foreground_write_bytes = other.io_foreground_write_bytes;
+  io_background_read_bytes = other.io_background_read_bytes;
+  io_background_write_bytes = other.io_background_write_bytes;
+  io_background_throttle_time = other.io_background_throttle_time;
+  io_background_rate = other.io_background_rate;
+  commit_syncs = other.commit_syncs;
+  commit_batch_size_p50 = other.commit_batch_size_p50;
+  commit_batch_size_p99 = other.commit_batch_size_p99;
+  commit_sync_latency_p50 = other.commit_sync_latency_p50;
+  commit_sync_latency_p99 = other.commit_sync_latency_p99;
   system = other.system;
   tables = other.tables;
 }
@@ -125,6 +144,19 @@ bool StatsRangeServer::operator==(const StatsRangeServer &other) const {
       !Serialization::equal(cpu_user, other.cpu_user) ||
       !Serialization::equal(cpu_sys, other.cpu_sys) ||
       live != other.live ||
+      io_foreground_reads != other.io_foreground_reads ||
+      io_foreground_read_bytes != other.io_foreground_read_bytes ||
+      io_foreground_read_latency != other.io_foreground_read_latency ||
+      io_foreground_write_bytes != other.io_foreground_write_bytes ||
+      io_background_read_bytes != other.io_background_read_bytes ||
+      io_background_write_bytes != other.io_background_write_bytes ||
+      io_background_throttle_time != other.io_background_throttle_time ||
+      io_background_rate != other.io_background_rate ||
+      commit_syncs != other.commit_syncs ||
+      commit_batch_size_p50 != other.commit_batch_size_p50 ||
+      commit_batch_size_p99 != other.commit_batch_size_p99 ||
+      commit_sync_latency_p50 != other.commit_sync_latency_p50 ||
+      commit_sync_latency_p99 != other.commit_sync_latency_p99 ||
       system != other.system)
     return false;
   if (tables.size() != other.tables.size())
@@ -149,6 +181,10 @@ size_t StatsRangeServer::encoded_length_group(int group) const {
       len += tables[i].encoded_length();
     return len;
   }
+  else if (group == IO_GROUP)
+    return 8*8;
+  else if (group == COMMIT_GROUP)
+    return 5*8;
   else
     HT_FATALF("Invalid group number (%d)", group);
   return 0;
@@ -186,6 +222,23 @@ void StatsRangeServer::encode_group(int group, uint8_t **bufp) const {
     for (size_t i=0; i<tables.size(); i++)
       tables[i].encode(bufp);
   }
+  else if (group == IO_GROUP) {
+    Serialization::encode_i64(bufp, io_foreground_reads);
+    Serialization::encode_i64(bufp, io_foreground_read_bytes);
+    Serialization::encode_i64(bufp, io_foreground_read_latency);
+    Serialization::encode_i64(bufp, io_foreground_write_bytes);
+    Serialization::encode_i64(bufp, io_background_read_bytes);
+    Serialization::encode_i64(bufp, io_background_write_bytes);
+    Serialization::encode_i64(bufp, io_background_throttle_time);
+    Serialization::encode_i64(bufp, io_background_rate);
+  }
+  else if (group == COMMIT_GROUP) {
+    Serialization::encode_i64(bufp, commit_syncs);
+    Serialization::encode_i64(bufp, commit_batch_size_p50);
+    Serialization::encode_i64(bufp, commit_batch_size_p99);
+    Serialization::encode_i64(bufp, commit_sync_latency_p50);
+    Serialization::encode_i64(bufp, commit_sync_latency_p99);
+  }
   else
     HT_FATALF("Invalid group number (%d)", group);
 }
@@ -226,6 +279,23 @@ void StatsRangeServer::decode_group(int group, uint16_t len, const uint8_t **buf
       tables.push_back(table);
     }
   }
+  else if (group == IO_GROUP) {
+    io_foreground_reads = Serialization::decode_i64(bufp, remainp);
+    io_foreground_read_bytes = Serialization::decode_i64(bufp, remainp);
+    io_foreground_read_latency = Serialization::decode_i64(bufp, remainp);
+    io_foreground_write_bytes = Serialization::decode_i64(bufp, remainp);
+    io_background_read_bytes = Serialization::decode_i64(bufp, remainp);
+    io_background_write_bytes = Serialization::decode_i64(bufp, remainp);
+    io_background_throttle_time = Serialization::decode_i64(bufp, remainp);
+    io_background_rate = Serialization::decode_i64(bufp, remainp);
+  }
+  else if (group == COMMIT_GROUP) {
+    commit_syncs = Serialization::decode_i64(bufp, remainp);
+    commit_batch_size_p50 = Serialization::decode_i64(bufp, remainp);
+    commit_batch_size_p99 = Serialization::decode_i64(bufp, remainp);
+    commit_sync_latency_p50 = Serialization::decode_i64(bufp, remainp);
+    commit_sync_latency_p99 = Serialization::decode_i64(bufp, remainp);
+  }
   else {
     HT_WARNF("Unrecognized StatsRangeServer group %d, skipping...", group);
     (*bufp) += len;
@@ -87,6 +87,19 @@ namespace Hypertable {
     double   cpu_user {};
     double   cpu_sys {};
     bool     live {};
+    uint64_t io_foreground_reads {};
+    uint64_t io_foreground_read_bytes {};
+    uint64_t io_foreground_read_latency {};
+    uint64_t io_foreground_write_bytes {};
+    uint64_t io_background_read_bytes {};
+    uint64_t io_background_write_bytes {};
+    uint64_t io_background_throttle_time {};
+    uint64_t io_background_rate {};
+    uint64_t commit_syncs {};
+    uint64_t commit_batch_size_p50 {};
+    uint64_t commit_batch_size_p99 {};
+    uint64_t commit_sync_latency_p50 {};
+    uint64_t commit_sync_latency_p99 {};
 
     StatsSystem system;
     std::vector<StatsTable> tables;
@@ -297,6 +297,60 @@ TableMutatorAsync::set_cells(Cells::const_iterator it,
     lock_guard<mutex> lock(m_member_mutex);
     ColumnFamilySpec *cf = 0;
 
+    // Without indexes, cells are routed to their range servers as a single
+    // sorted batch
+    if (!m_use_index) {
+      vector<TableMutatorAsyncScatterBuffer::BatchCell> batch;
+      batch.reserve(end - it);
+      size_t incr_mem = 0;
+      try {
+        for (; it != end; ++it) {
+          const Cell &cell = *it;
+          cell.sanity_check();
+          batch.emplace_back();
+          TableMutatorAsyncScatterBuffer::BatchCell &bc = batch.back();
+          if (!cell.column_family) {
+            if (cell.flag != FLAG_DELETE_ROW)
+              HT_THROW(Error::BAD_KEY,
+                  (String)"Column family not specified in non-delete row set "
+                  "on row=" + (String)cell.row_key);
+            bc.key.row = cell.row_key;
+            bc.key.timestamp = cell.timestamp;
+            bc.key.revision = cell.revision;
+            bc.key.flag = cell.flag;
+            cf = 0;
+          }
+          else
+            to_full_key(cell, bc.key, &cf);
+          if (cell.row_key)
+            bc.key.row_len = strlen(cell.row_key);
+          bc.cf = cf;
+          bc.incr_mem = 20 + bc.key.row_len + bc.key.column_qualifier_len;
+          if (cell.flag == FLAG_INSERT) {
+            bc.value = cell.value;
+            bc.value_len = cell.value_len;
+            bc.incr_mem += cell.value_len;
+          }
+          incr_mem += bc.incr_mem;
+        }
+        m_current_buffer->set(batch);
+        m_memory_used += incr_mem;
+      }
+      catch (...) {
+        const Cell &cell = (it == end) ? *(it-1) : *it;
+        handle_send_exceptions(
+          format("row=%s, cf=%s, cq=%s, value_len=%d (%s:%d)",
+          cell.row_key,
+          cell.column_family,
+          cell.column_qualifier ? cell.column_qualifier : "-",
+          cell.value_len,
+          __FILE__,
+          __LINE__));
+        throw;
+      }
+      it = end;
+    }
+
     try {
       for (; it != end; ++it) {
         Key full_key;
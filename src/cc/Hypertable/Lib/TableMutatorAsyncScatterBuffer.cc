@@ -73,8 +73,6 @@ void
 TableMutatorAsyncScatterBuffer::set(const Key &key, const ColumnFamilySpec *cf, const void *value,
     uint32_t value_len, size_t incr_mem) {
   RangeAddrInfo range_info;
-  TableMutatorAsyncSendBufferMap::const_iterator iter;
-  bool counter_reset = false;
 
   if (!m_location_cache->lookup(m_table_identifier.id, key.row, &range_info)) {
     Timer timer(m_timeout_ms, true);
@@ -86,60 +84,11 @@ TableMutatorAsyncScatterBuffer::set(const Key &key, const ColumnFamilySpec *cf,
 
   {
     lock_guard<mutex> lock(m_mutex);
-
-    bool is_counter = false;
-    if (key.column_family_code) {
-      if (!cf)
-        cf = m_schema->get_column_family(key.column_family_code);
-      is_counter = cf->get_option_counter();
-    }
-
-    // counter? make sure that a valid integer was specified and re-encode
-    // it as a 64bit value
-    if (is_counter) {
-      const char *ascii_value = (const char *)value;
-      char *endptr;
-      m_counter_value.clear();
-      m_counter_value.ensure(value_len+1);
-      if (value_len > 0 && (*ascii_value == '=' || *ascii_value == '+')) {
-        counter_reset = (*ascii_value == '=');
-        m_counter_value.add_unchecked(ascii_value+1, value_len-1);
-      }
-      else
-        m_counter_value.add_unchecked(value, value_len);
-      m_counter_value.add_unchecked((const void *)"\0",1);
-      int64_t val = strtoll((const char *)m_counter_value.base, &endptr, 0);
-      if (*endptr)
-        HT_THROWF(Error::BAD_KEY, "Expected integer value, got %s, row=%s",
-      (char*)m_counter_value.base, key.row);
-      m_counter_value.clear();
-      Serialization::encode_i64(&m_counter_value.ptr, val);
-    }
-
-    iter = m_buffer_map.find(range_info.addr);
-
-    if (iter == m_buffer_map.end()) {
-      iter = m_buffer_map.insert(std::make_pair(range_info.addr, make_shared<TableMutatorAsyncSendBuffer>(&m_table_identifier,
-                                 &m_completion_counter, m_range_locator.get()))).first;
-      (*iter).second->addr = range_info.addr;
-    }
-
-    (*iter).second->key_offsets.push_back((*iter).second->accum.fill());
-    create_key_and_append((*iter).second->accum, key);
-
-    // now append the counter
-    if (is_counter) {
-      if (counter_reset) {
-        *m_counter_value.ptr++ = '=';
-        append_as_byte_string((*iter).second->accum, m_counter_value.base, 9);
-      }
-      else
-        append_as_byte_string((*iter).second->accum, m_counter_value.base, 8);
-    }
-    else
-      append_as_byte_string((*iter).second->accum, value, value_len);
-
-    if ((*iter).second->accum.fill() > m_server_flush_limit)
+    TableMutatorAsyncSendBufferPtr &send_buffer = get_send_buffer(range_info.addr);
+    uint64_t offset = send_buffer->accum.fill();
+    append_cell(send_buffer->accum, key, cf, value, value_len);
+    send_buffer->key_offsets.push_back(offset);
+    if (send_buffer->accum.fill() > m_server_flush_limit)
       m_full = true;
     m_memory_used += incr_mem;
   }
@@ -150,7 +99,6 @@ void TableMutatorAsyncScatterBuffer::set_delete(const Key &key, size_t incr_mem)
   lock_guard<mutex> lock(m_mutex);
 
   RangeAddrInfo range_info;
-  TableMutatorAsyncSendBufferMap::const_iterator iter;
 
   if (key.flag == FLAG_INSERT)
     HT_THROW(Error::BAD_KEY, "Key flag is FLAG_INSERT, expected delete");
@@ -162,31 +110,167 @@ void TableMutatorAsyncScatterBuffer::set_delete(const Key &key, size_t incr_mem)
                                timer, false);
     range_info = range_loc_info;
   }
-  iter = m_buffer_map.find(range_info.addr);
 
+  TableMutatorAsyncSendBufferPtr &send_buffer = get_send_buffer(range_info.addr);
+  uint64_t offset = send_buffer->accum.fill();
+  append_cell(send_buffer->accum, key, nullptr, 0, 0);
+  send_buffer->key_offsets.push_back(offset);
+  if (send_buffer->accum.fill() > m_server_flush_limit)
+    m_full = true;
+  m_memory_used += incr_mem;
+}
+
+
+void TableMutatorAsyncScatterBuffer::set(std::vector<BatchCell> &cells) {
+
+  if (cells.empty())
+    return;
+
+  std::stable_sort(cells.begin(), cells.end(),
+                   [](const BatchCell &c1, const BatchCell &c2) {
+                     return strcmp(c1.key.row, c2.key.row) < 0;
+                   });
+
+  // Split sorted cells into runs that fall within a single range.  A range
+  // covers the rows in (start_row, end_row], with an empty end row meaning
+  // the end of the table, so a run extends until a row sorts past end_row.
+  struct Run {
+    size_t end;
+    CommAddress addr;
+  };
+  std::vector<Run> runs;
+  RangeLocationInfo range_loc_info;
+
+  for (size_t i=0; i<cells.size(); ) {
+    const char *row = cells[i].key.row;
+    if (!m_location_cache->lookup(m_table_identifier.id, row, &range_loc_info)) {
+      Timer timer(m_timeout_ms, true);
+      m_range_locator->find_loop(&m_table_identifier, row, &range_loc_info,
+                                 timer, false);
+    }
+    const char *end_row = range_loc_info.end_row.c_str();
+    if (*end_row == 0)
+      i = cells.size();
+    else {
+      for (++i; i<cells.size(); ++i) {
+        if (strcmp(cells[i].key.row, end_row) > 0)
+          break;
+      }
+    }
+    if (!runs.empty() && runs.back().addr == range_loc_info.addr)
+      runs.back().end = i;
+    else
+      runs.push_back({i, range_loc_info.addr});
+  }
+
+  lock_guard<mutex> lock(m_mutex);
+  size_t begin = 0;
+
+  for (auto &run : runs) {
+    TableMutatorAsyncSendBufferPtr &send_buffer = get_send_buffer(run.addr);
+    size_t incr_mem = 0;
+
+    m_run_buffer.clear();
+    m_run_offsets.clear();
+    for (size_t i=begin; i<run.end; ++i) {
+      const BatchCell &cell = cells[i];
+      m_run_offsets.push_back(m_run_buffer.fill());
+      if (cell.key.flag == FLAG_INSERT)
+        append_cell(m_run_buffer, cell.key, cell.cf, cell.value, cell.value_len);
+      else
+        append_cell(m_run_buffer, cell.key, nullptr, 0, 0);
+      incr_mem += cell.incr_mem;
+    }
+    begin = run.end;
+
+    uint64_t base = send_buffer->accum.fill();
+    send_buffer->accum.add(m_run_buffer.base, m_run_buffer.fill());
+    for (auto offset : m_run_offsets)
+      send_buffer->key_offsets.push_back(base + offset);
+
+    if (send_buffer->accum.fill() > m_server_flush_limit)
+      m_full = true;
+    m_memory_used += incr_mem;
+  }
+}
+
+
+TableMutatorAsyncSendBufferPtr &
+TableMutatorAsyncScatterBuffer::get_send_buffer(const CommAddress &addr) {
+  auto iter = m_buffer_map.find(addr);
   if (iter == m_buffer_map.end()) {
-    iter = m_buffer_map.insert(std::make_pair(range_info.addr, make_shared<TableMutatorAsyncSendBuffer>(&m_table_identifier,
-                                 &m_completion_counter, m_range_locator.get()))).first;
-    (*iter).second->addr = range_info.addr;
+    iter = m_buffer_map.insert(std::make_pair(addr, make_shared<TableMutatorAsyncSendBuffer>(&m_table_identifier,
+                               &m_completion_counter, m_range_locator.get()))).first;
+    (*iter).second->addr = addr;
   }
+  return (*iter).second;
+}
 
-  (*iter).second->key_offsets.push_back((*iter).second->accum.fill());
-  if (key.flag == FLAG_DELETE_COLUMN_FAMILY ||
-      key.flag == FLAG_DELETE_CELL || key.flag == FLAG_DELETE_CELL_VERSION) {
-    if (key.column_family_code == 0)
-      HT_THROWF(Error::BAD_KEY, "key.flag set to %d but column family=0", key.flag);
-    if (key.flag == FLAG_DELETE_CELL || key.flag == FLAG_DELETE_CELL_VERSION) {
-      if (key.flag == FLAG_DELETE_CELL_VERSION && key.timestamp == AUTO_ASSIGN) {
-        HT_THROWF(Error::BAD_KEY, "key.flag set to %d but timestamp == AUTO_ASSIGN", key.flag);
+
+void
+TableMutatorAsyncScatterBuffer::append_cell(DynamicBuffer &dst, const Key &key,
+    const ColumnFamilySpec *cf, const void *value, uint32_t value_len) {
+
+  if (key.flag != FLAG_INSERT) {
+    if (key.flag == FLAG_DELETE_COLUMN_FAMILY ||
+        key.flag == FLAG_DELETE_CELL || key.flag == FLAG_DELETE_CELL_VERSION) {
+      if (key.column_family_code == 0)
+        HT_THROWF(Error::BAD_KEY, "key.flag set to %d but column family=0", key.flag);
+      if (key.flag == FLAG_DELETE_CELL || key.flag == FLAG_DELETE_CELL_VERSION) {
+        if (key.flag == FLAG_DELETE_CELL_VERSION && key.timestamp == AUTO_ASSIGN) {
+          HT_THROWF(Error::BAD_KEY, "key.flag set to %d but timestamp == AUTO_ASSIGN", key.flag);
+        }
       }
     }
+    create_key_and_append(dst, key);
+    append_as_byte_string(dst, 0, 0);
+    return;
   }
 
-  create_key_and_append((*iter).second->accum, key);
-  append_as_byte_string((*iter).second->accum, 0, 0);
-  if ((*iter).second->accum.fill() > m_server_flush_limit)
-    m_full = true;
-  m_memory_used += incr_mem;
+  bool is_counter = false;
+  bool counter_reset = false;
+
+  if (key.column_family_code) {
+    if (!cf)
+      cf = m_schema->get_column_family(key.column_family_code);
+    is_counter = cf->get_option_counter();
+  }
+
+  // counter? make sure that a valid integer was specified and re-encode
+  // it as a 64bit value
+  if (is_counter) {
+    const char *ascii_value = (const char *)value;
+    char *endptr;
+    m_counter_value.clear();
+    m_counter_value.ensure(value_len+1);
+    if (value_len > 0 && (*ascii_value == '=' || *ascii_value == '+')) {
+      counter_reset = (*ascii_value == '=');
+      m_counter_value.add_unchecked(ascii_value+1, value_len-1);
+    }
+    else
+      m_counter_value.add_unchecked(value, value_len);
+    m_counter_value.add_unchecked((const void *)"\0",1);
+    int64_t val = strtoll((const char *)m_counter_value.base, &endptr, 0);
+    if (*endptr)
+      HT_THROWF(Error::BAD_KEY, "Expected integer value, got %s, row=%s",
+    (char*)m_counter_value.base, key.row);
+    m_counter_value.clear();
+    Serialization::encode_i64(&m_counter_value.ptr, val);
+  }
+
+  create_key_and_append(dst, key);
+
+  // now append the counter
+  if (is_counter) {
+    if (counter_reset) {
+      *m_counter_value.ptr++ = '=';
+      append_as_byte_string(dst, m_counter_value.base, 9);
+    }
+    else
+      append_as_byte_string(dst, m_counter_value.base, 8);
+  }
+  else
+    append_as_byte_string(dst, value, value_len);
 }
 
 
@@ -195,7 +279,6 @@ TableMutatorAsyncScatterBuffer::set(SerializedKey key, ByteString value, size_t
   lock_guard<mutex> lock(m_mutex);
 
   RangeAddrInfo range_info;
-  TableMutatorAsyncSendBufferMap::const_iterator iter;
   const uint8_t *ptr = key.ptr;
   size_t len = Serialization::decode_vi32(&ptr);
 
@@ -208,19 +291,12 @@ TableMutatorAsyncScatterBuffer::set(SerializedKey key, ByteString value, size_t
     range_info = range_loc_info;
   }
 
-  iter = m_buffer_map.find(range_info.addr);
-
-  if (iter == m_buffer_map.end()) {
-    iter = m_buffer_map.insert(std::make_pair(range_info.addr, make_shared<TableMutatorAsyncSendBuffer>(&m_table_identifier,
-                               &m_completion_counter, m_range_locator.get()))).first;
-    (*iter).second->addr = range_info.addr;
-  }
-
-  (*iter).second->key_offsets.push_back((*iter).second->accum.fill());
-  (*iter).second->accum.add(key.ptr, (ptr-key.ptr)+len);
-  (*iter).second->accum.add(value.ptr, value.length());
+  TableMutatorAsyncSendBufferPtr &send_buffer = get_send_buffer(range_info.addr);
+  send_buffer->key_offsets.push_back(send_buffer->accum.fill());
+  send_buffer->accum.add(key.ptr, (ptr-key.ptr)+len);
+  send_buffer->accum.add(value.ptr, value.length());
 
-  if ((*iter).second->accum.fill() > m_server_flush_limit)
+  if (send_buffer->accum.fill() > m_server_flush_limit)
     m_full = true;
   m_memory_used += incr_mem;
 }
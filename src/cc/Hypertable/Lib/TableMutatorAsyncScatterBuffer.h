@@ -64,6 +64,23 @@ namespace Hypertable {
   class TableMutatorAsyncScatterBuffer {
 
   public:
+
+    /// %Cell passed to set(std::vector<BatchCell> &).
+    /// The key, column family spec and value are referenced, not copied, so
+    /// they must remain valid until set() returns.
+    struct BatchCell {
+      /// Fully resolved key (delete flags are allowed)
+      Key key;
+      /// Column family spec, or nullptr to look it up in the schema
+      const ColumnFamilySpec *cf {};
+      /// Cell value
+      const void *value {};
+      /// Length of cell value
+      uint32_t value_len {};
+      /// Amount of memory to account for the cell
+      size_t incr_mem {};
+    };
+
     TableMutatorAsyncScatterBuffer(Comm *comm, ApplicationQueueInterfacePtr &app_queue,
                                    TableMutatorAsync *mutator,
                                    const TableIdentifier *,
@@ -75,6 +92,17 @@ namespace Hypertable {
              uint32_t value_len, size_t incr_mem);
     void set_delete(const Key &key, size_t incr_mem);
     void set(SerializedKey key, ByteString value, size_t incr_mem);
+
+    /// Adds a batch of cells.
+    /// Sorts <code>cells</code> by row (stable, so updates to the same row
+    /// keep their relative order) and then walks the sorted batch in runs
+    /// of cells that fall within the same range.  The location of each run
+    /// is resolved once and the run extends for as long as the rows do not
+    /// exceed the end row of that range.  Each run is serialized into a
+    /// staging buffer and appended to the send buffer of its range server
+    /// with a single copy.  Insert and delete cells can be mixed.
+    /// @param cells Cells to add (reordered by this method)
+    void set(std::vector<BatchCell> &cells);
     bool full() { std::lock_guard<std::mutex> lock(m_mutex); return m_full; }
     void send(uint32_t flags);
     void wait_for_completion();
@@ -105,6 +133,26 @@ namespace Hypertable {
 
   private:
     int set_failed_mutations();
+
+    /// Returns send buffer for a range server, creating it if necessary.
+    /// Must be called with #m_mutex locked.
+    /// @param addr Range server address
+    /// @return Send buffer for <code>addr</code>
+    TableMutatorAsyncSendBufferPtr &get_send_buffer(const CommAddress &addr);
+
+    /// Validates and serializes a cell.
+    /// Counter values are parsed and re-encoded as 64-bit integers and the
+    /// column family of delete keys is checked.  Must be called with
+    /// #m_mutex locked.
+    /// @param dst Buffer to append serialized key and value to
+    /// @param key Key of cell
+    /// @param cf Column family spec, or nullptr to look it up in the schema
+    /// @param value Cell value
+    /// @param value_len Length of cell value
+    void append_cell(DynamicBuffer &dst, const Key &key,
+                     const ColumnFamilySpec *cf, const void *value,
+                     uint32_t value_len);
+
     typedef CommAddressMap<TableMutatorAsyncSendBufferPtr> TableMutatorAsyncSendBufferMap;
 
     Comm                *m_comm;
@@ -125,6 +173,8 @@ namespace Hypertable {
     uint32_t             m_timeout_ms;
     uint32_t             m_server_flush_limit;
     DynamicBuffer        m_counter_value;
+    DynamicBuffer        m_run_buffer;
+    std::vector<uint32_t> m_run_offsets;
     Timer                m_timer;
     uint32_t             m_id;
     CommAddressSet       m_unsynced_rangeservers;
@@ -57,7 +57,9 @@ TableScannerAsync::TableScannerAsync(Comm *comm,
   HT_ASSERT(timeout_ms);
 
   // can we optimize this query with an index?
+  // aggregates are evaluated on the primary table
   if (!(flags & Table::SCANNER_FLAG_IGNORE_INDEX)
+      && scan_spec.aggregates.empty()
       && use_index(table, scan_spec, index_spec,
                    cell_predicates,
                    &use_qualifier,
@@ -414,11 +416,37 @@ void TableScannerAsync::init(Comm *comm, ApplicationQueueInterfacePtr &app_queue
   Timer timer(timeout_ms);
   bool current_set = false;
 
+  m_timeout_ms = timeout_ms;
+
   m_cb->increment_outstanding();
   m_cb->register_scanner(this);
 
   try {
-    if (scan_spec.row_intervals.empty()) {
+    if (!scan_spec.aggregates.empty()) {
+      if (scan_spec.row_limit || scan_spec.cell_limit ||
+          scan_spec.row_offset || scan_spec.cell_offset)
+        HT_THROW(Error::BAD_SCAN_SPEC, "Row and cell limits and offsets "
+                 "can't be combined with aggregates");
+      vector<uint8_t> functions;
+      for (const auto &sa : scan_spec.aggregates) {
+        functions.push_back(sa.function);
+        m_aggregate_columns.push_back(sa.render_hql());
+      }
+      m_aggregate_groups.set_functions(functions);
+      m_grouped = scan_spec.group_by_row_prefix > 0;
+      m_aggregate = true;
+    }
+    else if (scan_spec.group_by_row_prefix)
+      HT_THROW(Error::BAD_SCAN_SPEC, "GROUP BY ROW PREFIX requires aggregates");
+
+    if (scan_spec.parallel_ranges > 1 && scan_spec.cell_intervals.empty() &&
+        !scan_spec.scan_and_filter_rows && !scan_spec.row_limit &&
+        !scan_spec.cell_limit && !scan_spec.row_offset &&
+        !scan_spec.cell_offset) {
+      init_parallel(comm, app_queue, table, range_locator, scan_spec,
+                    timeout_ms);
+    }
+    else if (scan_spec.row_intervals.empty()) {
       if (scan_spec.cell_intervals.empty()) {
         ri_scanner =
           make_shared<IntervalScannerAsync>(comm, app_queue, table, range_locator,
@@ -493,6 +521,7 @@ void TableScannerAsync::init(Comm *comm, ApplicationQueueInterfacePtr &app_queue
   catch (Exception &e) {
     m_error = e.code();
     m_error_msg = e.what();
+    drop_pending_scanners();
     if (ri_scanner && ri_scanner->has_outstanding_requests()) {
       m_interval_scanners.push_back(ri_scanner);
       m_outstanding++;
@@ -502,6 +531,129 @@ void TableScannerAsync::init(Comm *comm, ApplicationQueueInterfacePtr &app_queue
   }
 }
 
+void TableScannerAsync::init_parallel(Comm *comm,
+        ApplicationQueueInterfacePtr &app_queue, Table *table,
+        RangeLocatorPtr &range_locator, const ScanSpec &scan_spec,
+        uint32_t timeout_ms) {
+  TableIdentifierManaged table_identifier;
+  SchemaPtr schema;
+  RangeLocationInfo range_info;
+  Timer timer(timeout_ms, true);
+  PendingInterval pending;
+  string row;
+
+  table->get(table_identifier, schema);
+
+  m_comm = comm;
+  m_app_queue = app_queue;
+  m_range_locator = range_locator;
+  m_parallel = scan_spec.parallel_ranges;
+  // aggregate results are only delivered at the end of the scan, so there
+  // is no order to preserve
+  m_unordered = scan_spec.parallel_unordered || m_aggregate;
+  m_parallel_spec = make_unique<ScanSpecBuilder>(scan_spec);
+
+  vector<RowInterval> intervals(scan_spec.row_intervals.begin(),
+                                scan_spec.row_intervals.end());
+  if (intervals.empty()) {
+    RowInterval ri;
+    ri.start = "";
+    ri.start_inclusive = false;
+    ri.end = Key::END_ROW_MARKER;
+    ri.end_inclusive = false;
+    intervals.push_back(ri);
+  }
+
+  // Split each interval at the end rows of the ranges it covers
+  for (const auto &ri : intervals) {
+    const char *end_row = (ri.end == 0 || *ri.end == 0) ?
+      Key::END_ROW_MARKER : ri.end;
+    pending.start = ri.start ? ri.start : "";
+    pending.start_inclusive = ri.start_inclusive;
+    row = pending.start;
+    if (!pending.start_inclusive)
+      row.append(1, 1);
+    while (true) {
+      range_locator->find_loop(&table_identifier, row.c_str(), &range_info,
+                               timer, false);
+      if (range_info.end_row.compare(Key::END_ROW_MARKER) == 0 ||
+          range_info.end_row.compare(end_row) >= 0) {
+        pending.end = end_row;
+        pending.end_inclusive = ri.end_inclusive;
+        m_pending.push_back(pending);
+        break;
+      }
+      pending.end = range_info.end_row;
+      pending.end_inclusive = true;
+      m_pending.push_back(pending);
+      pending.start = range_info.end_row;
+      pending.start_inclusive = false;
+      row = range_info.end_row;
+      row.append(1, 1);
+    }
+  }
+
+  m_interval_scanners.resize(m_pending.size());
+  m_outstanding = m_pending.size();
+  start_pending_scanners();
+}
+
+
+void TableScannerAsync::start_pending_scanners() {
+  ScanSpec interval_scan_spec;
+  RowInterval ri;
+
+  while (m_active < m_parallel && m_next_pending < m_pending.size()) {
+    const PendingInterval &pending = m_pending[m_next_pending];
+    m_parallel_spec->get().base_copy(interval_scan_spec);
+    ri.start = pending.start.c_str();
+    ri.start_inclusive = pending.start_inclusive;
+    ri.end = pending.end.c_str();
+    ri.end_inclusive = pending.end_inclusive;
+    interval_scan_spec.row_intervals.push_back(ri);
+    // In order mode only the first scanner is current; the others hold
+    // their first scan block until they become current
+    bool current = m_unordered || m_next_pending == 0;
+    m_interval_scanners[m_next_pending] =
+      make_shared<IntervalScannerAsync>(m_comm, m_app_queue, m_table,
+                                        m_range_locator, interval_scan_spec,
+                                        m_timeout_ms, current, this,
+                                        (int)m_next_pending);
+    m_next_pending++;
+    m_active++;
+  }
+}
+
+
+bool TableScannerAsync::maybe_start_pending_scanners() {
+  if (m_next_pending == m_pending.size())
+    return true;
+  if (m_error != Error::OK || is_cancelled()) {
+    drop_pending_scanners();
+    return true;
+  }
+  try {
+    start_pending_scanners();
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    m_error = e.code();
+    m_error_msg = e.what();
+    drop_pending_scanners();
+    return false;
+  }
+  return true;
+}
+
+
+void TableScannerAsync::drop_pending_scanners() {
+  if (m_next_pending < m_pending.size()) {
+    m_outstanding -= m_pending.size() - m_next_pending;
+    m_next_pending = m_pending.size();
+  }
+}
+
+
 TableScannerAsync::~TableScannerAsync() {
   try {
     cancel();
@@ -628,6 +780,8 @@ void TableScannerAsync::handle_result(int scanner_id, EventPtr &event, bool is_c
 
   // abort interval scanners if we've seen an error previously or scanned has been cancelled
   bool abort = (m_error != Error::OK || cancelled);
+  if (abort)
+    drop_pending_scanners();
 
   bool next;
   bool do_callback = false;
@@ -672,6 +826,7 @@ void TableScannerAsync::handle_result(int scanner_id, EventPtr &event, bool is_c
 
 void TableScannerAsync::maybe_callback_error(int scanner_id, bool next) {
   bool eos = false;
+  drop_pending_scanners();
   // ok to update m_outstanding since caller has locked mutex
   if (next) {
     HT_ASSERT(m_outstanding>0 && m_interval_scanners[scanner_id] != 0);
@@ -679,6 +834,8 @@ void TableScannerAsync::maybe_callback_error(int scanner_id, bool next) {
     // Aggregate profile data
     m_profile_data += m_interval_scanners[scanner_id]->profile_data();
     m_interval_scanners[scanner_id] = 0;
+    if (m_parallel)
+      m_active--;
   }
 
   if (m_outstanding == 0) {
@@ -702,13 +859,32 @@ void TableScannerAsync::maybe_callback_ok(int scanner_id, bool next, bool do_cal
     m_outstanding--;
     // Aggregate profile data
     m_profile_data += m_interval_scanners[scanner_id]->profile_data();
+    if (m_aggregate)
+      m_aggregate_groups.merge(m_interval_scanners[scanner_id]->aggregate_groups());
     m_interval_scanners[scanner_id] = 0;
+    if (m_parallel) {
+      m_active--;
+      if (!maybe_start_pending_scanners()) {
+        maybe_callback_error(scanner_id, false);
+        return;
+      }
+    }
   }
 
   if (m_outstanding == 0) {
     eos = true;
   }
 
+  // aggregate results are delivered once, at the end of the scan
+  if (m_aggregate) {
+    do_callback = eos;
+    if (eos) {
+      cells = make_shared<ScanCells>();
+      if (!is_cancelled())
+        load_aggregate_results(cells);
+    }
+  }
+
   if (do_callback) {
     if (eos)
       cells->set_eos();
@@ -723,6 +899,32 @@ void TableScannerAsync::maybe_callback_ok(int scanner_id, bool next, bool do_cal
   }
 }
 
+void TableScannerAsync::load_aggregate_results(ScanCellsPtr &cells) {
+  const vector<uint8_t> &functions = m_aggregate_groups.functions();
+  string value;
+  Cell cell;
+
+  // an ungrouped scan always returns its COUNT results, even if zero
+  if (!m_grouped && m_aggregate_groups.empty())
+    m_aggregate_groups.get("", 0);
+
+  for (const auto &entry : m_aggregate_groups.groups()) {
+    for (size_t i=0; i<functions.size(); i++) {
+      const AggregateValue &result = entry.second[i];
+      if (result.count == 0 && functions[i] != ScanAggregate::COUNT)
+        continue;
+      value = result.to_string(functions[i]);
+      cell.row_key = entry.first.c_str();
+      cell.column_family = m_aggregate_columns[i].c_str();
+      cell.column_qualifier = "";
+      cell.value = (const uint8_t *)value.c_str();
+      cell.value_len = value.length();
+      cell.flag = FLAG_INSERT;
+      cells->add(cell);
+    }
+  }
+}
+
 void TableScannerAsync::wait_for_completion() {
   unique_lock<mutex> lock(m_mutex);
   m_cond.wait(lock, [this](){ return m_outstanding == 0; });
@@ -739,6 +941,10 @@ void TableScannerAsync::move_to_next_interval_scanner(int current_scanner) {
   ScanCellsPtr cells;
   bool abort = cancelled || (m_error != Error::OK);
 
+  // in unordered mode every interval scanner is current
+  if (m_unordered)
+    return;
+
   while (next && m_outstanding && current_scanner < ((int)m_interval_scanners.size())-1) {
     current_scanner++;
     // unless the scan has been aborted we should be going through scanners in order
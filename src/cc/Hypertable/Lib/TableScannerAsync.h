@@ -36,7 +36,9 @@
 #include <AsyncComm/DispatchHandlerSynchronizer.h>
 
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 namespace Hypertable {
@@ -148,6 +150,45 @@ namespace Hypertable {
     void maybe_callback_error(int scanner_id, bool next);
     void wait_for_completion();
     void move_to_next_interval_scanner(int current_scanner);
+
+    /// Sets up concurrent scan of ranges.
+    /// Looks up the ranges covering each row interval of
+    /// <code>scan_spec</code> (or the whole table if there are none) and
+    /// adds a pending sub-interval to #m_pending for each one.  Then starts
+    /// the first <code>scan_spec.parallel_ranges</code> of them.
+    /// @param comm Comm layer
+    /// @param app_queue Application queue
+    /// @param table Table to scan
+    /// @param range_locator Range locator
+    /// @param scan_spec Scan specification
+    /// @param timeout_ms Timeout in milliseconds
+    void init_parallel(Comm *comm, ApplicationQueueInterfacePtr &app_queue,
+                       Table *table, RangeLocatorPtr &range_locator,
+                       const ScanSpec &scan_spec, uint32_t timeout_ms);
+
+    /// Starts pending sub-interval scanners.
+    /// Creates interval scanners for entries of #m_pending, in order, until
+    /// #m_parallel scanners are active.  Caller must hold #m_mutex.
+    void start_pending_scanners();
+
+    /// Starts pending sub-interval scanners after one has finished.
+    /// If the scan has been cancelled or has failed, drops the pending
+    /// sub-intervals instead.  Caller must hold #m_mutex.
+    /// @return <i>false</i> if a scanner could not be started, in which
+    /// case #m_error is set and the pending sub-intervals are dropped
+    bool maybe_start_pending_scanners();
+
+    /// Drops sub-intervals that have not been started yet.
+    /// Removes them from #m_outstanding.  Caller must hold #m_mutex.
+    void drop_pending_scanners();
+    /// Builds scan results from merged aggregate results.
+    /// Adds one cell to <code>cells</code> for each group and aggregate in
+    /// #m_aggregate_groups.  The row key of each cell is the group key, the
+    /// column family is the rendered aggregate (e.g. "SUM(cf)"), and the
+    /// value is the ASCII result.  Aggregates other than COUNT without any
+    /// numeric input in a group are omitted.
+    /// @param cells Scan cells to populate
+    void load_aggregate_results(ScanCellsPtr &cells);
     bool use_index(Table *table, const ScanSpec &primary_spec, 
                    ScanSpecBuilder &index_spec,
                    std::vector<CellPredicate> &cell_predicates,
@@ -172,6 +213,38 @@ namespace Hypertable {
     Table              *m_table;
     bool                m_cancelled;
     bool                m_use_index;
+
+    /// Row interval of a range to be scanned concurrently
+    struct PendingInterval {
+      std::string start;
+      bool start_inclusive;
+      std::string end;
+      bool end_inclusive;
+    };
+
+    /// Sub-intervals of a concurrent scan, one per interval scanner
+    std::vector<PendingInterval> m_pending;
+    /// Index of next sub-interval of #m_pending to start
+    size_t m_next_pending {};
+    /// Maximum number of active interval scanners (0 if not concurrent)
+    int m_parallel {};
+    /// Number of active interval scanners of concurrent scan
+    int m_active {};
+    /// Deliver results of concurrent scan in arrival order
+    bool m_unordered {};
+    /// Scan specification of concurrent scan, without row intervals
+    std::unique_ptr<ScanSpecBuilder> m_parallel_spec;
+    Comm *m_comm {};
+    ApplicationQueueInterfacePtr m_app_queue;
+    RangeLocatorPtr m_range_locator;
+    /// Flag indicating scan evaluates aggregates
+    bool m_aggregate {};
+    /// Flag indicating aggregate results are grouped by row prefix
+    bool m_grouped {};
+    /// Merged aggregate results of finished interval scanners
+    AggregateGroups m_aggregate_groups;
+    /// Column family of result cells of each aggregate
+    std::vector<std::string> m_aggregate_columns;
   };
 
   /// Smart pointer to TableScannerAsync
@@ -20,6 +20,8 @@
  */
 
 #include <Common/Compat.h>
+#include <Common/Checksum.h>
+#include <Common/Error.h>
 #include <Common/Logger.h>
 
 #include <Hypertable/Lib/BlockCompressionCodec.h>
@@ -135,6 +137,43 @@ int main(int argc, char **argv) {
     after.decode(&decode_ptr, &remain);
 
     HT_ASSERT(before == after);
+
+    // Version 1 with CRC32C checksums
+
+    set_default_checksum_algorithm(CHECKSUM_CRC32C);
+    encode_ptr = buffer;
+    before = BlockHeaderCellStore(1, "CELLSTORE-");
+    before.set_compression_type(BlockCompressionCodec::SNAPPY);
+    before.set_data_length(1000);
+    before.set_data_zlength(100);
+    before.set_data_checksum(before.compute_checksum(buffer, 100));
+    before.encode(&encode_ptr);
+    set_default_checksum_algorithm(CHECKSUM_FLETCHER32);
+
+    HT_ASSERT(before.get_flags() & BlockHeader::FLAGS_CHECKSUM_CRC32C);
+    HT_ASSERT(before.checksum_algorithm() == CHECKSUM_CRC32C);
+
+    remain = encode_ptr-buffer;
+    HT_ASSERT(remain == 28);
+    decode_ptr = buffer;
+    after = BlockHeaderCellStore(1);
+    after.decode(&decode_ptr, &remain);
+
+    HT_ASSERT(before == after);
+    HT_ASSERT(after.checksum_algorithm() == CHECKSUM_CRC32C);
+
+    // Corrupt flags, header checksum must no longer validate
+    buffer[12] ^= BlockHeader::FLAGS_CHECKSUM_CRC32C;
+    remain = encode_ptr-buffer;
+    decode_ptr = buffer;
+    after = BlockHeaderCellStore(1);
+    try {
+      after.decode(&decode_ptr, &remain);
+      HT_ASSERT(!"Header checksum mismatch not detected");
+    }
+    catch (Exception &e) {
+      HT_ASSERT(e.code() == Error::BLOCK_COMPRESSOR_BAD_HEADER);
+    }
   }
 
   return 0;
@@ -0,0 +1,204 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+
+#include <Common/Compat.h>
+
+#include <Hypertable/Lib/CompressorFactory.h>
+#include <Hypertable/Lib/BlockHeaderCommitLog.h>
+
+#include <Common/DynamicBuffer.h>
+#include <Common/FileUtils.h>
+#include <Common/Logger.h>
+#include <Common/Stopwatch.h>
+#include <Common/System.h>
+#include <Common/Usage.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: compressor_benchmark [--block-size <n>] [--iterations <n>] [<file> ...]",
+    "",
+    "Measures compression ratio and deflate/inflate throughput of each block",
+    "compressor over the given files (default: ./test-schemas.xml and",
+    "./random.dat).  Each file is split into blocks of --block-size bytes",
+    "(default 65536) and every block is compressed and decompressed",
+    "--iterations times (default 20).  The zstd dictionary variant trains",
+    "its dictionary on 1KB samples of the file before measuring.",
+    "",
+    0
+  };
+
+  const char *codec_specs[] = {
+    "none",
+    "zlib",
+    "zlib --best",
+    "lzo",
+    "quicklz",
+    "snappy",
+    "bmz",
+    "lz4",
+    "lz4 --acceleration 8",
+    "zstd",
+    "zstd --level 9",
+    "zstd --dictionary-size 8192",
+    0
+  };
+
+  const char MAGIC[12] = { '-','-','-','-','-','-','-','-','-','-','-','-' };
+
+  /// Trains a dictionary on fixed size samples of <code>data</code>
+  void train(BlockCompressionCodec *codec, const uint8_t *data, size_t len) {
+    const size_t sample_size = 1024;
+    DynamicBuffer samples(len);
+    vector<size_t> sample_sizes;
+    for (size_t offset = 0; offset < len; offset += sample_size) {
+      size_t amount = min(sample_size, len - offset);
+      samples.add_unchecked(data + offset, amount);
+      sample_sizes.push_back(amount);
+    }
+    BlockCompressionCodec::DictionaryPtr dictionary
+      = codec->train_dictionary(samples, sample_sizes);
+    if (dictionary)
+      codec->set_dictionary(dictionary);
+  }
+
+  void benchmark(const string &fname, size_t block_size, int iterations) {
+    off_t len;
+    uint8_t *data = (uint8_t *)FileUtils::file_to_buffer(fname, &len);
+    if (data == 0) {
+      HT_ERRORF("Problem loading '%s'", fname.c_str());
+      exit(1);
+    }
+
+    // Blocks reference the file data directly
+    vector<DynamicBuffer> blocks((len + block_size - 1) / block_size);
+    for (size_t j=0; j<blocks.size(); j++) {
+      size_t amount = min((off_t)block_size, len - (off_t)(j*block_size));
+      blocks[j].own = false;
+      blocks[j].base = (uint8_t *)data + j*block_size;
+      blocks[j].ptr = blocks[j].base + amount;
+      blocks[j].size = amount;
+    }
+
+    printf("%s (%lld bytes, %lu blocks)\n", fname.c_str(), (Lld)len,
+           (Lu)blocks.size());
+    printf("  %-28s %8s %12s %12s\n", "codec", "ratio", "deflate MB/s",
+           "inflate MB/s");
+
+    for (size_t i=0; codec_specs[i]; i++) {
+      unique_ptr<BlockCompressionCodec> codec;
+      try {
+        codec.reset(CompressorFactory::create_block_codec(codec_specs[i]));
+        if (codec->dictionary_size())
+          train(codec.get(), data, len);
+      }
+      catch (Exception &e) {
+        HT_ERROR_OUT << codec_specs[i] << ": " << e << HT_END;
+        continue;
+      }
+
+      vector<DynamicBuffer> compressed(blocks.size());
+      DynamicBuffer output;
+      BlockHeaderCommitLog header(MAGIC, 0, 0);
+      size_t zlen = 0;
+
+      Stopwatch deflate_watch;
+      for (int iter=0; iter<iterations; iter++) {
+        zlen = 0;
+        for (size_t j=0; j<blocks.size(); j++) {
+          codec->deflate(blocks[j], compressed[j], header);
+          zlen += compressed[j].fill();
+        }
+      }
+      deflate_watch.stop();
+
+      Stopwatch inflate_watch;
+      for (int iter=0; iter<iterations; iter++) {
+        for (size_t j=0; j<blocks.size(); j++) {
+          codec->inflate(compressed[j], output, header);
+          HT_ASSERT(output.fill() == blocks[j].fill());
+        }
+      }
+      inflate_watch.stop();
+
+      for (size_t j=0; j<blocks.size(); j++) {
+        codec->inflate(compressed[j], output, header);
+        HT_ASSERT(memcmp(output.base, blocks[j].base, output.fill()) == 0);
+      }
+
+      double mbytes = ((double)len * iterations) / (1024.0 * 1024.0);
+      printf("  %-28s %8.3f %12.1f %12.1f\n", codec_specs[i],
+             (double)zlen / (double)len, mbytes / deflate_watch.elapsed(),
+             mbytes / inflate_watch.elapsed());
+    }
+    printf("\n");
+    delete [] data;
+  }
+
+}
+
+int main(int argc, char **argv) {
+  size_t block_size = 65536;
+  int iterations = 20;
+  vector<string> files;
+
+  for (int i=1; i<argc; i++) {
+    if (!strcmp(argv[i], "--help"))
+      Usage::dump_and_exit(usage);
+    else if (!strcmp(argv[i], "--block-size") && i+1 < argc)
+      block_size = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--iterations") && i+1 < argc)
+      iterations = atoi(argv[++i]);
+    else
+      files.push_back(argv[i]);
+  }
+
+  if (block_size == 0 || iterations <= 0)
+    Usage::dump_and_exit(usage);
+
+  if (files.empty()) {
+    files.push_back("./test-schemas.xml");
+    files.push_back("./random.dat");
+  }
+
+  System::initialize(System::locate_install_dir(argv[0]));
+
+  try {
+    for (auto &fname : files)
+      benchmark(fname, block_size, iterations);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+
+  return 0;
+}
@@ -30,6 +30,8 @@
 #include <Common/System.h>
 #include <Common/Usage.h>
 
+#include <vector>
+
 using namespace Hypertable;
 
 namespace {
@@ -44,6 +46,12 @@ namespace {
     "lzo",
     "quicklz",
     "snappy",
+    "lz4",
+    "zstd",
+    "",
+    "If the compressor supports dictionaries and is given a non-zero",
+    "dictionary size (e.g. \"zstd --dictionary-size 1024\"), a dictionary",
+    "is trained from the lines of the input and used for the round trip.",
     "",
     0
   };
@@ -77,6 +85,29 @@ int main(int argc, char **argv) {
   }
   input.ptr = input.base + len;
 
+  // Train a dictionary using the lines of the input as samples
+  if (compressor->dictionary_size()) {
+    DynamicBuffer samples(input.fill());
+    std::vector<size_t> sample_sizes;
+    const uint8_t *line = input.base;
+    for (const uint8_t *ptr = input.base; ptr < input.ptr; ptr++) {
+      if (*ptr == '\n') {
+        samples.add(line, (ptr + 1) - line);
+        sample_sizes.push_back((ptr + 1) - line);
+        line = ptr + 1;
+      }
+    }
+    BlockCompressionCodec::DictionaryPtr dictionary =
+      compressor->train_dictionary(samples, sample_sizes);
+    if (!dictionary) {
+      HT_ERRORF("Unable to train dictionary for %s codec", argv[1]);
+      return 1;
+    }
+    // Reload it the way a CellStore would
+    compressor->set_dictionary(compressor->load_dictionary(dictionary->data(),
+                                                           dictionary->size()));
+  }
+
   try {
     compressor->deflate(input, output1, header);
     compressor->inflate(output1, output2, header);
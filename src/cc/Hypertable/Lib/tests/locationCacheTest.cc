@@ -26,9 +26,15 @@
 #include <Common/StringExt.h>
 #include <Common/Usage.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
 #include <utility>
+#include <vector>
 
 extern "C" {
 #include <sys/types.h>
@@ -85,11 +91,14 @@ namespace Hypertable {
 
 namespace {
   const char *usage[] = {
-    "usage: locationCacheTest",
+    "usage: locationCacheTest [--benchmark [<max-threads>]]",
     "",
     "Validates LocationCache class.  Generates output file "
     "'./locationCacheTest.output' and",
-    "diffs it against ./locationCacheTest.golden'.",
+    "diffs it against ./locationCacheTest.golden'.  Then checks lookups",
+    "from concurrent threads while a writer inserts and invalidates entries.",
+    "With --benchmark, measures lookup throughput for 1, 2, 4, ... up to",
+    "<max-threads> (default 8) threads.",
     0
   };
   typedef pair<const char *, const char *> RowRangeSpec;
@@ -244,6 +253,94 @@ namespace {
 
   ofstream outfile;
 
+  const int CONCURRENT_RANGES = 1000;
+  const int CONCURRENT_ROW_SPACING = 10;
+
+  void concurrent_row(char *buf, int i) {
+    sprintf(buf, "r%06d", i);
+  }
+
+  /// Runs lookup threads against cache of CONCURRENT_RANGES ranges.
+  /// Each lookup result is checked to contain the row looked up.  If
+  /// <code>writer</code> is <i>true</i>, a writer thread concurrently
+  /// re-inserts ranges and invalidates random rows.
+  /// @return Number of lookups per second
+  double run_concurrent(int nthreads, int millis, bool writer) {
+    LocationCache cache(2*CONCURRENT_RANGES);
+    RangeLocationInfo range_loc_info;
+    char start[32], end[32];
+
+    for (int i=0; i<CONCURRENT_RANGES; i++) {
+      concurrent_row(start, i*CONCURRENT_ROW_SPACING);
+      concurrent_row(end, (i+1)*CONCURRENT_ROW_SPACING);
+      range_loc_info.start_row = i ? start : "";
+      range_loc_info.end_row = end;
+      range_loc_info.addr.set_proxy(server_ids[i % MAX_SERVERIDS]);
+      cache.insert("1", range_loc_info);
+    }
+
+    atomic<bool> done {false};
+    atomic<uint64_t> lookups {0};
+    atomic<uint64_t> errors {0};
+    vector<thread> threads;
+
+    for (int t=0; t<nthreads; t++) {
+      threads.push_back(thread([&, t]() {
+            mt19937 gen(t);
+            uniform_int_distribution<int> dist(1, CONCURRENT_RANGES*CONCURRENT_ROW_SPACING);
+            RangeLocationInfo info;
+            char row[32];
+            uint64_t count = 0;
+            while (!done) {
+              for (int i=0; i<1000; i++, count++) {
+                concurrent_row(row, dist(gen));
+                if (cache.lookup("1", row, &info) &&
+                    (strcmp(row, info.start_row.c_str()) <= 0 ||
+                     strcmp(row, info.end_row.c_str()) > 0))
+                  errors++;
+              }
+            }
+            lookups += count;
+          }));
+    }
+
+    if (writer) {
+      threads.push_back(thread([&]() {
+            mt19937 gen(nthreads);
+            uniform_int_distribution<int> dist(0, CONCURRENT_RANGES-1);
+            RangeLocationInfo info;
+            char start[32], end[32];
+            while (!done) {
+              int i = dist(gen);
+              concurrent_row(start, i*CONCURRENT_ROW_SPACING);
+              concurrent_row(end, (i+1)*CONCURRENT_ROW_SPACING);
+              if (i & 1)
+                cache.invalidate("1", end);
+              info.start_row = i ? start : "";
+              info.end_row = end;
+              info.addr.set_proxy(server_ids[dist(gen) % MAX_SERVERIDS]);
+              cache.insert("1", info);
+            }
+          }));
+    }
+
+    auto start_time = chrono::steady_clock::now();
+    this_thread::sleep_for(chrono::milliseconds(millis));
+    done = true;
+    for (auto &thread : threads)
+      thread.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() -
+                                              start_time).count();
+
+    if (errors) {
+      HT_ERRORF("%llu lookups returned a range not containing the row",
+                (Llu)errors.load());
+      exit(EXIT_FAILURE);
+    }
+
+    return (double)lookups / elapsed;
+  }
+
   void TestLookup(LocationCache &cache, const String & table_id, const char *rowkey) {
     RangeLocationInfo  range_loc_info;
 
@@ -271,6 +368,18 @@ int main(int argc, char **argv) {
   if (argc > 1 && (!strcmp(argv[1], "--help") || !strcmp(argv[1], "-?")))
     Usage::dump_and_exit(usage);
 
+  if (argc > 1 && !strcmp(argv[1], "--benchmark")) {
+    int max_threads = (argc > 2) ? atoi(argv[2]) : 8;
+    for (int nthreads=1; nthreads<=max_threads; nthreads*=2) {
+      cout << nthreads << " threads: "
+           << (uint64_t)run_concurrent(nthreads, 2000, false)
+           << " lookups/s, with writer: "
+           << (uint64_t)run_concurrent(nthreads, 2000, true)
+           << " lookups/s" << endl;
+    }
+    return 0;
+  }
+
   outfile.open("./locationCacheTest.output");
 
   range_loc_info.start_row = "bar";
@@ -318,5 +427,7 @@ int main(int argc, char **argv) {
   if (system("diff ./locationCacheTest.output ./locationCacheTest.golden"))
     return 1;
 
+  run_concurrent(4, 200, true);
+
   return 0;
 }
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <Common/Compat.h>
+
+#include <Common/Init.h>
+#include <Common/Error.h>
+#include <Common/Logger.h>
+#include <Common/String.h>
+#include <Common/System.h>
+#include <Common/Usage.h>
+
+#include <Hypertable/Lib/Client.h>
+#include <Hypertable/Lib/Future.h>
+#include <Hypertable/Lib/Key.h>
+
+#include <AsyncComm/ReactorFactory.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Hypertable;
+using namespace std;
+
+namespace {
+  const char *usage[] = {
+    "usage: parallel_scan_test [<table>]",
+    "",
+    "Runs parallel (ScanSpec::parallel_ranges) scans over <table>, which must",
+    "already be loaded and split into at least three ranges, and checks them",
+    "against a sequential scan.  Also checks that parallel scans which are",
+    "cancelled midway, or which fail while starting, run to completion.",
+    0
+  };
+
+  const uint32_t TIMEOUT_MS = 60000;
+
+  void fail(const string &msg) {
+    cout << "error: " << msg << endl;
+    quick_exit(EXIT_FAILURE);
+  }
+
+  string format_cell(const Cell &cell) {
+    string str(cell.row_key);
+    str += "\t";
+    str += cell.column_family;
+    if (cell.column_qualifier && *cell.column_qualifier) {
+      str += ":";
+      str += cell.column_qualifier;
+    }
+    str += "\t";
+    str.append((const char *)cell.value, cell.value_len);
+    return str;
+  }
+
+  /// Counts the ranges of <code>table</code> by scanning its METADATA rows
+  size_t count_ranges(NamespacePtr &ns, TablePtr &table) {
+    TableIdentifier tid;
+    table->get_identifier(&tid);
+    string start_row = format("%s:", tid.id);
+    string end_row = start_row + Key::END_ROW_MARKER;
+    TablePtr metadata = ns->open_table("sys/METADATA");
+    ScanSpecBuilder ssb;
+    ssb.add_column("StartRow");
+    ssb.add_row_interval(start_row.c_str(), true, end_row.c_str(), true);
+    TableScannerPtr scanner(metadata->create_scanner(ssb.get()));
+    Cell cell;
+    size_t count = 0;
+    while (scanner->next(cell))
+      count++;
+    return count;
+  }
+
+  void sync_scan(TablePtr &table, const ScanSpec &spec,
+                 vector<string> &cells) {
+    TableScannerPtr scanner(table->create_scanner(spec, TIMEOUT_MS));
+    Cell cell;
+    cells.clear();
+    while (scanner->next(cell))
+      cells.push_back(format_cell(cell));
+  }
+
+  /// Scans asynchronously, cancelling the scanner once
+  /// <code>cancel_after</code> cells have been received (never if zero).
+  /// Fails if the scan does not complete within #TIMEOUT_MS.  Returns the
+  /// error code of the first error result, or Error::OK.
+  int async_scan(TablePtr &table, const ScanSpec &spec, size_t cancel_after,
+                 vector<string> &cells) {
+    Future ff;
+    ResultPtr result;
+    Cells result_cells;
+    bool timed_out = false;
+    int error = Error::OK;
+    cells.clear();
+    TableScannerAsyncPtr scanner(table->create_scanner_async(&ff, spec,
+                                                             TIMEOUT_MS));
+    while (ff.get(result, TIMEOUT_MS, timed_out)) {
+      if (timed_out)
+        break;
+      if (result->is_error()) {
+        int code;
+        string msg;
+        result->get_error(code, msg);
+        if (error == Error::OK)
+          error = code;
+        continue;
+      }
+      result->get_cells(result_cells);
+      for (const auto &cell : result_cells)
+        cells.push_back(format_cell(cell));
+      if (cancel_after && cells.size() >= cancel_after &&
+          !scanner->is_cancelled())
+        scanner->cancel();
+    }
+    if (timed_out)
+      fail("async scan did not complete within timeout");
+    if (!scanner->is_complete())
+      fail("async scan reported EOS with scanners outstanding");
+    return error;
+  }
+
+  void check_ordered(TablePtr &table, ScanSpecBuilder &ssb, int32_t parallel,
+                     const string &label) {
+    vector<string> expected, cells;
+    sync_scan(table, ssb.get(), expected);
+    if (expected.empty())
+      fail(label + ": sequential scan returned no cells");
+    ssb.set_parallel_ranges(parallel);
+    sync_scan(table, ssb.get(), cells);
+    if (cells != expected)
+      fail(format("%s: ordered parallel scan returned %d cells, expected %d "
+                  "in the same order", label.c_str(), (int)cells.size(),
+                  (int)expected.size()));
+    if (async_scan(table, ssb.get(), 0, cells) != Error::OK)
+      fail(label + ": async ordered parallel scan failed");
+    if (cells != expected)
+      fail(label + ": async ordered parallel scan out of order");
+    cout << label << ": ordered, " << cells.size() << " cells" << endl;
+  }
+
+  void check_unordered(TablePtr &table, ScanSpecBuilder &ssb,
+                       int32_t parallel, const string &label) {
+    vector<string> expected, cells;
+    sync_scan(table, ssb.get(), expected);
+    ssb.set_parallel_ranges(parallel, true);
+    sync_scan(table, ssb.get(), cells);
+    sort(expected.begin(), expected.end());
+    sort(cells.begin(), cells.end());
+    if (cells != expected)
+      fail(format("%s: unordered parallel scan returned %d cells, expected "
+                  "%d", label.c_str(), (int)cells.size(),
+                  (int)expected.size()));
+    cout << label << ": unordered, " << cells.size() << " cells" << endl;
+  }
+
+  void check_cancel(TablePtr &table, bool unordered, size_t total) {
+    ScanSpecBuilder ssb;
+    vector<string> cells;
+    ssb.set_parallel_ranges(2, unordered);
+    if (async_scan(table, ssb.get(), total / 4, cells) != Error::OK)
+      fail("cancelled parallel scan reported an error");
+    if (cells.size() >= total)
+      fail("cancelled parallel scan returned every cell");
+    cout << "cancel (" << (unordered ? "unordered" : "ordered")
+         << "): stopped after " << cells.size() << " cells" << endl;
+  }
+
+  void check_start_error(TablePtr &table, bool unordered) {
+    ScanSpecBuilder ssb;
+    vector<string> cells;
+    ssb.add_column("no_such_column");
+    ssb.set_parallel_ranges(2, unordered);
+    // The first interval scanner throws while being started, so the error
+    // is delivered with EOS once the pending intervals have been dropped
+    int error = async_scan(table, ssb.get(), 0, cells);
+    if (error != Error::RANGESERVER_INVALID_COLUMNFAMILY)
+      fail(format("parallel scan of unknown column returned %s",
+                  Error::get_text(error)));
+    cout << "start error (" << (unordered ? "unordered" : "ordered")
+         << "): " << Error::get_text(error) << endl;
+  }
+
+}
+
+
+int main(int argc, char **argv) {
+  ClientPtr client;
+  NamespacePtr ns;
+  TablePtr table;
+  const char *table_name = "ParallelScan";
+
+  if (argc > 2 || (argc == 2 && (!strcmp(argv[1], "-?") ||
+                                 !strcmp(argv[1], "--help"))))
+    Usage::dump_and_exit(usage);
+
+  if (argc == 2)
+    table_name = argv[1];
+
+  Config::init(0, 0);
+
+  ReactorFactory::initialize(2);
+
+  try {
+    client = make_shared<Hypertable::Client>(System::locate_install_dir(argv[0]), "./hypertable.cfg");
+    ns = client->open_namespace("/");
+    table = ns->open_table(table_name);
+
+    size_t ranges = count_ranges(ns, table);
+    cout << table_name << " has " << ranges << " ranges" << endl;
+    if (ranges < 3)
+      fail("table must have at least three ranges");
+
+    vector<string> all;
+    {
+      ScanSpecBuilder ssb;
+      sync_scan(table, ssb.get(), all);
+    }
+
+    // Fewer scanners than ranges, so pending intervals are started as
+    // earlier ones finish
+    {
+      ScanSpecBuilder ssb;
+      check_ordered(table, ssb, 2, "full table");
+    }
+    {
+      ScanSpecBuilder ssb;
+      check_ordered(table, ssb, (int32_t)ranges + 1, "full table, all ranges");
+    }
+    {
+      ScanSpecBuilder ssb;
+      ssb.add_row_interval("row001000", true, "row003000", false);
+      ssb.add_row_interval("row003500", false, "row003600", true);
+      check_ordered(table, ssb, 2, "row intervals");
+    }
+    {
+      ScanSpecBuilder ssb;
+      check_unordered(table, ssb, 3, "full table");
+    }
+    {
+      ScanSpecBuilder ssb;
+      ssb.add_row_interval("row001000", true, "row003000", false);
+      check_unordered(table, ssb, 2, "row interval");
+    }
+
+    // Pending intervals that were never started must not hold up EOS
+    check_cancel(table, false, all.size());
+    check_cancel(table, true, all.size());
+
+    check_start_error(table, false);
+    check_start_error(table, true);
+  }
+  catch (Exception &e) {
+    cerr << e << endl;
+    quick_exit(EXIT_FAILURE);
+  }
+
+  cout << "Test passed" << endl;
+
+  quick_exit(EXIT_SUCCESS);
+}
@@ -49,6 +49,19 @@ int main(int argc, char *argv[]) {
   stats1->cpu_user = Random::uniform01();
   stats1->cpu_sys = Random::uniform01();
   stats1->live = (Random::number32() % 2) == 0;
+  stats1->io_foreground_reads = Random::number64();
+  stats1->io_foreground_read_bytes = Random::number64();
+  stats1->io_foreground_read_latency = Random::number64();
+  stats1->io_foreground_write_bytes = Random::number64();
+  stats1->io_background_read_bytes = Random::number64();
+  stats1->io_background_write_bytes = Random::number64();
+  stats1->io_background_throttle_time = Random::number64();
+  stats1->io_background_rate = Random::number64();
+  stats1->commit_syncs = Random::number64();
+  stats1->commit_batch_size_p50 = Random::number64();
+  stats1->commit_batch_size_p99 = Random::number64();
+  stats1->commit_sync_latency_p50 = Random::number64();
+  stats1->commit_sync_latency_p99 = Random::number64();
 
   stats1->system.refresh();
 
@@ -0,0 +1,194 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <Common/Compat.h>
+
+#include <Hypertable/Lib/Key.h>
+#include <Hypertable/Lib/RangeServer/Response/Parameters/CreateScanner.h>
+#include <Hypertable/Lib/ScanBlock.h>
+
+#include <AsyncComm/Event.h>
+
+#include <Common/Error.h>
+#include <Common/Logger.h>
+#include <Common/Serialization.h>
+#include <Common/Usage.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Hypertable;
+using namespace Hypertable::Lib;
+
+namespace {
+  const char *usage[] = {
+    "usage: scan_block_test",
+    "",
+    "Verifies that scan blocks encoded with each scan block encoding decode",
+    "to the original key/value pairs.",
+    0
+  };
+
+  /// Builds a scan block as filled by the RangeServer
+  void fill_block(DynamicBuffer &dbuf, vector<string> &keys,
+                  vector<string> &values) {
+    SerializedKey key;
+    ByteString value;
+
+    dbuf.reserve(4);
+    dbuf.ptr = dbuf.base + 4;
+
+    for (int row=0; row<50; row++) {
+      string row_key = format("com.example.www/some/long/path/%04d", row);
+      for (int col=0; col<10; col++) {
+        string qualifier = format("qualifier%d", col);
+        size_t key_offset = dbuf.fill();
+        create_key_and_append(dbuf, FLAG_INSERT, row_key.c_str(),
+                              (uint8_t)(1 + col % 3), qualifier.c_str(),
+                              1000000LL + row*10 + col,
+                              2000000LL + row*10 + col);
+        key.ptr = dbuf.base + key_offset;
+        keys.push_back(string((const char *)key.ptr, key.length()));
+        string val = format("value-%d-%d", row, col);
+        if (col == 9)
+          val.clear();
+        size_t value_offset = dbuf.fill();
+        append_as_byte_string(dbuf, val.c_str(), val.length());
+        value.ptr = dbuf.base + value_offset;
+        values.push_back(string((const char *)value.ptr, value.length()));
+      }
+    }
+
+    uint8_t *ptr = dbuf.base;
+    Serialization::encode_i32(&ptr, dbuf.fill() - 4);
+  }
+
+  /// Wraps a scan block in a CREATE_SCANNER response event
+  EventPtr make_event(DynamicBuffer &dbuf, uint8_t encoding) {
+    ProfileDataScanner profile_data;
+    RangeServer::Response::Parameters::CreateScanner
+      params(0, 0, 0, false, profile_data, encoding);
+    size_t len = 4 + params.encoded_length() + dbuf.fill();
+    uint8_t *payload = new uint8_t [len];
+    uint8_t *ptr = payload;
+
+    Serialization::encode_i32(&ptr, Error::OK);
+    params.encode(&ptr);
+    memcpy(ptr, dbuf.base, dbuf.fill());
+
+    EventPtr event = make_shared<Event>(Event::MESSAGE);
+    event->payload = payload;
+    event->payload_len = len;
+    return event;
+  }
+
+  /// Checks that <code>block</code> returns the expected pairs
+  void check_block(ScanBlock &block, vector<string> &keys,
+                   vector<string> &values) {
+    SerializedKey key;
+    ByteString value;
+    size_t i = 0;
+
+    HT_ASSERT(block.size() == keys.size());
+    HT_ASSERT(block.more());
+
+    while (block.next(key, value)) {
+      HT_ASSERT(i < keys.size());
+      HT_ASSERT(key.length() == keys[i].length());
+      HT_ASSERT(memcmp(key.ptr, keys[i].c_str(), keys[i].length()) == 0);
+      HT_ASSERT(value.length() == values[i].length());
+      HT_ASSERT(memcmp(value.ptr, values[i].c_str(), values[i].length()) == 0);
+      i++;
+    }
+    HT_ASSERT(i == keys.size());
+    HT_ASSERT(!block.more());
+  }
+
+}
+
+int main(int argc, char **argv) {
+
+  if (argc != 1)
+    Usage::dump_and_exit(usage);
+
+  vector<string> keys, values;
+  DynamicBuffer plain;
+  fill_block(plain, keys, values);
+
+  HT_ASSERT(ScanBlock::parse_encoding("NONE") == 0);
+  HT_ASSERT(ScanBlock::parse_encoding("prefix") == ScanBlock::ENCODING_PREFIX);
+  HT_ASSERT(ScanBlock::parse_encoding("PREFIX+LZ4") ==
+            (ScanBlock::ENCODING_PREFIX|ScanBlock::ENCODING_LZ4));
+  try {
+    ScanBlock::parse_encoding("GZIP");
+    HT_ASSERT(!"bad encoding accepted");
+  }
+  catch (Exception &e) {
+    HT_ASSERT(e.code() == Error::CONFIG_BAD_VALUE);
+  }
+
+  uint8_t encodings[] = { 0, ScanBlock::ENCODING_PREFIX, ScanBlock::ENCODING_LZ4,
+                          ScanBlock::ENCODING_PREFIX|ScanBlock::ENCODING_LZ4 };
+
+  for (auto encoding : encodings) {
+    DynamicBuffer dbuf;
+    dbuf.set(plain.base, plain.fill());
+    ScanBlock::encode(encoding, dbuf);
+
+    if (encoding)
+      HT_ASSERT(dbuf.fill() < plain.fill());
+
+    EventPtr event = make_event(dbuf, encoding);
+    ScanBlock block;
+    HT_ASSERT(block.load(event) == Error::OK);
+    HT_ASSERT(block.transient_keys() ==
+              ((encoding & ScanBlock::ENCODING_PREFIX) != 0));
+    check_block(block, keys, values);
+
+    // Iterate again after a reset
+    block.reset();
+    check_block(block, keys, values);
+
+    cout << "encoding=" << (int)encoding << " size=" << dbuf.fill() << endl;
+  }
+
+  // Empty block
+  {
+    DynamicBuffer dbuf(4);
+    dbuf.ptr = dbuf.base;
+    Serialization::encode_i32(&dbuf.ptr, 0);
+    ScanBlock::encode(ScanBlock::ENCODING_PREFIX|ScanBlock::ENCODING_LZ4, dbuf);
+    EventPtr event = make_event(dbuf,
+                                ScanBlock::ENCODING_PREFIX|ScanBlock::ENCODING_LZ4);
+    ScanBlock block;
+    SerializedKey key;
+    ByteString value;
+    HT_ASSERT(block.load(event) == Error::OK);
+    HT_ASSERT(block.size() == 0);
+    HT_ASSERT(!block.next(key, value));
+  }
+
+  return 0;
+}
@@ -23,15 +23,18 @@
 
 #include <Hypertable/Lib/Client.h>
 
+#include <Common/StaticBuffer.h>
 #include <Common/md5.h>
 #include <Common/Logger.h>
 #include <Common/Usage.h>
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 using namespace std;
 using namespace Hypertable;
+using namespace Hypertable::Lib;
 
 namespace {
   const char *usage[] = {
@@ -83,5 +86,98 @@ int main(int argc, char **argv) {
   HT_ASSERT(fired==true);
   fired=false;
 
+  // not allowed: SUM(*)
+  try {
+    ScanSpecBuilder ssb;
+    ssb.add_aggregate(ScanAggregate::SUM);
+  }
+  catch (Exception &e) {
+    if (e.code()!=Error::BAD_SCAN_SPEC) {
+      std::cout << e << std::endl;
+      quick_exit(EXIT_FAILURE);
+    }
+    fired=true;
+  }
+
+  HT_ASSERT(fired==true);
+  fired=false;
+
+  // aggregates survive serialization
+  {
+    ScanSpecBuilder ssb;
+    ssb.add_aggregate(ScanAggregate::COUNT);
+    ssb.add_aggregate(ScanAggregate::MAX, "price:usd");
+    ssb.set_group_by_row_prefix(3);
+    const ScanSpec &ss = ssb.get();
+    StaticBuffer buf(ss.encoded_length());
+    uint8_t *ptr = buf.base;
+    ss.encode(&ptr);
+    HT_ASSERT(ptr == buf.base + buf.size);
+    // aggregates trail the version 1 encoding, so older servers can decode it
+    HT_ASSERT(*buf.base == 1);
+    ScanSpec decoded;
+    const uint8_t *decode_ptr = buf.base;
+    size_t remain = buf.size;
+    decoded.decode(&decode_ptr, &remain);
+    HT_ASSERT(remain == 0);
+    HT_ASSERT(decoded.aggregates.size() == 2);
+    HT_ASSERT(decoded.aggregates[0].function == ScanAggregate::COUNT);
+    HT_ASSERT(*decoded.aggregates[0].column == 0);
+    HT_ASSERT(decoded.aggregates[1].function == ScanAggregate::MAX);
+    HT_ASSERT(!strcmp(decoded.aggregates[1].column, "price:usd"));
+    HT_ASSERT(decoded.group_by_row_prefix == 3);
+    HT_ASSERT(!decoded.cacheable());
+  }
+
+  // specs without aggregates encode without the trailing aggregate fields
+  {
+    ScanSpecBuilder ssb;
+    ssb.add_column("price");
+    const ScanSpec &ss = ssb.get();
+    StaticBuffer buf(ss.encoded_length());
+    uint8_t *ptr = buf.base;
+    ss.encode(&ptr);
+    HT_ASSERT(ptr == buf.base + buf.size);
+    ScanSpec decoded;
+    const uint8_t *decode_ptr = buf.base;
+    size_t remain = buf.size;
+    decoded.decode(&decode_ptr, &remain);
+    HT_ASSERT(remain == 0);
+    HT_ASSERT(decoded.aggregates.empty());
+    HT_ASSERT(decoded.group_by_row_prefix == 0);
+  }
+
+  // partial results merge to the same result as a single pass
+  {
+    AggregateValue a, b, all;
+    a.add(ScanAggregate::SUM, "5", 1);
+    a.add(ScanAggregate::SUM, "abc", 3);
+    b.add(ScanAggregate::SUM, "2.5", 3);
+    all.add(ScanAggregate::SUM, "5", 1);
+    all.add(ScanAggregate::SUM, "2.5", 3);
+    a.merge(ScanAggregate::SUM, b);
+    HT_ASSERT(a.count == 2 && all.count == 2);
+    HT_ASSERT(a.to_string(ScanAggregate::SUM) == "7.5");
+    HT_ASSERT(all.to_string(ScanAggregate::SUM) == "7.5");
+
+    AggregateValue min, other;
+    min.add(ScanAggregate::MIN, "-3", 2);
+    other.add(ScanAggregate::MIN, "-7", 2);
+    min.merge(ScanAggregate::MIN, other);
+    HT_ASSERT(min.to_string(ScanAggregate::MIN) == "-7");
+
+    uint8_t buf[32];
+    uint8_t *ptr = buf;
+    HT_ASSERT(a.encoded_length() <= sizeof(buf));
+    a.encode(&ptr);
+    HT_ASSERT((size_t)(ptr - buf) == a.encoded_length());
+    AggregateValue decoded;
+    const uint8_t *decode_ptr = buf;
+    size_t remain = ptr - buf;
+    decoded.decode(&decode_ptr, &remain);
+    HT_ASSERT(remain == 0);
+    HT_ASSERT(decoded.to_string(ScanAggregate::SUM) == "7.5");
+  }
+
   quick_exit(EXIT_SUCCESS);
 }
@@ -31,7 +31,7 @@
 #include <Hypertable/RangeServer/CellCacheScanner.h>
 #include <Hypertable/RangeServer/CellStoreFactory.h>
 #include <Hypertable/RangeServer/CellStoreReleaseCallback.h>
-#include <Hypertable/RangeServer/CellStoreV7.h>
+#include <Hypertable/RangeServer/CellStoreV8.h>
 #include <Hypertable/RangeServer/Config.h>
 #include <Hypertable/RangeServer/Global.h>
 #include <Hypertable/RangeServer/MaintenanceFlag.h>
@@ -42,13 +42,18 @@
 #include <Common/DynamicBuffer.h>
 #include <Common/Error.h>
 #include <Common/FailureInducer.h>
+#include <Common/Time.h>
 #include <Common/md5.h>
 
+#include <boost/algorithm/string/join.hpp>
+
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <exception>
 #include <iterator>
+#include <thread>
 #include <vector>
 
 using namespace Hypertable;
@@ -106,6 +111,7 @@ void AccessGroup::update_schema(SchemaPtr &schema,
     m_garbage_tracker.update_schema(ag_spec);
 
     m_cellstore_props = make_shared<Properties>();
+    m_compression_dictionary.reset();
     m_cellstore_props->set("compressor", ag_spec->get_option_compressor());
     m_cellstore_props->set("blocksize", ag_spec->get_option_blocksize());
     if (ag_spec->get_option_replication() != -1)
@@ -450,11 +456,148 @@ void AccessGroup::load_cellstore(CellStorePtr &cellstore) {
 
   m_stores.push_back(cellstore);
 
+  // Seed compression dictionary from most recently loaded CellStore
+  {
+    BlockCompressionCodec::DictionaryPtr dictionary =
+      cellstore->get_compression_dictionary();
+    if (dictionary) {
+      lock_guard<mutex> lock(m_schema_mutex);
+      m_compression_dictionary = dictionary;
+    }
+  }
+
   int64_t total_index_entries = 0;
   recompute_compression_ratio(&total_index_entries);
   m_file_tracker.add_live_noupdate(cellstore->get_filename(), total_index_entries);
 }
 
+int64_t AccessGroup::prepare_link_cellstore(const String &fname,
+                                            CellStorePtr &cellstore) {
+  String dst;
+  int64_t revision;
+
+  if (m_in_memory)
+    HT_THROWF(Error::NOT_IMPLEMENTED, "Unable to link CellStore into IN_MEMORY "
+              "access group %s", m_full_name.c_str());
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    dst = format("%s/tables/%s/%s/%s/cs%d", Global::toplevel_dir.c_str(),
+                 m_identifier.id, m_name.c_str(), m_range_dir.c_str(),
+                 m_next_cs_id++);
+  }
+
+  Global::dfs->rename(fname, dst);
+
+  try {
+    cellstore = CellStoreFactory::open(dst, m_start_row.c_str(),
+                                       m_end_row.c_str());
+    revision = boost::any_cast<int64_t>
+      (cellstore->get_trailer()->get("revision"));
+
+    // The revision is assigned by the client, so make sure it is in the
+    // past on this server's clock.  Otherwise updates assigned revisions
+    // after the link could be older than the linked file and be skipped by
+    // commit log replay.
+    int64_t now = get_ts64();
+    if (revision >= now)
+      HT_THROWF(Error::RANGESERVER_CLOCK_SKEW, "CellStore %s revision %lld "
+                "is not older than RangeServer clock (%lld)", fname.c_str(),
+                (Lld)revision, (Lld)now);
+
+    lock_guard<mutex> lock(m_mutex);
+    if (revision >= m_earliest_cached_revision ||
+        m_earliest_cached_revision_saved != TIMESTAMP_MAX)
+      HT_THROWF(Error::RANGESERVER_REVISION_ORDER_ERROR,
+                "CellStore %s revision %lld is not older than cached updates "
+                "of %s", fname.c_str(), (Lld)revision, m_full_name.c_str());
+  }
+  catch (Exception &e) {
+    cellstore.reset();
+    try {
+      Global::dfs->rename(dst, fname);
+    }
+    catch (Exception &e2) {
+      HT_ERROR_OUT << "Problem moving " << dst << " back to " << fname
+                   << " - " << e2 << HT_END;
+    }
+    throw;
+  }
+
+  return revision;
+}
+
+void AccessGroup::commit_link_cellstore(CellStorePtr &cellstore,
+                                        int64_t revision) {
+  int64_t total_index_entries = 0;
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (revision > m_latest_stored_revision)
+      m_latest_stored_revision = revision;
+    m_stores.push_back(cellstore);
+    sort_cellstores_by_timestamp();
+    get_merge_info(m_needs_merging, m_end_merge);
+    m_garbage_tracker.update_cellstore_info(m_stores);
+    recompute_compression_ratio(&total_index_entries);
+  }
+
+  std::vector<String> added_files(1, cellstore->get_filename());
+  std::vector<String> removed_files;
+  m_file_tracker.update_live(added_files, removed_files, m_next_cs_id,
+                             total_index_entries);
+  m_file_tracker.update_files_column();
+
+  HT_INFOF("Linked %s into %s", cellstore->get_filename().c_str(),
+           m_full_name.c_str());
+}
+
+void AccessGroup::abort_link_cellstore(const String &fname,
+                                       CellStorePtr &cellstore) {
+  String dst = cellstore->get_filename();
+  bool committed = false;
+  int64_t total_index_entries = 0;
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    for (auto iter = m_stores.begin(); iter != m_stores.end(); ++iter) {
+      if (iter->cs == cellstore) {
+        m_stores.erase(iter);
+        committed = true;
+        break;
+      }
+    }
+    if (committed) {
+      get_merge_info(m_needs_merging, m_end_merge);
+      m_garbage_tracker.update_cellstore_info(m_stores);
+      recompute_compression_ratio(&total_index_entries);
+    }
+  }
+  cellstore.reset();
+
+  if (committed) {
+    std::vector<String> added_files;
+    std::vector<String> removed_files(1, dst);
+    m_file_tracker.update_live(added_files, removed_files, m_next_cs_id,
+                               total_index_entries);
+    try {
+      m_file_tracker.update_files_column();
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << "Problem removing " << dst << " from 'Files' column of "
+                   << m_full_name << " - " << e << HT_END;
+    }
+  }
+
+  try {
+    Global::dfs->rename(dst, fname);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << "Problem moving " << dst << " back to " << fname
+                 << " - " << e << HT_END;
+  }
+}
+
 void AccessGroup::measure_garbage(double *total, double *garbage) {
   ScanContextPtr scan_ctx = make_shared<ScanContext>(m_schema);
   MergeScannerAccessGroupPtr mscanner 
@@ -498,7 +641,7 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
   bool gc = false;
   bool cellstore_created = false;
   size_t merge_offset=0, merge_length=0;
-  String added_file;
+  vector<String> added_files;
 
   hints->ag_name = m_name;
   m_file_tracker.get_file_list(hints->files);
@@ -564,11 +707,13 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
     return;
   }
 
-  String cs_file;
+  vector<String> cs_files;
   PropertiesPtr cellstore_props;
+  BlockCompressionCodec::DictionaryPtr compression_dictionary;
   {
     lock_guard<mutex> lock(m_schema_mutex);
     cellstore_props = m_cellstore_props;
+    compression_dictionary = m_compression_dictionary;
   }
 
   try {
@@ -577,16 +722,18 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
     CellListScannerPtr scanner;
     MergeScannerAccessGroupPtr mscanner;
     ScanContextPtr scan_ctx;
+    vector<SubCompactionPtr> subs;
+    vector<CellStorePtr> cellstores;
 
     {
       lock_guard<mutex> lock(m_mutex);
       scan_ctx = make_shared<ScanContext>(m_schema);
 
-      cs_file = format("%s/tables/%s/%s/%s/cs%d",
-                       Global::toplevel_dir.c_str(),
-                       m_identifier.id, m_name.c_str(),
-                       m_range_dir.c_str(),
-                       m_next_cs_id++);
+      cs_files.push_back(format("%s/tables/%s/%s/%s/cs%d",
+                                Global::toplevel_dir.c_str(),
+                                m_identifier.id, m_name.c_str(),
+                                m_range_dir.c_str(),
+                                m_next_cs_id++));
 
       /**
        * Check for garbage and if threshold reached, change minor to major
@@ -615,7 +762,7 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
         }
       }
 
-      cellstore = make_shared<CellStoreV7>(Global::dfs.get(), m_schema);
+      cellstore = make_shared<CellStoreV8>(Global::dfs.get(), m_schema);
 
       max_num_entries = m_cell_cache_manager->immutable_items();
 
@@ -640,23 +787,64 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
         for (size_t i=merge_offset; i<merge_offset+merge_length; i++) {
           HT_ASSERT(m_stores[i].cs);
           mscanner->add_scanner(m_stores[i].cs->create_scanner(scan_ctx.get()));
-          int divisor = (boost::any_cast<uint32_t>(m_stores[i].cs->get_trailer()->get("flags")) & CellStoreTrailerV7::SPLIT) ? 2: 1;
+          int divisor = (boost::any_cast<uint32_t>(m_stores[i].cs->get_trailer()->get("flags")) & CellStoreTrailerV8::SPLIT) ? 2: 1;
           max_num_entries += (boost::any_cast<int64_t>
               (m_stores[i].cs->get_trailer()->get("total_entries")))/divisor;
         }
       }
       else if (major) {
-        mscanner = make_shared<MergeScannerAccessGroup>(m_table_name, scan_ctx.get(), 
-                                                        MergeScannerAccessGroup::IS_COMPACTION |
-                                                        MergeScannerAccessGroup::ACCUMULATE_COUNTERS);
-        m_cell_cache_manager->add_immutable_scanner(mscanner.get(), scan_ctx.get());
         for (size_t i=0; i<m_stores.size(); i++) {
           HT_ASSERT(m_stores[i].cs);
-          mscanner->add_scanner(m_stores[i].cs->create_scanner(scan_ctx.get()));
-          int divisor = (boost::any_cast<uint32_t>(m_stores[i].cs->get_trailer()->get("flags")) & CellStoreTrailerV7::SPLIT) ? 2: 1;
+          int divisor = (boost::any_cast<uint32_t>(m_stores[i].cs->get_trailer()->get("flags")) & CellStoreTrailerV8::SPLIT) ? 2: 1;
           max_num_entries += (boost::any_cast<int64_t>
               (m_stores[i].cs->get_trailer()->get("total_entries")))/divisor;
         }
+
+        vector<String> split_rows;
+        vector<double> fractions;
+        compaction_split_rows(split_rows, fractions);
+
+        if (split_rows.empty()) {
+          mscanner = make_shared<MergeScannerAccessGroup>(m_table_name, scan_ctx.get(), 
+                                                          MergeScannerAccessGroup::IS_COMPACTION |
+                                                          MergeScannerAccessGroup::ACCUMULATE_COUNTERS);
+          m_cell_cache_manager->add_immutable_scanner(mscanner.get(), scan_ctx.get());
+          for (size_t i=0; i<m_stores.size(); i++)
+            mscanner->add_scanner(m_stores[i].cs->create_scanner(scan_ctx.get()));
+        }
+        else {
+          // Sub-range i covers rows (split_rows[i-1]..split_rows[i]], with the
+          // first and last sub-ranges open ended
+          for (size_t i=0; i<=split_rows.size(); i++) {
+            SubCompactionPtr sub = make_unique<SubCompaction>();
+            sub->builder.add_row_interval(i == 0 ? "" : split_rows[i-1], i == 0,
+                                          i == split_rows.size() ? "" : split_rows[i],
+                                          true);
+            sub->scan_ctx = make_shared<ScanContext>(TIMESTAMP_MAX, &sub->builder.get(),
+                                                     nullptr, m_schema);
+            sub->mscanner = make_shared<MergeScannerAccessGroup>(m_table_name, sub->scan_ctx.get(),
+                                                                 MergeScannerAccessGroup::IS_COMPACTION |
+                                                                 MergeScannerAccessGroup::ACCUMULATE_COUNTERS);
+            m_cell_cache_manager->add_immutable_scanner(sub->mscanner.get(), sub->scan_ctx.get());
+            for (size_t j=0; j<m_stores.size(); j++)
+              sub->mscanner->add_scanner(m_stores[j].cs->create_scanner(sub->scan_ctx.get()));
+            if (i == 0)
+              sub->cellstore = cellstore;
+            else {
+              sub->cellstore = make_shared<CellStoreV8>(Global::dfs.get(), m_schema);
+              cs_files.push_back(format("%s/tables/%s/%s/%s/cs%d",
+                                        Global::toplevel_dir.c_str(),
+                                        m_identifier.id, m_name.c_str(),
+                                        m_range_dir.c_str(),
+                                        m_next_cs_id++));
+            }
+            sub->cs_file = cs_files.back();
+            sub->max_num_entries = (int64_t)(fractions[i] * max_num_entries) + 1;
+            subs.push_back(std::move(sub));
+          }
+          HT_INFOF("Splitting major compaction of %s into %d sub-ranges",
+                   m_full_name.c_str(), (int)subs.size());
+        }
       }
       else {
         scanner = m_cell_cache_manager->create_immutable_scanner(scan_ctx.get());
@@ -664,38 +852,61 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
       }
     }
 
-    cellstore->create(cs_file.c_str(), max_num_entries, cellstore_props, &m_identifier);
-
-    if (mscanner) {
-      while (mscanner->get(key, value)) {
-        cellstore->add(key, value);
-        if (m_in_memory)
-          filtered_cache->add(key, value);
-        mscanner->forward();
+    if (!subs.empty()) {
+      run_sub_compactions(subs, maintenance_flags, cellstore_props,
+                          compression_dictionary);
+      double input {}, output {};
+      for (auto &sub : subs) {
+        input += (double)sub->mscanner->get_input_bytes();
+        output += (double)sub->mscanner->get_output_bytes();
+        cellstores.push_back(sub->cellstore);
       }
-      m_garbage_tracker.adjust_targets(now, mscanner.get());
+      m_garbage_tracker.adjust_targets(now, input, input - output);
     }
     else {
-      while (scanner->get(key, value)) {
-        cellstore->add(key, value);
-        if (m_in_memory)
-          filtered_cache->add(key, value);
-        scanner->forward();
+      cellstore->create(cs_files[0].c_str(), max_num_entries, cellstore_props, &m_identifier);
+      cellstore->set_compression_dictionary(compression_dictionary);
+
+      if (mscanner) {
+        while (mscanner->get(key, value)) {
+          cellstore->add(key, value);
+          if (m_in_memory)
+            filtered_cache->add(key, value);
+          mscanner->forward();
+        }
+        m_garbage_tracker.adjust_targets(now, mscanner.get());
+      }
+      else {
+        while (scanner->get(key, value)) {
+          cellstore->add(key, value);
+          if (m_in_memory)
+            filtered_cache->add(key, value);
+          scanner->forward();
+        }
       }
-    }
 
-    CellStoreTrailerV7 *trailer = dynamic_cast<CellStoreTrailerV7 *>(cellstore->get_trailer());
+      CellStoreTrailerV8 *trailer = dynamic_cast<CellStoreTrailerV8 *>(cellstore->get_trailer());
 
-    if (major)
-      HT_ASSERT(mscanner);
+      if (major)
+        HT_ASSERT(mscanner);
 
-    if (major)
-      trailer->flags |= CellStoreTrailerV6::MAJOR_COMPACTION;
+      if (major)
+        trailer->flags |= CellStoreTrailerV6::MAJOR_COMPACTION;
 
-    if (maintenance_flags & MaintenanceFlag::SPLIT)
-      trailer->flags |= CellStoreTrailerV7::SPLIT;
+      if (maintenance_flags & MaintenanceFlag::SPLIT)
+        trailer->flags |= CellStoreTrailerV8::SPLIT;
+
+      cellstore->finalize(&m_identifier);
+      cellstores.push_back(cellstore);
+    }
 
-    cellstore->finalize(&m_identifier);
+    // Use the dictionary trained on this CellStore for subsequent ones,
+    // unless the compressor spec has changed in the meantime
+    {
+      lock_guard<mutex> lock(m_schema_mutex);
+      if (m_cellstore_props == cellstore_props)
+        m_compression_dictionary = cellstore->get_compression_dictionary();
+    }
 
     if (FailureInducer::enabled()) {
       if (MaintenanceFlag::split(maintenance_flags))
@@ -710,7 +921,7 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
     cellstore_created = true;
 
     /**
-     * Install new CellCache and CellStore and update Live file tracker
+     * Install new CellCache and CellStores and update Live file tracker
      */
     vector<String> removed_files;
     int64_t total_index_entries = 0;
@@ -726,7 +937,7 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
           removed_files.push_back(m_stores[i].cs->get_filename());
         if (cellstore->get_total_entries() > 0) {
           new_stores.push_back(cellstore);
-          added_file = cellstore->get_filename();
+          added_files.push_back(cellstore->get_filename());
         }
         for (size_t i=merge_offset+merge_length; i<m_stores.size(); i++)
           new_stores.push_back(m_stores[i]);
@@ -762,15 +973,17 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
           }
         }
 
-        /** Add the new cell store to the table vector, or delete it if
-         * it contains no entries
+        /** Add the new cell stores to the table vector, or delete them if
+         * they contain no entries
          */
-        if (cellstore->get_total_entries() > 0) {
-          if (shadow_cache)
-            m_stores.push_back( CellStoreInfo(cellstore, shadow_cache, m_earliest_cached_revision_saved) );
-          else
-            m_stores.push_back(cellstore);
-          added_file = cellstore->get_filename();
+        for (auto &cs : cellstores) {
+          if (cs->get_total_entries() > 0) {
+            if (shadow_cache)
+              m_stores.push_back( CellStoreInfo(cs, shadow_cache, m_earliest_cached_revision_saved) );
+            else
+              m_stores.push_back(cs);
+            added_files.push_back(cs->get_filename());
+          }
         }
       }
 
@@ -778,8 +991,12 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
 
       // If compaction included CellCache, recompute latest stored revision
       if (!merging || m_end_merge) {
-        m_latest_stored_revision = boost::any_cast<int64_t>
-          (cellstore->get_trailer()->get("revision"));
+        m_latest_stored_revision = TIMESTAMP_MIN;
+        for (auto &cs : cellstores) {
+          int64_t revision = boost::any_cast<int64_t>(cs->get_trailer()->get("revision"));
+          if (revision > m_latest_stored_revision)
+            m_latest_stored_revision = revision;
+        }
         if (m_latest_stored_revision >= m_earliest_cached_revision)
           HT_ERROR("Revision (clock) skew detected! May result in data loss.");
         m_cellcache_needs_compaction = false;
@@ -791,18 +1008,21 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
       hints->disk_usage = m_disk_usage;
     }
 
-    if (cellstore->get_total_entries() == 0) {
-      String fname = cellstore->get_filename();
-      cellstore = 0;
-      try {
-        Global::dfs->remove(fname);
-      }
-      catch (Hypertable::Exception &e) {
-        HT_WARN_OUT << "Problem removing empty CellStore '" << fname << "' " << e << HT_END;
+    for (auto &cs : cellstores) {
+      if (cs->get_total_entries() == 0) {
+        String fname = cs->get_filename();
+        try {
+          Global::dfs->remove(fname);
+        }
+        catch (Hypertable::Exception &e) {
+          HT_WARN_OUT << "Problem removing empty CellStore '" << fname << "' " << e << HT_END;
+        }
       }
     }
+    cellstores.clear();
+    cellstore = 0;
 
-    m_file_tracker.update_live(added_file, removed_files, m_next_cs_id, total_index_entries);
+    m_file_tracker.update_live(added_files, removed_files, m_next_cs_id, total_index_entries);
     m_file_tracker.update_files_column();
     m_file_tracker.get_file_list(hints->files);
 
@@ -822,15 +1042,15 @@ void AccessGroup::run_compaction(int maintenance_flags, Hints *hints) {
     }
 
     HT_INFOF("Finished Compaction of %s(%s) to %s", m_range_name.c_str(),
-             m_name.c_str(), added_file.c_str());
+             m_name.c_str(), boost::algorithm::join(added_files, ",").c_str());
 
   }
   catch (Exception &e) {
-    // Remove newly created file
+    // Remove newly created files
     if (!cellstore_created) {
-      if (!cs_file.empty()) {
+      for (auto &fname : cs_files) {
         try {
-          Global::dfs->remove(cs_file);
+          Global::dfs->remove(fname);
         }
         catch (Hypertable::Exception &e) {
         }
@@ -1205,6 +1425,103 @@ bool AccessGroup::find_merge_run(size_t *indexp, size_t *lenp) {
   return false;
 }
 
+void AccessGroup::compaction_split_rows(vector<String> &split_rows,
+                                        vector<double> &fractions) {
+
+  if (m_in_memory || Global::compaction_parallelism <= 1 ||
+      Global::cellstore_target_size_max <= 0)
+    return;
+
+  size_t count = std::min((int64_t)Global::compaction_parallelism,
+                          (int64_t)m_disk_usage / Global::cellstore_target_size_max);
+  if (count <= 1)
+    return;
+
+  StlArena arena(128000);
+  CellList::SplitRowDataMapT split_row_data =
+    CellList::SplitRowDataMapT(LtCstr(), CellList::SplitRowDataAlloc(arena));
+
+  for (auto &csinfo : m_stores)
+    csinfo.cs->split_row_estimate_data(split_row_data);
+  m_cell_cache_manager->split_row_estimate_data(split_row_data);
+
+  int64_t total = 0;
+  for (auto &entry : split_row_data)
+    total += entry.second;
+  if (total == 0)
+    return;
+
+  // Boundaries must fall strictly inside the range so that every sub-range
+  // is non-empty
+  int64_t cumulative = 0;
+  int64_t last = 0;
+  for (auto &entry : split_row_data) {
+    if (split_rows.size() == count - 1)
+      break;
+    cumulative += entry.second;
+    if (strcmp(entry.first, m_start_row.c_str()) <= 0 ||
+        strcmp(entry.first, m_end_row.c_str()) >= 0)
+      continue;
+    if (cumulative >= (total * (int64_t)(split_rows.size() + 1)) / (int64_t)count) {
+      split_rows.push_back(entry.first);
+      fractions.push_back((double)(cumulative - last) / total);
+      last = cumulative;
+    }
+  }
+
+  if (split_rows.empty())
+    return;
+
+  fractions.push_back((double)(total - last) / total);
+}
+
+
+void AccessGroup::run_sub_compactions(vector<SubCompactionPtr> &subs,
+                                      int maintenance_flags,
+                                      PropertiesPtr &cellstore_props,
+                                      BlockCompressionCodec::DictionaryPtr &dictionary) {
+  vector<exception_ptr> errors(subs.size());
+
+  auto compact = [&](size_t i) {
+    SubCompaction *sub = subs[i].get();
+    IOScheduler::BackgroundScope background;
+    try {
+      Key key;
+      ByteString value;
+      sub->cellstore->create(sub->cs_file.c_str(), sub->max_num_entries,
+                             cellstore_props, &m_identifier);
+      sub->cellstore->set_compression_dictionary(dictionary);
+      while (sub->mscanner->get(key, value)) {
+        sub->cellstore->add(key, value);
+        sub->mscanner->forward();
+      }
+      CellStoreTrailerV8 *trailer =
+        dynamic_cast<CellStoreTrailerV8 *>(sub->cellstore->get_trailer());
+      trailer->flags |= CellStoreTrailerV6::MAJOR_COMPACTION;
+      if (maintenance_flags & MaintenanceFlag::SPLIT)
+        trailer->flags |= CellStoreTrailerV8::SPLIT;
+      sub->cellstore->finalize(&m_identifier);
+    }
+    catch (...) {
+      errors[i] = current_exception();
+    }
+  };
+
+  vector<thread> threads;
+  threads.reserve(subs.size() - 1);
+  for (size_t i=1; i<subs.size(); i++)
+    threads.emplace_back(compact, i);
+  compact(0);
+  for (auto &t : threads)
+    t.join();
+
+  for (auto &error : errors) {
+    if (error)
+      rethrow_exception(error);
+  }
+}
+
+
 namespace {
   struct LtCellStoreInfoTimestamp {
     bool operator()(const CellStoreInfo &x, const CellStoreInfo &y) const {
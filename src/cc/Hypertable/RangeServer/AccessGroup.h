@@ -36,6 +36,7 @@
 #include <Hypertable/RangeServer/MergeScannerAccessGroup.h>
 
 #include <Hypertable/Lib/RangeSpec.h>
+#include <Hypertable/Lib/ScanSpec.h>
 #include <Hypertable/Lib/Schema.h>
 #include <Hypertable/Lib/TableIdentifier.h>
 
@@ -175,6 +176,43 @@ namespace Hypertable {
 
     void load_cellstore(CellStorePtr &cellstore);
 
+    /// Links an externally built CellStore into the access group.
+    /// Prepares an externally built CellStore for linking.
+    /// Moves <code>fname</code> into the range directory of the access group,
+    /// opens it and validates its revision.  The CellStore must not contain
+    /// revisions that are as new as the oldest cached update, since commit
+    /// log replay skips updates whose revision is not newer than the latest
+    /// stored revision.  For the same reason its revision must be older than
+    /// the current time on this server, since it was assigned on the client.
+    /// The caller must block updates and maintenance until the CellStore is
+    /// passed to commit_link_cellstore() or abort_link_cellstore().  On
+    /// failure, the file is moved back to <code>fname</code>.
+    /// @param fname Absolute pathname of CellStore file
+    /// @param cellstore Set to the opened CellStore
+    /// @return Revision of the CellStore
+    /// @throws Exception with code Error::RANGESERVER_REVISION_ORDER_ERROR if
+    /// the CellStore is not older than the cached updates,
+    /// Error::RANGESERVER_CLOCK_SKEW if it is not older than the current
+    /// time, or Error::NOT_IMPLEMENTED if the access group is in memory
+    int64_t prepare_link_cellstore(const String &fname,
+                                   CellStorePtr &cellstore);
+
+    /// Links a CellStore prepared by prepare_link_cellstore().
+    /// Adds it to the set of stores and updates the <i>Files</i> column of
+    /// METADATA.
+    /// @param cellstore CellStore returned by prepare_link_cellstore()
+    /// @param revision Revision returned by prepare_link_cellstore()
+    void commit_link_cellstore(CellStorePtr &cellstore, int64_t revision);
+
+    /// Undoes prepare_link_cellstore() and commit_link_cellstore().
+    /// Removes <code>cellstore</code> from the set of stores and the
+    /// <i>Files</i> column of METADATA if it was committed, and moves the file
+    /// back to <code>fname</code>.  Errors are logged, not thrown.
+    /// @param fname Original pathname of CellStore file
+    /// @param cellstore CellStore returned by prepare_link_cellstore(), reset
+    /// by this call
+    void abort_link_cellstore(const String &fname, CellStorePtr &cellstore);
+
     void pre_load_cellstores() {
       std::lock_guard<std::mutex> lock(m_mutex);
       m_latest_stored_revision = TIMESTAMP_MIN;
@@ -247,6 +285,58 @@ namespace Hypertable {
 
     bool find_merge_run(size_t *indexp=0, size_t *lenp=0);
 
+    /// State for one sub-range of a parallel major compaction.
+    struct SubCompaction {
+      /// Holds row interval of sub-range
+      ScanSpecBuilder builder;
+      /// Scan context restricted to sub-range
+      ScanContextPtr scan_ctx;
+      /// Merge scanner over sub-range
+      MergeScannerAccessGroupPtr mscanner;
+      /// CellStore receiving compacted sub-range
+      CellStorePtr cellstore;
+      /// Pathname of #cellstore
+      String cs_file;
+      /// Estimated number of entries in sub-range
+      int64_t max_num_entries {};
+    };
+
+    /// Smart pointer to SubCompaction
+    typedef std::unique_ptr<SubCompaction> SubCompactionPtr;
+
+    /// Chooses sub-range boundaries for a parallel major compaction.
+    /// The number of sub-ranges is limited by
+    /// Global::compaction_parallelism and by the access group disk usage
+    /// divided by Global::cellstore_target_size_max, so that the resulting
+    /// CellStores are not immediately picked up by merging compactions.
+    /// Boundaries are chosen from the CellStore block index and CellCache
+    /// split row estimates so that each sub-range holds roughly the same
+    /// number of keys.  This member function must be called with #m_mutex
+    /// locked.
+    /// @param split_rows Populated with the (inclusive) end rows of all but
+    /// the last sub-range; left empty if the compaction should not be split
+    /// @param fractions Populated with the estimated fraction of keys in each
+    /// sub-range (one more entry than <code>split_rows</code>)
+    void compaction_split_rows(std::vector<String> &split_rows,
+                               std::vector<double> &fractions);
+
+    /// Compacts sub-ranges of a major compaction concurrently.
+    /// The first sub-range is compacted by the calling thread and the
+    /// remaining ones each in their own thread.  Each sub-range is merged
+    /// into its CellStore, which is then finalized with the
+    /// MAJOR_COMPACTION (and, if <code>maintenance_flags</code> includes
+    /// MaintenanceFlag::SPLIT, the SPLIT) trailer flag set.
+    /// @param subs Sub-range compaction state
+    /// @param maintenance_flags Maintenance flags of compaction
+    /// @param cellstore_props CellStore creation properties
+    /// @param dictionary Compression dictionary for new CellStores
+    /// @throws Exception thrown by the first failed sub-range compaction,
+    /// after all sub-range compactions have completed
+    void run_sub_compactions(std::vector<SubCompactionPtr> &subs,
+                             int maintenance_flags,
+                             PropertiesPtr &cellstore_props,
+                             BlockCompressionCodec::DictionaryPtr &dictionary);
+
     /** Gets merging compaction information.
      * Determines whether or not a merging compaction is needed, and if so,
      * whether or not the "merge run" includes the end cell store (the one
@@ -281,6 +371,7 @@ namespace Hypertable {
     String m_range_name;
     std::vector<CellStoreInfo> m_stores;
     PropertiesPtr m_cellstore_props;
+    BlockCompressionCodec::DictionaryPtr m_compression_dictionary;
     CellCacheManagerPtr m_cell_cache_manager;
     uint32_t m_next_cs_id {};
     uint64_t m_disk_usage {};
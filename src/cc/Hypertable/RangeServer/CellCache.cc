@@ -38,11 +38,46 @@
 using namespace Hypertable;
 using namespace std;
 
+namespace {
+
+  template <typename CellMapT>
+  void estimate_split_rows(const CellMapT &cell_map,
+                           CellList::SplitRowDataMapT &split_row_data) {
+    const char *row, *last_row = 0;
+    int64_t last_count = 0;
+    for (auto iter = cell_map.begin(); iter != cell_map.end(); ++iter) {
+      row = iter->first.row();
+      if (last_row == 0)
+        last_row = row;
+      if (strcmp(row, last_row) != 0) {
+        CstrToInt64MapT::iterator iter = split_row_data.find(last_row);
+        if (iter == split_row_data.end())
+          split_row_data[last_row] = last_count;
+        else
+          iter->second += last_count;
+        last_row = row;
+        last_count = 0;
+      }
+      last_count++;
+    }
+    if (last_count > 0) {
+      CstrToInt64MapT::iterator iter = split_row_data.find(last_row);
+      if (iter == split_row_data.end())
+        split_row_data[last_row] = last_count;
+      else
+        iter->second += last_count;
+    }
+  }
+
+}
+
 CellCache::CellCache()
   : m_cell_map(std::less<const SerializedKey>(), Alloc(m_arena)) {
   assert(Config::properties); // requires Config::init* first
   m_arena.set_page_size((size_t)
       Config::get_i32("Hypertable.RangeServer.AccessGroup.CellCache.PageSize"));
+  if (Config::get_bool("Hypertable.RangeServer.AccessGroup.CellCache.SkipList"))
+    m_skip_list.reset(new CellCacheSkipList(m_arena));
 }
 
 
@@ -63,6 +98,18 @@ void CellCache::add(const Key &key, const ByteString value) {
 
   value.write(ptr);
 
+  if (m_skip_list) {
+    auto r = m_skip_list->insert(new_key, key.length);
+    if (!r.second) {
+      m_skip_list->replace(r.first, new_key);
+      m_collisions++;
+      HT_WARNF("Collision detected key insert (row = %s)", new_key.row());
+    }
+    else if (key.flag <= FLAG_DELETE_CELL_VERSION)
+      m_deletes++;
+    return;
+  }
+
   CellMap::value_type v(new_key, key.length);
   std::pair<CellMap::iterator, bool> r = m_cell_map.insert(v);
   if (!r.second) {
@@ -96,46 +143,72 @@ void CellCache::add_counter(const Key &key, const ByteString value) {
 
   HT_ASSERT(*value.ptr == 8);
 
-  auto iter = m_cell_map.lower_bound(key.serial);
-
-  if (iter == m_cell_map.end()) {
+  if (m_skip_list) {
+    auto iter = m_skip_list->lower_bound(key.serial);
+    if (iter != m_skip_list->end()) {
+      uint8_t *base = accumulate_counter(key, value, iter->first, iter->second);
+      if (base) {
+        if (base != iter->first.ptr)
+          m_skip_list->replace(iter, SerializedKey(base));
+        return;
+      }
+    }
     add(key, value);
     return;
   }
 
+  auto iter = m_cell_map.lower_bound(key.serial);
+
+  if (iter == m_cell_map.end() ||
+      !accumulate_counter(key, value, iter->first, iter->second))
+    add(key, value);
+}
+
+
+uint8_t *CellCache::accumulate_counter(const Key &key, const ByteString value,
+                                       const SerializedKey existing_key,
+                                       uint32_t value_offset) {
   const uint8_t *ptr;
 
-  size_t len = (*iter).first.decode_length(&ptr);
+  size_t len = existing_key.decode_length(&ptr);
 
   // If the lengths differ, assume they're different keys and do a normal add
-  if (len + (ptr-(*iter).first.ptr) != key.length) {
-    add(key, value);
-    return;
-  }
+  if (len + (ptr-existing_key.ptr) != key.length)
+    return 0;
 
-  if (memcmp(ptr+1, key.row, (key.flag_ptr+1)-(const uint8_t *)key.row)) {
-    add(key, value);
-    return;
-  }
+  if (memcmp(ptr+1, key.row, (key.flag_ptr+1)-(const uint8_t *)key.row))
+    return 0;
 
   ByteString old_value;
-  old_value.ptr = (*iter).first.ptr + (*iter).second;
+  old_value.ptr = existing_key.ptr + value_offset;
 
   HT_ASSERT(*old_value.ptr == 8 || *old_value.ptr == 9);
 
   /*
    * If old value was a reset, just insert the new value
    */
-  if (*old_value.ptr == 9) {
-    add(key, value);
-    return;
+  if (*old_value.ptr == 9)
+    return 0;
+
+  /*
+   * Skip list readers do not hold the cache mutex, so while any are open,
+   * rather than modifying the existing entry in place, accumulate into a copy
+   * which the caller swaps into the list.  Scanners register under the mutex,
+   * which the caller holds, so none can start while the entry is modified.
+   */
+  uint8_t *base = (uint8_t *)existing_key.ptr;
+  if (m_skip_list && m_skip_list_readers > 0) {
+    size_t total_len = value_offset + old_value.length();
+    base = m_arena.alloc(total_len);
+    memcpy(base, existing_key.ptr, total_len);
+    old_value.ptr = base + value_offset;
   }
 
   /*
    * copy timestamp/revision info from insert key to the one in the map
    */
   size_t offset = (key.flag_ptr-((const uint8_t *)key.serial.ptr)) + 1;
-  len = (*iter).second - offset;
+  len = value_offset - offset;
 
 #if 0
   // If key timestamp is not auto-assigned, assume that the timestamp uniquely
@@ -144,12 +217,12 @@ void CellCache::add_counter(const Key &key, const ByteString value) {
   if ((key.control & Key::REV_IS_TS) == 0) {
     int64_t existing_ts = Key::decode_ts64(&ptr);
     if (key.timestamp <= existing_ts)
-      return;
+      return 0;
   }
 #endif
 
   // Copy timestamp/revision info from insert key to the one in the map
-  memcpy(((uint8_t *)(*iter).first.ptr) + offset, key.flag_ptr+1, len);
+  memcpy(base + offset, key.flag_ptr+1, len);
 
   // read old value
   ptr = old_value.ptr+1;
@@ -164,40 +237,20 @@ void CellCache::add_counter(const Key &key, const ByteString value) {
   uint8_t *write_ptr = (uint8_t *)old_value.ptr+1;
 
   Serialization::encode_i64(&write_ptr, old_count+new_count);
+
+  return base;
 }
 
 
 void CellCache::split_row_estimate_data(SplitRowDataMapT &split_row_data) {
   lock_guard<mutex> lock(m_mutex);
-  const char *row, *last_row = 0;
-  int64_t last_count = 0;
-  for (CellMap::iterator iter = m_cell_map.begin();
-       iter != m_cell_map.end(); ++iter) {
-    row = iter->first.row();
-    if (last_row == 0)
-      last_row = row;
-    if (strcmp(row, last_row) != 0) {
-      CstrToInt64MapT::iterator iter = split_row_data.find(last_row);
-      if (iter == split_row_data.end())
-        split_row_data[last_row] = last_count;
-      else
-        iter->second += last_count;
-      last_row = row;
-      last_count = 0;
-    }
-    last_count++;
-  }
-  if (last_count > 0) {
-    CstrToInt64MapT::iterator iter = split_row_data.find(last_row);
-    if (iter == split_row_data.end())
-      split_row_data[last_row] = last_count;
-    else
-      iter->second += last_count;
-  }
+  if (m_skip_list)
+    estimate_split_rows(*m_skip_list, split_row_data);
+  else
+    estimate_split_rows(m_cell_map, split_row_data);
 }
 
 
-
 CellListScannerPtr CellCache::create_scanner(ScanContext *scan_ctx) {
   return make_shared<CellCacheScanner>(shared_from_this(), scan_ctx);
 }
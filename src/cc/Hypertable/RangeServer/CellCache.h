@@ -23,6 +23,7 @@
 #define Hypertable_RangeServer_CellCache_h
 
 #include <Hypertable/RangeServer/CellCacheAllocator.h>
+#include <Hypertable/RangeServer/CellCacheSkipList.h>
 #include <Hypertable/RangeServer/CellListScanner.h>
 #include <Hypertable/RangeServer/CellList.h>
 
@@ -47,7 +48,10 @@ namespace Hypertable {
   /**
    * Represents  a sorted list of key/value pairs in memory.
    * All updates get written to the CellCache and later get "compacted"
-   * into a CellStore on disk.
+   * into a CellStore on disk.  Cells are held either in a std::map (the
+   * default) or, if <code>Hypertable.RangeServer.AccessGroup.CellCache.SkipList</code>
+   * is set, in a CellCacheSkipList which allows scanners to read the cache
+   * without acquiring the cache mutex.
    */
   class CellCache : public CellList, public std::enable_shared_from_this<CellCache> {
 
@@ -88,9 +92,15 @@ namespace Hypertable {
     void lock()   { m_mutex.lock(); }
     void unlock() { m_mutex.unlock(); }
 
-    size_t size() { std::lock_guard<std::mutex> lock(m_mutex); return m_cell_map.size(); }
+    size_t size() {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_skip_list ? m_skip_list->size() : m_cell_map.size();
+    }
 
-    bool empty() { std::lock_guard<std::mutex> lock(m_mutex); return m_cell_map.empty(); }
+    bool empty() {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_skip_list ? m_skip_list->empty() : m_cell_map.empty();
+    }
 
     /** Returns the amount of memory used by the CellCache.  This is the
      * summation of the lengths of all the keys and values in the map.
@@ -115,7 +125,7 @@ namespace Hypertable {
 
     void add_statistics(Statistics &stats) {
       std::lock_guard<std::mutex> lock(m_mutex);
-      stats.size += m_cell_map.size();
+      stats.size += m_skip_list ? m_skip_list->size() : m_cell_map.size();
       stats.deletes += m_deletes;
       stats.memory_used += m_arena.used();
       stats.memory_allocated += m_arena.total();
@@ -130,6 +140,14 @@ namespace Hypertable {
 
     void populate_key_set(KeySet &keys) {
       Key key;
+      if (m_skip_list) {
+        for (auto iter = m_skip_list->begin();
+             iter != m_skip_list->end(); ++iter) {
+          key.load((*iter).first);
+          keys.insert(key);
+        }
+        return;
+      }
       for (CellMap::const_iterator iter = m_cell_map.begin();
 	   iter != m_cell_map.end(); ++iter) {
 	key.load((*iter).first);
@@ -148,9 +166,33 @@ namespace Hypertable {
 
   protected:
 
+    /** Accumulates a counter increment into an existing counter cell.
+     * Checks that <code>existing_key</code> refers to the same cell as
+     * <code>key</code> and holds an accumulated (non-reset) value, and if so
+     * adds the increment in <code>value</code> to it and copies the
+     * timestamp and revision of <code>key</code>.  The existing entry is
+     * modified in place unless the skip list backend has open scanners, in
+     * which case the entry is copied first so those readers never see a
+     * partial update.  The superseded copy stays in the arena and is counted
+     * by memory_used(), so it is reclaimed by the compaction that memory
+     * pressure schedules.
+     * @param key Key of counter increment
+     * @param value Counter increment value
+     * @param existing_key Key of candidate existing counter cell
+     * @param value_offset Offset of value relative to <code>existing_key</code>
+     * @return Pointer to the updated key/value data, or 0 if the increment
+     * could not be accumulated and should be added as a new cell
+     */
+    uint8_t *accumulate_counter(const Key &key, const ByteString value,
+                                const SerializedKey existing_key,
+                                uint32_t value_offset);
+
     std::mutex m_mutex;
     CellCacheArena m_arena;
     CellMap m_cell_map;
+    std::unique_ptr<CellCacheSkipList> m_skip_list;
+    /// Number of open scanners reading #m_skip_list without the mutex
+    int32_t m_skip_list_readers {};
     int32_t m_deletes {};
     int32_t m_collisions {};
     int64_t m_key_bytes {};
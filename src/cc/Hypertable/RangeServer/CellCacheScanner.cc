@@ -37,14 +37,41 @@ using namespace std;
 CellCacheScanner::CellCacheScanner(CellCachePtr cellcache,
                                    ScanContext *scan_ctx)
   : CellListScanner(scan_ctx), m_cell_cache_ptr(cellcache),
-    m_cell_cache_mutex(cellcache->m_mutex) {
-  lock_guard<mutex> lock(m_cell_cache_mutex);
-  DynamicBuffer current_buf;
-  Key current;
-  String tmp_str;
+    m_cell_cache_mutex(cellcache->m_mutex),
+    m_skip_list(cellcache->m_skip_list != nullptr) {
 
   m_keys_only = (scan_ctx->spec) ? (scan_ctx->spec->keys_only && !scan_ctx->spec->value_regexp) : false;
 
+  if (m_skip_list) {
+    {
+      lock_guard<mutex> lock(m_cell_cache_mutex);
+      m_cell_cache_ptr->m_skip_list_readers++;
+    }
+    initialize(*m_cell_cache_ptr->m_skip_list, m_list_cur_iter, m_list_end_iter);
+  }
+  else {
+    lock_guard<mutex> lock(m_cell_cache_mutex);
+    initialize(m_cell_cache_ptr->m_cell_map, m_cur_iter, m_end_iter);
+  }
+}
+
+
+CellCacheScanner::~CellCacheScanner() {
+  if (m_skip_list) {
+    lock_guard<mutex> lock(m_cell_cache_mutex);
+    m_cell_cache_ptr->m_skip_list_readers--;
+  }
+}
+
+
+template <typename CellMapT>
+void CellCacheScanner::initialize(CellMapT &cell_map,
+                                  typename CellMapT::iterator &cur_iter,
+                                  typename CellMapT::iterator &end_iter) {
+  ScanContext *scan_ctx = m_scan_context_ptr;
+  DynamicBuffer current_buf;
+  Key current;
+
   current_buf.grow(scan_ctx->start_key.row_len +
                    scan_ctx->start_key.column_qualifier_len +
                    scan_ctx->end_key.row_len +
@@ -59,7 +86,7 @@ CellCacheScanner::CellCacheScanner(CellCachePtr cellcache,
    * ie, the scan contains a qualified column.
    */
   if (scan_ctx->has_cell_interval) {
-    CellCache::CellMap::iterator iter;
+    typename CellMapT::iterator iter;
 
     /**
      * Look for any DELETE_ROW records for this row and add them
@@ -71,13 +98,13 @@ CellCacheScanner::CellCacheScanner(CellCachePtr cellcache,
 
     current.serial.ptr = current_buf.base;
 
-    for (iter = m_cell_cache_ptr->m_cell_map.lower_bound(current.serial);
-         iter != m_cell_cache_ptr->m_cell_map.end(); ++iter) {
+    for (iter = cell_map.lower_bound(current.serial);
+         iter != cell_map.end(); ++iter) {
       current.load(iter->first);
       if (current.flag != FLAG_DELETE_ROW ||
           strcmp(current.row, scan_ctx->start_key.row))
         break;
-      m_deletes.insert(CellCache::CellMap::value_type(iter->first, iter->second));
+      m_deletes.insert(CellCacheMap::value_type(iter->first, iter->second));
     }
 
     if (scan_ctx->has_start_cf_qualifier) {
@@ -90,42 +117,59 @@ CellCacheScanner::CellCacheScanner(CellCachePtr cellcache,
 
       current.serial.ptr = current_buf.base;
 
-      for (iter = m_cell_cache_ptr->m_cell_map.lower_bound(current.serial);
-           iter != m_cell_cache_ptr->m_cell_map.end(); ++iter) {
+      for (iter = cell_map.lower_bound(current.serial);
+           iter != cell_map.end(); ++iter) {
         current.load(iter->first);
         if (current.flag != FLAG_DELETE_COLUMN_FAMILY ||
             current.column_family_code != scan_ctx->start_key.column_family_code ||
             strcmp(current.row, scan_ctx->start_key.row))
           break;
-        m_deletes.insert(CellCache::CellMap::value_type(iter->first, iter->second));
+        m_deletes.insert(CellCacheMap::value_type(iter->first, iter->second));
       }
     }
   }
 
-  m_start_iter = m_cell_cache_ptr->m_cell_map.lower_bound(scan_ctx->start_serkey);
-  if (m_start_iter != m_cell_cache_ptr->m_cell_map.end())
-    m_end_iter = m_cell_cache_ptr->m_cell_map.lower_bound(scan_ctx->end_serkey);
+  cur_iter = cell_map.lower_bound(scan_ctx->start_serkey);
+  if (cur_iter != cell_map.end())
+    end_iter = cell_map.lower_bound(scan_ctx->end_serkey);
   else
-    m_end_iter = m_cell_cache_ptr->m_cell_map.end();
-  m_cur_iter = m_start_iter;
+    end_iter = cell_map.end();
 
   if (!m_deletes.empty()) {
     m_in_deletes = true;
     m_delete_iter = m_deletes.begin();
   }
 
-  while (m_cur_iter != m_end_iter) {
-    m_cur_entry.key.load( (*m_cur_iter).first );
+  if (!seek_visible(cur_iter, end_iter) && !m_in_deletes)
+    m_eos = true;
+}
+
+
+/**
+ * Advances <code>cur_iter</code> to the first entry at or after its current
+ * position that is either a row delete or belongs to a column family
+ * selected by the scan, and loads it into the current entry.
+ */
+template <typename IteratorT>
+bool CellCacheScanner::seek_visible(IteratorT &cur_iter,
+                                    const IteratorT &end_iter) {
+  while (cur_iter != end_iter) {
+    m_cur_entry.key.load( (*cur_iter).first );
     if (m_cur_entry.key.flag == FLAG_DELETE_ROW
         || m_scan_context_ptr->family_mask[m_cur_entry.key.column_family_code]) {
-      m_cur_entry.value.ptr = m_cur_entry.key.serial.ptr + (*m_cur_iter).second;
-      return;
+      m_cur_entry.value.ptr = m_cur_entry.key.serial.ptr + (*cur_iter).second;
+      return true;
     }
-    ++m_cur_iter;
+    ++cur_iter;
   }
-  if (!m_in_deletes)
-    m_eos = true;
-  return;
+  return false;
+}
+
+
+template <typename IteratorT>
+void CellCacheScanner::load_current(const IteratorT &iter) {
+  m_cur_entry.key.load( (*iter).first );
+  m_cur_entry.value.ptr = m_cur_entry.key.serial.ptr + (*iter).second;
 }
 
 bool CellCacheScanner::get(Key &key, ByteString &value) {
@@ -154,8 +198,7 @@ void CellCacheScanner::forward() {
 bool CellCacheScanner::internal_get() {
 
   if (m_in_deletes) {
-    m_cur_entry.key.load( (*m_delete_iter).first );
-    m_cur_entry.value.ptr = m_cur_entry.key.serial.ptr + (*m_delete_iter).second;
+    load_current(m_delete_iter);
     return true;
   }
 
@@ -176,29 +219,24 @@ void CellCacheScanner::internal_forward() {
     ++m_delete_iter;
     if (m_delete_iter == m_deletes.end()) {
       m_in_deletes = false;
-      if (m_cur_iter != m_end_iter) {
-        // reset current entry since its loaded with the last entry in m_deletes
-        m_cur_entry.key.load( (*m_cur_iter).first );
-        m_cur_entry.value.ptr = m_cur_entry.key.serial.ptr + (*m_cur_iter).second;
-      }
+      // reset current entry since its loaded with the last entry in m_deletes
+      if (m_skip_list && m_list_cur_iter != m_list_end_iter)
+        load_current(m_list_cur_iter);
+      else if (!m_skip_list && m_cur_iter != m_end_iter)
+        load_current(m_cur_iter);
       else
         m_eos = true;
     }
     return;
   }
 
-  ++m_cur_iter;
-  while (m_cur_iter != m_end_iter) {
-
-    m_cur_entry.key.load( (*m_cur_iter).first );
-    if (m_cur_entry.key.flag == FLAG_DELETE_ROW
-        || m_scan_context_ptr->family_mask[m_cur_entry.key.column_family_code]) {
-      m_cur_entry.value.ptr = m_cur_entry.key.serial.ptr + (*m_cur_iter).second;
-      return;
-    }
-    ++m_cur_iter;
-  }
-  m_eos = true;
+  bool found;
+  if (m_skip_list)
+    found = seek_visible(++m_list_cur_iter, m_list_end_iter);
+  else
+    found = seek_visible(++m_cur_iter, m_end_iter);
+  if (!found)
+    m_eos = true;
 }
 
 
@@ -207,7 +245,9 @@ void CellCacheScanner::internal_forward() {
  * size_t                         m_entry_cache_next;
  */
 void CellCacheScanner::load_entry_cache() {
-  lock_guard<mutex> lock(m_cell_cache_mutex);
+  unique_lock<mutex> lock(m_cell_cache_mutex, defer_lock);
+  if (!m_skip_list)
+    lock.lock();
 
   m_entry_cache_next = 0;
   m_entry_cache.clear();
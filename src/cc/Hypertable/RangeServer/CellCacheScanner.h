@@ -29,12 +29,14 @@
 namespace Hypertable {
 
   /**
-   * Provides a scanning interface to a CellCache.
+   * Provides a scanning interface to a CellCache.  If the cache is backed by
+   * a CellCacheSkipList, the scanner reads it without acquiring the cache
+   * mutex.
    */
   class CellCacheScanner : public CellListScanner {
   public:
     CellCacheScanner(CellCachePtr cellcache, ScanContext *scan_ctx);
-    virtual ~CellCacheScanner() { return; }
+    virtual ~CellCacheScanner();
     virtual void forward();
     virtual bool get(Key &key, ByteString &value);
 
@@ -48,6 +50,16 @@ namespace Hypertable {
     void internal_forward();
     void load_entry_cache();
 
+    template <typename CellMapT>
+    void initialize(CellMapT &cell_map, typename CellMapT::iterator &cur_iter,
+                    typename CellMapT::iterator &end_iter);
+
+    template <typename IteratorT>
+    bool seek_visible(IteratorT &cur_iter, const IteratorT &end_iter);
+
+    template <typename IteratorT>
+    void load_current(const IteratorT &iter);
+
     class CellCacheEntry {
     public:
       CellCacheEntry() : value(0) { };
@@ -55,9 +67,10 @@ namespace Hypertable {
       ByteString  value;
     };
 
-    CellCache::CellMap::iterator   m_start_iter;
     CellCache::CellMap::iterator   m_end_iter;
     CellCache::CellMap::iterator   m_cur_iter;
+    CellCacheSkipList::iterator    m_list_end_iter;
+    CellCacheSkipList::iterator    m_list_cur_iter;
     CellCacheMap::iterator         m_delete_iter;
     CellCachePtr                   m_cell_cache_ptr;
     std::mutex                    &m_cell_cache_mutex;
@@ -65,6 +78,7 @@ namespace Hypertable {
     std::vector<CellCacheEntry>    m_entry_cache;
     size_t                         m_entry_cache_next {};
     CellCacheMap                   m_deletes;
+    bool                           m_skip_list {};
     bool                           m_in_deletes {};
     bool                           m_eos {};
     bool                           m_keys_only {};
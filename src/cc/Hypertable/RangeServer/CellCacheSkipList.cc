@@ -0,0 +1,113 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for CellCacheSkipList.
+/// This file contains type definitions for CellCacheSkipList, an
+/// arena-backed skip list used as an alternative CellCache cell map.
+
+#include <Common/Compat.h>
+
+#include "CellCacheSkipList.h"
+
+#include <new>
+
+using namespace Hypertable;
+using namespace std;
+
+CellCacheSkipList::CellCacheSkipList(CellCacheArena &arena) : m_arena(arena) {
+  m_head = new_node(nullptr, 0, MAX_HEIGHT);
+}
+
+pair<CellCacheSkipList::iterator, bool>
+CellCacheSkipList::insert(SerializedKey key, uint32_t value_offset) {
+  Node *prev[MAX_HEIGHT];
+  Node *node = find_greater_or_equal(key, prev);
+
+  if (node && key == SerializedKey(node->key.load(memory_order_relaxed)))
+    return make_pair(iterator(node), false);
+
+  int height = random_height();
+  int max_height = m_max_height.load(memory_order_relaxed);
+  if (height > max_height) {
+    for (int i=max_height; i<height; i++)
+      prev[i] = m_head;
+    // Readers that observe the new height before the node is linked in
+    // will simply find nullptr at the head of the new levels
+    m_max_height.store(height, memory_order_relaxed);
+  }
+
+  node = new_node(key.ptr, value_offset, height);
+  for (int i=0; i<height; i++) {
+    node->next[i].store(prev[i]->next[i].load(memory_order_relaxed),
+                        memory_order_relaxed);
+    prev[i]->set_next(i, node);
+  }
+  m_size.fetch_add(1, memory_order_relaxed);
+  return make_pair(iterator(node), true);
+}
+
+CellCacheSkipList::Node *
+CellCacheSkipList::new_node(const uint8_t *key, uint32_t value_offset,
+                            int height) {
+  size_t len = sizeof(Node) + sizeof(atomic<Node *>) * (height - 1);
+  // PageArena does not align allocations
+  uintptr_t base = (uintptr_t)m_arena.alloc(len + alignof(Node) - 1);
+  base = (base + alignof(Node) - 1) & ~(uintptr_t)(alignof(Node) - 1);
+  Node *node = new ((void *)base) Node(key, value_offset);
+  for (int i=0; i<height; i++)
+    new (&node->next[i]) atomic<Node *>(nullptr);
+  return node;
+}
+
+int CellCacheSkipList::random_height() {
+  int height = 1;
+  while (height < MAX_HEIGHT) {
+    // xorshift32
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    if ((m_random & 3) != 0)
+      break;
+    height++;
+  }
+  return height;
+}
+
+CellCacheSkipList::Node *
+CellCacheSkipList::find_greater_or_equal(const SerializedKey key,
+                                         Node **prev) const {
+  Node *node = m_head;
+  Node *next;
+  int level = m_max_height.load(memory_order_relaxed) - 1;
+  while (true) {
+    next = node->get_next(level);
+    if (next && SerializedKey(next->key.load(memory_order_acquire)) < key)
+      node = next;
+    else {
+      if (prev)
+        prev[level] = node;
+      if (level == 0)
+        return next;
+      level--;
+    }
+  }
+}
@@ -0,0 +1,184 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for CellCacheSkipList.
+/// This file contains type declarations for CellCacheSkipList, an
+/// arena-backed skip list used as an alternative CellCache cell map.
+
+#ifndef Hypertable_RangeServer_CellCacheSkipList_h
+#define Hypertable_RangeServer_CellCacheSkipList_h
+
+#include <Hypertable/RangeServer/CellCacheAllocator.h>
+
+#include <Hypertable/Lib/SerializedKey.h>
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace Hypertable {
+
+  /// @addtogroup RangeServer
+  /// @{
+
+  /// Sorted map of serialized keys to value offsets, implemented as a skip
+  /// list.  Nodes are allocated from a CellCacheArena so they are packed
+  /// together with the key/value data they reference.  The list supports a
+  /// single writer concurrently with any number of readers.  Writers
+  /// (insert(), replace()) must be serialized externally (CellCache does this
+  /// with its mutex), but readers (lower_bound(), begin(), iteration) take no
+  /// locks.  Nodes are linked bottom-up with release stores and read with
+  /// acquire loads, so a reader either sees a fully initialized node or does
+  /// not see it at all.  Nodes are never removed; the whole list is released
+  /// when the arena is freed.
+  class CellCacheSkipList {
+
+    /// Maximum node height
+    static const int MAX_HEIGHT = 12;
+
+    /// Skip list node.  Allocated with <code>height-1</code> additional
+    /// <code>next</code> pointers.
+    struct Node {
+      Node(const uint8_t *k, uint32_t offset) : key(k), value_offset(offset) { }
+      Node *get_next(int level) {
+        return next[level].load(std::memory_order_acquire);
+      }
+      void set_next(int level, Node *node) {
+        next[level].store(node, std::memory_order_release);
+      }
+      /// Serialized key, followed by value
+      std::atomic<const uint8_t *> key;
+      /// Offset of value relative to start of key
+      uint32_t value_offset;
+      /// Per-level successor pointers
+      std::atomic<Node *> next[1];
+    };
+
+  public:
+
+    /// Value type returned by iterator
+    typedef std::pair<SerializedKey, uint32_t> value_type;
+
+    /// Forward iterator.  Loads the key pointer of the node it refers to
+    /// when positioned, so a concurrent replace() is either fully visible or
+    /// not visible at all.
+    class iterator {
+    public:
+      iterator(Node *node=nullptr) : m_node(node) { load(); }
+      const value_type &operator*() const { return m_value; }
+      const value_type *operator->() const { return &m_value; }
+      iterator &operator++() { m_node = m_node->get_next(0); load(); return *this; }
+      bool operator==(const iterator &other) const { return m_node == other.m_node; }
+      bool operator!=(const iterator &other) const { return m_node != other.m_node; }
+    private:
+      friend class CellCacheSkipList;
+      void load() {
+        if (m_node) {
+          m_value.first.ptr = m_node->key.load(std::memory_order_acquire);
+          m_value.second = m_node->value_offset;
+        }
+      }
+      Node *m_node;
+      value_type m_value;
+    };
+
+    /// Constructor.
+    /// @param arena Arena from which to allocate nodes
+    CellCacheSkipList(CellCacheArena &arena);
+
+    /// Inserts a key.
+    /// If an equal key already exists, the list is left unmodified and an
+    /// iterator to the existing entry is returned.  Must not be called
+    /// concurrently with another insert() or replace().
+    /// @param key Serialized key (followed by value) allocated from the arena
+    /// @param value_offset Offset of value relative to <code>key</code>
+    /// @return Pair consisting of an iterator to the inserted (or existing)
+    /// entry and a flag indicating if the key was inserted.
+    std::pair<iterator, bool> insert(SerializedKey key, uint32_t value_offset);
+
+    /// Replaces the key/value data of an existing entry.
+    /// <code>key</code> must compare equal to, or occupy the same position in
+    /// the sort order as, the key it replaces and must have the same value
+    /// offset.  Readers see either the old or the new data.
+    /// @param iter Iterator referring to entry to replace
+    /// @param key Replacement serialized key (followed by value)
+    void replace(iterator &iter, SerializedKey key) {
+      iter.m_node->key.store(key.ptr, std::memory_order_release);
+      iter.load();
+    }
+
+    /// Returns iterator to first entry with key not less than
+    /// <code>key</code>.
+    /// @param key Key to search for
+    /// @return Iterator to first entry not less than <code>key</code>, or
+    /// end() if no such entry exists
+    iterator lower_bound(const SerializedKey key) const {
+      return iterator(find_greater_or_equal(key, nullptr));
+    }
+
+    /// Returns iterator to first entry
+    iterator begin() const { return iterator(m_head->get_next(0)); }
+
+    /// Returns iterator to end of list
+    iterator end() const { return iterator(); }
+
+    /// Returns number of entries in the list
+    size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+    /// Checks if list is empty
+    bool empty() const { return size() == 0; }
+
+  private:
+
+    /// Allocates and constructs a node from the arena.
+    Node *new_node(const uint8_t *key, uint32_t value_offset, int height);
+
+    /// Picks a random height for a new node (branching factor 4).
+    int random_height();
+
+    /// Finds first node with key not less than <code>key</code>.
+    /// @param key Key to search for
+    /// @param prev If non-null, filled in with predecessor at each level
+    /// @return First node not less than <code>key</code> or nullptr
+    Node *find_greater_or_equal(const SerializedKey key, Node **prev) const;
+
+    /// Arena from which nodes are allocated
+    CellCacheArena &m_arena;
+
+    /// Head sentinel node (of height #MAX_HEIGHT)
+    Node *m_head;
+
+    /// Current maximum height of list
+    std::atomic<int> m_max_height {1};
+
+    /// Number of entries
+    std::atomic<size_t> m_size {};
+
+    /// Random state for random_height() (writer only)
+    uint32_t m_random {0xdeadbeef};
+  };
+
+  /// @}
+
+}
+
+#endif // Hypertable_RangeServer_CellCacheSkipList_h
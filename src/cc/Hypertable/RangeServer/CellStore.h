@@ -322,6 +322,39 @@ namespace Hypertable {
 
     virtual uint16_t block_header_format() = 0;
 
+    /**
+     * Checks if data blocks end with a restart offset array.  If true, each
+     * uncompressed data block is followed by an array of 32-bit offsets of
+     * keys stored without prefix compression (restart points), and a 32-bit
+     * count of the offsets.
+     *
+     * @return <i>true</i> if data blocks contain restart points
+     */
+    virtual bool block_restarts() { return false; }
+
+    /**
+     * Sets compression dictionary for a CellStore being created.  Must be
+     * called after create() and before the first call to add().  Ignored if
+     * the block compression codec was not configured to use a dictionary.
+     *
+     * @param dictionary Compression dictionary
+     */
+    virtual void
+    set_compression_dictionary(BlockCompressionCodec::DictionaryPtr dictionary) { }
+
+    /**
+     * Returns compression dictionary to use for subsequent CellStores.  For a
+     * CellStore that has been finalized, this is the dictionary trained from
+     * its data blocks (or the one that was set, if training was skipped).
+     * For a CellStore that was opened, this is the dictionary stored in the
+     * file.
+     *
+     * @return Compression dictionary, or null if there is none
+     */
+    virtual BlockCompressionCodec::DictionaryPtr get_compression_dictionary() {
+      return BlockCompressionCodec::DictionaryPtr();
+    }
+
     static const char DATA_BLOCK_MAGIC[10];
     static const char INDEX_FIXED_BLOCK_MAGIC[10];
     static const char INDEX_VARIABLE_BLOCK_MAGIC[10];
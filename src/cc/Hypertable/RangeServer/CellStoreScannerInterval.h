@@ -23,6 +23,8 @@
 #define HYPERTABLE_CELLSTORESCANNERINTERVAL_H
 
 #include "Common/ByteString.h"
+#include "Common/Logger.h"
+#include "Common/Serialization.h"
 #include "Hypertable/Lib/Key.h"
 
 namespace Hypertable {
@@ -41,7 +43,38 @@ namespace Hypertable {
       int64_t zlength;
       const uint8_t *base;
       const uint8_t *end;
+      const uint8_t *restarts;
+      uint32_t restart_count;
     };
+
+    /** Locates restart offset array at end of block.  Sets
+     * <code>block.restarts</code> and <code>block.restart_count</code> from
+     * the trailing restart array and moves <code>block.end</code> to the
+     * start of the array, so it marks the end of the key/value pairs.
+     * @param block Block with <code>base</code> and <code>end</code> set to
+     * the uncompressed block data
+     */
+    static void load_restarts(BlockInfo &block) {
+      const uint8_t *ptr = block.end - 4;
+      size_t remaining = 4;
+      HT_ASSERT(block.end - block.base >= 4);
+      block.restart_count = Serialization::decode_i32(&ptr, &remaining);
+      HT_ASSERT(block.end - block.base >= 4*((int64_t)block.restart_count+1));
+      block.restarts = block.end - 4*(block.restart_count+1);
+      block.end = block.restarts;
+    }
+
+    /** Returns pointer to restart key.
+     * @param block Block with restarts loaded by load_restarts()
+     * @param i Index of restart point
+     * @return Pointer to <code>i</code>th restart key in block
+     */
+    static const uint8_t *restart_key(const BlockInfo &block, uint32_t i) {
+      const uint8_t *ptr = block.restarts + 4*i;
+      size_t remaining = 4;
+      return block.base + Serialization::decode_i32(&ptr, &remaining);
+    }
+
     uint64_t m_disk_read;
   };
 
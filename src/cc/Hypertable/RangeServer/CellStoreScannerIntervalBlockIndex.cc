@@ -41,6 +41,7 @@
 #include <Common/Error.h>
 #include <Common/System.h>
 
+#include <algorithm>
 #include <cassert>
 #include <utility>
 
@@ -60,6 +61,10 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
   m_end_row = (m_end_key) ? m_end_key.row() : Key::END_ROW_MARKER;
   m_fd = m_cellstore->get_fd();
 
+  // Prefetching is disabled for scans with row sets since they skip blocks
+  if (m_rowset.empty())
+    m_prefetch_depth = std::min(2, Global::scanner_prefetch_depth);
+
   if (m_start_key && (m_iter = m_index->lower_bound(m_start_key)) == m_index->end())
     return;
 
@@ -70,6 +75,25 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
 
   if (m_start_key) {
     const uint8_t *ptr;
+
+    // Binary search restart points for the last one that is less than the
+    // start key and resume the linear walk from there
+    if (m_block.restart_count > 1 && m_key_decompressor->less_than(m_start_key)) {
+      uint32_t lo = 0;
+      uint32_t hi = m_block.restart_count;
+      while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        m_key_decompressor->reset();
+        m_key_decompressor->add(restart_key(m_block, mid));
+        if (m_key_decompressor->less_than(m_start_key))
+          lo = mid;
+        else
+          hi = mid;
+      }
+      m_key_decompressor->reset();
+      m_cur_value.ptr = m_key_decompressor->add(restart_key(m_block, lo));
+    }
+
     while (m_key_decompressor->less_than(m_start_key)) {
       ptr = m_cur_value.ptr + m_cur_value.length();
       if (ptr >= m_block.end) {
@@ -104,6 +128,10 @@ CellStoreScannerIntervalBlockIndex<IndexT>::CellStoreScannerIntervalBlockIndex(C
 
 template <typename IndexT>
 CellStoreScannerIntervalBlockIndex<IndexT>::~CellStoreScannerIntervalBlockIndex() {
+  // Outstanding reads reference handlers owned by this object
+  EventPtr event;
+  for (auto &read : m_prefetch_reads)
+    read->handler.wait_for_reply(event);
   if (m_block.base != 0) {
     if (m_cached)
       Global::block_cache->checkin(m_file_id, m_block.offset);
@@ -240,12 +268,24 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
 				           (uint8_t **)&buf.base, &len)) {
 
 	  /** Read compressed block **/
-          DispatchHandlerSynchronizer sync_handler;
-	  Global::dfs->pread(m_fd, m_block.zlength, m_block.offset, second_try, &sync_handler);
-          if (!sync_handler.wait_for_reply(event))
-            HT_THROW(Protocol::response_code(event.get()),
-                     Protocol::string_format_message(event).c_str());
-          {
+          if (m_zero_copy && !second_try &&
+              Global::dfs->pread_view(m_fd, m_block.zlength, m_block.offset,
+                                      event)) {
+            // Data is served from memory, so prefetching is of no benefit
+            m_prefetch_depth = 0;
+            buf.base = (uint8_t *)event->payload;
+            buf.own = false;
+          }
+          else {
+            // Filesystem does not serve this file from memory
+            m_zero_copy = false;
+            if (second_try || !take_prefetch_read(event)) {
+              DispatchHandlerSynchronizer sync_handler;
+              Global::dfs->pread(m_fd, m_block.zlength, m_block.offset, second_try, &sync_handler);
+              if (!sync_handler.wait_for_reply(event))
+                HT_THROW(Protocol::response_code(event.get()),
+                         Protocol::string_format_message(event).c_str());
+            }
             uint32_t length;
             uint64_t off;
             const void *data;
@@ -317,13 +357,104 @@ bool CellStoreScannerIntervalBlockIndex<IndexT>::fetch_next_block(bool eob) {
 
     m_key_decompressor->reset();
     m_block.end = m_block.base + len;
+    if (m_cellstore->block_restarts())
+      load_restarts(m_block);
     m_cur_value.ptr = m_key_decompressor->add(m_block.base);
 
+    if (m_prefetch_depth)
+      issue_prefetch_reads();
+
+    return true;
+  }
+  return false;
+}
+
+
+template <typename IndexT>
+void CellStoreScannerIntervalBlockIndex<IndexT>::issue_prefetch_reads() {
+  IndexIteratorT iter = m_iter;
+
+  for (int32_t i=0; i<m_prefetch_depth &&
+         m_prefetch_reads.size() < (size_t)m_prefetch_depth; i++) {
+
+    // Blocks following the one containing the end row are not needed
+    if (strcmp(iter.key().row(), m_end_row) >= 0)
+      return;
+
+    if (++iter == m_index->end())
+      return;
+
+    int64_t offset = iter.value();
+    if (offset < m_prefetch_end)
+      continue;
+
+    uint32_t zlength = block_zlength(iter);
+    m_prefetch_end = offset + zlength;
+
+    if (Global::block_cache && Global::block_cache->contains(m_file_id, offset))
+      continue;
+
+    auto read = make_unique<PrefetchRead>(offset, zlength);
+    try {
+      Global::dfs->pread(m_fd, zlength, offset, false, &read->handler);
+    }
+    catch (Exception &e) {
+      HT_WARN_OUT << "Problem prefetching cell store block (file="
+                  << m_cellstore->get_filename() << " offset=" << offset
+                  << "), disabling prefetch - " << e << HT_END;
+      m_prefetch_depth = 0;
+      return;
+    }
+    m_prefetch_reads.push_back(std::move(read));
+  }
+}
+
+
+template <typename IndexT>
+bool CellStoreScannerIntervalBlockIndex<IndexT>::take_prefetch_read(EventPtr &event) {
+
+  while (!m_prefetch_reads.empty() &&
+         m_prefetch_reads.front()->offset <= m_block.offset) {
+    std::unique_ptr<PrefetchRead> read = std::move(m_prefetch_reads.front());
+    m_prefetch_reads.pop_front();
+
+    bool ready = read->handler.reply_ready();
+    bool ok = read->handler.wait_for_reply(event);
+
+    // Read for a block that was served from the cache
+    if (read->offset < m_block.offset)
+      continue;
+
+    HT_ASSERT(read->zlength == m_block.zlength);
+
+    if (!ready) {
+      m_prefetch_hits = 0;
+      m_prefetch_depth = std::min(m_prefetch_depth * 2,
+                                  Global::scanner_prefetch_depth);
+    }
+    else if (++m_prefetch_hits >= m_prefetch_depth) {
+      m_prefetch_hits = 0;
+      if (m_prefetch_depth > 1)
+        m_prefetch_depth--;
+    }
+
+    if (!ok)
+      HT_THROW(Protocol::response_code(event.get()),
+               Protocol::string_format_message(event).c_str());
     return true;
   }
   return false;
 }
 
+
+template <typename IndexT>
+uint32_t CellStoreScannerIntervalBlockIndex<IndexT>::block_zlength(IndexIteratorT iter) {
+  uint64_t offset = iter.value();
+  if (++iter == m_index->end())
+    return m_index->end_of_last_block() - offset;
+  return iter.value() - offset;
+}
+
 namespace Hypertable {
   template class CellStoreScannerIntervalBlockIndex<CellStoreBlockIndexArray<uint32_t> >;
   template class CellStoreScannerIntervalBlockIndex<CellStoreBlockIndexArray<int64_t> >;
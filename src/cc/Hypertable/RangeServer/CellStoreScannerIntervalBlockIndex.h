@@ -32,8 +32,13 @@
 #include <Hypertable/RangeServer/CellStoreScannerInterval.h>
 #include <Hypertable/RangeServer/ScanContext.h>
 
+#include <AsyncComm/DispatchHandlerSynchronizer.h>
+
 #include <Common/DynamicBuffer.h>
 
+#include <deque>
+#include <memory>
+
 namespace Hypertable {
 
   class BlockCompressionCodec;
@@ -42,6 +47,12 @@ namespace Hypertable {
   /// @{
 
   /// Provides the ability to scan over a portion of a cell store using its block index.
+  /// When <code>Hypertable.RangeServer.Scanner.PrefetchDepth</code> is
+  /// non-zero, the scanner keeps a window of asynchronous block reads
+  /// outstanding ahead of the block it is positioned on.  The window starts
+  /// at two blocks, doubles each time the scanner has to wait for a read to
+  /// complete, and shrinks by one block after every window's worth of reads
+  /// that completed before they were needed.
   /// @tparam IndexT Type of block index
   template <typename IndexT>
   class CellStoreScannerIntervalBlockIndex : public CellStoreScannerInterval {
@@ -59,6 +70,38 @@ namespace Hypertable {
 
     bool fetch_next_block(bool eob=false);
 
+    /// Outstanding asynchronous block read.
+    struct PrefetchRead {
+      PrefetchRead(int64_t off, uint32_t zlen) : offset(off), zlength(zlen) { }
+      /// Offset of block
+      int64_t offset;
+      /// Compressed length of block
+      uint32_t zlength;
+      /// Handler receiving the read response
+      DispatchHandlerSynchronizer handler;
+    };
+
+    /// Issues asynchronous reads for the blocks following #m_iter.
+    /// Reads are issued for blocks not already in the block cache, up to
+    /// #m_prefetch_depth outstanding reads, stopping at the block that
+    /// contains the end row.
+    void issue_prefetch_reads();
+
+    /// Takes the prefetched read for the current block.
+    /// Discards any outstanding reads for blocks before the current block
+    /// and adjusts #m_prefetch_depth according to whether or not the read
+    /// completed before it was needed.
+    /// @param event Set to the read response event
+    /// @return <i>true</i> if a prefetched read for the current block was
+    /// found, <i>false</i> otherwise
+    /// @throws Exception if the prefetched read failed
+    bool take_prefetch_read(EventPtr &event);
+
+    /// Returns compressed length of block referenced by <code>iter</code>.
+    /// @param iter Iterator referencing block
+    /// @return Compressed length of block
+    uint32_t block_zlength(IndexIteratorT iter);
+
     CellStorePtr          m_cellstore;
     IndexT               *m_index {};
     IndexIteratorT        m_iter;
@@ -78,6 +121,11 @@ namespace Hypertable {
     int                   m_file_id {};
     ScanContext          *m_scan_ctx {};
     ScanContext::CstrRowSet& m_rowset;
+    std::deque<std::unique_ptr<PrefetchRead>> m_prefetch_reads;
+    int64_t               m_prefetch_end {};
+    int32_t               m_prefetch_depth {};
+    int32_t               m_prefetch_hits {};
+    bool                  m_zero_copy {true};
   };
 
   /// @}
@@ -301,6 +301,8 @@ bool CellStoreScannerIntervalReadahead<IndexT>::fetch_next_block_readahead(bool
 
     m_key_decompressor->reset();
     m_block.end = m_block.base + len;
+    if (m_cellstore->block_restarts())
+      load_restarts(m_block);
     m_cur_value.ptr = m_key_decompressor->add(m_block.base);
 
     return true;
@@ -36,6 +36,7 @@
 #include <Hypertable/RangeServer/Request/Handler/FetchScanblock.h>
 #include <Hypertable/RangeServer/Request/Handler/GetStatistics.h>
 #include <Hypertable/RangeServer/Request/Handler/Heapcheck.h>
+#include <Hypertable/RangeServer/Request/Handler/LinkCellStores.h>
 #include <Hypertable/RangeServer/Request/Handler/LoadRange.h>
 #include <Hypertable/RangeServer/Request/Handler/MetadataSync.h>
 #include <Hypertable/RangeServer/Request/Handler/PhantomCommitRanges.h>
@@ -211,6 +212,10 @@ void ConnectionHandler::handle(EventPtr &event) {
         handler = new Request::Handler::TableMaintenanceDisable(m_comm, m_range_server, event);
         break;
 
+      case Lib::RangeServer::Protocol::COMMAND_LINK_CELLSTORES:
+        handler = new Request::Handler::LinkCellStores(m_comm, m_range_server, event);
+        break;
+
       default:
         HT_THROWF(Error::PROTOCOL_ERROR, "Unimplemented command (%llu)",
                   (Llu)event->header.command);
@@ -23,7 +23,10 @@
 
 #include "FileBlockCache.h"
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
+#include <cstring>
 #include <iostream>
 #include <utility>
 
@@ -32,49 +35,113 @@ using namespace std;
 
 atomic<int> FileBlockCache::ms_next_file_id {0};
 
+namespace {
+  /// Typical block size, used to size the frequency sketches
+  const int64_t EXPECTED_BLOCK_SIZE = 65536;
+  const size_t MIN_SKETCH_WIDTH = 1024;
+  const size_t MAX_SKETCH_WIDTH = 65536;
+}
+
+FileBlockCache::FrequencySketch::FrequencySketch(size_t width) {
+  m_width = MIN_SKETCH_WIDTH;
+  while (m_width < width && m_width < MAX_SKETCH_WIDTH)
+    m_width <<= 1;
+  m_shift = 64;
+  for (size_t w = m_width; w > 1; w >>= 1)
+    m_shift--;
+  m_table.resize((DEPTH * m_width) / 16, 0);
+}
+
+void FileBlockCache::FrequencySketch::increment(uint64_t hash) {
+  for (int row=0; row<DEPTH; row++) {
+    size_t i = index(hash, row);
+    int shift = (i & 15) * 4;
+    if (((m_table[i >> 4] >> shift) & 0xf) != 0xf)
+      m_table[i >> 4] += 1ULL << shift;
+  }
+  if (++m_additions == 10 * m_width) {
+    for (auto &word : m_table)
+      word = (word >> 1) & 0x7777777777777777ULL;
+    m_additions /= 2;
+  }
+}
+
+uint32_t FileBlockCache::FrequencySketch::frequency(uint64_t hash) const {
+  uint32_t frequency = 0xf;
+  for (int row=0; row<DEPTH; row++) {
+    size_t i = index(hash, row);
+    frequency = min(frequency,
+                    (uint32_t)((m_table[i >> 4] >> ((i & 15) * 4)) & 0xf));
+  }
+  return frequency;
+}
+
+FileBlockCache::FileBlockCache(int64_t min_memory, int64_t max_memory,
+                               bool compressed, size_t shard_count,
+                               bool admission_filter)
+  : m_shard_count(max(shard_count, (size_t)1)),
+    m_admission_filter(admission_filter), m_min_memory(min_memory),
+    m_max_memory(max_memory), m_limit(max_memory), m_available(max_memory),
+    m_compressed(compressed) {
+  HT_ASSERT(min_memory <= max_memory);
+  size_t sketch_width = (max_memory / EXPECTED_BLOCK_SIZE) / m_shard_count;
+  m_shards.reset(new unique_ptr<Shard>[m_shard_count]);
+  for (size_t i=0; i<m_shard_count; i++)
+    m_shards[i].reset(new Shard(sketch_width));
+}
+
 FileBlockCache::~FileBlockCache() {
-  lock_guard<mutex> lock(m_mutex);
-  for (BlockCache::const_iterator iter = m_cache.begin();
-       iter != m_cache.end(); ++iter)
-    if (!iter->event)
-      delete [] (*iter).block;
-  m_cache.clear();
+  for (size_t i=0; i<m_shard_count; i++) {
+    lock_guard<mutex> lock(m_shards[i]->mutex);
+    for (BlockCache::const_iterator iter = m_shards[i]->cache.begin();
+         iter != m_shards[i]->cache.end(); ++iter)
+      if (!iter->event)
+        delete [] (*iter).block;
+    m_shards[i]->cache.clear();
+  }
 }
 
 bool
 FileBlockCache::checkout(int file_id, uint64_t file_offset, uint8_t **blockp,
                          uint32_t *lengthp) {
-  lock_guard<mutex> lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
+  int64_t key = make_key(file_id, file_offset);
+  uint64_t hash = hash_key(key);
+  Shard &shard = *m_shards[shard_index(hash)];
+  lock_guard<mutex> lock(shard.mutex);
+  HashIndex &hash_index = shard.cache.get<1>();
   HashIndex::iterator iter;
 
-  m_accesses++;
+  shard.stats.accesses++;
 
-  if ((iter = hash_index.find(make_key(file_id, file_offset))) == hash_index.end())
-    return false;
+  // Misses count too, so a block that keeps getting requested will
+  // eventually be admitted
+  if (m_admission_filter)
+    shard.sketch.increment(hash);
 
-  BlockCacheEntry entry = *iter;
-  entry.ref_count++;
+  if ((iter = hash_index.find(key)) == hash_index.end())
+    return false;
 
-  hash_index.erase(iter);
+  hash_index.modify(iter, IncrementRefCount());
 
-  pair<Sequence::iterator, bool> insert_result = m_cache.push_back(entry);
-  assert(insert_result.second);
+  // Move to most recently used position
+  shard.cache.relocate(shard.cache.end(), shard.cache.project<0>(iter));
 
-  *blockp = (*insert_result.first).block;
-  *lengthp = (*insert_result.first).length;
+  *blockp = (*iter).block;
+  *lengthp = (*iter).length;
 
-  m_hits++;
+  shard.stats.hits++;
   return true;
 }
 
 
 void FileBlockCache::checkin(int file_id, uint64_t file_offset) {
-  lock_guard<mutex> lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
+  int64_t key = make_key(file_id, file_offset);
+  Shard &shard = *m_shards[shard_index(hash_key(key))];
+  lock_guard<mutex> lock(shard.mutex);
+  HashIndex &hash_index = shard.cache.get<1>();
   HashIndex::iterator iter;
 
-  iter = hash_index.find(make_key(file_id, file_offset));
+  iter = hash_index.find(key);
 
   assert(iter != hash_index.end() && (*iter).ref_count > 0);
 
@@ -86,46 +153,75 @@ bool
 FileBlockCache::insert(int file_id, uint64_t file_offset,
 		       uint8_t *block, uint32_t length,
                        const EventPtr &event, bool checkout) {
-  lock_guard<mutex> lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
-
-  if (hash_index.find(make_key(file_id, file_offset)) != hash_index.end())
+  int64_t key = make_key(file_id, file_offset);
+  uint64_t hash = hash_key(key);
+  size_t index = shard_index(hash);
+  Shard &shard = *m_shards[index];
+  lock_guard<mutex> lock(shard.mutex);
+  HashIndex &hash_index = shard.cache.get<1>();
+
+  if (hash_index.find(key) != hash_index.end())
     return false;
 
-  if (m_available < length)
-    make_room(length);
-
-  if (m_available < length) {
-    if ((length-m_available) <= (m_max_memory-m_limit)) {
-      m_limit += (length-m_available);
-      m_available += (length-m_available);
+  bool reserved = reserve(length, false);
+
+  if (!reserved) {
+    uint32_t frequency =
+      m_admission_filter ? shard.sketch.frequency(hash) : UINT32_MAX;
+
+    // Evict from this shard first, then from any other shard that is not
+    // currently in use
+    make_room(shard, length - available(), frequency);
+    reserved = reserve(length, false);
+    for (size_t i=1; i<m_shard_count && !reserved; i++) {
+      Shard &other = *m_shards[(index + i) % m_shard_count];
+      unique_lock<mutex> other_lock(other.mutex, try_to_lock);
+      if (other_lock.owns_lock()) {
+        make_room(other, length - available(), frequency);
+        reserved = reserve(length, false);
+      }
     }
-    else
+
+    if (!reserved && !reserve(length, true)) {
+      shard.stats.rejections++;
       return false;
+    }
   }
 
   BlockCacheEntry entry(file_id, file_offset, event);
   entry.block = block;
   entry.length = length;
+
+  // A pooled payload shares its receive buffer with other messages, so
+  // holding the event would pin the whole buffer while only the block is
+  // charged against the cache.  Keep a copy of the block instead.
+  if (event && event->payload_pooled) {
+    entry.block = new uint8_t [length];
+    memcpy(entry.block, block, length);
+    entry.event.reset();
+  }
   entry.ref_count = checkout ? 1 : 0;
 
-  pair<Sequence::iterator, bool> insert_result = m_cache.push_back(entry);
+  pair<Sequence::iterator, bool> insert_result = shard.cache.push_back(entry);
   assert(insert_result.second);
   (void)insert_result;
 
-  m_available -= length;
+  shard.stats.inserts++;
+  shard.stats.memory_used += length;
 
   return true;
 }
 
 
 bool FileBlockCache::contains(int file_id, uint64_t file_offset) {
-  lock_guard<mutex> lock(m_mutex);
-  HashIndex &hash_index = m_cache.get<1>();
-  m_accesses++;
-
-  if (hash_index.find(make_key(file_id, file_offset)) != hash_index.end()) {
-    m_hits++;
+  int64_t key = make_key(file_id, file_offset);
+  Shard &shard = *m_shards[shard_index(hash_key(key))];
+  lock_guard<mutex> lock(shard.mutex);
+  HashIndex &hash_index = shard.cache.get<1>();
+  shard.stats.accesses++;
+
+  if (hash_index.find(key) != hash_index.end()) {
+    shard.stats.hits++;
     return true;
   }
   else
@@ -144,45 +240,102 @@ void FileBlockCache::increase_limit(int64_t amount) {
 
 
 int64_t FileBlockCache::decrease_limit(int64_t amount) {
-  lock_guard<mutex> lock(m_mutex);
   int64_t memory_freed = 0;
-  if (m_available < amount) {
-    if (amount > (m_limit - m_min_memory))
-      amount = m_limit - m_min_memory;
-    memory_freed = make_room(amount);
-    if (m_available < amount)
-      amount = m_available;
+  int64_t needed;
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_available < amount) {
+      if (amount > (m_limit - m_min_memory))
+        amount = m_limit - m_min_memory;
+    }
+    needed = amount - m_available;
+  }
+
+  // Spread eviction across shards in rounds so that no single shard is
+  // emptied while others keep cold blocks
+  while (needed > 0) {
+    int64_t round_freed = 0;
+    int64_t share = (needed + m_shard_count - 1) / m_shard_count;
+    for (size_t i=0; i<m_shard_count && round_freed < needed; i++) {
+      lock_guard<mutex> lock(m_shards[i]->mutex);
+      round_freed += make_room(*m_shards[i], share, UINT32_MAX);
+    }
+    if (round_freed == 0)
+      break;
+    memory_freed += round_freed;
+    needed -= round_freed;
   }
+
+  lock_guard<mutex> lock(m_mutex);
+  if (m_available < amount)
+    amount = m_available;
   m_available -= amount;
   m_limit -= amount;
   return memory_freed;
 }
 
 
-int64_t FileBlockCache::make_room(int64_t amount) {
-  BlockCache::iterator iter = m_cache.begin();
+int64_t FileBlockCache::make_room(Shard &shard, int64_t amount,
+                                  uint32_t frequency) {
+  BlockCache::iterator iter = shard.cache.begin();
   int64_t amount_freed = 0;
-  while (iter != m_cache.end()) {
+  while (iter != shard.cache.end() && amount_freed < amount) {
     if ((*iter).ref_count == 0) {
-      m_available += (*iter).length;
+      // Keep victims that are more popular than the block needing room
+      if (frequency != UINT32_MAX &&
+          shard.sketch.frequency(hash_key(iter->key())) > frequency)
+        break;
       amount_freed += (*iter).length;
       if (!iter->event)
         delete [] iter->block;
-      iter = m_cache.erase(iter);
-      if (m_available >= amount)
-	break;
+      iter = shard.cache.erase(iter);
+      shard.stats.evictions++;
     }
     else
       ++iter;
   }
+  shard.stats.memory_used -= amount_freed;
+  if (amount_freed) {
+    lock_guard<mutex> lock(m_mutex);
+    m_available += amount_freed;
+  }
   return amount_freed;
 }
 
+
+bool FileBlockCache::reserve(int64_t length, bool grow) {
+  lock_guard<mutex> lock(m_mutex);
+  if (m_available < length && grow &&
+      (length-m_available) <= (m_max_memory-m_limit)) {
+    m_limit += (length-m_available);
+    m_available += (length-m_available);
+  }
+  if (m_available < length)
+    return false;
+  m_available -= length;
+  return true;
+}
+
 void FileBlockCache::get_stats(uint64_t *max_memoryp, uint64_t *available_memoryp,
                                uint64_t *accessesp, uint64_t *hitsp) {
+  *accessesp = 0;
+  *hitsp = 0;
+  for (size_t i=0; i<m_shard_count; i++) {
+    lock_guard<mutex> lock(m_shards[i]->mutex);
+    *accessesp += m_shards[i]->stats.accesses;
+    *hitsp += m_shards[i]->stats.hits;
+  }
   lock_guard<mutex> lock(m_mutex);
   *max_memoryp = m_limit;
   *available_memoryp = m_available;
-  *accessesp = m_accesses;
-  *hitsp = m_hits;
+}
+
+void FileBlockCache::get_shard_stats(std::vector<ShardStats> &stats) {
+  stats.clear();
+  stats.reserve(m_shard_count);
+  for (size_t i=0; i<m_shard_count; i++) {
+    lock_guard<mutex> lock(m_shards[i]->mutex);
+    stats.push_back(m_shards[i]->stats);
+  }
 }
@@ -32,20 +32,52 @@
 #include <boost/multi_index/sequenced_index.hpp>
 
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 namespace Hypertable {
   using namespace boost::multi_index;
 
+  /// Cache of CellStore blocks.
+  /// Blocks are hashed on (file_id, file_offset) into a number of
+  /// independently locked shards, each of which is an LRU list.  The memory
+  /// limit is global, so a shard that needs room evicts its own least
+  /// recently used blocks first and then borrows from shards that are not
+  /// currently locked.  When the admission filter is enabled, each shard
+  /// keeps an approximate access frequency for recently requested blocks
+  /// (TinyLFU) and a new block only displaces blocks that are requested
+  /// less often than itself, so a large scan cannot flush the working set.
   class FileBlockCache {
 
     static std::atomic<int> ms_next_file_id;
 
   public:
-    FileBlockCache(int64_t min_memory, int64_t max_memory, bool compressed)
-      : m_min_memory(min_memory), m_max_memory(max_memory), m_limit(max_memory),
-	m_available(max_memory), m_accesses(0), m_hits(0), m_compressed(compressed)
-    { HT_ASSERT(min_memory <= max_memory); }
+
+    /// Per-shard statistics.
+    struct ShardStats {
+      /// Number of checkout() and contains() calls
+      uint64_t accesses {};
+      /// Number of accesses that found the block
+      uint64_t hits {};
+      /// Number of blocks inserted
+      uint64_t inserts {};
+      /// Number of blocks evicted
+      uint64_t evictions {};
+      /// Number of blocks refused by the admission filter or memory limit
+      uint64_t rejections {};
+      /// Amount of memory held by blocks in the shard
+      int64_t memory_used {};
+    };
+
+    /// Constructor.
+    /// @param min_memory Minimum memory limit
+    /// @param max_memory Maximum memory limit
+    /// @param compressed Cache holds compressed blocks
+    /// @param shard_count Number of independently locked shards
+    /// @param admission_filter Enable frequency based (TinyLFU) admission
+    FileBlockCache(int64_t min_memory, int64_t max_memory, bool compressed,
+                   size_t shard_count=1, bool admission_filter=false);
     ~FileBlockCache();
 
     bool compressed() { return m_compressed; }
@@ -107,9 +139,15 @@ namespace Hypertable {
     }
     void get_stats(uint64_t *max_memoryp, uint64_t *available_memoryp,
                    uint64_t *accessesp, uint64_t *hitsp);
-  private:
 
-    int64_t make_room(int64_t amount);
+    /// Gets statistics for each shard.
+    /// @param stats Vector filled in with one entry per shard
+    void get_shard_stats(std::vector<ShardStats> &stats);
+
+    /// Returns number of shards.
+    size_t shard_count() const { return m_shard_count; }
+
+  private:
 
     inline static int64_t make_key(int file_id, uint64_t file_offset) {
       HT_ASSERT(file_id < 268435456LL);        // Can't be larger than 2^28
@@ -117,6 +155,17 @@ namespace Hypertable {
       return ((int64_t)file_id << 36) | (int64_t)file_offset;
     }
 
+    /// Mixes bits of cache key (MurmurHash3 finalizer).
+    inline static uint64_t hash_key(int64_t key) {
+      uint64_t h = (uint64_t)key;
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return h;
+    }
+
     class BlockCacheEntry {
     public:
       BlockCacheEntry() { }
@@ -132,6 +181,12 @@ namespace Hypertable {
       int64_t key() const { return FileBlockCache::make_key(file_id, file_offset); }
     };
 
+    struct IncrementRefCount {
+      void operator()(BlockCacheEntry &entry) {
+        entry.ref_count++;
+      }
+    };
+
     struct DecrementRefCount {
       void operator()(BlockCacheEntry &entry) {
         entry.ref_count--;
@@ -156,14 +211,82 @@ namespace Hypertable {
     typedef BlockCache::nth_index<0>::type Sequence;
     typedef BlockCache::nth_index<1>::type HashIndex;
 
+    /// Count-Min sketch of 4-bit access counters.
+    /// Counters are halved every 10 * width increments so that the estimate
+    /// reflects recent history.
+    class FrequencySketch {
+    public:
+      /// Constructor.
+      /// @param width Number of counters per row (rounded up to a power of 2)
+      FrequencySketch(size_t width);
+      /// Records an access.
+      /// @param hash Hash of key accessed
+      void increment(uint64_t hash);
+      /// Returns estimated number of recent accesses.
+      /// @param hash Hash of key
+      /// @return Estimated access count (0 - 15)
+      uint32_t frequency(uint64_t hash) const;
+    private:
+      static const int DEPTH = 4;
+      /// Returns index of counter for <code>hash</code> in row
+      /// <code>row</code>.  Each row uses multiply-shift hashing with its
+      /// own multiplier so that keys colliding in one row are unlikely to
+      /// collide in the others.
+      size_t index(uint64_t hash, int row) const {
+        static const uint64_t multipliers[DEPTH] = {
+          0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL,
+          0x9ae16a3b2f90404fULL, 0x9e3779b97f4a7c15ULL };
+        return row * m_width + ((hash * multipliers[row]) >> m_shift);
+      }
+      /// Counters, DEPTH rows of m_width 4-bit counters
+      std::vector<uint64_t> m_table;
+      /// Counters per row
+      size_t m_width {};
+      /// 64 - log2(m_width)
+      int m_shift {};
+      /// Increments since last halving
+      size_t m_additions {};
+    };
+
+    /// Cache shard.
+    struct Shard {
+      Shard(size_t sketch_width) : sketch(sketch_width) { }
+      std::mutex mutex;
+      BlockCache cache;
+      FrequencySketch sketch;
+      ShardStats stats;
+    };
+
+    /// Returns index of shard responsible for key with hash <code>hash</code>.
+    size_t shard_index(uint64_t hash) const {
+      return (hash >> 32) % m_shard_count;
+    }
+
+    /// Evicts unreferenced blocks from a shard in LRU order.
+    /// Stops once <code>amount</code> bytes have been freed or a block that
+    /// is accessed more often than <code>frequency</code> is reached.  The
+    /// shard mutex must be locked by the caller.
+    /// @param shard Shard from which to evict
+    /// @param amount Amount of memory to free
+    /// @param frequency Estimated access frequency of the block that needs
+    /// the room, or UINT32_MAX to evict unconditionally
+    /// @return Amount of memory freed
+    int64_t make_room(Shard &shard, int64_t amount, uint32_t frequency);
+
+    /// Reserves memory for a block.
+    /// @param length Amount of memory to reserve
+    /// @param grow Raise limit (up to max memory) if not enough available
+    /// @return <i>true</i> if memory was reserved, <i>false</i> otherwise
+    bool reserve(int64_t length, bool grow);
+
     std::mutex m_mutex;
-    BlockCache    m_cache;
+    std::unique_ptr<std::unique_ptr<Shard>[]> m_shards;
+    size_t       m_shard_count;
+    bool         m_admission_filter;
     int64_t      m_min_memory;
     int64_t      m_max_memory;
     int64_t      m_limit;
     int64_t      m_available;
-    uint64_t     m_accesses;
-    uint64_t     m_hits;
     bool         m_compressed;
   };
 
@@ -22,8 +22,181 @@
 #include "Common/Compat.h"
 #include "FillScanBlock.h"
 
+#include <Hypertable/Lib/ScanAggregate.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
 namespace Hypertable {
 
+  namespace {
+
+    /// Cells an aggregate is evaluated over.
+    struct AggregateColumn {
+      /// Column family code, or -1 to count rows (COUNT(*))
+      int family {-1};
+      /// Column qualifier to match, or 0 to match any qualifier
+      const char *qualifier {};
+      /// Length of #qualifier
+      size_t qualifier_len {};
+    };
+
+    /// Estimated encoded size of the partial result of one aggregate,
+    /// excluding the group key
+    const int64_t AGGREGATE_RESULT_SIZE = 40;
+
+    /// Fills a block with partial aggregate results.
+    /// Evaluates the aggregates of the scan specification over the cells
+    /// pulled from <code>scanner</code>, grouping them by row prefix, and
+    /// serializes the partial result of each group and aggregate as a
+    /// key/value pair into <code>dbuf</code>.  The key row is the group key,
+    /// its column family code is the aggregate index plus one, and the value
+    /// is an encoded AggregateValue.  Counter values have already been
+    /// accumulated by MergeScannerAccessGroup and are aggregated as
+    /// integers.  Once the estimated size of the results, or the number of
+    /// bytes scanned to produce them, reaches <code>buffer_size</code>, the
+    /// block is cut at the next row boundary so that every row is aggregated
+    /// in exactly one block.  Cutting on bytes scanned bounds the work done
+    /// per block as FillScanBlock does, even when all cells fall into a
+    /// handful of groups.
+    /// @param scanner Scanner frome which cells are to be obtained
+    /// @param dbuf Buffer to hold encoded results
+    /// @param cell_count Address of variable to hold number of results in
+    /// the scan block.
+    /// @param buffer_size Target size of scan block
+    /// @return <i>true</i> if there are more cells to be pulled from the
+    /// scanner when this function returns, <i>false</i> otherwise.
+    bool FillScanBlockAggregates(MergeScannerRangePtr &scanner,
+                                 DynamicBuffer &dbuf, uint32_t *cell_count,
+                                 int64_t buffer_size) {
+      Key key;
+      ByteString value;
+      bool more = true;
+      uint8_t *ptr;
+      ScanContext *scan_context = scanner->scan_context();
+      const ScanSpec *spec = scan_context->spec;
+      std::vector<AggregateColumn> columns(spec->aggregates.size());
+      std::vector<uint8_t> functions;
+      AggregateGroups groups;
+      size_t prefix_len = (size_t)spec->group_by_row_prefix;
+      size_t group_len, group_count;
+      int64_t estimated_size = 0;
+      int64_t input_bytes = scanner->get_input_bytes();
+      std::string last_row;
+      bool have_row = false;
+      bool new_row;
+
+      assert(dbuf.base == 0);
+
+      for (size_t i=0; i<spec->aggregates.size(); i++) {
+        const ScanAggregate &sa = spec->aggregates[i];
+        functions.push_back(sa.function);
+        if (sa.column == 0 || *sa.column == 0)
+          continue;
+        const char *colon = strchr(sa.column, ':');
+        std::string family = colon ? std::string(sa.column, colon-sa.column) :
+          std::string(sa.column);
+        ColumnFamilySpec *cf_spec =
+          scan_context->schema->get_column_family(family);
+        if (cf_spec == 0)
+          HT_THROWF(Error::RANGESERVER_INVALID_COLUMNFAMILY,
+                    "Unknown aggregate column family '%s'", family.c_str());
+        columns[i].family = cf_spec->get_id();
+        if (colon) {
+          columns[i].qualifier = colon + 1;
+          columns[i].qualifier_len = strlen(colon + 1);
+        }
+      }
+      groups.set_functions(functions);
+
+      while ((more = scanner->get(key, value))) {
+
+        if (key.flag != FLAG_INSERT) {
+          scanner->forward();
+          continue;
+        }
+
+        new_row = !have_row || last_row.compare(key.row) != 0;
+        if (new_row) {
+          if (estimated_size >= buffer_size ||
+              scanner->get_input_bytes() - input_bytes >= buffer_size)
+            break;
+          last_row = key.row;
+          have_row = true;
+        }
+
+        group_len = prefix_len ? std::min(prefix_len, (size_t)key.row_len) : 0;
+        group_count = groups.size();
+        std::vector<AggregateValue> &values = groups.get(key.row, group_len);
+        if (groups.size() != group_count)
+          estimated_size += functions.size() *
+            (group_len + AGGREGATE_RESULT_SIZE);
+
+        for (size_t i=0; i<columns.size(); i++) {
+
+          // COUNT(*) counts rows
+          if (columns[i].family == -1) {
+            if (new_row)
+              values[i].add(functions[i], (int64_t)1);
+            continue;
+          }
+
+          if (key.column_family_code != columns[i].family)
+            continue;
+
+          if (columns[i].qualifier &&
+              (key.column_qualifier_len != columns[i].qualifier_len ||
+               memcmp(key.column_qualifier, columns[i].qualifier,
+                      columns[i].qualifier_len)))
+            continue;
+
+          const uint8_t *decode;
+          size_t remain = value.decode_length(&decode);
+
+          if (scan_context->cell_predicates[key.column_family_code].counter) {
+            // value must be encoded 64 bit int followed by '=' character
+            if (remain != 9)
+              HT_FATAL_OUT << "Expected counter to be encoded 64 bit int but remain=" << remain
+                           << " ,key=" << key << HT_END;
+            values[i].add(functions[i], Serialization::decode_i64(&decode, &remain));
+          }
+          else
+            values[i].add(functions[i], (const char *)decode, remain);
+        }
+
+        scanner->forward();
+      }
+
+      dbuf.reserve(4 + estimated_size);
+      // skip encoded length
+      dbuf.ptr = dbuf.base + 4;
+
+      uint8_t result_buf[32];
+      for (const auto &entry : groups.groups()) {
+        for (size_t i=0; i<functions.size(); i++) {
+          const AggregateValue &result = entry.second[i];
+          if (result.count == 0)
+            continue;
+          create_key_and_append(dbuf, FLAG_INSERT, entry.first.c_str(),
+                                (uint8_t)(i+1), "");
+          HT_ASSERT(result.encoded_length() <= sizeof(result_buf));
+          ptr = result_buf;
+          result.encode(&ptr);
+          append_as_byte_string(dbuf, result_buf, ptr - result_buf);
+          if (cell_count)
+            (*cell_count)++;
+        }
+      }
+
+      ptr = dbuf.base;
+      Serialization::encode_i32(&ptr, dbuf.fill() - 4);
+
+      return more;
+    }
+
+  }
+
   bool
   FillScanBlock(MergeScannerRangePtr &scanner, DynamicBuffer &dbuf,
                 uint32_t *cell_count, int64_t buffer_size) {
@@ -41,6 +214,9 @@ namespace Hypertable {
     bool counter;
     String empty_value("");
 
+    if (!scan_context->spec->aggregates.empty())
+      return FillScanBlockAggregates(scanner, dbuf, cell_count, buffer_size);
+
     assert(dbuf.base == 0);
 
     while ((more = scanner->get(key, value))) {
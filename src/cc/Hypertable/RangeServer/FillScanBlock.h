@@ -43,7 +43,10 @@ namespace Hypertable {
   /// <code>buffer_size</code>.  If the KEYS_ONLY predicate is specified in the
   /// scan specification, then an empty value is encoded for each key/value
   /// pair.  For each key representing a COUNTER, the value is an encoded
-  /// 64-bit integer and is converted to an ASCII value.
+  /// 64-bit integer and is converted to an ASCII value.  If the scan
+  /// specification has aggregates, the block is instead filled with the
+  /// partial aggregate results of the cells pulled from <code>scanner</code>,
+  /// one key/value pair per group and aggregate.
   /// @param scanner Scanner frome which results are to be obtained
   /// @param dbuf Buffer to hold encoded results
   /// @param cell_count Address of variable to hold number of cells in the scan
@@ -33,6 +33,8 @@ namespace Hypertable {
   SessionPtr             Global::hyperspace = 0;
   FilesystemPtr          Global::dfs;
   FilesystemPtr          Global::log_dfs;
+  FilesystemPtr          Global::unscheduled_dfs;
+  IOSchedulerPtr         Global::io_scheduler;
   ApplicationQueuePtr    Global::app_queue;
   MaintenanceQueuePtr    Global::maintenance_queue;
   Lib::Master::ClientPtr        Global::master_client;
@@ -58,6 +60,7 @@ namespace Hypertable {
   int32_t                Global::access_group_garbage_compaction_threshold = 0;
   int32_t                Global::access_group_max_mem = 0;
   int32_t                Global::cell_cache_scanner_cache_size = 0;
+  int32_t                Global::scanner_prefetch_depth = 0;
   FileBlockCache        *Global::block_cache = 0;
   TablePtr               Global::metadata_table = 0;
   TablePtr               Global::rs_metrics_table = 0;
@@ -67,6 +70,7 @@ namespace Hypertable {
   int64_t                Global::log_prune_threshold_max = 0;
   int64_t                Global::cellstore_target_size_min = 0;
   int64_t                Global::cellstore_target_size_max = 0;
+  int32_t                Global::compaction_parallelism = 1;
   int64_t                Global::memory_limit = 0;
   int64_t                Global::memory_limit_ensure_unused = 0;
   int64_t                Global::memory_limit_ensure_unused_current = 0;
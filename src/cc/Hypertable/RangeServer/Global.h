@@ -43,6 +43,7 @@
 #include "Hypertable/Lib/TableIdentifier.h"
 
 #include "FileBlockCache.h"
+#include "IOScheduler.h"
 #include "LoadStatistics.h"
 #include "LocationInitializer.h"
 #include "MaintenanceQueue.h"
@@ -63,6 +64,10 @@ namespace Hypertable {
     static Hyperspace::SessionPtr hyperspace;
     static Hypertable::FilesystemPtr dfs;
     static Hypertable::FilesystemPtr log_dfs;
+    /// Broker of #dfs without I/O scheduling, for log writes that may be
+    /// issued while holding range or metalog locks
+    static Hypertable::FilesystemPtr unscheduled_dfs;
+    static IOSchedulerPtr io_scheduler;
     static Hypertable::ApplicationQueuePtr app_queue;
     static Hypertable::MaintenanceQueuePtr maintenance_queue;
     static Hypertable::Lib::Master::ClientPtr master_client;
@@ -87,6 +92,7 @@ namespace Hypertable {
     static int32_t        access_group_garbage_compaction_threshold;
     static int32_t        access_group_max_mem;
     static int32_t        cell_cache_scanner_cache_size;
+    static int32_t        scanner_prefetch_depth;
     static Hypertable::FileBlockCache *block_cache;
     static TablePtr       metadata_table;
     static TablePtr       rs_metrics_table;
@@ -96,6 +102,7 @@ namespace Hypertable {
     static int64_t        log_prune_threshold_max;
     static int64_t        cellstore_target_size_min;
     static int64_t        cellstore_target_size_max;
+    static int32_t        compaction_parallelism;
     static int64_t        memory_limit;
     // amount of unused physical memory to achieve according
     // to the configuration
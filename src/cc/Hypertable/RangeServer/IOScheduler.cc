@@ -0,0 +1,163 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for IOScheduler.
+/// This file contains method definitions for IOScheduler, a class that
+/// classifies filesystem I/O as foreground or background and rate limits
+/// background I/O.
+
+#include <Common/Compat.h>
+
+#include "IOScheduler.h"
+
+#include <Common/Logger.h>
+
+#include <algorithm>
+#include <thread>
+
+using namespace Hypertable;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+  /// I/O class of current thread
+  thread_local IOScheduler::Priority current_priority {IOScheduler::Priority::FOREGROUND};
+
+  /// Seconds worth of tokens the bucket can accumulate while idle
+  const double BURST_SECONDS = 0.25;
+
+}
+
+IOScheduler::BackgroundScope::BackgroundScope() : m_saved(current_priority) {
+  current_priority = Priority::BACKGROUND;
+}
+
+IOScheduler::BackgroundScope::~BackgroundScope() {
+  current_priority = m_saved;
+}
+
+
+IOScheduler::IOScheduler(int64_t rate, int64_t minimum_rate,
+                         int64_t target_latency, int32_t adjust_interval)
+  : m_max_rate(rate), m_min_rate(std::min(minimum_rate, rate)),
+    m_target_latency(target_latency),
+    m_adjust_interval(adjust_interval), m_rate(rate) {
+  m_last_refill = m_last_adjust = steady_clock::now();
+  m_tokens = (double)rate * BURST_SECONDS;
+}
+
+
+IOScheduler::Priority IOScheduler::priority() {
+  return current_priority;
+}
+
+
+void IOScheduler::begin_read(size_t len) {
+  if (current_priority == Priority::BACKGROUND) {
+    m_background_read_bytes += len;
+    acquire(len);
+  }
+}
+
+
+void IOScheduler::record_foreground_read(size_t len,
+                                         steady_clock::duration latency) {
+  m_foreground_read_bytes += len;
+  m_foreground_read_latency += duration_cast<microseconds>(latency).count();
+  m_foreground_reads++;
+}
+
+
+void IOScheduler::begin_append(size_t len) {
+  if (current_priority == Priority::BACKGROUND) {
+    m_background_write_bytes += len;
+    acquire(len);
+  }
+  else
+    m_foreground_write_bytes += len;
+}
+
+
+void IOScheduler::get_stats(Stats &stats) {
+  stats.foreground_reads = m_foreground_reads;
+  stats.foreground_read_bytes = m_foreground_read_bytes;
+  stats.foreground_read_latency = m_foreground_read_latency;
+  stats.foreground_write_bytes = m_foreground_write_bytes;
+  stats.background_read_bytes = m_background_read_bytes;
+  stats.background_write_bytes = m_background_write_bytes;
+  stats.background_throttle_time = m_background_throttle_time;
+  stats.background_rate = m_rate;
+}
+
+
+void IOScheduler::acquire(size_t len) {
+  if (m_max_rate <= 0)
+    return;
+
+  double wait_seconds {};
+  {
+    lock_guard<mutex> lock(m_mutex);
+    auto now = steady_clock::now();
+
+    if (m_target_latency && now - m_last_adjust >= m_adjust_interval)
+      adjust_rate(now);
+
+    double rate = (double)m_rate.load();
+    m_tokens += duration<double>(now - m_last_refill).count() * rate;
+    m_tokens = std::min(m_tokens, rate * BURST_SECONDS);
+    m_last_refill = now;
+
+    m_tokens -= (double)len;
+    if (m_tokens < 0)
+      wait_seconds = -m_tokens / rate;
+  }
+
+  if (wait_seconds > 0) {
+    auto wait = duration_cast<microseconds>(duration<double>(wait_seconds));
+    this_thread::sleep_for(wait);
+    m_background_throttle_time += wait.count();
+  }
+}
+
+
+void IOScheduler::adjust_rate(steady_clock::time_point now) {
+  uint64_t reads = m_foreground_reads - m_adjust_reads;
+  uint64_t latency = m_foreground_read_latency - m_adjust_latency;
+  m_adjust_reads += reads;
+  m_adjust_latency += latency;
+  m_last_adjust = now;
+
+  int64_t rate = m_rate;
+  if (reads && (int64_t)(latency / reads) > m_target_latency)
+    rate = std::max(m_min_rate, rate / 2);
+  else
+    rate = std::min(m_max_rate, rate + std::max((int64_t)1, m_max_rate / 10));
+
+  if (rate != m_rate) {
+    HT_DEBUGF("Background I/O rate adjusted from %lld to %lld bytes/s "
+              "(foreground reads=%llu, average latency=%lluus)",
+              (Lld)m_rate.load(), (Lld)rate, (Llu)reads,
+              (Llu)(reads ? latency / reads : 0));
+    m_rate = rate;
+  }
+}
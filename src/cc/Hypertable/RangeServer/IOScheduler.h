@@ -0,0 +1,221 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for IOScheduler.
+/// This file contains type declarations for IOScheduler, a class that
+/// classifies filesystem I/O as foreground or background and rate limits
+/// background I/O.
+
+#ifndef Hypertable_RangeServer_IOScheduler_h
+#define Hypertable_RangeServer_IOScheduler_h
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace Hypertable {
+
+  /// @addtogroup RangeServer
+  /// @{
+
+  /// Classifies and rate limits filesystem I/O.
+  /// Each thread is either in the foreground class (the default) or the
+  /// background class, which is entered for the lifetime of a
+  /// BackgroundScope object.  Maintenance tasks (compactions, splits,
+  /// relinquishes) run in the background class.  Background reads and
+  /// appends draw from a token bucket refilled at the current background
+  /// rate; a request larger than the available tokens puts the bucket into
+  /// debt and the requesting thread sleeps until the debt is repaid.
+  ///
+  /// When a foreground latency target is configured, the background rate
+  /// is adjusted once per adjustment interval: if the average latency of
+  /// the foreground reads completed during the interval exceeded the target,
+  /// the rate is halved (but not below the minimum rate), otherwise it grows
+  /// by a tenth of the configured rate (but not above it).
+  class IOScheduler {
+  public:
+
+    /// I/O class.
+    enum class Priority {
+      /// Latency sensitive I/O issued on behalf of clients
+      FOREGROUND,
+      /// Throughput oriented maintenance I/O
+      BACKGROUND
+    };
+
+    /// Cumulative I/O statistics.
+    struct Stats {
+      /// Number of foreground reads
+      uint64_t foreground_reads {};
+      /// Bytes read by foreground reads
+      uint64_t foreground_read_bytes {};
+      /// Total latency of foreground reads, in microseconds
+      uint64_t foreground_read_latency {};
+      /// Bytes appended in the foreground class
+      uint64_t foreground_write_bytes {};
+      /// Bytes read in the background class
+      uint64_t background_read_bytes {};
+      /// Bytes appended in the background class
+      uint64_t background_write_bytes {};
+      /// Time background I/O spent waiting for tokens, in microseconds
+      uint64_t background_throttle_time {};
+      /// Current background rate in bytes per second (0 if unlimited)
+      uint64_t background_rate {};
+    };
+
+    /// Places calling thread in background class for its lifetime.
+    class BackgroundScope {
+    public:
+      /// Constructor.
+      /// Saves the current class of the calling thread and switches it to
+      /// Priority::BACKGROUND.
+      BackgroundScope();
+      /// Destructor.
+      /// Restores the class saved by the constructor.
+      ~BackgroundScope();
+      BackgroundScope(const BackgroundScope &) = delete;
+      BackgroundScope &operator=(const BackgroundScope &) = delete;
+    private:
+      /// Saved class
+      Priority m_saved;
+    };
+
+    /// Constructor.
+    /// @param rate Background rate limit in bytes per second (0 disables
+    /// rate limiting)
+    /// @param minimum_rate Lower bound for adaptive rate adjustments in bytes
+    /// per second
+    /// @param target_latency Foreground read latency target in microseconds
+    /// (0 disables adaptive rate adjustments)
+    /// @param adjust_interval Rate adjustment interval in milliseconds
+    IOScheduler(int64_t rate, int64_t minimum_rate, int64_t target_latency,
+                int32_t adjust_interval=1000);
+
+    /// Returns I/O class of calling thread.
+    /// @return I/O class of calling thread
+    static Priority priority();
+
+    /// Accounts for a read about to be issued by calling thread.
+    /// If the calling thread is in the background class, waits for
+    /// <code>len</code> tokens.
+    /// @param len Number of bytes to be read
+    void begin_read(size_t len);
+
+    /// Accounts for a completed foreground read.
+    /// <code>latency</code> contributes to the latency average that drives
+    /// adaptive rate adjustments.  Since asynchronous reads complete on a
+    /// different thread than the one that issued them, the caller is
+    /// responsible for checking that the read was issued in the foreground
+    /// class.
+    /// @param len Number of bytes read
+    /// @param latency Time taken by read
+    void record_foreground_read(size_t len,
+                                std::chrono::steady_clock::duration latency);
+
+    /// Accounts for an append about to be issued by calling thread.
+    /// If the calling thread is in the background class, waits for
+    /// <code>len</code> tokens.
+    /// @param len Number of bytes to be appended
+    void begin_append(size_t len);
+
+    /// Returns cumulative I/O statistics.
+    /// @param stats Filled in with statistics
+    void get_stats(Stats &stats);
+
+  private:
+
+    /// Waits for background tokens.
+    /// Refills the bucket, adjusts the rate if an adjustment interval has
+    /// elapsed, takes <code>len</code> tokens and sleeps if the bucket went
+    /// into debt.
+    /// @param len Number of tokens to take
+    void acquire(size_t len);
+
+    /// Adjusts background rate from foreground latency of last interval.
+    /// Must be called with #m_mutex locked.
+    /// @param now Current time
+    void adjust_rate(std::chrono::steady_clock::time_point now);
+
+    /// %Mutex serializing access to token bucket
+    std::mutex m_mutex;
+
+    /// Configured background rate in bytes per second
+    const int64_t m_max_rate;
+
+    /// Minimum background rate in bytes per second
+    const int64_t m_min_rate;
+
+    /// Foreground read latency target in microseconds
+    const int64_t m_target_latency;
+
+    /// Rate adjustment interval
+    const std::chrono::milliseconds m_adjust_interval;
+
+    /// Current background rate in bytes per second
+    std::atomic<int64_t> m_rate;
+
+    /// Available tokens (negative when in debt)
+    double m_tokens {};
+
+    /// Time of last token refill
+    std::chrono::steady_clock::time_point m_last_refill;
+
+    /// Time of last rate adjustment
+    std::chrono::steady_clock::time_point m_last_adjust;
+
+    /// Foreground read count at last rate adjustment
+    uint64_t m_adjust_reads {};
+
+    /// Foreground read latency at last rate adjustment
+    uint64_t m_adjust_latency {};
+
+    /// Number of foreground reads
+    std::atomic<uint64_t> m_foreground_reads {0};
+
+    /// Bytes read in foreground class
+    std::atomic<uint64_t> m_foreground_read_bytes {0};
+
+    /// Total foreground read latency in microseconds
+    std::atomic<uint64_t> m_foreground_read_latency {0};
+
+    /// Bytes appended in foreground class
+    std::atomic<uint64_t> m_foreground_write_bytes {0};
+
+    /// Bytes read in background class
+    std::atomic<uint64_t> m_background_read_bytes {0};
+
+    /// Bytes appended in background class
+    std::atomic<uint64_t> m_background_write_bytes {0};
+
+    /// Time spent waiting for tokens in microseconds
+    std::atomic<uint64_t> m_background_throttle_time {0};
+  };
+
+  /// Smart pointer to IOScheduler
+  typedef std::shared_ptr<IOScheduler> IOSchedulerPtr;
+
+  /// @}
+}
+
+#endif // Hypertable_RangeServer_IOScheduler_h
@@ -49,11 +49,11 @@ LiveFileTracker::LiveFileTracker(const TableIdentifier *identifier,
 
 }
 
-void LiveFileTracker::update_live(const String &add, std::vector<String> &deletes, uint32_t nextcsid, int64_t total_blocks) {
+void LiveFileTracker::update_live(const std::vector<String> &adds, std::vector<String> &deletes, uint32_t nextcsid, int64_t total_blocks) {
   lock_guard<mutex> lock(m_mutex);
   for (size_t i=0; i<deletes.size(); i++)
     m_live.erase(strip_basename(deletes[i]));
-  if (add != "")
+  for (auto &add : adds)
     m_live.insert(strip_basename(add));
   m_cur_nextcsid = nextcsid;
   m_total_blocks = total_blocks;
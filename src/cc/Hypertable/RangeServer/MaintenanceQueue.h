@@ -26,6 +26,7 @@
 #ifndef Hypertable_RangeServer_MaintenanceQueue_h
 #define Hypertable_RangeServer_MaintenanceQueue_h
 
+#include "IOScheduler.h"
 #include "MaintenanceTask.h"
 #include "MaintenanceTaskMemoryPurge.h"
 
@@ -148,6 +149,7 @@ namespace Hypertable {
             if (m_state.shutdown)
               return;
 
+            IOScheduler::BackgroundScope background;
             task->execute();
 
           }
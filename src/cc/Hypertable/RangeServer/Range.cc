@@ -54,6 +54,7 @@
 
 #include <re2/re2.h>
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <string>
@@ -762,7 +763,7 @@ void Range::relinquish_install_log() {
   {
     Barrier::ScopedActivator block_updates(m_update_barrier);
     lock_guard<mutex> lock(m_mutex);
-    m_transfer_log = make_shared<CommitLog>(Global::dfs, logname, !m_table.is_user());
+    m_transfer_log = make_shared<CommitLog>(Global::unscheduled_dfs, logname, !m_table.is_user());
     for (size_t i=0; i<ag_vector.size(); i++)
       ag_vector[i]->stage_compaction();
   }
@@ -1076,7 +1077,7 @@ void Range::split_install_log() {
     m_split_row = split_row;
     for (size_t i=0; i<ag_vector.size(); i++)
       ag_vector[i]->stage_compaction();
-    m_transfer_log = make_shared<CommitLog>(Global::dfs, logname, !m_table.is_user());
+    m_transfer_log = make_shared<CommitLog>(Global::unscheduled_dfs, logname, !m_table.is_user());
   }
 
   HT_MAYBE_FAIL("split-1");
@@ -1435,6 +1436,12 @@ void Range::compact(MaintenanceFlag::Map &subtask_map) {
     deferred_initialization();
 
   RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
+
+  run_compaction(subtask_map);
+}
+
+
+void Range::run_compaction(MaintenanceFlag::Map &subtask_map) {
   AccessGroupVector ag_vector(0);
   int flags = 0;
   int state = m_metalog_entity->get_state();
@@ -1521,6 +1528,87 @@ void Range::compact(MaintenanceFlag::Map &subtask_map) {
 
 
 
+void Range::link_cellstores(const std::vector<String> &access_groups,
+                            const std::vector<String> &files) {
+
+  if (!m_initialized)
+    deferred_initialization();
+
+  AccessGroupVector ag_vector(0);
+
+  {
+    lock_guard<mutex> lock(m_schema_mutex);
+    for (auto &name : access_groups) {
+      auto iter = m_access_group_map.find(name);
+      if (iter == m_access_group_map.end())
+        HT_THROWF(Error::RANGESERVER_INVALID_COLUMNFAMILY,
+                  "Access group '%s' not found in range %s", name.c_str(),
+                  m_name.c_str());
+      ag_vector.push_back(iter->second);
+    }
+  }
+
+  RangeMaintenanceGuard::Activator activator(m_maintenance_guard);
+
+  if (m_metalog_entity->get_state() != RangeState::STEADY)
+    HT_THROWF(Error::RANGESERVER_RANGE_BUSY, "Range %s is in state %s",
+              m_name.c_str(),
+              RangeState::get_text(m_metalog_entity->get_state()).c_str());
+
+  // Persist cached updates so the linked files are newer than all of them
+  MaintenanceFlag::Map subtask_map;
+  for (auto &ag : ag_vector)
+    subtask_map[ag.get()] = MaintenanceFlag::COMPACT_MINOR;
+  run_compaction(subtask_map);
+
+  {
+    Barrier::ScopedActivator block_updates(m_update_barrier);
+    std::vector<CellStorePtr> cellstores(ag_vector.size());
+    std::vector<int64_t> revisions(ag_vector.size());
+    size_t prepared = 0;
+    int64_t latest_revision = TIMESTAMP_MIN;
+
+    // Validate all files before linking any, and unlink all of them if
+    // one can't be linked, so that the load is all or nothing
+    try {
+      for (; prepared<ag_vector.size(); prepared++)
+        revisions[prepared] =
+          ag_vector[prepared]->prepare_link_cellstore(files[prepared],
+                                                      cellstores[prepared]);
+      for (size_t i=0; i<ag_vector.size(); i++) {
+        ag_vector[i]->commit_link_cellstore(cellstores[i], revisions[i]);
+        latest_revision = std::max(latest_revision, revisions[i]);
+      }
+    }
+    catch (Exception &e) {
+      for (size_t i=0; i<prepared; i++)
+        ag_vector[i]->abort_link_cellstore(files[i], cellstores[i]);
+      throw;
+    }
+
+    // Updates let through the barrier are assigned newer revisions
+    lock_guard<mutex> lock(m_mutex);
+    if (latest_revision > m_latest_revision)
+      m_latest_revision = latest_revision;
+  }
+
+  {
+    lock_guard<mutex> lock(m_schema_mutex);
+    ag_vector = m_access_group_vector;
+  }
+  std::vector<AccessGroup::Hints> hints(ag_vector.size());
+  for (size_t i=0; i<ag_vector.size(); i++)
+    ag_vector[i]->load_hints(&hints[i]);
+  m_hints_file.set(hints);
+  m_hints_file.write(Global::location_initializer->get());
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_maintenance_generation++;
+  }
+}
+
+
 void Range::purge_memory(MaintenanceFlag::Map &subtask_map) {
 
   if (!m_initialized)
@@ -1579,13 +1667,13 @@ void Range::recovery_finalize() {
       (state & RangeState::RELINQUISH_LOG_INSTALLED)
       == RangeState::RELINQUISH_LOG_INSTALLED) {
     CommitLogReaderPtr commit_log_reader =
-      make_shared<CommitLogReader>(Global::dfs, m_metalog_entity->get_transfer_log());
+      make_shared<CommitLogReader>(Global::unscheduled_dfs, m_metalog_entity->get_transfer_log());
 
     replay_transfer_log(commit_log_reader.get());
 
     commit_log_reader = 0;
 
-    m_transfer_log = make_shared<CommitLog>(Global::dfs, m_metalog_entity->get_transfer_log(),
+    m_transfer_log = make_shared<CommitLog>(Global::unscheduled_dfs, m_metalog_entity->get_transfer_log(),
                                    !m_table.is_user());
 
     // re-initiate compaction
@@ -189,6 +189,21 @@ namespace Hypertable {
 
     void compact(MaintenanceFlag::Map &subtask_map);
 
+    /// Links externally built CellStore files into access groups.
+    /// With maintenance blocked, first runs a minor compaction of each target
+    /// access group so that no update held only in the commit log has a
+    /// revision older than the linked files.  Then, with updates blocked,
+    /// prepares every file with AccessGroup::prepare_link_cellstore() before
+    /// committing any of them, so that either all files are linked or none
+    /// are.  Finally raises the latest revision of the range to that of the
+    /// linked files so that subsequent updates are assigned newer revisions,
+    /// and rewrites the hints file.
+    /// @param access_groups Access group names
+    /// @param files Absolute pathnames of CellStore files, one per entry of
+    /// <code>access_groups</code>
+    void link_cellstores(const std::vector<String> &access_groups,
+                         const std::vector<String> &files);
+
     void purge_memory(MaintenanceFlag::Map &subtask_map);
 
     void schedule_relinquish() { m_relinquish = true; }
@@ -343,6 +358,11 @@ namespace Hypertable {
 
     bool cancel_maintenance();
 
+    /// Runs compactions of compact(); the caller must hold the maintenance
+    /// guard.
+    /// @param subtask_map Maintenance subtask map
+    void run_compaction(MaintenanceFlag::Map &subtask_map);
+
     void relinquish_install_log();
     void relinquish_compact();
     void relinquish_finalize();
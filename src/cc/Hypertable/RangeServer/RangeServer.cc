@@ -45,7 +45,9 @@
 #include <Hypertable/RangeServer/MetaLogEntityRemoveOkLogs.h>
 #include <Hypertable/RangeServer/MetaLogEntityTask.h>
 #include <Hypertable/RangeServer/ReplayBuffer.h>
+#include <Hypertable/RangeServer/ReplayPipeline.h>
 #include <Hypertable/RangeServer/ScanContext.h>
+#include <Hypertable/RangeServer/ScheduledFilesystem.h>
 
 #include <Hypertable/Lib/ClusterId.h>
 #include <Hypertable/Lib/CommitLog.h>
@@ -57,8 +59,10 @@
 #include <Hypertable/Lib/PseudoTables.h>
 #include <Hypertable/Lib/RangeServer/Protocol.h>
 #include <Hypertable/Lib/RangeServerRecovery/ReceiverPlan.h>
+#include <Hypertable/Lib/ScanBlock.h>
 
 #include <FsBroker/Lib/Client.h>
+#include <FsBroker/Lib/LocalReadClient.h>
 
 #include <Common/FailureInducer.h>
 #include <Common/FileUtils.h>
@@ -145,6 +149,7 @@ Apps::RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_
   Global::cellstore_target_size_max = cfg.get_i64("CellStore.TargetSize.Maximum");
   Global::pseudo_tables = PseudoTables::instance();
   m_scanner_buffer_size = cfg.get_i64("Scanner.BufferSize");
+  m_scan_block_prefiller = make_shared<ScanBlockPrefiller>(m_props);
   port = cfg.get_i16("Port");
 
   m_control_file_check_interval = cfg.get_i32("ControlFile.CheckInterval");
@@ -171,6 +176,9 @@ Apps::RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_
     HT_INFOF("drive count = %d, maintenance threads = %d", disk_count, maintenance_threads);
   }
 
+  Global::compaction_parallelism =
+    cfg.get_i32("Maintenance.MajorCompaction.Parallelism", (int32_t)m_cores);
+
   Global::toplevel_dir = props->get_str("Hypertable.Directory");
   boost::trim_if(Global::toplevel_dir, boost::is_any_of("/"));
   Global::toplevel_dir = String("/") + Global::toplevel_dir;
@@ -203,6 +211,8 @@ Apps::RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_
   Global::cell_cache_scanner_cache_size =
     cfg.get_i32("AccessGroup.CellCache.ScannerCacheSize");
 
+  Global::scanner_prefetch_depth = cfg.get_i32("Scanner.PrefetchDepth");
+
   if (m_scanner_ttl < (time_t)10000) {
     HT_WARNF("Value %u for Hypertable.RangeServer.Scanner.ttl is too small, "
              "setting to 10000", (unsigned int)m_scanner_ttl);
@@ -243,7 +253,9 @@ Apps::RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_
 
   if (block_cache_max > 0)
     Global::block_cache = new FileBlockCache(block_cache_min, block_cache_max,
-                        cfg.get_bool("BlockCache.Compressed"));
+                        cfg.get_bool("BlockCache.Compressed"),
+                        cfg.get_i32("BlockCache.Shards"),
+                        cfg.get_bool("BlockCache.AdmissionFilter"));
 
   int64_t query_cache_memory = cfg.get_i64("QueryCache.MaxMemory");
   if (query_cache_memory > 0) {
@@ -258,7 +270,11 @@ Apps::RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_
 
   Global::memory_tracker = new MemoryTracker(Global::block_cache, m_query_cache);
 
-  FsBroker::Lib::ClientPtr dfsclient = std::make_shared<FsBroker::Lib::Client>(conn_mgr, props);
+  FsBroker::Lib::ClientPtr dfsclient;
+  if (props->get_bool("FsBroker.Local.MappedReads"))
+    dfsclient = std::make_shared<FsBroker::Lib::LocalReadClient>(conn_mgr, props);
+  else
+    dfsclient = std::make_shared<FsBroker::Lib::Client>(conn_mgr, props);
 
   int dfs_timeout;
   if (props->has("FsBroker.Timeout"))
@@ -269,7 +285,15 @@ Apps::RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_
   if (!dfsclient->wait_for_connection(dfs_timeout))
     HT_THROW(Error::REQUEST_TIMEOUT, "connecting to FS Broker");
 
-  Global::dfs = dfsclient;
+  // Route cell store I/O through the I/O scheduler, which rate limits
+  // maintenance reads and appends.  Commit logs and the RSML bypass it, since
+  // they are written while holding range and metalog locks.
+  Global::unscheduled_dfs = dfsclient;
+  Global::io_scheduler =
+    make_shared<IOScheduler>((int64_t)cfg.get_i32("IO.Background.Rate") * Property::MiB,
+                             (int64_t)cfg.get_i32("IO.Background.MinimumRate") * Property::MiB,
+                             (int64_t)cfg.get_i32("IO.Foreground.TargetLatency") * 1000);
+  Global::dfs = make_shared<ScheduledFilesystem>(dfsclient, Global::io_scheduler);
 
   m_log_roll_limit = cfg.get_i64("CommitLog.RollLimit");
 
@@ -289,7 +313,7 @@ Apps::RangeServer::RangeServer(PropertiesPtr &props, ConnectionManagerPtr &conn_
     Global::log_dfs = dfsclient;
   }
   else
-    Global::log_dfs = Global::dfs;
+    Global::log_dfs = Global::unscheduled_dfs;
 
   // Create the maintenance queue
   Global::maintenance_queue = make_shared<MaintenanceQueue>(maintenance_threads);
@@ -420,6 +444,8 @@ void Apps::RangeServer::shutdown() {
     if (m_group_commit_timer_handler)
       m_group_commit_timer_handler->shutdown();
 
+    m_scan_block_prefiller->shutdown();
+
     // Kill update pipelines
     m_update_pipeline_user->shutdown();
     if (m_update_pipeline_system)
@@ -460,6 +486,7 @@ void Apps::RangeServer::shutdown() {
     Global::rs_metrics_table = 0;
     Global::hyperspace = 0;
     Global::log_dfs = 0;
+    Global::unscheduled_dfs = 0;
     Global::dfs = 0;
     delete Global::memory_tracker;
     Global::memory_tracker = 0;
@@ -1426,7 +1453,8 @@ Apps::RangeServer::metadata_sync(ResponseCallback *cb, const char *table_id,
 void
 Apps::RangeServer::create_scanner(Response::Callback::CreateScanner *cb,
         const TableIdentifier &table, const RangeSpec &range_spec,
-        const ScanSpec &scan_spec, QueryCache::Key *cache_key) {
+        const ScanSpec &scan_spec, uint8_t scan_block_encoding,
+        QueryCache::Key *cache_key) {
   int error = Error::OK;
   String errmsg;
   TableInfoPtr table_info;
@@ -1438,6 +1466,7 @@ Apps::RangeServer::create_scanner(Response::Callback::CreateScanner *cb,
   ScanContextPtr scan_ctx;
   ProfileDataScanner profile_data;
   bool decrement_needed=false;
+  bool aggregated = !scan_spec.aggregates.empty();
 
   //HT_DEBUG_OUT <<"Creating scanner:\n"<< *table << *range_spec
   //<< *scan_spec << HT_END;
@@ -1505,7 +1534,9 @@ Apps::RangeServer::create_scanner(Response::Callback::CreateScanner *cb,
       uint32_t ext_len;
       uint32_t cell_count;
       if (m_query_cache->lookup(cache_key, ext_buffer, &ext_len, &cell_count)) {
-        if ((error = cb->response(id, 0, 0, false, profile_data, ext_buffer, ext_len))
+        if ((error = cb->response(id, 0, 0, false, profile_data,
+                                  scan_block_encoding, aggregated,
+                                  ext_buffer, ext_len))
                 != Error::OK)
           HT_ERRORF("Problem sending OK response - %s", Error::get_text(error));
         range->decrement_scan_counter();
@@ -1518,6 +1549,7 @@ Apps::RangeServer::create_scanner(Response::Callback::CreateScanner *cb,
     scan_ctx = make_shared<ScanContext>(range->get_scan_revision(cb->event()->header.timeout_ms),
                                &scan_spec, &range_spec, schema, &columns);
     scan_ctx->timeout_ms = cb->event()->header.timeout_ms;
+    scan_ctx->scan_block_encoding = scan_block_encoding;
 
     range->create_scanner(scan_ctx, scanner);
 
@@ -1527,6 +1559,7 @@ Apps::RangeServer::create_scanner(Response::Callback::CreateScanner *cb,
     uint32_t cell_count {};
 
     more = FillScanBlock(scanner, rbuf, &cell_count, m_scanner_buffer_size);
+    ScanBlock::encode(scan_block_encoding, rbuf);
 
     profile_data.cells_scanned = scanner->get_input_cells();
     profile_data.cells_returned = scanner->get_output_cells();
@@ -1555,7 +1588,13 @@ Apps::RangeServer::create_scanner(Response::Callback::CreateScanner *cb,
 
     if (more) {
       scan_ctx->deep_copy_specs();
-      id = m_scanner_map.put(scanner, range, table, profile_data);
+      ScanBlockPrefillPtr prefill;
+      if (m_scan_block_prefiller->enabled())
+        prefill = make_shared<ScanBlockPrefill>(m_scan_block_prefiller.get(),
+                                                scanner, m_scanner_buffer_size);
+      id = m_scanner_map.put(scanner, range, table, profile_data, prefill);
+      if (prefill)
+        m_scan_block_prefiller->schedule(prefill);
     }
     else {
       id = 0;
@@ -1585,14 +1624,16 @@ Apps::RangeServer::create_scanner(Response::Callback::CreateScanner *cb,
       m_query_cache->insert(cache_key, tablename_ptr, row_key_ptr,
                             columns, cell_count, ext_buffer, rbuf.fill());
       if ((error = cb->response(id, skipped_rows, skipped_cells, false,
-                                profile_data, ext_buffer, rbuf.fill())) != Error::OK) {
+                                profile_data, scan_block_encoding, aggregated,
+                                ext_buffer, rbuf.fill())) != Error::OK) {
         HT_ERRORF("Problem sending OK response - %s", Error::get_text(error));
       }
     }
     else {
       StaticBuffer ext(rbuf);
       if ((error = cb->response(id, skipped_rows, skipped_cells, more,
-                                profile_data, ext)) != Error::OK) {
+                                profile_data, scan_block_encoding, aggregated,
+                                ext)) != Error::OK) {
         HT_ERRORF("Problem sending OK response - %s", Error::get_text(error));
       }
     }
@@ -1633,12 +1674,14 @@ Apps::RangeServer::fetch_scanblock(Response::Callback::CreateScanner *cb,
   SchemaPtr schema;
   ProfileDataScanner profile_data_before;
   ProfileDataScanner profile_data;
+  ScanBlockPrefillPtr prefill;
 
   HT_DEBUG_OUT <<"Scanner ID = " << scanner_id << HT_END;
 
   try {
 
-    if (!m_scanner_map.get(scanner_id, scanner, range, scanner_table, &profile_data_before))
+    if (!m_scanner_map.get(scanner_id, scanner, range, scanner_table,
+                           &profile_data_before, &prefill))
       HT_THROW(Error::RANGESERVER_INVALID_SCANNER_ID,
                format("scanner ID %d", scanner_id));
 
@@ -1660,7 +1703,14 @@ Apps::RangeServer::fetch_scanblock(Response::Callback::CreateScanner *cb,
 
     uint32_t cell_count {};
 
-    more = FillScanBlock(scanner, rbuf, &cell_count, m_scanner_buffer_size);
+    uint8_t scan_block_encoding = scanner->scan_context()->scan_block_encoding;
+    bool aggregated = !scanner->scan_context()->spec->aggregates.empty();
+
+    // Use the block filled in the background if there is one
+    if (!prefill || !prefill->take(rbuf, &more, &cell_count)) {
+      more = FillScanBlock(scanner, rbuf, &cell_count, m_scanner_buffer_size);
+      ScanBlock::encode(scan_block_encoding, rbuf);
+    }
 
     profile_data.cells_scanned = scanner->get_input_cells();
     profile_data.cells_returned = scanner->get_output_cells();
@@ -1695,12 +1745,17 @@ Apps::RangeServer::fetch_scanblock(Response::Callback::CreateScanner *cb,
                            profile_data.disk_read);
     }
 
+    // Start filling the next block while this one is in flight
+    if (more && prefill)
+      m_scan_block_prefiller->schedule(prefill);
+
     /**
      *  Send back data
      */
     {
       StaticBuffer ext(rbuf);
-      error = cb->response(scanner_id, 0, 0, more, profile_data, ext);
+      error = cb->response(scanner_id, 0, 0, more, profile_data,
+                           scan_block_encoding, aggregated, ext);
       if (error != Error::OK)
         HT_ERRORF("Problem sending OK response - %s", Error::get_text(error));
 
@@ -2538,6 +2593,35 @@ void
                                    &m_stats->block_cache_accesses,
                                    &m_stats->block_cache_hits);
 
+  uint64_t previous_io_foreground_reads = m_stats->io_foreground_reads;
+  uint64_t previous_io_foreground_read_latency = m_stats->io_foreground_read_latency;
+  uint64_t previous_io_background_bytes =
+    m_stats->io_background_read_bytes + m_stats->io_background_write_bytes;
+  uint64_t previous_io_background_throttle_time = m_stats->io_background_throttle_time;
+
+  if (Global::io_scheduler) {
+    IOScheduler::Stats io_stats;
+    Global::io_scheduler->get_stats(io_stats);
+    m_stats->io_foreground_reads = io_stats.foreground_reads;
+    m_stats->io_foreground_read_bytes = io_stats.foreground_read_bytes;
+    m_stats->io_foreground_read_latency = io_stats.foreground_read_latency;
+    m_stats->io_foreground_write_bytes = io_stats.foreground_write_bytes;
+    m_stats->io_background_read_bytes = io_stats.background_read_bytes;
+    m_stats->io_background_write_bytes = io_stats.background_write_bytes;
+    m_stats->io_background_throttle_time = io_stats.background_throttle_time;
+    m_stats->io_background_rate = io_stats.background_rate;
+  }
+
+  if (m_update_pipeline_user) {
+    UpdatePipeline::CommitStats commit_stats;
+    m_update_pipeline_user->get_commit_stats(commit_stats);
+    m_stats->commit_syncs = commit_stats.syncs;
+    m_stats->commit_batch_size_p50 = commit_stats.batch_size_p50;
+    m_stats->commit_batch_size_p99 = commit_stats.batch_size_p99;
+    m_stats->commit_sync_latency_p50 = commit_stats.sync_latency_p50;
+    m_stats->commit_sync_latency_p99 = commit_stats.sync_latency_p99;
+  }
+
   TableMutatorPtr mutator;
   if (now > m_next_metrics_update) {
     if (!Global::rs_metrics_table) {
@@ -2779,6 +2863,60 @@ void
   m_ganglia_collector->update("blockCache.fill",
                             (float)block_cache_fill / 1000000000.0);
 
+  // Spread of per-shard hit rates shows whether hot blocks cluster in a few
+  // shards, and rejections show how often the admission filter kicks in
+  if (Global::block_cache) {
+    vector<FileBlockCache::ShardStats> shard_stats;
+    Global::block_cache->get_shard_stats(shard_stats);
+    int32_t min_hit_rate {100}, max_hit_rate {};
+    uint64_t rejections {};
+    for (size_t i=0; i<shard_stats.size(); i++) {
+      FileBlockCache::ShardStats previous;
+      if (i < m_block_cache_shard_stats.size())
+        previous = m_block_cache_shard_stats[i];
+      uint64_t accesses = shard_stats[i].accesses - previous.accesses;
+      uint64_t hits = shard_stats[i].hits - previous.hits;
+      int32_t hit_rate = accesses ? (int32_t)((hits*100) / accesses) : 0;
+      min_hit_rate = std::min(min_hit_rate, hit_rate);
+      max_hit_rate = std::max(max_hit_rate, hit_rate);
+      rejections += shard_stats[i].rejections - previous.rejections;
+    }
+    m_block_cache_shard_stats.swap(shard_stats);
+    m_ganglia_collector->update("blockCache.shardHitRate.min", min_hit_rate);
+    m_ganglia_collector->update("blockCache.shardHitRate.max", max_hit_rate);
+    m_ganglia_collector->update("blockCache.rejections",
+                                (float)rejections / period_seconds);
+  }
+
+  {
+    uint64_t reads = m_stats->io_foreground_reads - previous_io_foreground_reads;
+    uint64_t latency =
+      m_stats->io_foreground_read_latency - previous_io_foreground_read_latency;
+    uint64_t background_bytes = m_stats->io_background_read_bytes +
+      m_stats->io_background_write_bytes - previous_io_background_bytes;
+    uint64_t throttle_time =
+      m_stats->io_background_throttle_time - previous_io_background_throttle_time;
+    m_ganglia_collector->update("io.foreground.readLatency",
+                                reads ? (float)latency / (float)reads / 1000.0 : (float)0.0);
+    m_ganglia_collector->update("io.background.throughput",
+                                ((float)background_bytes / period_seconds) / 1000000.0);
+    m_ganglia_collector->update("io.background.rate",
+                                (float)m_stats->io_background_rate / 1000000.0);
+    m_ganglia_collector->update("io.background.throttled",
+                                ((float)throttle_time / 1000000.0) / period_seconds);
+  }
+
+  m_ganglia_collector->update("commit.syncs",
+                              (float)m_stats->commit_syncs / period_seconds);
+  m_ganglia_collector->update("commit.batchSize.p50",
+                              (float)m_stats->commit_batch_size_p50 / 1000.0);
+  m_ganglia_collector->update("commit.batchSize.p99",
+                              (float)m_stats->commit_batch_size_p99 / 1000.0);
+  m_ganglia_collector->update("commit.syncLatency.p50",
+                              (float)m_stats->commit_sync_latency_p50 / 1000.0);
+  m_ganglia_collector->update("commit.syncLatency.p99",
+                              (float)m_stats->commit_sync_latency_p99 / 1000.0);
+
   HT_ASSERT(previous_query_cache_accesses <= m_stats->query_cache_accesses &&
             previous_query_cache_hits <= m_stats->query_cache_hits);
   uint64_t query_cache_accesses = m_stats->query_cache_accesses - previous_query_cache_accesses;
@@ -2887,6 +3025,55 @@ Apps::RangeServer::relinquish_range(ResponseCallback *cb,
   }
 }
 
+void
+Apps::RangeServer::link_cellstores(ResponseCallback *cb,
+                                    const TableIdentifier &table,
+                                    const RangeSpec &range_spec,
+                                    const std::vector<String> &access_groups,
+                                    const std::vector<String> &files) {
+  TableInfoPtr table_info;
+  RangePtr range;
+  SchemaPtr schema;
+
+  HT_INFOF("link_cellstores %s[%s..%s] (%d files)", table.id,
+           range_spec.start_row, range_spec.end_row, (int)files.size());
+
+  if (!m_log_replay_barrier->wait(cb->event()->deadline(), table, range_spec))
+    return;
+
+  try {
+    if (access_groups.size() != files.size())
+      HT_THROWF(Error::PROTOCOL_ERROR, "Access group count (%d) does not match "
+                "file count (%d)", (int)access_groups.size(), (int)files.size());
+
+    if (!m_context->live_map->lookup(table.id, table_info))
+      HT_THROW(Error::TABLE_NOT_FOUND, table.id);
+
+    if (!table_info->get_range(range_spec, range))
+      HT_THROWF(Error::RANGESERVER_RANGE_NOT_FOUND, "%s[%s..%s]",
+                table.id, range_spec.start_row, range_spec.end_row);
+
+    schema = table_info->get_schema();
+
+    if (schema->get_generation() != table.generation)
+      HT_THROWF(Error::RANGESERVER_GENERATION_MISMATCH,
+                "RangeServer Schema generation for table '%s'"
+                " is %lld but supplied is %lld",
+                table.id, (Lld)schema->get_generation(),
+                (Lld)table.generation);
+
+    range->link_cellstores(access_groups, files);
+
+    cb->response_ok();
+  }
+  catch (Hypertable::Exception &e) {
+    int error = 0;
+    HT_ERROR_OUT << e << HT_END;
+    if ((error = cb->error(e.code(), e.what())) != Error::OK)
+      HT_ERRORF("Problem sending error response - %s", Error::get_text(error));
+  }
+}
+
 void Apps::RangeServer::replay_fragments(ResponseCallback *cb, int64_t op_id,
         const String &location, int32_t plan_generation, 
         int32_t type, const vector<int32_t> &fragments,
@@ -2925,86 +3112,34 @@ void Apps::RangeServer::replay_fragments(ResponseCallback *cb, int64_t op_id,
       }
     }
 
-    BlockHeaderCommitLog header;
-    uint8_t *base;
-    size_t len;
-    TableIdentifier table_id;
-    const uint8_t *ptr, *end;
-    SerializedKey key;
-    ByteString value;
-    uint32_t block_count = 0;
-    uint32_t fragment_id;
-    uint32_t last_fragment_id = 0;
-    bool started = false;
-    ReplayBuffer replay_buffer(m_props, m_context->comm, receiver_plan, location, plan_generation);
-    size_t num_kv_pairs=0;
+    ReplayPipeline pipeline(m_props, m_context->comm, receiver_plan, location,
+                            plan_generation);
 
-    try {
-
-      while (log_reader->next((const uint8_t **)&base, &len, &header)) {
-        fragment_id = log_reader->last_fragment_id();
-        if (!started) {
-          started = true;
-          last_fragment_id = fragment_id;
-          replay_buffer.set_current_fragment(fragment_id);
+    auto report_status = [&]() {
+      if (timer.expired()) {
+        try {
+          m_master_client->replay_status(op_id, location, plan_generation);
         }
-        else if (fragment_id != last_fragment_id) {
-          replay_buffer.flush();
-          last_fragment_id = fragment_id;
-          replay_buffer.set_current_fragment(fragment_id);
-        }
-
-        ptr = base;
-        end = base + len;
-
-        decode_table_id(&ptr, &len, &table_id);
-
-        num_kv_pairs = 0;
-        while (ptr < end) {
-          // extract the key
-          key.ptr = ptr;
-          ptr += key.length();
-          if (ptr > end)
-            HT_THROW(Error::RANGESERVER_CORRUPT_COMMIT_LOG, "Problem decoding key");
-          // extract the value
-          value.ptr = ptr;
-          ptr += value.length();
-          if (ptr > end)
-            HT_THROW(Error::RANGESERVER_CORRUPT_COMMIT_LOG, "Problem decoding value");
-          ++num_kv_pairs;
-          replay_buffer.add(table_id, key, value);
-        }
-        HT_INFOF("Replayed %d key/value pairs from fragment %s",
-                 (int)num_kv_pairs, log_reader->last_fragment_fname().c_str());
-        block_count++;
-
-        // report back status
-        if (timer.expired()) {
-          try {
-            m_master_client->replay_status(op_id, location, plan_generation);
-          }
-          catch (Exception &ee) {
-            HT_ERROR_OUT << ee << HT_END;
-          }
-          timer.reset(true);
+        catch (Exception &ee) {
+          HT_ERROR_OUT << ee << HT_END;
         }
+        timer.reset(true);
       }
+    };
 
-      HT_MAYBE_FAIL_X("replay-fragments-user-0", type==RangeSpec::USER);
+    pipeline.replay(log_reader, report_status);
 
-    }
-    catch (Exception &e){
-      HT_ERROR_OUT << log_reader->last_fragment_fname() << ": " << e << HT_END;
-      HT_THROWF(e.code(), "%s: %s", log_reader->last_fragment_fname().c_str(), e.what());
-    }
+    HT_MAYBE_FAIL_X("replay-fragments-user-0", type==RangeSpec::USER);
 
-    replay_buffer.flush();
+    pipeline.flush();
 
     HT_MAYBE_FAIL_X("replay-fragments-user-1", type==RangeSpec::USER);
 
     HT_INFOF("Finished playing %d fragments from %s",
              (int)fragments.size(), log_dir.c_str());
 
+    pipeline.log_statistics(log_dir);
+
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
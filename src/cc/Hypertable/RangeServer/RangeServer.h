@@ -42,6 +42,7 @@
 #include <Hypertable/RangeServer/Response/Callback/PhantomUpdate.h>
 #include <Hypertable/RangeServer/Response/Callback/Status.h>
 #include <Hypertable/RangeServer/Response/Callback/Update.h>
+#include <Hypertable/RangeServer/ScanBlockPrefiller.h>
 #include <Hypertable/RangeServer/ScannerMap.h>
 #include <Hypertable/RangeServer/TableInfo.h>
 #include <Hypertable/RangeServer/TableInfoMap.h>
@@ -103,7 +104,7 @@ namespace Apps {
     void create_scanner(Response::Callback::CreateScanner *,
                         const TableIdentifier &,
                         const  RangeSpec &, const ScanSpec &,
-                        QueryCache::Key *);
+                        uint8_t scan_block_encoding, QueryCache::Key *);
     void destroy_scanner(ResponseCallback *cb, int32_t scanner_id);
     void fetch_scanblock(Response::Callback::CreateScanner *, int32_t scanner_id);
     void load_range(ResponseCallback *, const TableIdentifier &,
@@ -143,6 +144,21 @@ namespace Apps {
 
     void relinquish_range(ResponseCallback *, const TableIdentifier &,
                           const RangeSpec &);
+
+    /// Links externally built CellStore files into a range.
+    /// Looks up the range identified by <code>table</code> and
+    /// <code>range_spec</code>, verifies that the schema generation of
+    /// <code>table</code> matches, and calls Range::link_cellstores().
+    /// @param cb Response callback
+    /// @param table %Table identifier
+    /// @param range_spec %Range specification
+    /// @param access_groups Access group names
+    /// @param files Absolute pathnames of CellStore files, one per entry of
+    /// <code>access_groups</code>
+    void link_cellstores(ResponseCallback *cb, const TableIdentifier &table,
+                         const RangeSpec &range_spec,
+                         const std::vector<String> &access_groups,
+                         const std::vector<String> &files);
     void heapcheck(ResponseCallback *, const char *);
 
     void metadata_sync(ResponseCallback *, const char *, uint32_t flags, std::vector<const char *> columns);
@@ -300,6 +316,10 @@ namespace Apps {
     Lib::Master::ClientPtr        m_master_client;
     Hyperspace::SessionPtr m_hyperspace;
 
+    /// Scan block prefiller (declared before #m_scanner_map, whose prefill
+    /// state refers to it, so that it is destroyed after the map)
+    ScanBlockPrefillerPtr m_scan_block_prefiller;
+
     /// Outstanding scanner map
     ScannerMap m_scanner_map;
     uint32_t               m_scanner_ttl;
@@ -312,6 +332,9 @@ namespace Apps {
     /// Timestamp (nanoseconds) of last metrics collection
     int64_t m_stats_last_timestamp {};
 
+    /// Block cache shard statistics as of last metrics collection
+    std::vector<FileBlockCache::ShardStats> m_block_cache_shard_stats;
+
     /// Indicates if a get_statistics() call is outstanding
     bool m_get_statistics_outstanding {};
 
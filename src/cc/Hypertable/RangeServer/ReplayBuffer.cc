@@ -24,6 +24,8 @@
 #include "ReplayBuffer.h"
 #include "ReplayDispatchHandler.h"
 
+#include <chrono>
+
 using namespace std;
 using namespace Hypertable;
 using namespace Hypertable::Lib;
@@ -83,6 +85,7 @@ void ReplayBuffer::add(const TableIdentifier &table, SerializedKey &key,
 }
 
 void ReplayBuffer::flush() {
+  auto start_time = chrono::steady_clock::now();
   ReplayDispatchHandler handler(m_comm, m_location, m_plan_generation, m_timeout_ms);
 
   for (auto &vv : m_buffer_map) {
@@ -100,5 +103,7 @@ void ReplayBuffer::flush() {
 
   handler.wait_for_completion();
 
+  m_flushed_bytes += m_memory_used;
+  m_flush_time += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start_time).count();
   m_memory_used=0;
 }
@@ -56,6 +56,14 @@ namespace Hypertable {
 
     void flush();
 
+    /// Returns amount of update data sent by flush().
+    /// @return Number of bytes flushed
+    uint64_t flushed_bytes() const { return m_flushed_bytes; }
+
+    /// Returns time spent in flush().
+    /// @return Microseconds spent flushing
+    uint64_t flush_time() const { return m_flush_time; }
+
   private:
 
     Comm *m_comm;
@@ -69,6 +77,8 @@ namespace Hypertable {
     size_t m_flush_limit_per_range {};
     int32_t m_timeout_ms {};
     uint32_t m_fragment {};
+    uint64_t m_flushed_bytes {};
+    uint64_t m_flush_time {};
   };
 
 }
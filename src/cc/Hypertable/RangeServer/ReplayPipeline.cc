@@ -0,0 +1,357 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for ReplayPipeline.
+/// This file contains type definitions for ReplayPipeline, a multithreaded
+/// pipeline that replays commit log fragments to recovery receivers.
+
+#include <Common/Compat.h>
+
+#include "ReplayPipeline.h"
+
+#include <Hypertable/Lib/CompressorFactory.h>
+#include <Hypertable/Lib/Key.h>
+#include <Hypertable/Lib/LegacyDecoder.h>
+
+#include <Common/Error.h>
+#include <Common/Logger.h>
+#include <Common/String.h>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace Hypertable;
+using namespace Hypertable::Lib;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+  uint64_t elapsed_us(steady_clock::time_point start) {
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+  }
+
+  void decode_table_id(const uint8_t **bufp, size_t *remainp,
+                       TableIdentifier *tid) {
+    const uint8_t *buf_saved = *bufp;
+    size_t remain_saved = *remainp;
+    try {
+      tid->decode(bufp, remainp);
+    }
+    catch (Exception &e) {
+      if (e.code() == Error::PROTOCOL_ERROR) {
+        *bufp = buf_saved;
+        *remainp = remain_saved;
+        legacy_decode(bufp, remainp, tid);
+      }
+      else
+        throw;
+    }
+  }
+
+}
+
+ReplayPipeline::ReplayPipeline(PropertiesPtr &props, Comm *comm,
+                               const RangeServerRecovery::ReceiverPlan &plan,
+                               const String &location,
+                               int32_t plan_generation) {
+  int32_t thread_count =
+    props->get_i32("Hypertable.RangeServer.Failover.ReplayThreads");
+  if (thread_count < 1)
+    thread_count = 1;
+  m_readahead = 2 * thread_count;
+  m_workers.reserve(thread_count);
+  m_threads.reserve(thread_count);
+  for (int32_t i=0; i<thread_count; i++) {
+    m_workers.push_back(unique_ptr<Worker>(new Worker(props, comm, plan, location,
+                                                      plan_generation)));
+    m_threads.push_back(thread(&ReplayPipeline::worker_loop, this,
+                               m_workers.back().get()));
+  }
+}
+
+ReplayPipeline::~ReplayPipeline() {
+  shutdown();
+}
+
+void ReplayPipeline::replay(CommitLogReaderPtr &log_reader,
+                            std::function<void()> report_status) {
+  auto start_time = steady_clock::now();
+  CommitLogBlockInfo binfo;
+  BlockHeaderCommitLog header;
+
+  while (true) {
+    auto read_start = steady_clock::now();
+    try {
+      if (!log_reader->next_raw_block(&binfo, &header))
+        break;
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << log_reader->last_fragment_fname() << ": " << e << HT_END;
+      HT_THROWF(e.code(), "%s: %s", log_reader->last_fragment_fname().c_str(),
+                e.what());
+    }
+    m_read_us += elapsed_us(read_start);
+
+    if (binfo.error != Error::OK) {
+      HT_WARNF("Corruption detected in CommitLog fragment %s starting at "
+               "postion %lld for %lld bytes - %s",
+               log_reader->last_fragment_fname().c_str(),
+               (Lld)binfo.start_offset,
+               (Lld)(binfo.end_offset - binfo.start_offset),
+               Error::get_text(binfo.error));
+      continue;
+    }
+    log_reader->update_revision(header.get_revision());
+
+    BlockPtr block = make_shared<Block>();
+    block->fragment = (uint32_t)log_reader->last_fragment_id();
+    block->fname = log_reader->last_fragment_fname();
+    block->start_offset = binfo.start_offset;
+    block->end_offset = binfo.end_offset;
+    block->header = header;
+    block->zblock.set(binfo.block_ptr, binfo.block_len);
+    m_read_bytes += binfo.block_len;
+    m_blocks++;
+
+    {
+      unique_lock<mutex> lock(m_mutex);
+      m_space_cond.wait(lock, [this](){
+          return m_queue.size() < m_readahead || m_error != Error::OK; });
+      if (m_error != Error::OK)
+        HT_THROW(m_error, m_error_msg);
+      m_queue.push_back(block);
+    }
+    m_queue_cond.notify_one();
+
+    report_status();
+  }
+
+  {
+    unique_lock<mutex> lock(m_mutex);
+    m_space_cond.wait(lock, [this](){
+        return (m_queue.empty() && m_busy == 0) || m_error != Error::OK; });
+    if (m_error != Error::OK)
+      HT_THROW(m_error, m_error_msg);
+  }
+
+  m_elapsed_us += elapsed_us(start_time);
+}
+
+void ReplayPipeline::flush() {
+  auto start_time = steady_clock::now();
+  vector<thread> threads;
+
+  // Workers are idle once replay() returns, so their buffers can be flushed
+  // from here, one thread per worker
+  threads.reserve(m_workers.size());
+  for (auto &worker : m_workers) {
+    if (worker->started && worker->replay_buffer.memory_used() > 0) {
+      Worker *w = worker.get();
+      threads.push_back(thread([this, w]() {
+            try {
+              w->replay_buffer.flush();
+            }
+            catch (Exception &e) {
+              set_error(e.code(), e.what());
+            }
+          }));
+    }
+  }
+  for (thread &t : threads)
+    t.join();
+
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_error != Error::OK)
+      HT_THROW(m_error, m_error_msg);
+  }
+
+  m_elapsed_us += elapsed_us(start_time);
+}
+
+void ReplayPipeline::log_statistics(const String &log_dir) {
+  uint64_t dispatch_us {};
+  uint64_t dispatch_bytes {};
+
+  for (auto &worker : m_workers) {
+    dispatch_us += worker->replay_buffer.flush_time();
+    dispatch_bytes += worker->replay_buffer.flushed_bytes();
+  }
+
+  auto mb_per_sec = [](uint64_t bytes, uint64_t us) -> double {
+    return us ? ((double)bytes / (double)us) : 0.0;
+  };
+  auto per_sec = [](uint64_t count, uint64_t us) -> double {
+    return us ? ((double)count * 1000000.0 / (double)us) : 0.0;
+  };
+
+  HT_INFOF("Replay of %s: %llu blocks, %llu key/value pairs in %.3fs "
+           "(%.0f pairs/s) with %d threads",
+           log_dir.c_str(), (Llu)m_blocks.load(), (Llu)m_kv_pairs.load(),
+           (double)m_elapsed_us / 1000000.0,
+           per_sec(m_kv_pairs, m_elapsed_us), (int)m_workers.size());
+  HT_INFOF("Replay of %s phases: read %.2f MB/s (%.3fs), inflate %.2f MB/s "
+           "(%.3fs), route %.0f pairs/s (%.3fs), dispatch %.2f MB/s (%.3fs)",
+           log_dir.c_str(),
+           mb_per_sec(m_read_bytes, m_read_us), (double)m_read_us / 1000000.0,
+           mb_per_sec(m_inflated_bytes, m_inflate_us),
+           (double)m_inflate_us / 1000000.0,
+           per_sec(m_kv_pairs, m_route_us), (double)m_route_us / 1000000.0,
+           mb_per_sec(dispatch_bytes, dispatch_us),
+           (double)dispatch_us / 1000000.0);
+}
+
+void ReplayPipeline::worker_loop(Worker *worker) {
+  BlockPtr block;
+
+  while (true) {
+
+    {
+      unique_lock<mutex> lock(m_mutex);
+      m_queue_cond.wait(lock, [this](){
+          return !m_queue.empty() || m_shutdown; });
+      if (m_queue.empty())
+        break;
+      block = m_queue.front();
+      m_queue.pop_front();
+      m_busy++;
+    }
+    m_space_cond.notify_all();
+
+    try {
+      process(worker, block.get());
+    }
+    catch (Exception &e) {
+      HT_ERROR_OUT << block->fname << ": " << e << HT_END;
+      set_error(e.code(), format("%s: %s", block->fname.c_str(), e.what()));
+    }
+    block.reset();
+
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_busy--;
+    }
+    m_space_cond.notify_all();
+  }
+}
+
+void ReplayPipeline::process(Worker *worker, Block *block) {
+  auto start_time = steady_clock::now();
+  uint16_t ztype = block->header.get_compression_type();
+
+  if (ztype >= BlockCompressionCodec::COMPRESSION_TYPE_LIMIT)
+    HT_THROWF(Error::BLOCK_COMPRESSOR_UNSUPPORTED_TYPE,
+              "Invalid compression type '%d'", (int)ztype);
+
+  BlockCompressionCodecPtr &codec = worker->codecs[ztype];
+  if (!codec)
+    codec.reset(CompressorFactory::create_block_codec((BlockCompressionCodec::Type)ztype));
+
+  worker->block.clear();
+  try {
+    codec->inflate(block->zblock, worker->block, block->header);
+  }
+  catch (Exception &e) {
+    HT_ERRORF("Inflate error in CommitLog fragment %s starting at "
+              "postion %lld (block len = %lld) - %s", block->fname.c_str(),
+              (Lld)block->start_offset,
+              (Lld)(block->end_offset - block->start_offset),
+              Error::get_text(e.code()));
+    return;
+  }
+  m_inflated_bytes += worker->block.fill();
+  m_inflate_us += elapsed_us(start_time);
+
+  start_time = steady_clock::now();
+  uint64_t flush_time = worker->replay_buffer.flush_time();
+
+  if (!worker->started) {
+    worker->started = true;
+    worker->fragment = block->fragment;
+    worker->replay_buffer.set_current_fragment(block->fragment);
+  }
+  else if (block->fragment != worker->fragment) {
+    worker->replay_buffer.flush();
+    worker->fragment = block->fragment;
+    worker->replay_buffer.set_current_fragment(block->fragment);
+  }
+
+  const uint8_t *ptr = worker->block.base;
+  const uint8_t *end = worker->block.base + worker->block.fill();
+  size_t len = worker->block.fill();
+  TableIdentifier table_id;
+  SerializedKey key;
+  ByteString value;
+  size_t num_kv_pairs = 0;
+
+  decode_table_id(&ptr, &len, &table_id);
+
+  while (ptr < end) {
+    // extract the key
+    key.ptr = ptr;
+    ptr += key.length();
+    if (ptr > end)
+      HT_THROW(Error::RANGESERVER_CORRUPT_COMMIT_LOG, "Problem decoding key");
+    // extract the value
+    value.ptr = ptr;
+    ptr += value.length();
+    if (ptr > end)
+      HT_THROW(Error::RANGESERVER_CORRUPT_COMMIT_LOG, "Problem decoding value");
+    ++num_kv_pairs;
+    worker->replay_buffer.add(table_id, key, value);
+  }
+  m_kv_pairs += num_kv_pairs;
+
+  // Exclude time spent in flushes triggered while routing
+  uint64_t route_us = elapsed_us(start_time);
+  flush_time = worker->replay_buffer.flush_time() - flush_time;
+  m_route_us += route_us > flush_time ? route_us - flush_time : 0;
+
+  HT_INFOF("Replayed %d key/value pairs from fragment %s",
+           (int)num_kv_pairs, block->fname.c_str());
+}
+
+void ReplayPipeline::set_error(int error, const String &msg) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_error == Error::OK) {
+      m_error = error;
+      m_error_msg = msg;
+    }
+    m_queue.clear();
+  }
+  m_space_cond.notify_all();
+}
+
+void ReplayPipeline::shutdown() {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_shutdown)
+      return;
+    m_shutdown = true;
+    m_queue.clear();
+  }
+  m_queue_cond.notify_all();
+  for (thread &t : m_threads)
+    t.join();
+}
@@ -0,0 +1,226 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for ReplayPipeline.
+/// This file contains type declarations for ReplayPipeline, a multithreaded
+/// pipeline that replays commit log fragments to recovery receivers.
+
+#ifndef Hypertable_RangeServer_ReplayPipeline_h
+#define Hypertable_RangeServer_ReplayPipeline_h
+
+#include <Hypertable/RangeServer/ReplayBuffer.h>
+
+#include <Hypertable/Lib/BlockCompressionCodec.h>
+#include <Hypertable/Lib/BlockHeaderCommitLog.h>
+#include <Hypertable/Lib/CommitLogReader.h>
+#include <Hypertable/Lib/RangeServerRecovery/ReceiverPlan.h>
+
+#include <AsyncComm/Comm.h>
+
+#include <Common/Properties.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Hypertable {
+
+  /// @addtogroup RangeServer
+  /// @{
+
+  /// Multithreaded commit log replay pipeline.
+  /// The calling thread reads raw (compressed) blocks from a CommitLogReader
+  /// and queues them, reading ahead of the worker threads by a bounded number
+  /// of blocks.  Each worker inflates the blocks it takes off the queue,
+  /// routes their key/value pairs into its own ReplayBuffer, and flushes that
+  /// buffer to the receivers.  Blocks are therefore decompressed and
+  /// dispatched concurrently while the next blocks are being read.  Each
+  /// ReplayBuffer is flushed whenever its worker moves on to a block of a
+  /// different fragment, so every batch sent is tagged with the fragment it
+  /// came from.  The time spent in each phase is accumulated and logged by
+  /// log_statistics().
+  class ReplayPipeline {
+  public:
+
+    /// Constructor.
+    /// Starts the number of worker threads given by the
+    /// <code>Hypertable.RangeServer.Failover.ReplayThreads</code> property
+    /// (at least one) and sets the read-ahead limit to twice that many
+    /// blocks.
+    /// @param props Configuration properties
+    /// @param comm Comm object used to send replay batches
+    /// @param plan Receiver plan of the recovery operation
+    /// @param location Proxy name of server being recovered
+    /// @param plan_generation Recovery plan generation
+    ReplayPipeline(PropertiesPtr &props, Comm *comm,
+                   const RangeServerRecovery::ReceiverPlan &plan,
+                   const String &location, int32_t plan_generation);
+
+    /// Destructor.
+    /// Stops the worker threads if they are still running.
+    ~ReplayPipeline();
+
+    /// Replays all blocks of a commit log.
+    /// Reads blocks from <code>log_reader</code> and queues them for the
+    /// workers, calling <code>report_status</code> after each block is
+    /// queued.  After the last block is read, waits for the workers to
+    /// process all queued blocks.  Key/value pairs may remain buffered in the
+    /// workers' replay buffers until flush() is called.  If reading fails or
+    /// a worker encounters an error, reading stops and the first error is
+    /// thrown, with the name of the fragment file prefixed to its message.
+    /// @param log_reader Commit log reader
+    /// @param report_status Function called periodically to report progress
+    void replay(CommitLogReaderPtr &log_reader,
+                std::function<void()> report_status);
+
+    /// Flushes the replay buffers of all workers.
+    void flush();
+
+    /// Logs replay throughput of each phase.
+    /// @param log_dir Commit log directory being replayed
+    void log_statistics(const String &log_dir);
+
+  private:
+
+    /// Raw commit log block queued for a worker
+    struct Block {
+      /// Toplevel fragment ID
+      uint32_t fragment {};
+      /// Fragment file name (for error messages)
+      String fname;
+      /// Starting offset of block within fragment file
+      uint64_t start_offset {};
+      /// Ending offset of block within fragment file
+      uint64_t end_offset {};
+      /// Block header
+      BlockHeaderCommitLog header;
+      /// Compressed block data
+      DynamicBuffer zblock;
+    };
+
+    typedef std::shared_ptr<Block> BlockPtr;
+
+    /// Worker state
+    struct Worker {
+      Worker(PropertiesPtr &props, Comm *comm,
+             const RangeServerRecovery::ReceiverPlan &plan,
+             const String &location, int32_t plan_generation)
+        : replay_buffer(props, comm, plan, location, plan_generation) { }
+      /// Replay buffer for this worker's key/value pairs
+      ReplayBuffer replay_buffer;
+      /// Fragment of key/value pairs in #replay_buffer
+      uint32_t fragment {};
+      /// <i>true</i> if #replay_buffer holds key/value pairs
+      bool started {};
+      /// Decompression codecs, indexed by compression type
+      std::unordered_map<uint16_t, BlockCompressionCodecPtr> codecs;
+      /// Buffer holding inflated block
+      DynamicBuffer block;
+    };
+
+    /// Worker thread function.
+    /// @param worker Worker state
+    void worker_loop(Worker *worker);
+
+    /// Inflates and routes a block.
+    /// @param worker Worker state
+    /// @param block Block to replay
+    void process(Worker *worker, Block *block);
+
+    /// Records first error and stops the pipeline.
+    /// @param error %Error code
+    /// @param msg %Error message
+    void set_error(int error, const String &msg);
+
+    /// Stops worker threads and waits for them to exit.
+    void shutdown();
+
+    /// %Mutex protecting the queue and error state
+    std::mutex m_mutex;
+
+    /// Signals that a block was queued or the pipeline is stopping
+    std::condition_variable m_queue_cond;
+
+    /// Signals that a block was removed from the queue or an error occurred
+    std::condition_variable m_space_cond;
+
+    /// Queue of blocks read but not yet taken by a worker
+    std::deque<BlockPtr> m_queue;
+
+    /// Maximum number of queued blocks
+    size_t m_readahead {};
+
+    /// Number of workers processing a block
+    size_t m_busy {};
+
+    /// Set when there are no more blocks to read
+    bool m_shutdown {};
+
+    /// First error encountered by a worker (Error::OK if none)
+    int m_error {};
+
+    /// Message of #m_error
+    String m_error_msg;
+
+    /// Worker state
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    /// Worker threads
+    std::vector<std::thread> m_threads;
+
+    /// Number of blocks read
+    std::atomic<uint64_t> m_blocks {};
+
+    /// Number of key/value pairs replayed
+    std::atomic<uint64_t> m_kv_pairs {};
+
+    /// Amount of compressed data read
+    std::atomic<uint64_t> m_read_bytes {};
+
+    /// Amount of data after decompression
+    std::atomic<uint64_t> m_inflated_bytes {};
+
+    /// Microseconds spent reading blocks
+    std::atomic<uint64_t> m_read_us {};
+
+    /// Microseconds spent inflating blocks, summed over workers
+    std::atomic<uint64_t> m_inflate_us {};
+
+    /// Microseconds spent routing key/value pairs into replay buffers,
+    /// summed over workers (excludes flushes triggered by the buffers)
+    std::atomic<uint64_t> m_route_us {};
+
+    /// Wall clock microseconds spent in replay() and flush()
+    uint64_t m_elapsed_us {};
+  };
+
+  /// @}
+
+}
+
+#endif // Hypertable_RangeServer_ReplayPipeline_h
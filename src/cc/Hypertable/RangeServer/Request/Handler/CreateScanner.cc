@@ -54,11 +54,13 @@ void CreateScanner::run() {
       md5_csum((unsigned char *)base, ptr-base,
                reinterpret_cast<unsigned char *>(key.digest));
       m_range_server->create_scanner(&cb, params.table(), params.range_spec(),
-                                     params.scan_spec(), &key);
+                                     params.scan_spec(),
+                                     params.scan_block_encoding(), &key);
     }
     else
       m_range_server->create_scanner(&cb, params.table(), params.range_spec(),
-                                     params.scan_spec(), 0);
+                                     params.scan_spec(),
+                                     params.scan_block_encoding(), 0);
   }
   catch (Exception &e) {
     HT_ERROR_OUT << e << HT_END;
@@ -36,12 +36,15 @@ using namespace Hypertable::RangeServer::Response::Callback;
 int CreateScanner::response(int32_t id, int32_t skipped_rows,
                             int32_t skipped_cells, bool more,
 			    ProfileDataScanner &profile_data,
+                            uint8_t encoding, bool aggregated,
                             StaticBuffer &ext) {
   CommHeader header;
   header.initialize_from_request_header(m_event->header);
   Lib::RangeServer::Response::Parameters::CreateScanner params(id, skipped_rows,
                                                                skipped_cells, more,
-                                                               profile_data);
+                                                               profile_data,
+                                                               encoding,
+                                                               aggregated);
   CommBufPtr cbuf(new CommBuf(header, 4+params.encoded_length(), ext));
   cbuf->append_i32(Error::OK);
   params.encode(cbuf->get_data_ptr_address());
@@ -52,13 +55,16 @@ int CreateScanner::response(int32_t id, int32_t skipped_rows,
 int CreateScanner::response(int32_t id, int32_t skipped_rows, 
 			    int32_t skipped_cells, bool more,
                             ProfileDataScanner &profile_data,
+                            uint8_t encoding, bool aggregated,
 			    boost::shared_array<uint8_t> &ext_buffer,
 			    uint32_t ext_len) {
   CommHeader header;
   header.initialize_from_request_header(m_event->header);
   Lib::RangeServer::Response::Parameters::CreateScanner params(id, skipped_rows,
                                                                skipped_cells, more,
-                                                               profile_data);
+                                                               profile_data,
+                                                               encoding,
+                                                               aggregated);
   CommBufPtr cbuf(new CommBuf(header, 4+params.encoded_length(),
                               ext_buffer, ext_len));
   cbuf->append_i32(Error::OK);
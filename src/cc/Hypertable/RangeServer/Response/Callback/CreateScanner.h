@@ -43,11 +43,13 @@ namespace Callback {
 
     int response(int32_t id, int32_t skipped_rows, int32_t skipped_cells,
                  bool more, ProfileDataScanner &profile_data,
-                 StaticBuffer &ext);
+                 uint8_t encoding, bool aggregated, StaticBuffer &ext);
 
     int response(int32_t id, int32_t skipped_rows, int32_t skipped_cells,
                  bool more, ProfileDataScanner &profile_data,
-                 boost::shared_array<uint8_t> &ext_buffer, uint32_t ext_len);
+                 uint8_t encoding, bool aggregated,
+                 boost::shared_array<uint8_t> &ext_buffer,
+                 uint32_t ext_len);
   };
 
   /// @}
@@ -0,0 +1,210 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for ScanBlockPrefiller.
+/// This file contains type definitions for ScanBlockPrefiller, a thread pool
+/// that fills the next scan block of outstanding scanners ahead of the
+/// FETCH_SCANBLOCK request that asks for it.
+
+#include <Common/Compat.h>
+
+#include "ScanBlockPrefiller.h"
+
+#include <Hypertable/RangeServer/FillScanBlock.h>
+
+#include <Hypertable/Lib/ScanBlock.h>
+
+#include <Common/Error.h>
+#include <Common/Logger.h>
+
+using namespace Hypertable;
+using namespace std;
+
+ScanBlockPrefill::~ScanBlockPrefill() {
+  if (m_ready)
+    m_prefiller->m_memory_used -= m_block.size;
+}
+
+bool ScanBlockPrefill::take(DynamicBuffer &dbuf, bool *more,
+                            uint32_t *cell_count) {
+  unique_lock<mutex> lock(m_mutex);
+
+  // Filling inline is no slower than waiting for a fill that has not started,
+  // so cancel it; the prefiller thread skips it when dequeued
+  if (m_queued) {
+    m_queued = false;
+    return false;
+  }
+
+  m_cond.wait(lock, [this](){ return !m_filling; });
+
+  if (!m_ready)
+    return false;
+  m_ready = false;
+
+  m_prefiller->m_memory_used -= m_block.size;
+
+  if (m_error != Error::OK) {
+    m_block.free();
+    HT_THROW(m_error, m_error_msg);
+  }
+
+  swap(dbuf.base, m_block.base);
+  swap(dbuf.ptr, m_block.ptr);
+  swap(dbuf.mark, m_block.mark);
+  swap(dbuf.size, m_block.size);
+  m_block.free();
+  *more = m_more;
+  *cell_count = m_cell_count;
+  return true;
+}
+
+ScanBlockPrefiller::ScanBlockPrefiller(PropertiesPtr &props) {
+  int32_t thread_count =
+    props->get_i32("Hypertable.RangeServer.Scanner.Prefill.Threads");
+  m_memory_limit =
+    props->get_i64("Hypertable.RangeServer.Scanner.Prefill.MaxMemory");
+  if (m_memory_limit <= 0)
+    thread_count = 0;
+  m_threads.reserve(thread_count);
+  for (int32_t i=0; i<thread_count; i++)
+    m_threads.push_back(thread(&ScanBlockPrefiller::worker_loop, this));
+}
+
+ScanBlockPrefiller::~ScanBlockPrefiller() {
+  shutdown();
+}
+
+void ScanBlockPrefiller::schedule(ScanBlockPrefillPtr &prefill) {
+  {
+    lock_guard<mutex> lock(prefill->m_mutex);
+    if (prefill->m_queued || prefill->m_filling || prefill->m_ready)
+      return;
+    prefill->m_queued = true;
+  }
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (!m_shutdown) {
+      m_queue.push_back(prefill);
+      m_cond.notify_one();
+      return;
+    }
+  }
+  abandon(prefill.get());
+}
+
+void ScanBlockPrefiller::shutdown() {
+  deque<ScanBlockPrefillPtr> queue;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_shutdown)
+      return;
+    m_shutdown = true;
+    queue.swap(m_queue);
+  }
+  m_cond.notify_all();
+  for (auto &prefill : queue)
+    abandon(prefill.get());
+  for (thread &t : m_threads)
+    t.join();
+}
+
+void ScanBlockPrefiller::worker_loop() {
+  ScanBlockPrefillPtr prefill;
+
+  while (true) {
+    {
+      unique_lock<mutex> lock(m_mutex);
+      m_cond.wait(lock, [this](){ return !m_queue.empty() || m_shutdown; });
+      if (m_shutdown)
+        break;
+      prefill = m_queue.front();
+      m_queue.pop_front();
+    }
+
+    // Skip fills cancelled by take() while queued
+    {
+      lock_guard<mutex> lock(prefill->m_mutex);
+      if (!prefill->m_queued) {
+        prefill.reset();
+        continue;
+      }
+      prefill->m_queued = false;
+      prefill->m_filling = true;
+    }
+
+    // Skip scanners that were removed from the scanner map while queued, and
+    // leave the fill to the request if the budget is used up
+    if (prefill.use_count() == 1 || m_memory_used >= m_memory_limit)
+      abandon(prefill.get());
+    else
+      fill(prefill.get());
+
+    prefill.reset();
+  }
+}
+
+void ScanBlockPrefiller::fill(ScanBlockPrefill *prefill) {
+  DynamicBuffer dbuf;
+  bool more {};
+  uint32_t cell_count {};
+  int error = Error::OK;
+  String error_msg;
+
+  try {
+    more = FillScanBlock(prefill->m_scanner, dbuf, &cell_count,
+                         prefill->m_buffer_size);
+    ScanBlock::encode(prefill->m_scanner->scan_context()->scan_block_encoding,
+                      dbuf);
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    error = e.code();
+    error_msg = e.what();
+  }
+
+  m_memory_used += dbuf.size;
+
+  {
+    lock_guard<mutex> lock(prefill->m_mutex);
+    swap(prefill->m_block.base, dbuf.base);
+    swap(prefill->m_block.ptr, dbuf.ptr);
+    swap(prefill->m_block.mark, dbuf.mark);
+    swap(prefill->m_block.size, dbuf.size);
+    prefill->m_more = more;
+    prefill->m_cell_count = cell_count;
+    prefill->m_error = error;
+    prefill->m_error_msg = error_msg;
+    prefill->m_ready = true;
+    prefill->m_filling = false;
+  }
+  prefill->m_cond.notify_all();
+}
+
+void ScanBlockPrefiller::abandon(ScanBlockPrefill *prefill) {
+  {
+    lock_guard<mutex> lock(prefill->m_mutex);
+    prefill->m_queued = false;
+    prefill->m_filling = false;
+  }
+  prefill->m_cond.notify_all();
+}
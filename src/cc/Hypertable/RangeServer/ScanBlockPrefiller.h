@@ -0,0 +1,223 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for ScanBlockPrefiller.
+/// This file contains type declarations for ScanBlockPrefiller, a thread pool
+/// that fills the next scan block of outstanding scanners ahead of the
+/// FETCH_SCANBLOCK request that asks for it.
+
+#ifndef Hypertable_RangeServer_ScanBlockPrefiller_h
+#define Hypertable_RangeServer_ScanBlockPrefiller_h
+
+#include <Hypertable/RangeServer/MergeScannerRange.h>
+
+#include <Common/DynamicBuffer.h>
+#include <Common/Properties.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Hypertable {
+
+  /// @addtogroup RangeServer
+  /// @{
+
+  class ScanBlockPrefiller;
+
+  /// Prefill state of an outstanding scanner.
+  /// Holds the scan block filled ahead of time for one scanner, or the error
+  /// encountered while filling it.  While a fill is running the scanner
+  /// belongs to the prefiller thread, so take() must be called before the
+  /// scanner is used by a request.
+  class ScanBlockPrefill {
+  public:
+
+    /// Constructor.
+    /// @param prefiller Prefiller that fills blocks for this scanner
+    /// @param scanner Scanner from which blocks are filled
+    /// @param buffer_size Target size of scan block
+    ScanBlockPrefill(ScanBlockPrefiller *prefiller,
+                     MergeScannerRangePtr &scanner, int64_t buffer_size)
+      : m_prefiller(prefiller), m_scanner(scanner),
+        m_buffer_size(buffer_size) { }
+
+    /// Destructor.
+    /// Returns the memory of an unconsumed block to the prefill budget.
+    ~ScanBlockPrefill();
+
+    /// Takes the prefilled scan block.
+    /// If a fill is queued but has not started, it is cancelled so that the
+    /// request does not wait behind other queued fills, and <i>false</i> is
+    /// returned.  If a fill is running, waits for it to complete.  If a block
+    /// is ready, it is moved into <code>dbuf</code> (already encoded with the
+    /// scanner's scan block encoding) and <i>true</i> is returned.  If no
+    /// block was prefilled, <i>false</i> is returned and the caller fills the
+    /// block itself.  If the fill failed, its exception is rethrown after its
+    /// memory is returned to the prefill budget.
+    /// @param dbuf Buffer to receive the scan block
+    /// @param more Address of variable to hold flag indicating if the scanner
+    /// has more results
+    /// @param cell_count Address of variable to hold number of cells in block
+    /// @return <i>true</i> if a prefilled block was returned, <i>false</i>
+    /// otherwise
+    bool take(DynamicBuffer &dbuf, bool *more, uint32_t *cell_count);
+
+  private:
+
+    friend class ScanBlockPrefiller;
+
+    /// Prefiller that fills blocks for this scanner
+    ScanBlockPrefiller *m_prefiller;
+
+    /// Scanner from which blocks are filled
+    MergeScannerRangePtr m_scanner;
+
+    /// Target size of scan block
+    int64_t m_buffer_size;
+
+    /// %Mutex protecting the members below
+    std::mutex m_mutex;
+
+    /// Signals completion of a fill
+    std::condition_variable m_cond;
+
+    /// <i>true</i> while a fill is queued and has not started
+    bool m_queued {};
+
+    /// <i>true</i> while the block is being filled
+    bool m_filling {};
+
+    /// <i>true</i> if a filled block (or error) is waiting to be taken
+    bool m_ready {};
+
+    /// Prefilled scan block
+    DynamicBuffer m_block;
+
+    /// Flag indicating if the scanner has more results after #m_block
+    bool m_more {};
+
+    /// Number of cells in #m_block
+    uint32_t m_cell_count {};
+
+    /// %Error encountered while filling (Error::OK if none)
+    int m_error {};
+
+    /// Message of #m_error
+    String m_error_msg;
+  };
+
+  /// Smart pointer to ScanBlockPrefill
+  typedef std::shared_ptr<ScanBlockPrefill> ScanBlockPrefillPtr;
+
+  /// Fills scan blocks of outstanding scanners in the background.
+  /// Without prefilling, the merge scanner of a scanner sits idle while a scan
+  /// block is in flight to the client and being consumed, and each
+  /// FETCH_SCANBLOCK request pays for the fill of its block.  After a scan
+  /// block is returned, the RangeServer schedules the scanner with this
+  /// class, whose threads fill and encode the next block so that the
+  /// following FETCH_SCANBLOCK can reply immediately.  Prefilled blocks are
+  /// held in memory until fetched, so filling is skipped while the memory
+  /// held by unfetched blocks exceeds the configured budget.  The budget is
+  /// checked before each fill, so it can be exceeded by at most one block
+  /// per thread.
+  class ScanBlockPrefiller {
+  public:
+
+    /// Constructor.
+    /// Starts the number of threads given by the
+    /// <code>Hypertable.RangeServer.Scanner.Prefill.Threads</code> property
+    /// and reads the memory budget from
+    /// <code>Hypertable.RangeServer.Scanner.Prefill.MaxMemory</code>.
+    /// @param props Configuration properties
+    ScanBlockPrefiller(PropertiesPtr &props);
+
+    /// Destructor.
+    /// Stops the threads if they are still running.
+    ~ScanBlockPrefiller();
+
+    /// Checks if prefilling is enabled.
+    /// @return <i>true</i> if at least one prefill thread is running
+    bool enabled() const { return !m_threads.empty(); }
+
+    /// Schedules the fill of the next scan block of a scanner.
+    /// Does nothing if a block is already queued, being filled, or waiting to
+    /// be taken.
+    /// @param prefill Prefill state of scanner
+    void schedule(ScanBlockPrefillPtr &prefill);
+
+    /// Stops the threads and discards queued fills.
+    void shutdown();
+
+    /// Returns the amount of memory held by prefilled blocks.
+    /// @return Memory held by prefilled blocks
+    int64_t memory_used() const { return m_memory_used; }
+
+  private:
+
+    friend class ScanBlockPrefill;
+
+    /// Thread function.
+    void worker_loop();
+
+    /// Fills the next scan block of a scanner.
+    /// @param prefill Prefill state of scanner
+    void fill(ScanBlockPrefill *prefill);
+
+    /// Marks a fill as abandoned and wakes up any waiting request.
+    /// @param prefill Prefill state of scanner
+    void abandon(ScanBlockPrefill *prefill);
+
+    /// %Mutex protecting the queue
+    std::mutex m_mutex;
+
+    /// Signals that a fill was queued or the prefiller is stopping
+    std::condition_variable m_cond;
+
+    /// Queue of scanners waiting to be filled
+    std::deque<ScanBlockPrefillPtr> m_queue;
+
+    /// Set when the prefiller is stopping
+    bool m_shutdown {};
+
+    /// Maximum memory held by prefilled blocks
+    int64_t m_memory_limit {};
+
+    /// Memory held by prefilled blocks
+    std::atomic<int64_t> m_memory_used {};
+
+    /// Prefill threads
+    std::vector<std::thread> m_threads;
+  };
+
+  /// Smart pointer to ScanBlockPrefiller
+  typedef std::shared_ptr<ScanBlockPrefiller> ScanBlockPrefillerPtr;
+
+  /// @}
+
+}
+
+#endif // Hypertable_RangeServer_ScanBlockPrefiller_h
@@ -75,6 +75,8 @@ namespace Hypertable {
     typedef std::set<const char *, LtCstr, CstrAlloc> CstrRowSet;
     CstrRowSet rowset;
     uint32_t timeout_ms;
+    /// Scan block encoding flags requested by the client (see ScanBlock)
+    uint8_t scan_block_encoding {};
 
     /**
      * Constructor.
@@ -38,7 +38,8 @@ atomic<int> ScannerMap::ms_next_id {0};
 /**
  */
 int32_t ScannerMap::put(MergeScannerRangePtr &scanner, RangePtr &range,
-                         const TableIdentifier &table, ProfileDataScanner &profile_data) {
+                         const TableIdentifier &table, ProfileDataScanner &profile_data,
+                         ScanBlockPrefillPtr prefill) {
   lock_guard<mutex> lock(m_mutex);
   ScanInfo scaninfo;
   scaninfo.scanner = scanner;
@@ -46,6 +47,7 @@ int32_t ScannerMap::put(MergeScannerRangePtr &scanner, RangePtr &range,
   scaninfo.last_access_millis = get_timestamp_millis();
   scaninfo.table= table;
   scaninfo.profile_data = profile_data;
+  scaninfo.prefill = prefill;
   int32_t id = ++ms_next_id;
   m_scanner_map[id] = scaninfo;
   return id;
@@ -57,7 +59,8 @@ int32_t ScannerMap::put(MergeScannerRangePtr &scanner, RangePtr &range,
  */
 bool
 ScannerMap::get(int32_t id, MergeScannerRangePtr &scanner, RangePtr &range,
-                TableIdentifierManaged &table,ProfileDataScanner *profile_data){
+                TableIdentifierManaged &table,ProfileDataScanner *profile_data,
+                ScanBlockPrefillPtr *prefill) {
   lock_guard<mutex> lock(m_mutex);
   auto iter = m_scanner_map.find(id);
   if (iter == m_scanner_map.end())
@@ -67,6 +70,8 @@ ScannerMap::get(int32_t id, MergeScannerRangePtr &scanner, RangePtr &range,
   range = (*iter).second.range;
   table = (*iter).second.table;
   *profile_data = (*iter).second.profile_data;
+  if (prefill)
+    *prefill = (*iter).second.prefill;
   return true;
 }
 
@@ -29,6 +29,7 @@
 
 #include <Hypertable/RangeServer/MergeScannerRange.h>
 #include <Hypertable/RangeServer/Range.h>
+#include <Hypertable/RangeServer/ScanBlockPrefiller.h>
 
 #include <Hypertable/Lib/ProfileDataScanner.h>
 
@@ -54,10 +55,12 @@ namespace Hypertable {
      * @param range smart pointer to range object
      * @param table table identifier for this scanner
      * @param profile_data Scanner profile data
+     * @param prefill Scan block prefill state (may be null)
      * @return unique scanner ID
      */
     int32_t put(MergeScannerRangePtr &scanner, RangePtr &range,
-                 const TableIdentifier &table, ProfileDataScanner &profile_data);
+                 const TableIdentifier &table, ProfileDataScanner &profile_data,
+                 ScanBlockPrefillPtr prefill = ScanBlockPrefillPtr());
 
     /**
      * This method retrieves the scanner and range mapped to the given scanner
@@ -70,10 +73,13 @@ namespace Hypertable {
      * @param table reference to (managed) table identifier
      * @param profile_data Pointer to profile data structure populated by this
      * function
+     * @param prefill Address of pointer to hold scan block prefill state, or
+     * nullptr if not needed
      * @return true if found, false if not
      */
     bool get(int32_t id, MergeScannerRangePtr &scanner, RangePtr &range,
-             TableIdentifierManaged &table, ProfileDataScanner *profile_data);
+             TableIdentifierManaged &table, ProfileDataScanner *profile_data,
+             ScanBlockPrefillPtr *prefill = nullptr);
 
     /**
      * This method removes the entry in the scanner map corresponding to the
@@ -135,6 +141,8 @@ namespace Hypertable {
       TableIdentifierManaged table;
       /// Accumulated profile data
       ProfileDataScanner profile_data;
+      /// Scan block prefill state
+      ScanBlockPrefillPtr prefill;
     };
 
     /// Scanner map
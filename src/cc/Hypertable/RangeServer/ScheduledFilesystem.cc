@@ -0,0 +1,139 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Definitions for ScheduledFilesystem.
+/// This file contains method definitions for ScheduledFilesystem, a
+/// Filesystem that passes reads and appends through an IOScheduler.
+
+#include <Common/Compat.h>
+
+#include "ScheduledFilesystem.h"
+
+#include <AsyncComm/DispatchHandler.h>
+
+using namespace Hypertable;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+  /// Times an asynchronous foreground read.
+  /// Reports the time between construction and the arrival of the response
+  /// to the scheduler, forwards the response to the original handler and
+  /// then deletes itself.
+  class TimedReadHandler : public DispatchHandler {
+  public:
+    TimedReadHandler(IOSchedulerPtr &scheduler, size_t len,
+                     DispatchHandler *handler)
+      : m_scheduler(scheduler), m_len(len), m_handler(handler),
+        m_start(steady_clock::now()) { }
+
+    void handle(EventPtr &event) override {
+      m_scheduler->record_foreground_read(m_len, steady_clock::now() - m_start);
+      m_handler->handle(event);
+      delete this;
+    }
+
+  private:
+    IOSchedulerPtr m_scheduler;
+    size_t m_len;
+    DispatchHandler *m_handler;
+    steady_clock::time_point m_start;
+  };
+
+}
+
+
+void ScheduledFilesystem::read(int fd, size_t len, DispatchHandler *handler) {
+  if (IOScheduler::priority() == IOScheduler::Priority::BACKGROUND) {
+    m_scheduler->begin_read(len);
+    m_fs->read(fd, len, handler);
+    return;
+  }
+  TimedReadHandler *timed_handler = new TimedReadHandler(m_scheduler, len, handler);
+  try {
+    m_fs->read(fd, len, timed_handler);
+  }
+  catch (...) {
+    delete timed_handler;
+    throw;
+  }
+}
+
+
+size_t ScheduledFilesystem::read(int fd, void *dst, size_t len) {
+  if (IOScheduler::priority() == IOScheduler::Priority::BACKGROUND) {
+    m_scheduler->begin_read(len);
+    return m_fs->read(fd, dst, len);
+  }
+  auto start = steady_clock::now();
+  size_t nread = m_fs->read(fd, dst, len);
+  m_scheduler->record_foreground_read(nread, steady_clock::now() - start);
+  return nread;
+}
+
+
+void ScheduledFilesystem::pread(int fd, size_t amount, uint64_t offset,
+                                bool verify_checksum, DispatchHandler *handler) {
+  if (IOScheduler::priority() == IOScheduler::Priority::BACKGROUND) {
+    m_scheduler->begin_read(amount);
+    m_fs->pread(fd, amount, offset, verify_checksum, handler);
+    return;
+  }
+  TimedReadHandler *timed_handler = new TimedReadHandler(m_scheduler, amount, handler);
+  try {
+    m_fs->pread(fd, amount, offset, verify_checksum, timed_handler);
+  }
+  catch (...) {
+    delete timed_handler;
+    throw;
+  }
+}
+
+
+size_t ScheduledFilesystem::pread(int fd, void *dst, size_t len,
+                                  uint64_t offset, bool verify_checksum) {
+  if (IOScheduler::priority() == IOScheduler::Priority::BACKGROUND) {
+    m_scheduler->begin_read(len);
+    return m_fs->pread(fd, dst, len, offset, verify_checksum);
+  }
+  auto start = steady_clock::now();
+  size_t nread = m_fs->pread(fd, dst, len, offset, verify_checksum);
+  m_scheduler->record_foreground_read(nread, steady_clock::now() - start);
+  return nread;
+}
+
+
+bool ScheduledFilesystem::pread_view(int fd, size_t len, uint64_t offset,
+                                     EventPtr &event) {
+  if (IOScheduler::priority() == IOScheduler::Priority::BACKGROUND) {
+    if (!m_fs->pread_view(fd, len, offset, event))
+      return false;
+    m_scheduler->begin_read(len);
+    return true;
+  }
+  auto start = steady_clock::now();
+  if (!m_fs->pread_view(fd, len, offset, event))
+    return false;
+  m_scheduler->record_foreground_read(len, steady_clock::now() - start);
+  return true;
+}
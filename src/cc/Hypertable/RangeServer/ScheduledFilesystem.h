@@ -0,0 +1,251 @@
+/* -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Declarations for ScheduledFilesystem.
+/// This file contains type declarations for ScheduledFilesystem, a
+/// Filesystem that passes reads and appends through an IOScheduler.
+
+#ifndef Hypertable_RangeServer_ScheduledFilesystem_h
+#define Hypertable_RangeServer_ScheduledFilesystem_h
+
+#include <Hypertable/RangeServer/IOScheduler.h>
+
+#include <Common/Filesystem.h>
+
+namespace Hypertable {
+
+  /// @addtogroup RangeServer
+  /// @{
+
+  /// %Filesystem that passes reads and appends through an IOScheduler.
+  /// All requests are forwarded to an underlying Filesystem.  Before a read
+  /// or append is issued, IOScheduler::begin_read() or
+  /// IOScheduler::begin_append() is called, which blocks background
+  /// requests until the background rate allows them to proceed.
+  /// Foreground reads are timed and reported with
+  /// IOScheduler::record_foreground_read(); asynchronous reads are timed
+  /// until their response handler is invoked.
+  class ScheduledFilesystem : public Filesystem {
+  public:
+
+    /// Constructor.
+    /// @param fs Underlying filesystem
+    /// @param scheduler I/O scheduler
+    ScheduledFilesystem(FilesystemPtr fs, IOSchedulerPtr scheduler)
+      : m_fs(fs), m_scheduler(scheduler) { }
+
+    /// Returns underlying filesystem.
+    /// @return Underlying filesystem
+    FilesystemPtr underlying() { return m_fs; }
+
+    void open(const String &name, uint32_t flags,
+              DispatchHandler *handler) override {
+      m_fs->open(name, flags, handler);
+    }
+
+    int open(const String &name, uint32_t flags) override {
+      return m_fs->open(name, flags);
+    }
+
+    int open_buffered(const String &name, uint32_t flags, uint32_t buf_size,
+                      uint32_t outstanding, uint64_t start_offset = 0,
+                      uint64_t end_offset = 0) override {
+      return m_fs->open_buffered(name, flags, buf_size, outstanding,
+                                 start_offset, end_offset);
+    }
+
+    void decode_response_open(EventPtr &event, int32_t *fd) override {
+      m_fs->decode_response_open(event, fd);
+    }
+
+    void create(const String &name, uint32_t flags, int32_t bufsz,
+                int32_t replication, int64_t blksz,
+                DispatchHandler *handler) override {
+      m_fs->create(name, flags, bufsz, replication, blksz, handler);
+    }
+
+    int create(const String &name, uint32_t flags, int32_t bufsz,
+               int32_t replication, int64_t blksz) override {
+      return m_fs->create(name, flags, bufsz, replication, blksz);
+    }
+
+    void decode_response_create(EventPtr &event, int32_t *fd) override {
+      m_fs->decode_response_create(event, fd);
+    }
+
+    void close(int fd, DispatchHandler *handler) override {
+      m_fs->close(fd, handler);
+    }
+
+    void close(int fd) override { m_fs->close(fd); }
+
+    void read(int fd, size_t len, DispatchHandler *handler) override;
+
+    size_t read(int fd, void *dst, size_t len) override;
+
+    void decode_response_read(EventPtr &event, const void **buffer,
+                              uint64_t *offset, uint32_t *length) override {
+      m_fs->decode_response_read(event, buffer, offset, length);
+    }
+
+    void append(int fd, StaticBuffer &buffer, Flags flags,
+                DispatchHandler *handler) override {
+      m_scheduler->begin_append(buffer.size);
+      m_fs->append(fd, buffer, flags, handler);
+    }
+
+    size_t append(int fd, StaticBuffer &buffer,
+                  Flags flags = Flags::NONE) override {
+      m_scheduler->begin_append(buffer.size);
+      return m_fs->append(fd, buffer, flags);
+    }
+
+    void decode_response_append(EventPtr &event, uint64_t *offset,
+                                uint32_t *length) override {
+      m_fs->decode_response_append(event, offset, length);
+    }
+
+    void seek(int fd, uint64_t offset, DispatchHandler *handler) override {
+      m_fs->seek(fd, offset, handler);
+    }
+
+    void seek(int fd, uint64_t offset) override { m_fs->seek(fd, offset); }
+
+    void remove(const String &name, DispatchHandler *handler) override {
+      m_fs->remove(name, handler);
+    }
+
+    void remove(const String &name, bool force = true) override {
+      m_fs->remove(name, force);
+    }
+
+    void length(const String &name, bool accurate,
+                DispatchHandler *handler) override {
+      m_fs->length(name, accurate, handler);
+    }
+
+    int64_t length(const String &name, bool accurate = true) override {
+      return m_fs->length(name, accurate);
+    }
+
+    int64_t decode_response_length(EventPtr &event) override {
+      return m_fs->decode_response_length(event);
+    }
+
+    void pread(int fd, size_t amount, uint64_t offset, bool verify_checksum,
+               DispatchHandler *handler) override;
+
+    size_t pread(int fd, void *dst, size_t len, uint64_t offset,
+                 bool verify_checksum = true) override;
+
+    void decode_response_pread(EventPtr &event, const void **buffer,
+                               uint64_t *offset, uint32_t *length) override {
+      m_fs->decode_response_pread(event, buffer, offset, length);
+    }
+
+    bool pread_view(int fd, size_t len, uint64_t offset,
+                    EventPtr &event) override;
+
+    void mkdirs(const String &name, DispatchHandler *handler) override {
+      m_fs->mkdirs(name, handler);
+    }
+
+    void mkdirs(const String &name) override { m_fs->mkdirs(name); }
+
+    void rmdir(const String &name, DispatchHandler *handler) override {
+      m_fs->rmdir(name, handler);
+    }
+
+    void rmdir(const String &name, bool force = true) override {
+      m_fs->rmdir(name, force);
+    }
+
+    void readdir(const String &name, DispatchHandler *handler) override {
+      m_fs->readdir(name, handler);
+    }
+
+    void readdir(const String &name, std::vector<Dirent> &listing) override {
+      m_fs->readdir(name, listing);
+    }
+
+    void decode_response_readdir(EventPtr &event,
+                                 std::vector<Dirent> &listing) override {
+      m_fs->decode_response_readdir(event, listing);
+    }
+
+    void flush(int fd, DispatchHandler *handler) override {
+      m_fs->flush(fd, handler);
+    }
+
+    void flush(int fd) override { m_fs->flush(fd); }
+
+    void sync(int fd) override { m_fs->sync(fd); }
+
+    void exists(const String &name, DispatchHandler *handler) override {
+      m_fs->exists(name, handler);
+    }
+
+    bool exists(const String &name) override { return m_fs->exists(name); }
+
+    bool decode_response_exists(EventPtr &event) override {
+      return m_fs->decode_response_exists(event);
+    }
+
+    void rename(const String &src, const String &dst,
+                DispatchHandler *handler) override {
+      m_fs->rename(src, dst, handler);
+    }
+
+    void rename(const String &src, const String &dst) override {
+      m_fs->rename(src, dst);
+    }
+
+    void status(Status &status, Timer *timer=0) override {
+      m_fs->status(status, timer);
+    }
+
+    void decode_response_status(EventPtr &event, Status &status) override {
+      m_fs->decode_response_status(event, status);
+    }
+
+    void debug(int32_t command, StaticBuffer &serialized_parameters) override {
+      m_fs->debug(command, serialized_parameters);
+    }
+
+    void debug(int32_t command, StaticBuffer &serialized_parameters,
+               DispatchHandler *handler) override {
+      m_fs->debug(command, serialized_parameters, handler);
+    }
+
+  private:
+
+    /// Underlying filesystem
+    FilesystemPtr m_fs;
+
+    /// I/O scheduler
+    IOSchedulerPtr m_scheduler;
+  };
+
+  /// @}
+}
+
+#endif // Hypertable_RangeServer_ScheduledFilesystem_h
@@ -27,6 +27,7 @@
 
 #include <AsyncComm/Clock.h>
 
+#include <chrono>
 #include <vector>
 
 namespace Hypertable {
@@ -60,6 +61,12 @@ namespace Hypertable {
     uint32_t total_added {};
     uint32_t total_syncs {};
     uint64_t total_bytes_added {};
+    /// Amount of update data written to the commit log
+    uint64_t commit_bytes {};
+    /// Flag indicating commit log must be synced before responding
+    bool log_needs_syncing {};
+    /// Time at which updates were written to the commit log
+    std::chrono::steady_clock::time_point commit_time;
   };
 
   /// @}
@@ -58,9 +58,11 @@ UpdatePipeline::UpdatePipeline(ContextPtr &context, QueryCachePtr &query_cache,
   m_maintenance_pause_interval = m_context->props->get_i32("Hypertable.RangeServer.Testing.MaintenanceNeeded.PauseInterval");
   m_update_delay = m_context->props->get_i32("Hypertable.RangeServer.UpdateDelay", 0);
   m_max_clock_skew = m_context->props->get_i32("Hypertable.RangeServer.ClockSkew.Max");
-  m_threads.reserve(3);
+  m_target_latency = chrono::milliseconds(m_context->props->get_i32("Hypertable.RangeServer.CommitLog.GroupCommit.TargetLatency"));
+  m_threads.reserve(4);
   m_threads.push_back( thread(&UpdatePipeline::qualify_and_transform, this) );
   m_threads.push_back( thread(&UpdatePipeline::commit, this) );
+  m_threads.push_back( thread(&UpdatePipeline::sync, this) );
   m_threads.push_back( thread(&UpdatePipeline::add_and_respond, this) );
 }
 
@@ -76,11 +78,24 @@ void UpdatePipeline::shutdown() {
   m_shutdown = true;
   m_qualify_queue_cond.notify_all();
   m_commit_queue_cond.notify_all();
+  m_sync_queue_cond.notify_all();
   m_response_queue_cond.notify_all();
   for (std::thread &t : m_threads)
     t.join();
 }
 
+void UpdatePipeline::get_commit_stats(CommitStats &stats) {
+  lock_guard<mutex> lock(m_stats_mutex);
+  stats.syncs = m_syncs;
+  stats.batch_size_p50 = m_batch_size_histogram.percentile(50);
+  stats.batch_size_p99 = m_batch_size_histogram.percentile(99);
+  stats.sync_latency_p50 = m_sync_latency_histogram.percentile(50);
+  stats.sync_latency_p99 = m_sync_latency_histogram.percentile(99);
+  m_syncs = 0;
+  m_batch_size_histogram.clear();
+  m_sync_latency_histogram.clear();
+}
+
 
 void UpdatePipeline::qualify_and_transform() {
   UpdateContext *uc;
@@ -516,11 +531,8 @@ void UpdatePipeline::qualify_and_transform() {
 void UpdatePipeline::commit() {
   UpdateContext *uc;
   SerializedKey key;
-  std::list<UpdateContext *> coalesce_queue;
-  uint64_t coalesce_amount = 0;
   int error = Error::OK;
   uint32_t committed_transfer_data;
-  bool log_needs_syncing {};
 
   while (true) {
 
@@ -537,7 +549,6 @@ void UpdatePipeline::commit() {
     }
 
     committed_transfer_data = 0;
-    log_needs_syncing = false;
 
     // Commit ROOT mutations
     if (uc->root_buf.ptr > uc->root_buf.mark) {
@@ -549,7 +560,7 @@ void UpdatePipeline::commit() {
 
     for (UpdateRecTable *table_update : uc->updates) {
 
-      coalesce_amount += table_update->total_buffer_size;
+      uc->commit_bytes += table_update->total_buffer_size;
 
       // Iterate through all of the ranges, committing any transferring updates
       for (auto iter = table_update->range_map.begin(); iter != table_update->range_map.end(); ++iter) {
@@ -575,7 +586,7 @@ void UpdatePipeline::commit() {
         Lib::RangeServer::Protocol::UPDATE_FLAG_NO_LOG;
 
       if ((table_update->flags & NO_LOG_SYNC_FLAGS) == 0)
-        log_needs_syncing = true;
+        uc->log_needs_syncing = true;
 
       // Commit valid (go) mutations
       if ((table_update->flags & Lib::RangeServer::Protocol::UPDATE_FLAG_NO_LOG) == 0 &&
@@ -594,21 +605,63 @@ void UpdatePipeline::commit() {
 
     }
 
+    uc->commit_time = chrono::steady_clock::now();
+
+    // Enqueue update
+    {
+      lock_guard<std::mutex> lock(m_sync_queue_mutex);
+      m_sync_queue.push_back(uc);
+      m_sync_queue_bytes += uc->commit_bytes;
+      m_sync_queue_cond.notify_all();
+    }
+  }
+}
+
+void UpdatePipeline::sync() {
+  std::list<UpdateContext *> group;
+  uint64_t group_bytes;
+  int error = Error::OK;
+
+  while (true) {
+
+    // Dequeue all updates written since the previous sync
+    {
+      unique_lock<std::mutex> lock(m_sync_queue_mutex);
+      m_sync_queue_cond.wait(lock, [this](){
+          return !m_sync_queue.empty() || m_shutdown; });
+      if (m_shutdown)
+        return;
+
+      // With a latency target, hold the sync back for updates queued behind
+      // it as long as the oldest one can still make the target
+      if (m_target_latency.count() > 0) {
+        auto deadline = m_sync_queue.front()->commit_time + m_target_latency -
+          chrono::microseconds(m_sync_latency_estimate);
+        m_sync_queue_cond.wait_until(lock, deadline, [this](){
+            return m_shutdown || m_commit_queue_count == 0 ||
+              m_sync_queue_bytes >= m_update_coalesce_limit; });
+        if (m_shutdown)
+          return;
+      }
+
+      group.swap(m_sync_queue);
+      group_bytes = m_sync_queue_bytes;
+      m_sync_queue_bytes = 0;
+    }
+
     bool do_sync = false;
-    if (log_needs_syncing) {
-      if (m_commit_queue_count > 0 && coalesce_amount < m_update_coalesce_limit) {
-        coalesce_queue.push_back(uc);
-        continue;
+    for (UpdateContext *uc : group) {
+      if (uc->log_needs_syncing) {
+        do_sync = true;
+        break;
       }
-      do_sync = true;
     }
-    else if (!coalesce_queue.empty())
-      do_sync = true;
 
     // Now sync the commit log if needed
     if (do_sync) {
       size_t retry_count {};
-      uc->total_syncs++;
+      auto start_time = chrono::steady_clock::now();
+      group.back()->total_syncs++;
 
       while (true) {
 
@@ -631,18 +684,23 @@ void UpdatePipeline::commit() {
         else
           break;
       }
+
+      int64_t latency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start_time).count();
+      if (m_sync_latency_estimate == 0)
+        m_sync_latency_estimate = latency;
+      else
+        m_sync_latency_estimate = (7*m_sync_latency_estimate + latency) / 8;
+
+      lock_guard<std::mutex> lock(m_stats_mutex);
+      m_syncs++;
+      m_batch_size_histogram.add(group_bytes);
+      m_sync_latency_histogram.add(latency);
     }
 
-    // Enqueue update
+    // Enqueue updates
     {
       lock_guard<std::mutex> lock(m_response_queue_mutex);
-      coalesce_queue.push_back(uc);
-      while (!coalesce_queue.empty()) {
-        uc = coalesce_queue.front();
-        coalesce_queue.pop_front();
-        m_response_queue.push_back(uc);
-      }
-      coalesce_amount = 0;
+      m_response_queue.splice(m_response_queue.end(), group);
       m_response_queue_cond.notify_all();
     }
   }
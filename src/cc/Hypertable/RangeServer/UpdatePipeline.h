@@ -37,7 +37,10 @@
 #include <Common/ByteString.h>
 #include <Common/DynamicBuffer.h>
 #include <Common/Filesystem.h>
+#include <Common/Histogram.h>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -48,10 +51,27 @@ namespace Hypertable {
   /// @addtogroup RangeServer
   /// @{
 
-  /// Three-staged, multithreaded update pipeline.
+  /// Four-staged, multithreaded update pipeline.
+  /// Commit log writes and syncs are done by separate stages, so updates
+  /// that arrive while the log is being synced are written behind the sync
+  /// and covered together by the next one (group commit).
   class UpdatePipeline {
   public:
 
+    /// Group commit statistics.
+    struct CommitStats {
+      /// Number of commit log syncs
+      uint64_t syncs {};
+      /// Median amount of update data covered by a sync
+      uint64_t batch_size_p50 {};
+      /// 99th percentile amount of update data covered by a sync
+      uint64_t batch_size_p99 {};
+      /// Median sync latency in microseconds
+      uint64_t sync_latency_p50 {};
+      /// 99th percentile sync latency in microseconds
+      uint64_t sync_latency_p99 {};
+    };
+
     /// Constructor.
     /// Initializes the pipeline as follows:
     ///   - Sets #m_update_coalesce_limit to the value of the
@@ -63,9 +83,12 @@ namespace Hypertable {
     ///     <code>Hypertable.RangeServer.UpdateDelay</code> property.
     ///   - Sets #m_max_clock_skew to the value of the
     ///     <code>Hypertable.RangeServer.ClockSkew.Max</code> property.
-    ///   - Creates and starts the three pipeline threads using
-    ///     qualify_and_transform(), commit(), and add_and_respond() as the
-    ///     thread functions, respectively.
+    ///   - Sets #m_target_latency to the value of the
+    ///     <code>Hypertable.RangeServer.CommitLog.GroupCommit.TargetLatency</code>
+    ///     property.
+    ///   - Creates and starts the four pipeline threads using
+    ///     qualify_and_transform(), commit(), sync(), and add_and_respond()
+    ///     as the thread functions, respectively.
     /// @param context %Range server context
     /// @param query_cache Query cache
     /// @param timer_handler Timer handler
@@ -79,10 +102,15 @@ namespace Hypertable {
     void add(UpdateContext *uc);
 
     /// Shuts down the pipeline
-    /// Sets #m_shutdown to <i>true</i>, signals the three pipeline condition
+    /// Sets #m_shutdown to <i>true</i>, signals the four pipeline condition
     /// variables, and performs a join on each pipeline thread.
     void shutdown();
 
+    /// Gets group commit statistics.
+    /// Statistics cover the syncs since the previous call.
+    /// @param stats Address of structure to hold statistics
+    void get_commit_stats(CommitStats &stats);
+
   private:
 
     /// Thread function for stage 1 of update pipeline.
@@ -103,14 +131,26 @@ namespace Hypertable {
     ///   - Writes the key/value pairs that were buffered in the previous stage
     ///     to the appropriate
     ///     commit log (or transfer log) <b>without</b> calling sync().
-    ///   - Once either #m_update_coalesce_limit amount of updates has been
-    ///     collected or when #m_qualify_queue becomes empty, sync() is called
-    ///     on the commit (or transfer) log.
-    ///   - Adds the UpdateContext objects to #m_response_queue and signals
-    ///     #m_response_queue_cond.
+    ///   - Records whether the commit log needs to be synced for the update.
+    ///   - Adds the UpdateContext object to #m_sync_queue and signals
+    ///     #m_sync_queue_cond.
     void commit();
 
     /// Thread function for stage 3 of update pipeline.
+    /// Takes all of the UpdateContext objects on the input queue
+    /// #m_sync_queue, which were written while the previous sync was in
+    /// progress, and does the following:
+    ///   - If #m_target_latency is non-zero and more updates are queued for
+    ///     stage 2, waits for them to be written as long as the oldest update
+    ///     can still be synced within the target latency and less than
+    ///     #m_update_coalesce_limit of update data has been collected.
+    ///   - Syncs the commit log once if any of the updates requires it and
+    ///     records batch size and sync latency.
+    ///   - Adds the UpdateContext objects to #m_response_queue and signals
+    ///     #m_response_queue_cond.
+    void sync();
+
+    /// Thread function for stage 4 of update pipeline.
     /// For each UpdateContext object on the input queue #m_response_queue, this
     /// function does the following:
     ///   - Adds the key/value pairs that were commited in the previous state to
@@ -150,18 +190,30 @@ namespace Hypertable {
     std::condition_variable m_commit_queue_cond;
 
     /// Count of objects in stage 2 input queue
-    int32_t m_commit_queue_count {};
+    std::atomic<int32_t> m_commit_queue_count {};
 
     /// Stage 2 input queue
     std::list<UpdateContext *> m_commit_queue;
 
     /// %Mutex protecting stage 3 input queue
-    std::mutex m_response_queue_mutex;
+    std::mutex m_sync_queue_mutex;
 
     /// Condition variable signaling addition to stage 3 input queue
-    std::condition_variable m_response_queue_cond;
+    std::condition_variable m_sync_queue_cond;
 
     /// Stage 3 input queue
+    std::list<UpdateContext *> m_sync_queue;
+
+    /// Amount of update data in stage 3 input queue
+    uint64_t m_sync_queue_bytes {};
+
+    /// %Mutex protecting stage 4 input queue
+    std::mutex m_response_queue_mutex;
+
+    /// Condition variable signaling addition to stage 4 input queue
+    std::condition_variable m_response_queue_cond;
+
+    /// Stage 4 input queue
     std::list<UpdateContext *> m_response_queue;
 
     /// Update pipeline threads
@@ -173,6 +225,24 @@ namespace Hypertable {
     /// Commit log coalesce limit
     uint64_t m_update_coalesce_limit {};
 
+    /// Group commit target latency
+    std::chrono::microseconds m_target_latency {};
+
+    /// Moving average of sync latency in microseconds
+    int64_t m_sync_latency_estimate {};
+
+    /// %Mutex protecting commit statistics
+    std::mutex m_stats_mutex;
+
+    /// Number of syncs since last call to get_commit_stats()
+    uint64_t m_syncs {};
+
+    /// Amount of update data covered by each sync
+    Histogram m_batch_size_histogram;
+
+    /// Latency of each sync in microseconds
+    Histogram m_sync_latency_histogram;
+
     /// Millisecond pause time at the end of the pipeline (TESTING)
     int32_t m_maintenance_pause_interval {};
 
@@ -0,0 +1,590 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 3 of the
+ * License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/// @file
+/// Bulk loader.
+/// This file contains the ht_bulk_load program which loads a TSV file into a
+/// table by sorting it externally, writing one CellStore per range and access
+/// group directly to the FS, and asking the RangeServers to link the
+/// CellStores into their ranges.  This bypasses the commit log, the CellCache
+/// and the compactions that would otherwise rewrite the data.
+
+#include <Common/Compat.h>
+
+#include <Hypertable/RangeServer/CellStoreFactory.h>
+#include <Hypertable/RangeServer/CellStoreV8.h>
+#include <Hypertable/RangeServer/Config.h>
+#include <Hypertable/RangeServer/Global.h>
+#include <Hypertable/RangeServer/ScanContext.h>
+
+#include <Hypertable/Lib/Client.h>
+#include <Hypertable/Lib/Key.h>
+#include <Hypertable/Lib/KeySpec.h>
+#include <Hypertable/Lib/LoadDataEscape.h>
+#include <Hypertable/Lib/LoadDataSourceFactory.h>
+#include <Hypertable/Lib/RangeLocator.h>
+#include <Hypertable/Lib/RangeServer/Client.h>
+#include <Hypertable/Lib/SerializedKey.h>
+
+#include <FsBroker/Lib/Client.h>
+
+#include <AsyncComm/Comm.h>
+#include <AsyncComm/ConnectionManager.h>
+
+#include <Common/ByteString.h>
+#include <Common/DynamicBuffer.h>
+#include <Common/Init.h>
+#include <Common/Logger.h>
+#include <Common/System.h>
+#include <Common/Time.h>
+#include <Common/Timer.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace Hypertable;
+using namespace Config;
+using namespace std;
+
+namespace {
+
+  struct AppPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc("Usage: %s [options] <table> <input-file>\n\n"
+        "Loads <input-file>, a local file in LOAD DATA INFILE format, into "
+        "<table>.\nThe input is sorted on local disk, split by the current "
+        "range boundaries of\n<table> and written as CellStores directly to "
+        "the FS.  The CellStores of each\nrange are then linked into the "
+        "range, bypassing the commit log and the\nCellCache.  Deletes and "
+        "counter columns are not supported.\n\nOptions").add_options()
+        ("namespace", str()->default_value("/"), "Namespace of <table>")
+        ("memory-limit", i64()->default_value(256*1024*1024),
+         "Amount of input to sort in memory before spilling a run to disk")
+        ("tmp-dir", str()->default_value("/tmp"),
+         "Local directory to hold sorted runs")
+        ("no-escape", "Don't unescape row, qualifier and value fields")
+        ;
+      cmdline_hidden_desc().add_options()
+        ("table", str(), "")
+        ("input-file", str(), "");
+      cmdline_positional_desc().add("table", 1).add("input-file", 1);
+    }
+    static void init() {
+      if (!has("table") || !has("input-file")) {
+        HT_ERROR_OUT << "table and input-file required" << HT_END;
+        cout << cmdline_desc() << endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+  };
+
+  typedef Meta::list<AppPolicy, FsClientPolicy, DefaultCommPolicy> Policies;
+
+  /// Reads key/value pairs back from a sorted run file.
+  /// Each record is an i32 length followed by a serialized key and a
+  /// serialized value.
+  class RunReader {
+  public:
+    RunReader(const String &fname) : m_in(fname.c_str(), ios::binary) {
+      if (!m_in)
+        HT_THROWF(Error::EXTERNAL, "Unable to open sorted run %s",
+                  fname.c_str());
+    }
+
+    /// Advances to next key/value pair.
+    /// @return <i>false</i> if run is exhausted, <i>true</i> otherwise
+    bool next() {
+      uint32_t len;
+      if (!m_in.read((char *)&len, sizeof(len)))
+        return false;
+      m_record.resize(len);
+      if (!m_in.read(&m_record[0], len))
+        HT_THROW(Error::EXTERNAL, "Truncated sorted run");
+      key.ptr = (const uint8_t *)m_record.data();
+      value.ptr = key.ptr + key.length();
+      return true;
+    }
+
+    /// Current key
+    SerializedKey key;
+
+    /// Current value
+    ByteString value;
+
+  private:
+    ifstream m_in;
+    string m_record;
+  };
+
+  typedef std::shared_ptr<RunReader> RunReaderPtr;
+
+  /// Orders run readers so that the smallest key is on top of the heap.
+  struct GtRunReader {
+    bool operator()(const RunReaderPtr &r1, const RunReaderPtr &r2) const {
+      return r1->key > r2->key;
+    }
+  };
+
+  /// Sorts buffered key/value pairs and writes them to a run file.
+  /// @param buf Buffer holding serialized key/value pairs
+  /// @param offsets Offsets into <code>buf</code> of the key/value pairs
+  /// @param fname Pathname of run file
+  void write_run(DynamicBuffer &buf, vector<size_t> &offsets,
+                 const String &fname) {
+    const uint8_t *base = buf.base;
+    sort(offsets.begin(), offsets.end(),
+         [base](size_t o1, size_t o2) {
+           return SerializedKey(base + o1) < SerializedKey(base + o2);
+         });
+    ofstream out(fname.c_str(), ios::binary | ios::trunc);
+    for (size_t offset : offsets) {
+      SerializedKey key(base + offset);
+      ByteString value(base + offset + key.length());
+      uint32_t len = key.length() + value.length();
+      out.write((const char *)&len, sizeof(len));
+      out.write((const char *)key.ptr, len);
+    }
+    if (!out.flush())
+      HT_THROWF(Error::EXTERNAL, "Problem writing sorted run %s",
+                fname.c_str());
+    buf.clear();
+    offsets.clear();
+  }
+
+  /// Builds the CellStore properties of an access group.
+  /// Mirrors AccessGroup::update_schema() so that bulk loaded CellStores
+  /// are indistinguishable from compacted ones.
+  /// @param ag_spec Access group specification
+  /// @return CellStore properties
+  PropertiesPtr cellstore_properties(AccessGroupSpec *ag_spec) {
+    PropertiesPtr props = make_shared<Properties>();
+    props->set("compressor", ag_spec->get_option_compressor());
+    props->set("blocksize", ag_spec->get_option_blocksize());
+    if (ag_spec->get_option_replication() != -1)
+      props->set("replication", (int32_t)ag_spec->get_option_replication());
+    if (!ag_spec->get_option_bloom_filter().empty())
+      AccessGroupOptions::parse_bloom_filter(ag_spec->get_option_bloom_filter(),
+                                             props);
+    else
+      AccessGroupOptions::parse_bloom_filter(
+        get_str("Hypertable.RangeServer.CellStore.DefaultBloomFilter"), props);
+    return props;
+  }
+
+  /// CellStores being written for one range.
+  struct RangeStores {
+    RangeLocationInfo location;
+    /// Row that was used to locate the range
+    String located_row;
+    vector<String> access_groups;
+    vector<String> files;
+    vector<CellStorePtr> cellstores;
+    map<String, size_t> index;
+  };
+
+  /// Maximum number of times the CellStores of a range are relocated
+  /// because the range was no longer found where it was located.
+  const int MAX_RELOCATIONS = 10;
+
+  /// State shared by all RangeWriter objects of a load.
+  struct LoadContext {
+    TableIdentifier *table_id {};
+    SchemaPtr schema;
+    RangeLocatorPtr range_locator;
+    Lib::RangeServer::Client *rs_client {};
+    int32_t timeout_ms {};
+    String staging_dir;
+    map<String, PropertiesPtr> ag_props;
+    /// Bound on the cell count estimate given to CellStoreV8::create()
+    int64_t range_cells_estimate {};
+    /// Number of CellStore files created
+    size_t file_count {};
+    /// Number of ranges linked
+    size_t range_count {};
+  };
+
+  /// Writes cells into one CellStore per range and access group and links
+  /// the CellStores of each range into it.
+  /// A range may split or move between the time it is located and the time
+  /// its CellStores are linked, in which case the RangeServer responds with
+  /// Error::RANGESERVER_RANGE_NOT_FOUND.  The range is then located again.
+  /// If only its location changed, the link is retried at the new location,
+  /// otherwise the CellStores are read back and re-split by the new range
+  /// boundaries.
+  class RangeWriter {
+  public:
+
+    /// Constructor.
+    /// @param ctx Load context
+    /// @param cells_remaining Number of cells still to be added, used to
+    /// size bloom filters
+    /// @param relocations Number of relocations leading up to this writer
+    RangeWriter(LoadContext &ctx, int64_t cells_remaining, int relocations=0)
+      : m_ctx(ctx), m_cells_remaining(cells_remaining),
+        m_relocations(relocations) { }
+
+    /// Adds a cell.
+    /// Adds <code>cell</code> to the CellStore of its access group in the
+    /// range that contains its row, locating the range if it is not already
+    /// open.
+    /// @param cell Cell key
+    /// @param value Cell value
+    void add(const Key &cell, const ByteString &value) {
+      RangeStores *stores = find(cell.row);
+      if (stores == 0) {
+        unique_ptr<RangeStores> new_stores(new RangeStores());
+        Timer timer(m_ctx.timeout_ms, true);
+        m_ctx.range_locator->find_loop(m_ctx.table_id, cell.row,
+                                       &new_stores->location, timer, false);
+        new_stores->located_row = cell.row;
+        stores = new_stores.get();
+        m_ranges[stores->location.end_row] = std::move(new_stores);
+      }
+
+      const String &ag_name = m_ctx.schema->get_column_family(
+          cell.column_family_code)->get_access_group();
+      auto iter = stores->index.find(ag_name);
+      if (iter == stores->index.end()) {
+        String fname = format("%s/%s-%u", m_ctx.staging_dir.c_str(),
+                              ag_name.c_str(), (unsigned)m_ctx.file_count++);
+        CellStorePtr cellstore = make_shared<CellStoreV8>(Global::dfs.get(),
+                                                          m_ctx.schema);
+        cellstore->create(fname.c_str(),
+                          std::min(m_cells_remaining,
+                                   m_ctx.range_cells_estimate) + 1,
+                          m_ctx.ag_props[ag_name], m_ctx.table_id);
+        iter = stores->index.insert(make_pair(ag_name,
+                                              stores->cellstores.size())).first;
+        stores->access_groups.push_back(ag_name);
+        stores->files.push_back(fname);
+        stores->cellstores.push_back(cellstore);
+      }
+      stores->cellstores[iter->second]->add(cell, value);
+      if (m_cells_remaining > 0)
+        m_cells_remaining--;
+    }
+
+    /// Links open ranges that end before a row.
+    /// Called with the row of each cell when cells are added in order.
+    /// @param row Row key
+    void link_before(const char *row) {
+      while (!m_ranges.empty() && m_ranges.begin()->first.compare(row) < 0) {
+        link(*m_ranges.begin()->second);
+        m_ranges.erase(m_ranges.begin());
+      }
+    }
+
+    /// Links all open ranges.
+    void link_all() {
+      for (auto &entry : m_ranges)
+        link(*entry.second);
+      m_ranges.clear();
+    }
+
+  private:
+
+    /// Finds open range that contains a row.
+    /// @param row Row key
+    /// @return Open range containing <code>row</code>, or 0 if none
+    RangeStores *find(const char *row) {
+      auto iter = m_ranges.lower_bound(row);
+      if (iter == m_ranges.end() ||
+          iter->second->location.start_row.compare(row) >= 0)
+        return 0;
+      return iter->second.get();
+    }
+
+    /// Finalizes and links the CellStores of a range.
+    /// @param stores CellStores of range
+    void link(RangeStores &stores) {
+      for (auto &cs : stores.cellstores)
+        cs->finalize(m_ctx.table_id);
+      stores.cellstores.clear();
+
+      int relocations = m_relocations;
+      while (true) {
+        try {
+          Timer timer(m_ctx.timeout_ms, true);
+          RangeSpec range_spec(stores.location.start_row.c_str(),
+                               stores.location.end_row.c_str());
+          m_ctx.rs_client->link_cellstores(stores.location.addr,
+                                           *m_ctx.table_id, range_spec,
+                                           stores.access_groups, stores.files,
+                                           timer);
+          m_ctx.range_count++;
+          return;
+        }
+        catch (Exception &e) {
+          if (e.code() != Error::RANGESERVER_RANGE_NOT_FOUND ||
+              relocations == MAX_RELOCATIONS)
+            throw;
+          HT_WARNF("Range %s[%s..%s] not found at %s, relocating",
+                   m_ctx.table_id->id, stores.location.start_row.c_str(),
+                   stores.location.end_row.c_str(),
+                   stores.location.addr.to_str().c_str());
+          relocations++;
+        }
+
+        RangeLocationInfo location;
+        Timer timer(m_ctx.timeout_ms, true);
+        m_ctx.range_locator->find_loop(m_ctx.table_id,
+                                       stores.located_row.c_str(), &location,
+                                       timer, true);
+        if (location.start_row != stores.location.start_row ||
+            location.end_row != stores.location.end_row)
+          break;
+        stores.location = location;
+      }
+
+      // The range has split, re-split its CellStores by the new boundaries
+      RangeWriter writer(m_ctx, m_ctx.range_cells_estimate, relocations);
+      ScanContextPtr scan_ctx = make_shared<ScanContext>();
+      Key key;
+      ByteString value;
+      for (auto &fname : stores.files) {
+        CellStorePtr cellstore = CellStoreFactory::open(fname, 0, 0);
+        CellListScannerPtr scanner = cellstore->create_scanner(scan_ctx.get());
+        while (scanner->get(key, value)) {
+          writer.add(key, value);
+          scanner->forward();
+        }
+      }
+      writer.link_all();
+      for (auto &fname : stores.files)
+        Global::dfs->remove(fname);
+    }
+
+    /// Load context
+    LoadContext &m_ctx;
+
+    /// Number of cells still to be added
+    int64_t m_cells_remaining;
+
+    /// Number of relocations leading up to this writer
+    int m_relocations;
+
+    /// Open ranges, keyed by end row
+    map<String, unique_ptr<RangeStores>> m_ranges;
+  };
+
+} // local namespace
+
+
+int main(int argc, char **argv) {
+  vector<String> runs;
+  String staging_dir;
+
+  try {
+    init_with_policies<Policies>(argc, argv);
+
+    String ns_name = get_str("namespace");
+    String table_name = get_str("table");
+    String input_file = get_str("input-file");
+    int64_t memory_limit = get_i64("memory-limit");
+    String tmp_dir = get_str("tmp-dir");
+    bool escape = !has("no-escape");
+    int32_t timeout_ms = get_i32("Hypertable.Request.Timeout");
+
+    ConnectionManagerPtr conn_mgr = make_shared<ConnectionManager>();
+    FsBroker::Lib::ClientPtr dfs =
+      make_shared<FsBroker::Lib::Client>(conn_mgr, properties);
+    if (!dfs->wait_for_connection(timeout_ms)) {
+      cerr << "error: timed out waiting for FS broker" << endl;
+      quick_exit(EXIT_FAILURE);
+    }
+    Global::dfs = dfs;
+    Global::memory_tracker = new MemoryTracker(0, 0);
+    Global::toplevel_dir = get_str("Hypertable.Directory");
+    boost::trim_if(Global::toplevel_dir, boost::is_any_of("/"));
+    Global::toplevel_dir = String("/") + Global::toplevel_dir;
+
+    ClientPtr client = make_shared<Hypertable::Client>();
+    NamespacePtr ns = client->open_namespace(ns_name);
+    TablePtr table = ns->open_table(table_name);
+    TableIdentifierManaged table_id;
+    SchemaPtr schema;
+    table->get(table_id, schema);
+    RangeLocatorPtr range_locator = table->get_range_locator();
+    Lib::RangeServer::Client rs_client(Comm::instance(), timeout_ms);
+
+    // All loaded cells share one revision, taken before any is written
+    int64_t revision = get_ts64();
+
+    /**
+     * Phase 1: read input and spill sorted runs to local disk
+     */
+    FsBroker::Lib::ClientPtr null_dfs;
+    vector<String> no_columns;
+    LoadDataSourcePtr lds(LoadDataSourceFactory::create(null_dfs, input_file,
+                          LOCAL_FILE, "", 0, no_columns, "", '\t', 0, 0));
+    LoadDataEscape row_escaper, qualifier_escaper, value_escaper;
+    KeySpec key;
+    uint8_t *value;
+    uint32_t value_len;
+    uint32_t consumed;
+    bool is_delete;
+    const char *row, *qualifier, *escaped_value;
+    size_t row_len, qualifier_len, escaped_value_len;
+    DynamicBuffer buf;
+    vector<size_t> offsets;
+    String run_prefix = format("%s/ht_bulk_load-%d-", tmp_dir.c_str(),
+                               (int)getpid());
+    int64_t total_cells = 0;
+    int64_t total_bytes = 0;
+
+    while (lds->next(&key, &value, &value_len, &is_delete, &consumed)) {
+      if (is_delete)
+        HT_THROW(Error::NOT_IMPLEMENTED, "Deletes are not supported");
+
+      ColumnFamilySpec *cf_spec = schema->get_column_family(key.column_family);
+      if (cf_spec == 0)
+        HT_THROWF(Error::BAD_KEY, "Unknown column family '%s'",
+                  key.column_family);
+      if (cf_spec->get_option_counter())
+        HT_THROWF(Error::NOT_IMPLEMENTED, "Counter column family '%s' is not "
+                  "supported", key.column_family);
+
+      if (escape) {
+        row_escaper.unescape((const char *)key.row, (size_t)key.row_len,
+                             &row, &row_len);
+        qualifier_escaper.unescape(key.column_qualifier,
+                                   (size_t)key.column_qualifier_len,
+                                   &qualifier, &qualifier_len);
+        value_escaper.unescape((const char *)value, (size_t)value_len,
+                               &escaped_value, &escaped_value_len);
+      }
+      else {
+        row = (const char *)key.row;
+        row_len = key.row_len;
+        qualifier = key.column_qualifier ? key.column_qualifier : "";
+        qualifier_len = key.column_qualifier_len;
+        escaped_value = (const char *)value;
+        escaped_value_len = value_len;
+      }
+
+      offsets.push_back(buf.fill());
+      create_key_and_append(buf, FLAG_INSERT, String(row, row_len).c_str(),
+                            (uint8_t)cf_spec->get_id(),
+                            String(qualifier, qualifier_len).c_str(),
+                            key.timestamp == AUTO_ASSIGN ? revision : key.timestamp,
+                            revision, !cf_spec->get_option_time_order_desc());
+      append_as_byte_string(buf, escaped_value, escaped_value_len);
+      total_cells++;
+
+      if ((int64_t)buf.fill() >= memory_limit) {
+        total_bytes += buf.fill();
+        runs.push_back(run_prefix + format("%u", (unsigned)runs.size()));
+        write_run(buf, offsets, runs.back());
+      }
+    }
+    if (!offsets.empty()) {
+      total_bytes += buf.fill();
+      runs.push_back(run_prefix + format("%u", (unsigned)runs.size()));
+      write_run(buf, offsets, runs.back());
+    }
+    buf.free();
+
+    cout << "Sorted " << total_cells << " cells into " << runs.size()
+         << " runs" << endl;
+
+    /**
+     * Phase 2: merge runs, writing one CellStore per range and access group
+     */
+    staging_dir = format("%s/tmp/bulk_load/%s/%d-%lld",
+                         Global::toplevel_dir.c_str(), table_id.id,
+                         (int)getpid(), (Lld)revision);
+    Global::dfs->mkdirs(staging_dir);
+
+    priority_queue<RunReaderPtr, vector<RunReaderPtr>, GtRunReader> heap;
+    for (auto &fname : runs) {
+      RunReaderPtr reader = make_shared<RunReader>(fname);
+      if (reader->next())
+        heap.push(reader);
+    }
+
+    LoadContext ctx;
+    ctx.table_id = &table_id;
+    ctx.schema = schema;
+    ctx.range_locator = range_locator;
+    ctx.rs_client = &rs_client;
+    ctx.timeout_ms = timeout_ms;
+    ctx.staging_dir = staging_dir;
+    for (auto ag_spec : schema->get_access_groups())
+      ctx.ag_props[ag_spec->get_name()] = cellstore_properties(ag_spec);
+
+    // CellStoreV8 sizes bloom filters from this estimate until it has seen
+    // enough rows to extrapolate, so bound it by what fits in one range
+    int64_t avg_cell_size = total_cells ? (total_bytes / total_cells) + 1 : 1;
+    ctx.range_cells_estimate =
+      get_i64("Hypertable.RangeServer.Range.SplitSize") / avg_cell_size;
+
+    RangeWriter writer(ctx, total_cells);
+    Key cell;
+
+    while (!heap.empty()) {
+      RunReaderPtr reader = heap.top();
+      heap.pop();
+
+      cell.load(reader->key);
+      writer.link_before(cell.row);
+      writer.add(cell, reader->value);
+
+      if (reader->next())
+        heap.push(reader);
+    }
+    writer.link_all();
+
+    for (auto &fname : runs)
+      unlink(fname.c_str());
+    Global::dfs->rmdir(staging_dir);
+
+    cout << "Loaded " << total_cells << " cells into " << ctx.range_count
+         << " ranges" << endl;
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    // Ranges linked before the failure keep their data, so only the runs
+    // and the CellStores that were not linked are removed
+    for (auto &fname : runs)
+      unlink(fname.c_str());
+    if (!staging_dir.empty()) {
+      try {
+        Global::dfs->rmdir(staging_dir);
+      }
+      catch (Exception &e2) {
+        HT_ERROR_OUT << "Problem removing " << staging_dir << " - " << e2
+                     << HT_END;
+      }
+    }
+    quick_exit(EXIT_FAILURE);
+  }
+  quick_exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <Common/Compat.h>
+
+#include <Hypertable/RangeServer/CellCache.h>
+#include <Hypertable/RangeServer/Global.h>
+#include <Hypertable/RangeServer/MemoryTracker.h>
+#include <Hypertable/RangeServer/ScanContext.h>
+
+#include <Hypertable/Lib/Key.h>
+
+#include <Common/Config.h>
+#include <Common/DynamicBuffer.h>
+#include <Common/Init.h>
+#include <Common/Random.h>
+#include <Common/Serialization.h>
+#include <Common/Stopwatch.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace Hypertable;
+using namespace Config;
+using namespace std;
+
+namespace {
+
+  struct MyPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc("Usage: %s [Options]\n\n"
+        "  Verifies the std::map and skip list CellCache backends.  With\n"
+        "  --benchmark, measures insert and scan throughput of both backends\n"
+        "  at 1, 2, 4, ... --max-threads threads.\n\nOptions").add_options()
+        ("benchmark", "Measure insert and scan throughput")
+        ("items,n", i32()->default_value(200*K), "Number of cells per run")
+        ("max-threads", i32()->default_value(32), "Maximum thread count")
+        ;
+    }
+  };
+
+  typedef Cons<MyPolicy, DefaultPolicy> AppPolicy;
+
+  const char *SKIP_LIST_PROPERTY =
+    "Hypertable.RangeServer.AccessGroup.CellCache.SkipList";
+
+  /// Randomly generated cell keys
+  struct KeyData {
+    KeyData(size_t count, uint32_t seed, int64_t first_revision) {
+      Random::seed(seed);
+      buf.reserve(count * 64);
+      vector<size_t> offsets;
+      offsets.reserve(count);
+      char row[32];
+      for (size_t i=0; i<count; i++) {
+        sprintf(row, "row%010u", (unsigned)Random::number32());
+        offsets.push_back(buf.fill());
+        create_key_and_append(buf, FLAG_INSERT, row, 1, "qualifier",
+                              first_revision + i, first_revision + i);
+      }
+      keys.resize(count);
+      for (size_t i=0; i<count; i++)
+        keys[i].load(SerializedKey(buf.base + offsets[i]));
+    }
+    DynamicBuffer buf;
+    vector<Key> keys;
+  };
+
+  ByteString make_value(uint8_t *buf, int64_t count) {
+    uint8_t *ptr = buf;
+    *ptr++ = 8;
+    Serialization::encode_i64(&ptr, count);
+    return ByteString(buf);
+  }
+
+  CellCachePtr new_cache(bool skip_list) {
+    properties->set(SKIP_LIST_PROPERTY, skip_list);
+    return make_shared<CellCache>();
+  }
+
+  /// Scans entire cache, checking sort order.
+  size_t scan_all(CellCachePtr &cache) {
+    ScanContext scan_ctx;
+    CellListScannerPtr scanner = cache->create_scanner(&scan_ctx);
+    Key key, last_key;
+    ByteString value;
+    size_t count = 0;
+    while (scanner->get(key, value)) {
+      if (count > 0)
+        HT_ASSERT(last_key.serial < key.serial);
+      last_key = key;
+      scanner->forward();
+      count++;
+    }
+    return count;
+  }
+
+  void insert_range(CellCachePtr cache, KeyData *data, size_t begin,
+                    size_t end, ByteString value) {
+    for (size_t i=begin; i<end; i++) {
+      cache->lock();
+      cache->add(data->keys[i], value);
+      cache->unlock();
+    }
+  }
+
+  void test_concurrent_scan(bool skip_list, size_t items) {
+    KeyData data(items, 1, 1);
+    uint8_t valuebuf[16];
+    ByteString value = make_value(valuebuf, 1);
+    CellCachePtr cache = new_cache(skip_list);
+    atomic<bool> done {};
+
+    // Scanners run while the writer inserts and must always see sorted data
+    vector<thread> readers;
+    for (size_t i=0; i<4; i++)
+      readers.push_back(thread([&cache, &done]() {
+            while (!done)
+              scan_all(cache);
+          }));
+    insert_range(cache, &data, 0, items, value);
+    done = true;
+    for (auto &t : readers)
+      t.join();
+
+    // Keys are random so a few may collide
+    HT_ASSERT(scan_all(cache) == cache->size());
+    HT_ASSERT(cache->size() > items - items/100);
+  }
+
+  void test_counter(bool skip_list) {
+    CellCachePtr cache = new_cache(skip_list);
+    DynamicBuffer buf(1024);
+    uint8_t valuebuf[16];
+    Key key;
+    int64_t expected = 0;
+
+    auto increment = [&](int64_t i) {
+      buf.clear();
+      create_key_and_append(buf, FLAG_INSERT, "counter", 1, "", i, i);
+      key.load(SerializedKey(buf.base));
+      cache->lock();
+      cache->add_counter(key, make_value(valuebuf, i));
+      cache->unlock();
+      expected += i;
+    };
+
+    auto check = [](CellListScannerPtr &scanner, int64_t timestamp,
+                    int64_t count) {
+      Key key;
+      ByteString value;
+      HT_ASSERT(scanner->get(key, value));
+      HT_ASSERT(key.timestamp == timestamp);
+      const uint8_t *ptr = value.ptr + 1;
+      size_t remaining = 8;
+      HT_ASSERT(*value.ptr == 8);
+      HT_ASSERT((int64_t)Serialization::decode_i64(&ptr, &remaining) == count);
+    };
+
+    increment(1);
+    int64_t memory_used = cache->memory_used();
+
+    // Without open scanners, increments are accumulated in place
+    for (int64_t i=2; i<=100; i++)
+      increment(i);
+    HT_ASSERT(cache->size() == 1);
+    HT_ASSERT(cache->memory_used() == memory_used);
+
+    ScanContext scan_ctx;
+    CellListScannerPtr scanner = cache->create_scanner(&scan_ctx);
+    check(scanner, 100, expected);
+
+    // An open skip list scanner keeps seeing the value it was positioned on
+    int64_t seen = expected;
+    increment(101);
+    if (skip_list) {
+      check(scanner, 100, seen);
+      HT_ASSERT(cache->memory_used() > memory_used);
+    }
+
+    scanner.reset();
+    memory_used = cache->memory_used();
+    increment(102);
+    HT_ASSERT(cache->memory_used() == memory_used);
+    scanner = cache->create_scanner(&scan_ctx);
+    check(scanner, 102, expected);
+  }
+
+  void benchmark(bool skip_list, size_t items, size_t max_threads) {
+    const char *label = skip_list ? "skiplist" : "map";
+    KeyData data(items, 2, 1);
+    KeyData extra(items, 3, items + 1);
+    uint8_t valuebuf[16];
+    ByteString value = make_value(valuebuf, 1);
+
+    for (size_t nthreads=1; nthreads<=max_threads; nthreads*=2) {
+
+      // Inserts from all threads through the cache lock
+      CellCachePtr cache = new_cache(skip_list);
+      vector<thread> threads;
+      Stopwatch insert_watch;
+      for (size_t i=0; i<nthreads; i++)
+        threads.push_back(thread(insert_range, cache, &data,
+                                 (i*items)/nthreads, ((i+1)*items)/nthreads,
+                                 value));
+      for (auto &t : threads)
+        t.join();
+      insert_watch.stop();
+      threads.clear();
+
+      // Full scans from all threads against a concurrent writer
+      atomic<size_t> scanned {};
+      thread writer(insert_range, cache, &extra, 0, items, value);
+      Stopwatch scan_watch;
+      for (size_t i=0; i<nthreads; i++)
+        threads.push_back(thread([&cache, &scanned]() {
+              scanned += scan_all(cache);
+            }));
+      for (auto &t : threads)
+        t.join();
+      scan_watch.stop();
+      writer.join();
+
+      cout << setw(8) << label << " threads=" << setw(2) << nthreads
+           << "  insert " << setw(10) << (size_t)(items / insert_watch.elapsed())
+           << "/s  scan " << setw(10)
+           << (size_t)(scanned / scan_watch.elapsed()) << "/s" << endl;
+    }
+  }
+
+}
+
+int main(int argc, char **argv) {
+
+  try {
+    init_with_policy<AppPolicy>(argc, argv);
+
+    Global::memory_tracker = new MemoryTracker(0, 0);
+    Global::cell_cache_scanner_cache_size =
+      get_i32("Hypertable.RangeServer.AccessGroup.CellCache.ScannerCacheSize");
+
+    size_t items = get_i32("items");
+
+    if (has("benchmark")) {
+      size_t max_threads = get_i32("max-threads");
+      benchmark(false, items, max_threads);
+      benchmark(true, items, max_threads);
+      return 0;
+    }
+
+    for (bool skip_list : { false, true }) {
+      test_concurrent_scan(skip_list, items);
+      test_counter(skip_list);
+    }
+  }
+  catch (Exception &e) {
+    HT_ERROR_OUT << e << HT_END;
+    return 1;
+  }
+
+  return 0;
+}
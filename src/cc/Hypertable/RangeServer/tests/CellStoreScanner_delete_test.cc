@@ -22,6 +22,7 @@
 #include <Common/Compat.h>
 
 #include "../CellStoreV7.h"
+#include "../CellStoreV8.h"
 #include "../Global.h"
 
 #include <Hypertable/Lib/Key.h>
@@ -37,24 +38,37 @@
 #include <Common/FileUtils.h>
 #include <Common/InetAddr.h>
 #include <Common/System.h>
-#include <Common/Usage.h>
 
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
 
 using namespace Hypertable;
+using namespace Config;
 using namespace std;
 
 namespace {
-  const char *usage[] = {
-    "usage: CellStoreScanner_delete_test",
-    "",
-    "  This program tests for the proper functioning of the CellStore",
-    "  scanner.  It creates a dummy cell store and then repeatedly scans",
-    "  it with different ranges",
-    (const char *)0
+  struct MyPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc("Usage: %s [Options]\n\n"
+        "  This program tests for the proper functioning of the CellStore\n"
+        "  scanner.  It creates a dummy cell store and then repeatedly scans\n"
+        "  it with different ranges.\n\nOptions").add_options()
+        ("cellstore-version", i32()->default_value(7),
+         "CellStore version to test (7 or 8)")
+        ;
+    }
   };
+
+  typedef Cons<MyPolicy, DefaultPolicy> AppPolicy;
+
+  /// Creates a CellStore of the version under test
+  CellStorePtr new_cellstore(int version, SchemaPtr &schema) {
+    if (version == 7)
+      return make_shared<CellStoreV7>(Global::dfs.get(), schema);
+    return make_shared<CellStoreV8>(Global::dfs.get(), schema);
+  }
+
   const char *schema_str =
   "<Schema>\n"
   "  <AccessGroup name=\"default\">\n"
@@ -490,7 +504,6 @@ int main(int argc, char **argv) {
     struct sockaddr_in addr;
     FsBroker::Lib::ClientPtr client;
     CellStorePtr cs;
-    std::ofstream out("CellStoreScanner_delete_test.output");
     String delete_row = "delete_row";
     String delete_cf  = "delete_cf";
     String delete_row_cf = "delete_row_cf";
@@ -501,10 +514,11 @@ int main(int argc, char **argv) {
     String delete_cell_version = "delete_cell_version";
     TableIdentifier table_id("0");
 
-    Config::init(argc, argv);
+    init_with_policy<AppPolicy>(argc, argv);
 
-    if (Config::has("help"))
-      Usage::dump_and_exit(usage);
+    int version = get_i32("cellstore-version");
+    String output_file = format("CellStoreScanner_delete_test-v%d.output", version);
+    std::ofstream out(output_file.c_str());
 
     ReactorFactory::initialize(2);
 
@@ -524,7 +538,7 @@ int main(int argc, char **argv) {
 
     Global::memory_tracker = new MemoryTracker(0, 0);
 
-    String testdir = "/CellStoreScanner_delete_test";
+    String testdir = format("/CellStoreScanner_delete_test-v%d", version);
     client->mkdirs(testdir);
 
     SchemaPtr schema( Schema::new_instance(schema_str) );
@@ -533,7 +547,7 @@ int main(int argc, char **argv) {
     PropertiesPtr cs_props = make_shared<Properties>();
     // make sure blocks are small so only one key value pair fits in a block
     cs_props->set("blocksize", int32_t(32));
-    cs = make_shared<CellStoreV7>(Global::dfs.get(), schema);
+    cs = new_cellstore(version, schema);
     HT_TRY("creating cellstore", cs->create(csname.c_str(), 24000, cs_props, &table_id));
 
     DynamicBuffer dbuf(512000);
@@ -899,8 +913,8 @@ int main(int argc, char **argv) {
     }
 
     out << flush;
-    String cmd_str = "diff CellStoreScanner_delete_test.output "
-                     "CellStoreScanner_delete_test.golden";
+    String cmd_str = format("diff %s CellStoreScanner_delete_test.golden",
+                            output_file.c_str());
     if (system(cmd_str.c_str()) != 0)
       return 1;
 
@@ -23,6 +23,7 @@
 
 #include "../CellStoreFactory.h"
 #include "../CellStoreV7.h"
+#include "../CellStoreV8.h"
 #include "../Global.h"
 
 #include <Hypertable/Lib/Key.h>
@@ -39,24 +40,37 @@
 #include <Common/FileUtils.h>
 #include <Common/InetAddr.h>
 #include <Common/System.h>
-#include <Common/Usage.h>
 
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
 
 using namespace Hypertable;
+using namespace Config;
 using namespace std;
 
 namespace {
-  const char *usage[] = {
-    "usage: CellStoreScanner_test",
-    "",
-    "  This program tests for the proper functioning of the CellStore",
-    "  scanner.  It creates a dummy cell store and then repeatedly scans",
-    "  it with different ranges",
-    (const char *)0
+  struct MyPolicy : Config::Policy {
+    static void init_options() {
+      cmdline_desc("Usage: %s [Options]\n\n"
+        "  This program tests for the proper functioning of the CellStore\n"
+        "  scanner.  It creates a dummy cell store and then repeatedly scans\n"
+        "  it with different ranges.\n\nOptions").add_options()
+        ("cellstore-version", i32()->default_value(7),
+         "CellStore version to test (7 or 8)")
+        ;
+    }
   };
+
+  typedef Cons<MyPolicy, DefaultPolicy> AppPolicy;
+
+  /// Creates a CellStore of the version under test
+  CellStorePtr new_cellstore(int version, SchemaPtr &schema) {
+    if (version == 7)
+      return make_shared<CellStoreV7>(Global::dfs.get(), schema);
+    return make_shared<CellStoreV8>(Global::dfs.get(), schema);
+  }
+
   const char *schema_str =
   "<Schema>\n"
   "  <AccessGroup name=\"default\">\n"
@@ -544,6 +558,34 @@ namespace {
     return count;
   }
 
+  /// Scans rows <code>start_row</code> through <code>end_row</code> and
+  /// checks that exactly one cell, of row <code>expected_row</code>, is
+  /// returned.  Mismatches are written to <code>out</code>.
+  bool check_seek(CellStorePtr &cs, SchemaPtr &schema, RangeSpec &range,
+                  const char *start_row, const char *end_row,
+                  const char *expected_row, ostream &out) {
+    ScanSpecBuilder ssbuilder;
+    ssbuilder.add_row_interval(start_row, true, end_row, true);
+    ScanContextPtr scan_ctx = make_shared<ScanContext>(TIMESTAMP_MAX,
+                                   &(ssbuilder.get()), &range, schema);
+    CellListScannerPtr scanner = cs->create_scanner(scan_ctx.get());
+    Key key_comps;
+    ByteString bsvalue;
+    String first_row;
+    size_t count = 0;
+    while (scanner->get(key_comps, bsvalue)) {
+      if (count++ == 0)
+        first_row = key_comps.row;
+      scanner->forward();
+    }
+    if (count == 1 && first_row == expected_row)
+      return true;
+    out << "seek to " << start_row << " returned " << count
+        << " cells starting at '" << first_row << "', expected "
+        << expected_row << "\n";
+    return false;
+  }
+
   void check_replaced_files(CellStorePtr &cs, vector<String> &replaced_files_write,
                             ostream &out) {
 
@@ -570,7 +612,6 @@ int main(int argc, char **argv) {
     struct sockaddr_in addr;
     FsBroker::Lib::ClientPtr client;
     CellStorePtr cs;
-    std::ofstream out("CellStoreScanner_test.output");
     size_t wordi=0;
     const char *delete_test = "delete_test";
     char delete_row[256];
@@ -589,10 +630,12 @@ int main(int argc, char **argv) {
     replaced_files_write.push_back("/hypertable/tables/0/1/default/qyoNKN5rd__dbHKv/cs1");
     replaced_files_write.push_back("/hypertable/tables/0/1/default/qyoNKN5rd__dbHKv/cs11");
 
-    Config::init(argc, argv);
+    init_with_policy<AppPolicy>(argc, argv);
 
-    if (Config::has("help"))
-      Usage::dump_and_exit(usage);
+    int version = get_i32("cellstore-version");
+    String output_file = format("CellStoreScanner_test-v%d.output",
+                                version);
+    std::ofstream out(output_file.c_str());
 
     System::initialize(System::locate_install_dir(argv[0]));
     ReactorFactory::initialize(2);
@@ -613,7 +656,7 @@ int main(int argc, char **argv) {
 
     Global::memory_tracker = new MemoryTracker(0, 0);
 
-    String testdir = "/CellStoreScanner_test";
+    String testdir = format("/CellStoreScanner_test-v%d", version);
     client->mkdirs(testdir);
 
     //String csname = testdir + format("/cs_pid%d", getpid());
@@ -624,7 +667,7 @@ int main(int argc, char **argv) {
 
     SchemaPtr schema ( Schema::new_instance(schema_str) );
 
-    cs = make_shared<CellStoreV7>(Global::dfs.get(), schema);
+    cs = new_cellstore(version, schema);
     HT_TRY("creating cellstore", cs->create(csname.c_str(), 0, cs_props, &table_id));
     cs->set_replaced_files(replaced_files_write);
 
@@ -1430,7 +1473,7 @@ int main(int argc, char **argv) {
     cs_props = make_shared<Properties>();
     cs_props->set("blocksize", (int32_t)10000);
     cs_props->set("compressor", String("none"));
-    cs = make_shared<CellStoreV7>(Global::dfs.get(), schema);
+    cs = new_cellstore(version, schema);
     HT_TRY("creating cellstore", cs->create(csname.c_str(), 0, cs_props, &table_id));
     // should not coalesce and be in a separate block from trailer
     replaced_files_write.push_back("1/hypertable/tables/0/1/default/qyoNKN5rd__dbHKv/cs0");
@@ -1539,7 +1582,7 @@ int main(int argc, char **argv) {
 
     schema.reset( Schema::new_instance(schema2_str) );
 
-    cs = make_shared<CellStoreV7>(Global::dfs.get(), schema);
+    cs = new_cellstore(version, schema);
     HT_TRY("creating cellstore", cs->create(csname.c_str(), 0, cs_props, &table_id));
     // should coalesce and be in 2 blocks, with the 2nd block also containing the trailer
     replaced_files_write.push_back("7/hypertable/tables/0/1/default/qyoNKN5rd__dbHKv/cs0");
@@ -1593,7 +1636,7 @@ int main(int argc, char **argv) {
     AccessGroupOptions::parse_bloom_filter("rows", cs_props);
     schema.reset( Schema::new_instance(schema_str) );
 
-    cs = make_shared<CellStoreV7>(Global::dfs.get(), schema);
+    cs = new_cellstore(version, schema);
     HT_TRY("creating cellstore", cs->create(csname.c_str(), 735, cs_props, &table_id));
     strcpy((char *)rowbuf, "the only row");
     value = "Dummy value";
@@ -1623,12 +1666,59 @@ int main(int argc, char **argv) {
     out << "may_contain(ROW=\"absent row\") == ";
     out << ((cs->may_contain(scan_ctx.get())) ? "true" : "false") << "\n";
 
+    /**
+     * Seek to keys inside blocks.  With 4KB blocks, each block holds
+     * several restart points, so seeks land on, right after and between
+     * restart keys.
+     */
+    out << "[seek-within-block]\n";
+    csname = testdir + "/cs4";
+    cs_props = make_shared<Properties>();
+    cs_props->set("blocksize", (int32_t)4096);
+    cs_props->set("compressor", String("none"));
+    cs = new_cellstore(version, schema);
+    HT_TRY("creating cellstore", cs->create(csname.c_str(), 0, cs_props, &table_id));
+
+    const int seek_rows = 500;
+    for (int i=0; i<seek_rows; i++) {
+      dbuf.clear();
+      serkey.ptr = dbuf.ptr;
+      sprintf(rowbuf, "row%04d", i);
+      create_key_and_append(dbuf, FLAG_INSERT, rowbuf, 1, "", timestamp,
+                            timestamp);
+      timestamp++;
+      key.load(serkey);
+      cs->add(key, bsvalue);
+    }
+    cs->finalize(&table_id);
+    cs = CellStoreFactory::open(csname, "", Key::END_ROW_MARKER);
+
+    {
+      char seek_row[32], next_row[32];
+      size_t seeks = 0, failed = 0;
+      for (int i=0; i<seek_rows; i++) {
+        sprintf(rowbuf, "row%04d", i);
+        if (!check_seek(cs, schema, range, rowbuf, rowbuf, rowbuf, out))
+          failed++;
+        seeks++;
+        if (i+1 < seek_rows) {
+          // A start row that sorts between two stored rows
+          sprintf(seek_row, "row%04d!", i);
+          sprintf(next_row, "row%04d", i+1);
+          if (!check_seek(cs, schema, range, seek_row, next_row, next_row, out))
+            failed++;
+          seeks++;
+        }
+      }
+      out << seeks << " seeks, " << failed << " failed\n";
+    }
+
     cs = 0;
 
     out << flush;
 
-    String cmd_str = "diff CellStoreScanner_test.output "
-                     "CellStoreScanner_test.golden";
+    String cmd_str = format("diff %s CellStoreScanner_test.golden",
+                            output_file.c_str());
     if (system(cmd_str.c_str()) != 0)
       return 1;
 
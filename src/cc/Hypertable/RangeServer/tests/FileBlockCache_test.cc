@@ -22,9 +22,11 @@
 #include "Common/Compat.h"
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <list>
 #include <set>
+#include <thread>
 #include <vector>
 #include <set>
 
@@ -68,6 +70,181 @@ namespace {
   };
 }
 
+namespace {
+
+  const uint32_t BLOCK_SIZE = 1000;
+
+  /// Inserts a block of BLOCK_SIZE bytes, checking it out first like a
+  /// scanner would.  Returns true if the block was (or already is) cached.
+  bool access(FileBlockCache *cache, int file_id, uint32_t file_offset) {
+    uint8_t *block;
+    uint32_t length;
+    if (cache->checkout(file_id, file_offset, &block, &length)) {
+      cache->checkin(file_id, file_offset);
+      return true;
+    }
+    block = new uint8_t [ BLOCK_SIZE ];
+    if (!cache->insert(file_id, file_offset, block, BLOCK_SIZE, EventPtr(),
+                       false)) {
+      delete [] block;
+      return false;
+    }
+    return true;
+  }
+
+  /// Checks that a one-pass scan does not flush a frequently accessed
+  /// working set when the admission filter is enabled, and does when it
+  /// is not.
+  bool test_scan_resistance(bool admission_filter) {
+    const int HOT_BLOCKS = 50;
+    FileBlockCache cache(100*BLOCK_SIZE, 100*BLOCK_SIZE, false, 4,
+                         admission_filter);
+
+    for (int pass=0; pass<10; pass++)
+      for (int i=0; i<HOT_BLOCKS; i++)
+        access(&cache, 1, i);
+
+    for (int i=0; i<10000; i++)
+      access(&cache, 2, i);
+
+    int hot_cached = 0;
+    for (int i=0; i<HOT_BLOCKS; i++)
+      if (cache.contains(1, i))
+        hot_cached++;
+
+    cout << "FileBlockCache_test admission_filter=" << admission_filter
+         << " hot blocks cached after scan = " << hot_cached << "/"
+         << HOT_BLOCKS << endl;
+
+    if (admission_filter && hot_cached != HOT_BLOCKS) {
+      HT_ERROR("Scan evicted hot blocks despite admission filter");
+      return false;
+    }
+    if (!admission_filter && hot_cached != 0) {
+      HT_ERROR("Scan did not evict hot blocks from LRU cache");
+      return false;
+    }
+    return true;
+  }
+
+  /// Hammers a sharded cache from several threads and then verifies that
+  /// shard statistics and memory accounting agree with each other and that
+  /// decrease_limit() and cap_memory_use() still honor their contracts.
+  bool test_sharded(size_t thread_count) {
+    const int64_t MEMORY = 500*BLOCK_SIZE;
+    FileBlockCache cache(MEMORY/10, MEMORY, false, 8, true);
+    vector<thread> threads;
+
+    for (size_t t=0; t<thread_count; t++)
+      threads.push_back(thread([&cache, t]() {
+            unsigned int seed = (unsigned int)t;
+            for (int i=0; i<100000; i++) {
+              // Skewed so that some blocks are hot
+              uint32_t offset = rand_r(&seed) % 1000;
+              if (rand_r(&seed) & 1)
+                offset %= 100;
+              access(&cache, (int)(offset % 7), offset);
+            }
+          }));
+    for (auto &t : threads)
+      t.join();
+
+    vector<FileBlockCache::ShardStats> shard_stats;
+    cache.get_shard_stats(shard_stats);
+    if (shard_stats.size() != cache.shard_count()) {
+      HT_ERROR("Wrong number of shard statistics");
+      return false;
+    }
+
+    uint64_t accesses = 0, hits = 0;
+    int64_t memory_used = 0;
+    for (auto &stats : shard_stats) {
+      if (stats.hits > stats.accesses || stats.accesses == 0) {
+        HT_ERROR("Bad shard statistics");
+        return false;
+      }
+      accesses += stats.accesses;
+      hits += stats.hits;
+      memory_used += stats.memory_used;
+    }
+
+    uint64_t max_memory, available, total_accesses, total_hits;
+    cache.get_stats(&max_memory, &available, &total_accesses, &total_hits);
+    if (accesses != total_accesses || hits != total_hits ||
+        accesses != thread_count * 100000) {
+      HT_ERROR("Shard statistics do not add up to cache statistics");
+      return false;
+    }
+    if (memory_used != cache.memory_used() ||
+        (int64_t)max_memory != cache.get_limit() ||
+        cache.get_limit() > MEMORY) {
+      HT_ERRORF("Memory accounting mismatch (shards=%lld, cache=%lld)",
+                (Lld)memory_used, (Lld)cache.memory_used());
+      return false;
+    }
+
+    int64_t limit = cache.get_limit();
+    cache.decrease_limit(limit / 2);
+    if (cache.get_limit() != limit - limit/2 ||
+        cache.memory_used() > cache.get_limit()) {
+      HT_ERROR("decrease_limit() did not free enough memory");
+      return false;
+    }
+
+    cache.decrease_limit(MEMORY);
+    if (cache.get_limit() != MEMORY/10) {
+      HT_ERROR("decrease_limit() went below minimum memory");
+      return false;
+    }
+
+    cache.increase_limit(MEMORY);
+    cache.cap_memory_use();
+    if (cache.available() != MEMORY/10 - cache.memory_used()) {
+      HT_ERROR("cap_memory_use() did not fall back to minimum memory");
+      return false;
+    }
+
+    return true;
+  }
+
+  /// Checks that a block whose event payload is a slice of a pooled receive
+  /// buffer is copied into the cache instead of pinning the buffer.
+  bool test_pooled_payload() {
+    FileBlockCache cache(10*BLOCK_SIZE, 10*BLOCK_SIZE, true);
+    ReceiveBufferPtr buffer = ReceiveBufferPool::get();
+    uint8_t *payload = buffer.get() + 16;
+    for (uint32_t i=0; i<BLOCK_SIZE; i++)
+      payload[i] = (uint8_t)i;
+
+    EventPtr event = make_shared<Event>(Event::MESSAGE);
+    event->payload = payload;
+    event->payload_len = BLOCK_SIZE;
+    event->payload_buffer = buffer;
+    event->payload_pooled = true;
+    if (!cache.insert(0, 0, payload, BLOCK_SIZE, event, false)) {
+      HT_ERROR("Insert of pooled block failed");
+      return false;
+    }
+    event.reset();
+
+    if (buffer.use_count() != 1) {
+      HT_ERROR("Cached block pins pooled receive buffer");
+      return false;
+    }
+
+    uint8_t *block;
+    uint32_t length;
+    if (!cache.checkout(0, 0, &block, &length) || length != BLOCK_SIZE ||
+        block == payload || memcmp(block, payload, BLOCK_SIZE)) {
+      HT_ERROR("Pooled block not copied into cache");
+      return false;
+    }
+    cache.checkin(0, 0);
+    return true;
+  }
+
+}
+
 #define TOTAL_ALLOC_LIMIT 100000000
 #define TARGET_BUFSIZE (2 * 65536)
 #define MAX_FILE_ID 10
@@ -176,5 +353,14 @@ int main(int argc, char **argv) {
 
   delete cache;
 
+  if (!test_scan_resistance(true) || !test_scan_resistance(false))
+    return 1;
+
+  if (!test_sharded(8))
+    return 1;
+
+  if (!test_pooled_payload())
+    return 1;
+
   return 0;
 }
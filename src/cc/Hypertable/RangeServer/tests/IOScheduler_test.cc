@@ -0,0 +1,141 @@
+/** -*- c++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <Common/Compat.h>
+
+#include <Hypertable/RangeServer/IOScheduler.h>
+
+#include <Common/Logger.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace Hypertable;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+  const int64_t MB = 1024 * 1024;
+
+  /// Returns seconds taken to append <code>count</code> 1MB buffers.
+  double timed_appends(IOScheduler &scheduler, int count) {
+    auto start = steady_clock::now();
+    for (int i=0; i<count; i++)
+      scheduler.begin_append(MB);
+    return duration<double>(steady_clock::now() - start).count();
+  }
+
+}
+
+int main(int argc, char **argv) {
+  IOScheduler::Stats stats;
+
+  // Foreground appends are never throttled
+  {
+    IOScheduler scheduler(10*MB, MB, 0);
+    HT_ASSERT(IOScheduler::priority() == IOScheduler::Priority::FOREGROUND);
+    double elapsed = timed_appends(scheduler, 20);
+    if (elapsed > 0.2) {
+      cout << "Foreground appends throttled (" << elapsed << "s)" << endl;
+      exit(EXIT_FAILURE);
+    }
+    scheduler.get_stats(stats);
+    HT_ASSERT(stats.foreground_write_bytes == (uint64_t)(20*MB));
+    HT_ASSERT(stats.background_write_bytes == 0);
+  }
+
+  // Background appends are limited to the configured rate.  The bucket
+  // starts with a quarter second worth of tokens, so 10MB at 20MB/s should
+  // take about 0.25 seconds.
+  {
+    IOScheduler scheduler(20*MB, MB, 0);
+    IOScheduler::BackgroundScope background;
+    HT_ASSERT(IOScheduler::priority() == IOScheduler::Priority::BACKGROUND);
+    double elapsed = timed_appends(scheduler, 10);
+    if (elapsed < 0.2 || elapsed > 1.0) {
+      cout << "Background appends took " << elapsed << "s, expected ~0.25s"
+           << endl;
+      exit(EXIT_FAILURE);
+    }
+    scheduler.get_stats(stats);
+    HT_ASSERT(stats.background_write_bytes == (uint64_t)(10*MB));
+    HT_ASSERT(stats.background_throttle_time > 0);
+  }
+  HT_ASSERT(IOScheduler::priority() == IOScheduler::Priority::FOREGROUND);
+
+  // Background class is per-thread
+  {
+    IOScheduler scheduler(20*MB, MB, 0);
+    IOScheduler::BackgroundScope background;
+    thread t([&scheduler]() { timed_appends(scheduler, 20); });
+    t.join();
+    scheduler.get_stats(stats);
+    HT_ASSERT(stats.foreground_write_bytes == (uint64_t)(20*MB));
+    HT_ASSERT(stats.background_write_bytes == 0);
+  }
+
+  // Rate halves while foreground latency exceeds the target and recovers
+  // once it is back below it
+  {
+    IOScheduler scheduler(64*MB, 8*MB, 1000, 10);
+    IOScheduler::BackgroundScope background;
+
+    for (int i=0; i<3; i++) {
+      scheduler.record_foreground_read(65536, milliseconds(5));
+      this_thread::sleep_for(milliseconds(15));
+      scheduler.begin_read(1);
+    }
+    scheduler.get_stats(stats);
+    if (stats.background_rate != (uint64_t)(8*MB)) {
+      cout << "Expected rate of " << 8*MB << " after slow reads, got "
+           << stats.background_rate << endl;
+      exit(EXIT_FAILURE);
+    }
+    HT_ASSERT(stats.foreground_reads == 3);
+    HT_ASSERT(stats.foreground_read_latency == 15000);
+
+    scheduler.record_foreground_read(65536, microseconds(100));
+    this_thread::sleep_for(milliseconds(15));
+    scheduler.begin_read(1);
+    scheduler.get_stats(stats);
+    if (stats.background_rate != (uint64_t)(8*MB + (64*MB)/10)) {
+      cout << "Expected rate of " << 8*MB + (64*MB)/10
+           << " after fast reads, got " << stats.background_rate << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Zero rate disables throttling
+  {
+    IOScheduler scheduler(0, 0, 1000);
+    IOScheduler::BackgroundScope background;
+    double elapsed = timed_appends(scheduler, 100);
+    HT_ASSERT(elapsed < 0.2);
+    scheduler.get_stats(stats);
+    HT_ASSERT(stats.background_rate == 0);
+    HT_ASSERT(stats.background_throttle_time == 0);
+  }
+
+  return 0;
+}
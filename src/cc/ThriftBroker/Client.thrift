@@ -373,6 +373,41 @@ typedef list<string> CellAsArray
 
 /**
  * Binary buffer holding serialized sequence of cells
+ *
+ * The buffer is decoded in place by the SerializedCellsReader classes of
+ * the client libraries, so cells can be read without creating an object per
+ * cell.  Integers are little-endian.  The buffer starts with an i32 format
+ * version (currently 1), followed by a sequence of cells, each of which is
+ * laid out as follows:
+ *
+ * <dl>
+ *   <dt>flag (i8)</dt>
+ *   <dd>Bitwise OR of 0x20 (auto-assigned timestamp), 0x40 (timestamp
+ *   present), 0x80 (revision present) and 0x10 (revision equals
+ *   timestamp)</dd>
+ *
+ *   <dt>timestamp (i64)</dt>
+ *   <dd>Present only if the flag has 0x40 set</dd>
+ *
+ *   <dt>revision (i64)</dt>
+ *   <dd>Present only if the flag has 0x80 set and 0x10 clear</dd>
+ *
+ *   <dt>row</dt>
+ *   <dd>NUL-terminated row key; empty if it is the same as the row of the
+ *   previous cell</dd>
+ *
+ *   <dt>column_family, column_qualifier</dt>
+ *   <dd>NUL-terminated strings</dd>
+ *
+ *   <dt>value</dt>
+ *   <dd>i32 length followed by that many bytes</dd>
+ *
+ *   <dt>cell_flag (i8)</dt>
+ *   <dd>Cell flag (see <a href="#Enum_KeyFlag">KeyFlag</a>)</dd>
+ * </dl>
+ *
+ * The sequence is terminated by a flag byte with 0x01 (end of buffer) set.
+ * If 0x02 (end of scan) is also set, the scanner has no more cells.
  */
 typedef binary CellsSerialized
 
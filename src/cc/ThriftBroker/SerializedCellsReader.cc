@@ -94,7 +94,8 @@ bool SerializedCellsReader::next() {
   remaining = m_end - m_ptr;
   m_value_len = Serialization::decode_i32(&m_ptr, &remaining);
 
-  if (m_value_len > remaining)
+  // value is followed by the cell flag byte
+  if (m_value_len >= remaining)
     HT_THROW(Error::SERIALIZATION_INPUT_OVERRUN, "");
 
   m_value = m_ptr;
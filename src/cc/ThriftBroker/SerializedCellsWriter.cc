@@ -67,64 +67,82 @@ bool SerializedCellsWriter::add(const char *row, const char *column_family,
   // need to leave room for the termination byte
   if (length > (int32_t)m_buf.remaining()) {
     if (m_grow)
-      m_buf.ensure(length);
+      ensure(length);
     else {
       if (!m_buf.empty())
         return false;
-      m_buf.grow(length);
+      grow(length);
     }
   }
 
   // version
   if (m_buf.empty())
-    Serialization::encode_i32(&m_buf.ptr, SerializedCellsVersion::SCVERSION);
+    put_i32(SerializedCellsVersion::SCVERSION);
 
   // flag byte
-  *m_buf.ptr++ = flag;
+  put_byte(flag);
 
   // timestamp
   if ((flag & SerializedCellsFlag::HAVE_TIMESTAMP) != 0)
-    Serialization::encode_i64(&m_buf.ptr, timestamp);
+    put_i64(timestamp);
 
   // revision
   if ((flag & SerializedCellsFlag::HAVE_REVISION) &&
       (flag & SerializedCellsFlag::REV_IS_TS) == 0)
-    Serialization::encode_i64(&m_buf.ptr, 0);
+    put_i64(0);
 
   // row; only write it if it's not identical to the previous row
   if (need_row) {
-    memcpy(m_buf.ptr, row, row_length);
-    m_previous_row_offset = m_buf.ptr - m_buf.base;
-    m_buf.ptr += row_length;
+    m_previous_row_offset = m_str ? m_str->size() : m_buf.fill();
+    put(row, row_length);
     m_previous_row_length = row_length;
   }
-  *m_buf.ptr++ = 0;
+  put_byte(0);
 
   // column_family
   if (column_family)
-    memcpy(m_buf.ptr, column_family, column_family_length);
-  m_buf.ptr += column_family_length;
-  *m_buf.ptr++ = 0;
+    put(column_family, column_family_length);
+  put_byte(0);
 
   // column_qualifier
   if (column_qualifier)
-    memcpy(m_buf.ptr, column_qualifier, column_qualifier_length);
-  m_buf.ptr += column_qualifier_length;
-  *m_buf.ptr++ = 0;
+    put(column_qualifier, column_qualifier_length);
+  put_byte(0);
 
-  Serialization::encode_i32(&m_buf.ptr, value_length);
+  put_i32(value_length);
   if (value)
-    memcpy(m_buf.ptr, value, value_length);
-  m_buf.ptr += value_length;
-  Serialization::encode_i8(&m_buf.ptr, cell_flag);
+    put(value, value_length);
+  put_byte(cell_flag);
+
+  sync_string();
 
   return true;
 }
 
 
 void SerializedCellsWriter::clear() { 
-  m_buf.clear();
+  if (m_str) {
+    m_str->clear();
+    sync_string();
+  }
+  else
+    m_buf.clear();
   m_previous_row_offset = -1;
   m_previous_row_length = 0;
   m_finalized = false;
 }
+
+
+void SerializedCellsWriter::grow(size_t new_size) {
+  if (m_str)
+    grow_string(new_size);
+  else
+    m_buf.grow(new_size);
+}
+
+
+void SerializedCellsWriter::grow_string(size_t new_size) {
+  m_str->reserve(new_size);
+  m_buf.size = new_size;
+  sync_string();
+}
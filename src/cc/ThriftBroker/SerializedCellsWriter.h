@@ -27,6 +27,8 @@
 
 #include "SerializedCellsFlag.h"
 
+#include <string>
+
 namespace Hypertable {
 
   class SerializedCellsWriter {
@@ -36,6 +38,21 @@ namespace Hypertable {
       :  m_buf(size), m_finalized(false), m_grow(grow),
          m_previous_row_offset(-1), m_previous_row_length(0) { }
 
+    /**
+     * Constructs a writer that serializes directly into <code>str</code>.
+     * Capacity for <code>size</code> bytes is reserved and cells are
+     * appended to the string, so its length is always the serialized
+     * length and no bytes are initialized only to be overwritten.
+     * This lets the ThriftBroker build a CellsSerialized result in place
+     * instead of copying it out of an intermediate buffer.
+     */
+    SerializedCellsWriter(std::string &str, int32_t size, bool grow = false)
+      :  m_buf(0, false), m_str(&str), m_finalized(false), m_grow(grow),
+         m_previous_row_offset(-1), m_previous_row_length(0) {
+      str.clear();
+      grow_string(size);
+    }
+
     bool add(Cell &cell) {
       return add(cell.row_key, cell.column_family, cell.column_qualifier,
                  cell.timestamp, cell.value, cell.value_len, cell.flag);
@@ -55,11 +72,12 @@ namespace Hypertable {
 			 uint8_t cell_flag = FLAG_INSERT);
 
     void finalize(uint8_t flag) {
-      if (m_grow)
-        m_buf.ensure(m_buf.empty() ? 5 : 1);
+      if (m_grow || m_str)
+        ensure(m_buf.empty() ? 5 : 1);
       if (m_buf.empty())
-        Serialization::encode_i32(&m_buf.ptr, SerializedCellsVersion::SCVERSION);
-      *m_buf.ptr++ = SerializedCellsFlag::EOB | flag;
+        put_i32(SerializedCellsVersion::SCVERSION);
+      put_byte(SerializedCellsFlag::EOB | flag);
+      sync_string();
       m_finalized = true;
     }
 
@@ -80,7 +98,55 @@ namespace Hypertable {
     void clear();
 
   private:
+    void ensure(size_t len) {
+      if (len > m_buf.remaining())
+        grow((m_buf.fill() + len) * 3 / 2);
+    }
+
+    void grow(size_t new_size);
+
+    /// Reserves string capacity and sets the buffer limit to
+    /// <code>new_size</code>
+    void grow_string(size_t new_size);
+
+    /// Points #m_buf at the string contents after appends
+    void sync_string() {
+      if (m_str) {
+        m_buf.base = m_buf.mark = (uint8_t *)&(*m_str)[0];
+        m_buf.ptr = m_buf.base + m_str->size();
+      }
+    }
+
+    void put(const void *data, size_t len) {
+      if (m_str)
+        m_str->append((const char *)data, len);
+      else
+        m_buf.add_unchecked(data, len);
+    }
+
+    void put_byte(uint8_t byte) {
+      if (m_str)
+        m_str->push_back((char)byte);
+      else
+        *m_buf.ptr++ = byte;
+    }
+
+    void put_i32(int32_t val) {
+      uint8_t tmp[4], *ptr = tmp;
+      Serialization::encode_i32(&ptr, val);
+      put(tmp, 4);
+    }
+
+    void put_i64(int64_t val) {
+      uint8_t tmp[8], *ptr = tmp;
+      Serialization::encode_i64(&ptr, val);
+      put(tmp, 8);
+    }
+
+    /// Output buffer; when writing to #m_str, it views the string contents
+    /// and its size is the limit up to which cells may be appended
     DynamicBuffer m_buf;
+    std::string *m_str {};
     bool m_finalized;
     bool m_grow;
     int  m_previous_row_offset;
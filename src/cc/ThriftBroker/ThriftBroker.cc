@@ -49,8 +49,10 @@
 #include <Common/System.h>
 #include <Common/Time.h>
 
+#include <concurrency/PosixThreadFactory.h>
 #include <concurrency/ThreadManager.h>
 #include <protocol/TBinaryProtocol.h>
+#include <server/TNonblockingServer.h>
 #include <server/TThreadedServer.h>
 #include <transport/TBufferTransports.h>
 #include <transport/TServerSocket.h>
@@ -232,7 +234,6 @@ inline bool operator < (const SharedMutatorMapKey &skey1,
 typedef Meta::list<ThriftBrokerPolicy, DefaultCommPolicy> Policies;
 
 typedef std::map<SharedMutatorMapKey, TableMutator * > SharedMutatorMap;
-typedef std::unordered_map< ::int64_t, ClientObjectPtr> ObjectMap;
 typedef std::vector<ThriftGen::Cell> ThriftCells;
 typedef std::vector<CellAsArray> ThriftCellsAsArrays;
 
@@ -608,12 +609,11 @@ int32_t convert_cells(Hypertable::Cells &hcells, CellsSerialized &tcells) {
         + strlen(hcells[ii].column_qualifier) + 8 + 8 + 4 + 1
         + hcells[ii].value_len + 4;
   }
-  SerializedCellsWriter writer(amount, true);
+  SerializedCellsWriter writer(tcells, amount, true);
   for (size_t ii = 0; ii < hcells.size(); ++ii) {
     writer.add(hcells[ii]);
   }
   writer.finalize(SerializedCellsFlag::EOS);
-  tcells = String((char *)writer.get_buffer(), writer.get_buffer_length());
   amount = tcells.size();
   return amount;
 }
@@ -888,6 +888,141 @@ public:
 };
 typedef std::shared_ptr<ScannerInfo> ScannerInfoPtr;
 
+/// Registry of client objects handed out to Thrift clients.
+/// Objects are spread by ID over a fixed number of shards, each protected by
+/// its own mutex, so that concurrent calls on different objects rarely
+/// contend.  The scanner information of a scanner is kept in the same entry
+/// as the scanner, so the two are looked up and removed together.
+class ObjectRegistry {
+public:
+
+  /// Registers an object.
+  /// @param id Object ID
+  /// @param object Object to register
+  /// @param info Scanner information (scanners only)
+  /// @return <i>false</i> if an object is already registered under
+  /// <code>id</code> (it is not replaced), <i>true</i> otherwise
+  bool insert(int64_t id, ClientObjectPtr object,
+              ScannerInfoPtr info = ScannerInfoPtr()) {
+    Shard &shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Entry &entry = shard.map[id];
+    if (entry.object)
+      return false;
+    entry.object = object;
+    entry.info = info;
+    return true;
+  }
+
+  /// Looks up an object.
+  /// @param id Object ID
+  /// @param info Address of pointer to hold scanner information, or nullptr
+  /// @return Object registered under <code>id</code>, or null if none
+  ClientObjectPtr get(int64_t id, ScannerInfoPtr *info = nullptr) {
+    Shard &shard = get_shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.map.find(id);
+    if (it == shard.map.end())
+      return ClientObjectPtr();
+    if (info)
+      *info = it->second.info;
+    return it->second.object;
+  }
+
+  /// Unregisters an object.
+  /// The object is released after the shard lock is dropped, unless it is
+  /// returned to the caller.
+  /// @param id Object ID
+  /// @param object Address of pointer to hold removed object, or nullptr
+  /// @param info Address of pointer to hold scanner information, or nullptr
+  /// @return <i>true</i> if an object was removed, <i>false</i> otherwise
+  bool remove(int64_t id, ClientObjectPtr *object = nullptr,
+              ScannerInfoPtr *info = nullptr) {
+    Entry entry;
+    {
+      Shard &shard = get_shard(id);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.map.find(id);
+      if (it == shard.map.end())
+        return false;
+      entry = it->second;
+      shard.map.erase(it);
+    }
+    if (object)
+      *object = entry.object;
+    if (info)
+      *info = entry.info;
+    return true;
+  }
+
+  /// Returns number of registered objects.
+  /// @return Number of registered objects
+  size_t size() {
+    size_t count = 0;
+    for (auto &shard : m_shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      count += shard.map.size();
+    }
+    return count;
+  }
+
+  /// Unregisters all objects.
+  /// Each object is destroyed individually and exceptions thrown by its
+  /// destructor are logged.
+  void clear() {
+    for (auto &shard : m_shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (auto &entry : shard.map) {
+        try {
+          entry.second.object = nullptr;
+        }
+        catch (Exception &e) {
+          HT_ERROR_OUT << e << HT_END;
+        }
+      }
+      try {
+        shard.map.clear();
+      }
+      catch (Exception &e) {
+      }
+    }
+  }
+
+private:
+
+  /// Registered object
+  struct Entry {
+    /// Client object
+    ClientObjectPtr object;
+    /// Scanner information (scanners only)
+    ScannerInfoPtr info;
+  };
+
+  /// Shard of the registry
+  struct Shard {
+    /// %Mutex protecting #map
+    std::mutex mutex;
+    /// Objects of this shard
+    std::unordered_map< ::int64_t, Entry> map;
+  };
+
+  /// Number of shards (power of two)
+  static const size_t SHARD_COUNT = 16;
+
+  /// Returns shard holding an object ID.
+  /// IDs are mostly object addresses, so they are hashed to spread the
+  /// aligned low bits.
+  /// @param id Object ID
+  /// @return Shard holding <code>id</code>
+  Shard &get_shard(int64_t id) {
+    uint64_t hash = (uint64_t)id * 0x9E3779B97F4A7C15ULL;
+    return m_shards[hash >> 60];
+  }
+
+  /// Shards
+  Shard m_shards[SHARD_COUNT];
+};
+
 class ServerHandler;
 
 template <class ResultT, class CellT>
@@ -958,10 +1093,10 @@ public:
 
   virtual ~ServerHandler() {
     std::lock_guard<std::mutex> lock(m_mutex);
-    if (!m_object_map.empty())
+    size_t object_count = m_objects.size();
+    if (object_count)
       HT_WARNF("Destroying ServerHandler for remote peer %s with %d objects in map",
-               m_remote_peer.c_str(),
-               (int)m_object_map.size());
+               m_remote_peer.c_str(), (int)object_count);
     // Clear reference map.  Force each object to be destroyed individually and
     // catch and log exceptions.
     for (auto entry : m_reference_map) {
@@ -977,36 +1112,10 @@ public:
     }
     catch (Exception &e) {
     }
-    // Clear object map.  Force each object to be destroyed individually and
-    // catch and log exceptions.
-    for (auto entry : m_object_map) {
-      try {
-        entry.second = nullptr;
-      }
-      catch (Exception &e) {
-        HT_ERROR_OUT << e << HT_END;
-      }
-    }
-    try {
-      m_object_map.clear();
-    }
-    catch (Exception &e) {
-    }
-    // Clear cached object map.  Force each object to be destroyed individually
-    // and catch and log exceptions.
-    for (auto entry : m_cached_object_map) {
-      try {
-        entry.second = nullptr;
-      }
-      catch (Exception &e) {
-        HT_ERROR_OUT << e << HT_END;
-      }
-    }
-    try {
-      m_cached_object_map.clear();
-    }
-    catch (Exception &e) {
-    }
+    // Clear object registries.  Each object is destroyed individually and
+    // exceptions are logged.
+    m_objects.clear();
+    m_cached_objects.clear();
   }
 
   const String& remote_peer() const {
@@ -1387,7 +1496,9 @@ public:
     LOG_API_START("scanner="<< scanner_id);
 
     try {
-      SerializedCellsWriter writer(m_context.next_threshold);
+      // Cells are serialized straight into the result to avoid copying
+      // the buffer once it's filled
+      SerializedCellsWriter writer(result, m_context.next_threshold);
       Hypertable::Cell cell;
 
       TableScanner *scanner = get_scanner(scanner_id, scanner_info);
@@ -1405,8 +1516,6 @@ public:
           break;
         }
       }
-
-      result = String((char *)writer.get_buffer(), writer.get_buffer_length());
     } RETHROW("scanner="<< scanner_id);
     LOG_API_FINISH_E("result.size="<< result.size());
   }
@@ -1450,7 +1559,7 @@ public:
     LOG_API_START("scanner="<< scanner_id);
 
     try {
-      SerializedCellsWriter writer(0, true);
+      SerializedCellsWriter writer(result, 0, true);
       Hypertable::Cell cell;
       std::string prev_row;
 
@@ -1478,8 +1587,6 @@ public:
           break;
         }
       }
-
-      result = String((char *)writer.get_buffer(), writer.get_buffer_length());
     } RETHROW("scanner="<< scanner_id)
     LOG_API_FINISH_E(" result.size="<< result.size());
   }
@@ -1531,7 +1638,7 @@ public:
     LOG_API_START("namespace=" << ns << " table="<< table <<" row"<< row);
 
     try {
-      SerializedCellsWriter writer(0, true);
+      SerializedCellsWriter writer(result, 0, true);
       Hypertable::Namespace *namespace_ptr = get_namespace(ns);
       TablePtr t = namespace_ptr->open_table(table);
       Hypertable::ScanSpec ss;
@@ -1545,7 +1652,6 @@ public:
         writer.add(cell);
       writer.finalize(SerializedCellsFlag::EOS);
 
-      result = String((char *)writer.get_buffer(), writer.get_buffer_length());
       LOG_SLOW_QUERY_SCANNER(scanner, get_namespace(ns), table, ss);
     } RETHROW("namespace=" << ns << " table="<< table <<" row"<< row)
     LOG_API_FINISH_E(" result.size="<< result.size());
@@ -1620,7 +1726,7 @@ public:
     try {
       Hypertable::ScanSpec hss;
       convert_scan_spec(ss, hss);
-      SerializedCellsWriter writer(0, true);
+      SerializedCellsWriter writer(result, 0, true);
       TableScannerPtr scanner(_open_scanner(ns, table, hss));
       Hypertable::Cell cell;
 
@@ -1628,7 +1734,6 @@ public:
         writer.add(cell);
       writer.finalize(SerializedCellsFlag::EOS);
 
-      result = String((char *)writer.get_buffer(), writer.get_buffer_length());
       LOG_SLOW_QUERY_SCANNER(scanner, get_namespace(ns), table, hss);
     } RETHROW("namespace=" << ns << " table="<< table <<" scan_spec="<< ss)
     LOG_API_FINISH_E(" result.size="<< result.size());
@@ -2719,15 +2824,11 @@ public:
   }
 
   ClientObject *get_object(int64_t id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    ObjectMap::iterator it = m_object_map.find(id);
-    return (it != m_object_map.end()) ? it->second.get() : 0;
+    return m_objects.get(id).get();
   }
 
   ClientObject *get_cached_object(int64_t id) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    ObjectMap::iterator it = m_cached_object_map.find(id);
-    return (it != m_cached_object_map.end()) ? it->second.get() : 0;
+    return m_cached_objects.get(id).get();
   }
 
   Hypertable::Future *get_future(int64_t id) {
@@ -2753,52 +2854,45 @@ public:
 
   int64_t get_cached_object_id(ClientObjectPtr co) {
     int64_t id;
-    std::lock_guard<std::mutex> lock(m_mutex);
-    while (!m_cached_object_map.insert(make_pair(id = Random::number32(), co)).second || id == 0); // no overwrite
+    while ((id = Random::number32()) == 0 || !m_cached_objects.insert(id, co)); // no overwrite
     return id;
   }
 
   int64_t get_object_id(ClientObject *co) {
-    std::lock_guard<std::mutex> lock(m_mutex);
     int64_t id = reinterpret_cast<int64_t>(co);
-    m_object_map.insert(make_pair(id, ClientObjectPtr(co))); // no overwrite
+    m_objects.insert(id, ClientObjectPtr(co)); // no overwrite
     return id;
   }
 
   int64_t get_object_id(TableMutatorPtr &mutator) {
-    std::lock_guard<std::mutex> lock(m_mutex);
     int64_t id = reinterpret_cast<int64_t>(mutator.get());
-    m_object_map.insert(make_pair(id, static_pointer_cast<ClientObject>(mutator))); // no overwrite
+    m_objects.insert(id, static_pointer_cast<ClientObject>(mutator)); // no overwrite
     return id;
   }
 
   int64_t try_get_object_id(ClientObject* co) {
-    std::lock_guard<std::mutex> lock(m_mutex);
     int64_t id = reinterpret_cast<int64_t>(co);
-    return m_object_map.find(id) != m_object_map.end() ? id : 0;
+    return m_objects.get(id) ? id : 0;
   }
 
   int64_t get_scanner_id(TableScanner *scanner, ScannerInfoPtr &info) {
-    std::lock_guard<std::mutex> lock(m_mutex);
     int64_t id = reinterpret_cast<int64_t>(scanner);
-    m_object_map.insert(make_pair(id, ClientObjectPtr(scanner)));
-    m_scanner_info_map.insert(make_pair(id, info));
+    m_objects.insert(id, ClientObjectPtr(scanner), info);
     return id;
   }
 
   int64_t get_scanner_id(TableScannerPtr &scanner, ScannerInfoPtr &info) {
-    std::lock_guard<std::mutex> lock(m_mutex);
     int64_t id = reinterpret_cast<int64_t>(scanner.get());
-    m_object_map.insert(make_pair(id, static_pointer_cast<ClientObject>(scanner)));
-    m_scanner_info_map.insert(make_pair(id, info));
+    m_objects.insert(id, static_pointer_cast<ClientObject>(scanner), info);
     return id;
   }
 
   void add_reference(int64_t from, int64_t to) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    ObjectMap::iterator it = m_object_map.find(to);
-    if (it != m_object_map.end())
-      m_reference_map.insert(make_pair(from, it->second));
+    ClientObjectPtr object = m_objects.get(to);
+    if (object) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_reference_map.insert(make_pair(from, object));
+    }
   }
 
   void remove_references(int64_t id) {
@@ -2818,86 +2912,39 @@ public:
   }
 
   TableScanner *get_scanner(int64_t id, ScannerInfoPtr &info) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    TableScanner *scanner {};
-    auto it = m_object_map.find(id);
-    if (it == m_object_map.end() ||
-        (scanner = dynamic_cast<TableScanner *>(it->second.get())) == nullptr) {
+    ClientObjectPtr object = m_objects.get(id, &info);
+    TableScanner *scanner = dynamic_cast<TableScanner *>(object.get());
+    if (scanner == nullptr) {
       HT_ERROR_OUT << "Bad scanner id - " << id << HT_END;
       THROW_TE(Error::THRIFTBROKER_BAD_SCANNER_ID,
                format("Invalid scanner id: %lld", (Lld)id));
     }
-    auto sit = m_scanner_info_map.find(id);
-    HT_ASSERT(sit != m_scanner_info_map.end());
-    info = sit->second;
+    HT_ASSERT(info);
     return scanner;
   }
 
   bool remove_object(int64_t id) {
-    // destroy client object unlocked
-    bool removed = false;
-    ClientObjectPtr item;
-    {
-      std::lock_guard<std::mutex> lock(m_mutex);
-      ObjectMap::iterator it = m_object_map.find(id);
-      if (it != m_object_map.end()) {
-        item = (*it).second;
-        m_object_map.erase(it);
-        removed = true;
-      }
-    }
-    return removed;
+    return m_objects.remove(id);
   }
 
   bool remove_cached_object(int64_t id) {
-    // destroy client object unlocked
-    bool removed = false;
-    ClientObjectPtr item;
-    {
-      std::lock_guard<std::mutex> lock(m_mutex);
-      ObjectMap::iterator it = m_cached_object_map.find(id);
-      if (it != m_cached_object_map.end()) {
-        item = (*it).second;
-        m_cached_object_map.erase(it);
-        removed = true;
-      }
-    }
-    return removed;
+    return m_cached_objects.remove(id);
   }
 
   void remove_scanner(int64_t id) {
-    // destroy client object unlocked
-    ClientObjectPtr item;
-    {
-      std::lock_guard<std::mutex> lock(m_mutex);
-      m_scanner_info_map.erase(id);
-      ObjectMap::iterator it = m_object_map.find(id);
-      if (it != m_object_map.end()) {
-        item = (*it).second;
-        m_object_map.erase(it);
-      }
-      else {
-        HT_ERROR_OUT << "Bad scanner id - " << id << HT_END;
-        THROW_TE(Error::THRIFTBROKER_BAD_SCANNER_ID,
-                 format("Invalid scanner id: %lld", (Lld)id));
-      }
+    if (!m_objects.remove(id)) {
+      HT_ERROR_OUT << "Bad scanner id - " << id << HT_END;
+      THROW_TE(Error::THRIFTBROKER_BAD_SCANNER_ID,
+               format("Invalid scanner id: %lld", (Lld)id));
     }
   }
 
   void remove_scanner(int64_t id, ClientObjectPtr &scanner, ScannerInfoPtr &info) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    ObjectMap::iterator it = m_object_map.find(id);
-    if (it != m_object_map.end()) {
-      scanner = (*it).second;
-      m_object_map.erase(it);
-    }
-    else {
+    if (!m_objects.remove(id, &scanner, &info)) {
       HT_ERROR_OUT << "Bad scanner id - " << id << HT_END;
       THROW_TE(Error::THRIFTBROKER_BAD_SCANNER_ID,
                format("Invalid scanner id: %lld", (Lld)id));
     }
-    info = m_scanner_info_map[id];
-    m_scanner_info_map.erase(id);
   }
 
   void shared_mutator_refresh(const ThriftGen::Namespace ns,
@@ -3004,9 +3051,8 @@ private:
   Context &m_context;
   std::mutex m_mutex;
   multimap<::int64_t, ClientObjectPtr> m_reference_map;
-  ObjectMap m_object_map;
-  ObjectMap m_cached_object_map;
-  std::unordered_map< ::int64_t, ScannerInfoPtr> m_scanner_info_map;
+  ObjectRegistry m_objects;
+  ObjectRegistry m_cached_objects;
 };
 
 template <class ResultT, class CellT>
@@ -3168,23 +3214,50 @@ int main(int argc, char **argv) {
     boost::shared_ptr<HqlServiceIfFactory> hql_service_factory(new ThriftBrokerIfFactory());
     boost::shared_ptr<TProcessorFactory> hql_service_processor_factory(new HqlServiceProcessorFactory(hql_service_factory));
 
-    boost::shared_ptr<TServerTransport> serverTransport;
-
-    if (has("thrift-timeout")) {
-      int timeout_ms = get_i32("thrift-timeout");
-      serverTransport.reset( new TServerSocket(port, timeout_ms, timeout_ms) );
+    boost::shared_ptr<TServer> server;
+    String server_type = get_str("ThriftBroker.Server");
+
+    if (!strcasecmp(server_type.c_str(), "nonblocking")) {
+      // Connections are multiplexed over a few libevent I/O threads and
+      // calls are executed by a fixed pool of worker threads.  Clients must
+      // use framed transport, as with the threaded server.
+      int workers = get_i32("workers");
+      int io_threads = get_i32("ThriftBroker.IOThreads");
+      boost::shared_ptr<ThreadManager> thread_manager =
+        ThreadManager::newSimpleThreadManager(workers);
+      thread_manager->threadFactory(
+        boost::shared_ptr<PosixThreadFactory>(new PosixThreadFactory()));
+      thread_manager->start();
+      TNonblockingServer *nonblocking_server =
+        new TNonblockingServer(hql_service_processor_factory, protocolFactory,
+                               port, thread_manager);
+      nonblocking_server->setNumIOThreads(io_threads);
+      server.reset(nonblocking_server);
+      HT_INFOF("Starting the nonblocking server with %d I/O threads and %d "
+               "workers...", io_threads, workers);
     }
-    else
-      serverTransport.reset( new TServerSocket(port) );
+    else if (!strcasecmp(server_type.c_str(), "threaded")) {
+      boost::shared_ptr<TServerTransport> serverTransport;
 
-    boost::shared_ptr<TTransportFactory> transportFactory(new TFramedTransportFactory());
+      if (has("thrift-timeout")) {
+        int timeout_ms = get_i32("thrift-timeout");
+        serverTransport.reset( new TServerSocket(port, timeout_ms, timeout_ms) );
+      }
+      else
+        serverTransport.reset( new TServerSocket(port) );
 
-    TThreadedServer server(hql_service_processor_factory, serverTransport,
-                           transportFactory, protocolFactory);
+      boost::shared_ptr<TTransportFactory> transportFactory(new TFramedTransportFactory());
 
-    HT_INFO("Starting the server...");
+      server.reset(new TThreadedServer(hql_service_processor_factory,
+                                       serverTransport, transportFactory,
+                                       protocolFactory));
+      HT_INFO("Starting the server...");
+    }
+    else
+      HT_THROWF(Error::CONFIG_BAD_VALUE, "Invalid ThriftBroker.Server value "
+                "'%s' (expected threaded or nonblocking)", server_type.c_str());
 
-    server.serve();
+    server->serve();
 
     g_metrics_handler->start_collecting();
     g_metrics_handler.reset();
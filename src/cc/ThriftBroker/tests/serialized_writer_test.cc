@@ -0,0 +1,135 @@
+/** -*- C++ -*-
+ * Copyright (C) 2007-2016 Hypertable, Inc.
+ *
+ * This file is part of Hypertable.
+ *
+ * Hypertable is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or any later version.
+ *
+ * Hypertable is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Hypertable. If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "Common/Compat.h"
+#include "Common/Logger.h"
+
+#include "ThriftBroker/SerializedCellsReader.h"
+#include "ThriftBroker/SerializedCellsWriter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace Hypertable;
+
+/**
+ * Round-trips cells through a SerializedCellsWriter that writes into a
+ * std::string, as the ThriftBroker does for serialized scan results, and
+ * checks that the result is identical to what a buffer-backed writer
+ * produces.  Does not require a running ThriftBroker.
+ */
+
+namespace {
+
+  const int CELL_COUNT = 100;
+
+  std::string big_value(5000, 'x');
+
+  void make_row(int i, char *row) {
+    // three cells per row, so repeated rows are elided
+    sprintf(row, "row%03d", i / 3);
+  }
+
+  const char *value_of(int i) {
+    return i == 0 ? big_value.c_str() : "val";
+  }
+
+  int32_t value_length_of(int i) {
+    return i == 0 ? (int32_t)big_value.size() : 3;
+  }
+
+  int add_cells(SerializedCellsWriter &writer, int count) {
+    char row[32];
+    int added = 0;
+    for (int i = 0; i < count; i++) {
+      make_row(i, row);
+      if (!writer.add(row, "cf", i % 2 ? "q" : 0, 1000 + i,
+                      (const void *)value_of(i), value_length_of(i)))
+        break;
+      added++;
+    }
+    return added;
+  }
+
+  void check_cells(const std::string &str, int count) {
+    SerializedCellsReader reader((void *)str.data(), str.size());
+    char row[32];
+    int i = 0;
+    while (reader.next()) {
+      make_row(i, row);
+      HT_ASSERT(!strcmp(reader.row(), row));
+      HT_ASSERT(!strcmp(reader.column_family(), "cf"));
+      HT_ASSERT(!strcmp(reader.column_qualifier(), i % 2 ? "q" : ""));
+      HT_ASSERT(reader.timestamp() == 1000 + i);
+      HT_ASSERT((int32_t)reader.value_len() == value_length_of(i));
+      HT_ASSERT(!memcmp(reader.value(), value_of(i), value_length_of(i)));
+      i++;
+    }
+    HT_ASSERT(reader.eos());
+    HT_ASSERT(i == count);
+  }
+
+  void test_string_writer(bool grow, int32_t size, int expected_count) {
+    std::string str("left over from previous call");
+    SerializedCellsWriter writer(str, size, grow);
+    HT_ASSERT(writer.empty());
+
+    int count = add_cells(writer, CELL_COUNT);
+    HT_ASSERT(count == expected_count);
+    writer.finalize(SerializedCellsFlag::EOS);
+
+    const uint8_t *ptr;
+    int32_t len;
+    writer.get_buffer(&ptr, &len);
+    HT_ASSERT(ptr == (const uint8_t *)str.data());
+    HT_ASSERT(len == (int32_t)str.size());
+    check_cells(str, count);
+
+    SerializedCellsWriter buffer_writer(0, true);
+    HT_ASSERT(add_cells(buffer_writer, count) == count);
+    buffer_writer.finalize(SerializedCellsFlag::EOS);
+    HT_ASSERT(buffer_writer.get_buffer_length() == len);
+    HT_ASSERT(!memcmp(buffer_writer.get_buffer(), ptr, len));
+
+    // the writer is reusable after clear()
+    writer.clear();
+    HT_ASSERT(writer.empty());
+    HT_ASSERT(str.empty());
+    HT_ASSERT(add_cells(writer, count) == count);
+    writer.finalize(SerializedCellsFlag::EOS);
+    check_cells(str, count);
+  }
+
+}
+
+int main() {
+  // grows as needed
+  test_string_writer(true, 0, CELL_COUNT);
+
+  // first cell is taken even if larger than the buffer, and no more
+  test_string_writer(false, 256, 1);
+
+  // buffer fills up part way through
+  test_string_writer(false, 5200, 7);
+
+  std::cout << "SUCCESS" << std::endl;
+  return 0;
+}
@@ -741,6 +741,138 @@ def metric_init(params):
              'groups': 'hypertable RangeServer'}
         descriptors.append(d);
         
+        d = {'name': 'ht.rangeserver.blockCache.shardHitRate.min',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'uint',
+             'units': '%',
+             'slope': 'both',
+             'format': '%u',
+             'description': 'Lowest block cache shard hit rate',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.blockCache.shardHitRate.max',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'uint',
+             'units': '%',
+             'slope': 'both',
+             'format': '%u',
+             'description': 'Highest block cache shard hit rate',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.blockCache.rejections',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': '/s',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Blocks refused by block cache',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.io.foreground.readLatency',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'ms',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Average foreground filesystem read latency',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.io.background.throughput',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'MB/s',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Maintenance filesystem reads and appends',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.io.background.rate',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'MB/s',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Maintenance I/O rate limit (0 if unlimited)',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.io.background.throttled',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 's/s',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Time maintenance I/O spent waiting on the rate limit',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.commit.syncs',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'syncs/s',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Commit log syncs per second',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.commit.batchSize.p50',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'KB',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Median update data covered by a commit log sync',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.commit.batchSize.p99',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'KB',
+             'slope': 'both',
+             'format': '%f',
+             'description': '99th percentile update data covered by a commit log sync',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.commit.syncLatency.p50',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'ms',
+             'slope': 'both',
+             'format': '%f',
+             'description': 'Median commit log sync latency',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
+        d = {'name': 'ht.rangeserver.commit.syncLatency.p99',
+             'call_back': metric_callback,
+             'time_max': 90,
+             'value_type': 'float',
+             'units': 'ms',
+             'slope': 'both',
+             'format': '%f',
+             'description': '99th percentile commit log sync latency',
+             'groups': 'hypertable RangeServer'}
+        descriptors.append(d);
+        
         d = {'name': 'ht.rangeserver.queryCache.hitRate',
              'call_back': metric_callback,
              'time_max': 90,
@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+
+HT_HOME=${INSTALL_DIR:-"$HOME/hypertable/current"}
+SCRIPT_DIR=`dirname $0`
+NUM_ROWS=${NUM_ROWS:-"4000"}
+
+. $HT_HOME/bin/ht-env.sh
+
+$HT_HOME/bin/ht start-test-servers --clear --no-thriftbroker \
+    --Hypertable.RangeServer.Range.SplitSize=100K \
+    --Hypertable.RangeServer.Maintenance.Interval=100
+
+echo "use '/'; drop table if exists BulkLoad; CREATE TABLE BulkLoad (a, b, ACCESS GROUP ag1 (b));" | $HT_HOME/bin/ht shell --batch
+
+# Even rows are inserted normally, so the table has split into several
+# ranges with cached and stored data by the time odd rows are bulk loaded
+VALUE=`printf '%0200d' 0`
+echo "#row	column	value" > insert.tsv
+echo "#row	column	value" > bulk.tsv
+for ((i=0; i<$NUM_ROWS; i+=2)); do
+  printf "row%06d\ta\t%s\n" $i $VALUE >> insert.tsv
+  printf "row%06d\ta\tbulk\nrow%06d\tb\tbulk\n" $((i+1)) $((i+1)) >> bulk.tsv
+done
+
+echo "use '/'; load data infile 'insert.tsv' into table BulkLoad;" | $HT_HOME/bin/ht shell --batch
+sleep 5
+
+$HT_HOME/bin/ht bulk_load BulkLoad bulk.tsv
+if [ $? -ne 0 ]; then
+  echo "error: ht_bulk_load failed"
+  $HT_HOME/bin/ht stop-servers
+  exit 1
+fi
+
+# Updates after the link must be newer than the linked CellStores, or commit
+# log replay would skip them after the restart below
+echo "use '/'; insert into BulkLoad values ('row000001', 'a', 'updated');" | $HT_HOME/bin/ht shell --batch
+
+$HT_HOME/bin/ht stop-servers
+$HT_HOME/bin/ht start-test-servers --no-thriftbroker
+
+echo "use '/'; select * from BulkLoad MAX_VERSIONS 1;" | $HT_HOME/bin/ht shell --batch | sort > dump.output
+$HT_HOME/bin/ht stop-servers
+
+cat insert.tsv bulk.tsv | grep -v '^#' | \
+  sed 's/^row000001\ta\tbulk$/row000001\ta\tupdated/' | sort > dump.golden
+
+diff dump.output dump.golden
+if [ $? -ne 0 ]; then
+  echo "error: table contents differ from what was loaded"
+  exit 1
+fi
+
+if [ -n "`find $HT_HOME/fs/local/hypertable/tmp/bulk_load -type f 2>/dev/null`" ]; then
+  echo "error: staged CellStores left behind"
+  exit 1
+fi
+
+exit 0
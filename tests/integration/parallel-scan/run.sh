@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+
+HT_HOME=${INSTALL_DIR:-"$HOME/hypertable/current"}
+SCRIPT_DIR=`dirname $0`
+NUM_ROWS=${NUM_ROWS:-"4000"}
+
+. $HT_HOME/bin/ht-env.sh
+
+$HT_HOME/bin/ht start-test-servers --clear --no-thriftbroker \
+    --Hypertable.RangeServer.Range.SplitSize=100K \
+    --Hypertable.RangeServer.Maintenance.Interval=100
+
+echo "use '/'; drop table if exists ParallelScan; CREATE TABLE ParallelScan (a, b);" | $HT_HOME/bin/ht shell --batch
+
+# Large enough values that the table splits into several ranges
+VALUE=`printf '%0200d' 0`
+echo "#row	column	value" > parallel-scan.tsv
+for ((i=0; i<$NUM_ROWS; i++)); do
+  printf "row%06d\ta\t%s\nrow%06d\tb\t%d\n" $i $VALUE $i $i >> parallel-scan.tsv
+done
+
+echo "use '/'; load data infile 'parallel-scan.tsv' into table ParallelScan;" | $HT_HOME/bin/ht shell --batch
+sleep 5
+
+cd ${TEST_BIN_DIR}
+./parallel_scan_test ParallelScan
+status=$?
+
+$HT_HOME/bin/ht stop-servers
+
+if [ $status -ne 0 ]; then
+  echo "error: parallel_scan_test failed"
+  exit 1
+fi
+
+exit 0